@@ -0,0 +1,136 @@
+import 'dart:async';
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+
+import '../../workspace_sandbox.dart';
+import '../util/glob.dart';
+
+/// Reruns a command whenever matching files in a workspace change.
+///
+/// Backs [Workspace.watch]. The workspace root is watched recursively
+/// (inotify on Linux, FSEvents on macOS, ReadDirectoryChangesW on Windows)
+/// from the moment [results] is listened to until the subscription is
+/// cancelled.
+///
+/// Changes are debounced: a burst of writes triggers one run once no
+/// matching change arrived for the debounce interval. A change during a
+/// run kills it; its result is dropped and a fresh run follows, so every
+/// emitted result reflects the files as they were when it started.
+class CommandWatcher {
+  final Workspace _workspace;
+  final Object _command;
+  final WorkspaceOptions? _options;
+  final List<RegExp> _patterns;
+  final Duration _debounce;
+  final bool _runImmediately;
+
+  late final _results = StreamController<CommandResult>(
+      onListen: _start, onCancel: _stop);
+  StreamSubscription<FileSystemEvent>? _watch;
+  Timer? _timer;
+  WorkspaceProcess? _running;
+  Future<void>? _current;
+  int _generation = 0;
+  bool _stopped = false;
+
+  /// Creates a watcher; nothing runs until [results] is listened to.
+  ///
+  /// [paths] are globs relative to the workspace root (see
+  /// [globToRegExp]); by default every file outside hidden directories.
+  CommandWatcher(this._workspace, this._command,
+      {List<String>? paths,
+      Duration debounce = const Duration(milliseconds: 200),
+      bool runImmediately = true,
+      WorkspaceOptions? options})
+      : _patterns = [
+          for (final glob in paths ?? const ['**']) globToRegExp(glob)
+        ],
+        _debounce = debounce,
+        _runImmediately = runImmediately,
+        _options = options;
+
+  /// Results of completed runs. Spawn failures are emitted as errors and
+  /// watching continues.
+  Stream<CommandResult> get results => _results.stream;
+
+  void _start() {
+    _watch = Directory(_workspace.rootPath)
+        .watch(recursive: true)
+        .listen(_onChange, onError: _results.addError);
+    if (_runImmediately) _schedule(Duration.zero);
+  }
+
+  Future<void> _stop() async {
+    _stopped = true;
+    _timer?.cancel();
+    _running?.kill();
+    await _watch?.cancel();
+  }
+
+  void _onChange(FileSystemEvent event) {
+    final touched = event is FileSystemMoveEvent
+        ? [event.path, if (event.destination != null) event.destination!]
+        : [event.path];
+    if (!touched.any(_matches)) return;
+    _generation++;
+    _running?.kill();
+    _schedule(_debounce);
+  }
+
+  bool _matches(String path) {
+    final relative = p.relative(path, from: _workspace.rootPath);
+    final posix = p.split(relative).join('/');
+    return _patterns.any((pattern) => pattern.hasMatch(posix));
+  }
+
+  void _schedule(Duration delay) {
+    _timer?.cancel();
+    _timer = Timer(delay, _run);
+  }
+
+  Future<void> _run() async {
+    final generation = _generation;
+    // Let a killed run exit before starting over.
+    await _current;
+    if (_stopped || generation != _generation) return;
+
+    final done = Completer<void>();
+    _current = done.future;
+    try {
+      final stopwatch = Stopwatch()..start();
+      final process =
+          await _workspace.execStream(_command, options: _options);
+      _running = process;
+      if (_stopped || generation != _generation) process.kill();
+      final result = await _collect(process, stopwatch);
+      if (!_stopped && generation == _generation) _results.add(result);
+    } catch (e, st) {
+      if (!_stopped) _results.addError(e, st);
+    } finally {
+      _running = null;
+      done.complete();
+    }
+  }
+
+  static Future<CommandResult> _collect(
+      WorkspaceProcess process, Stopwatch stopwatch) async {
+    final stdout = StringBuffer();
+    final stderr = StringBuffer();
+    await Future.wait([
+      process.stdout.forEach(stdout.write),
+      process.stderr.forEach(stderr.write),
+    ]);
+    final code = await process.exitCode;
+    return CommandResult(
+      exitCode: code,
+      stdout: stdout.toString(),
+      stderr: stderr.toString(),
+      duration: stopwatch.elapsed,
+      isCancelled: process.isCancelled,
+      terminationReason: process.terminationReason,
+      fileAccess: await process.fileAccess,
+      outputStats: await process.outputStats,
+    );
+  }
+}
@@ -0,0 +1,158 @@
+import 'dart:io';
+
+import '../models/process_priority.dart';
+
+/// CPUs this process may use and how they split into NUMA nodes, read
+/// from `/proc` and `/sys` (Linux only).
+class CpuTopology {
+  /// CPUs in this process's affinity mask, ascending.
+  final List<int> allowed;
+
+  /// CPUs per NUMA node, restricted to [allowed]; a single node when the
+  /// kernel reports none.
+  final List<List<int>> nodes;
+
+  /// Creates a topology.
+  const CpuTopology(this.allowed, this.nodes);
+
+  /// Reads the topology of the running host.
+  factory CpuTopology.read() {
+    final allowed = _allowedCpus() ??
+        List.generate(Platform.numberOfProcessors, (i) => i);
+    final nodes = <List<int>>[];
+    try {
+      final dirs = Directory('/sys/devices/system/node')
+          .listSync()
+          .where((e) => RegExp(r'/node\d+$').hasMatch(e.path))
+          .toList()
+        ..sort((a, b) => _nodeNumber(a.path).compareTo(_nodeNumber(b.path)));
+      for (final dir in dirs) {
+        final cpus = parseList(File('${dir.path}/cpulist').readAsStringSync())
+            .where(allowed.contains)
+            .toList();
+        if (cpus.isNotEmpty) nodes.add(cpus);
+      }
+    } on FileSystemException {
+      // No NUMA information: one node.
+    }
+    return CpuTopology(allowed, nodes.isEmpty ? [allowed] : nodes);
+  }
+
+  static int _nodeNumber(String path) =>
+      int.parse(path.substring(path.lastIndexOf('node') + 4));
+
+  static List<int>? _allowedCpus() {
+    try {
+      for (final line in File('/proc/self/status').readAsLinesSync()) {
+        if (line.startsWith('Cpus_allowed_list:')) {
+          return parseList(line.substring(line.indexOf(':') + 1));
+        }
+      }
+    } on FileSystemException {
+      // Not Linux.
+    }
+    return null;
+  }
+
+  /// Parses a kernel CPU list such as `0-3,8,10-11`.
+  static List<int> parseList(String list) => [
+        for (final part in list.trim().split(','))
+          if (part.isNotEmpty)
+            if (part.split('-') case [final first, final last])
+              for (var cpu = int.parse(first); cpu <= int.parse(last); cpu++)
+                cpu
+            else
+              int.parse(part),
+      ];
+
+  /// Formats [cpus] as a kernel CPU list, collapsing runs into ranges.
+  static String formatList(List<int> cpus) {
+    final parts = <String>[];
+    for (var i = 0; i < cpus.length;) {
+      var j = i;
+      while (j + 1 < cpus.length && cpus[j + 1] == cpus[j] + 1) {
+        j++;
+      }
+      parts.add(i == j ? '${cpus[i]}' : '${cpus[i]}-${cpus[j]}');
+      i = j + 1;
+    }
+    return parts.join(',');
+  }
+}
+
+/// Assigns workspaces to CPU groups for [CpuSet.spread].
+///
+/// Each workspace is pinned to the group with the fewest workspaces the
+/// first time it runs a command with a given spread, and keeps that group
+/// until [release]. Balancing covers the workspaces of this isolate;
+/// `WorkspaceManager` resolves spreads on its own isolate for that reason.
+class CpuAllocator {
+  static CpuAllocator? _shared;
+
+  /// The allocator of this isolate, reading the host topology on first
+  /// use.
+  static CpuAllocator get shared =>
+      _shared ??= CpuAllocator(CpuTopology.read());
+
+  /// The topology groups are cut from.
+  final CpuTopology topology;
+
+  /// Workspaces per group, keyed by the spread's group layout.
+  final _loads = <String, List<int>>{};
+
+  /// Group index per layout, for each workspace.
+  final _assigned = <String, Map<String, int>>{};
+
+  /// Creates an allocator over [topology].
+  CpuAllocator(this.topology);
+
+  /// The CPUs workspace [owner] runs on under [spread].
+  ///
+  /// Throws [ArgumentError] when [CpuSet.exclude] leaves no CPU.
+  List<int> assign(String owner, CpuSet spread) {
+    final groups = this.groups(spread);
+    final layout = groups.map(CpuTopology.formatList).join('|');
+    final loads =
+        _loads.putIfAbsent(layout, () => List.filled(groups.length, 0));
+    final assigned = _assigned.putIfAbsent(owner, () => {});
+    final index = assigned.putIfAbsent(layout, () {
+      var best = 0;
+      for (var i = 1; i < loads.length; i++) {
+        if (loads[i] < loads[best]) best = i;
+      }
+      loads[best]++;
+      return best;
+    });
+    return groups[index];
+  }
+
+  /// Frees the groups of [owner].
+  void release(String owner) {
+    final assigned = _assigned.remove(owner);
+    if (assigned == null) return;
+    assigned.forEach((layout, index) => _loads[layout]![index]--);
+  }
+
+  /// The groups [spread] divides the allowed CPUs into.
+  List<List<int>> groups(CpuSet spread) {
+    final nodes = spread.byNumaNode ? topology.nodes : [topology.allowed];
+    final bases = [
+      for (final node in nodes)
+        [
+          for (final cpu in node)
+            if (!spread.exclude.contains(cpu)) cpu
+        ],
+    ].where((cpus) => cpus.isNotEmpty).toList();
+    if (bases.isEmpty) {
+      throw ArgumentError.value(spread.exclude.toList(), 'exclude',
+          'Leaves none of CPUs ${CpuTopology.formatList(topology.allowed)}');
+    }
+    final width = spread.width;
+    if (width == null) return bases;
+    return [
+      for (final cpus in bases)
+        for (var i = 0; i < cpus.length; i += width)
+          cpus.sublist(i, i + width < cpus.length ? i + width : cpus.length),
+    ];
+  }
+}
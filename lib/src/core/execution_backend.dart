@@ -0,0 +1,29 @@
+import '../models/workspace_options.dart';
+import '../models/workspace_process.dart';
+
+/// Runs the commands of one workspace.
+///
+/// Every `exec` and `execStream` of a workspace goes through its backend.
+/// The default, [LauncherService], starts the native launcher on this
+/// host; `RemoteLauncher.backendFor` returns backends that send commands
+/// to a launcher daemon over a socket.
+///
+/// Implementations receive fully merged options with output redirects
+/// already resolved to absolute paths.
+abstract class ExecutionBackend {
+  /// Runs [commandLine] through the platform shell of the executing host.
+  Future<WorkspaceProcess> spawnShell(
+      String commandLine, WorkspaceOptions options);
+
+  /// Runs [executable] with [args] without shell interpretation.
+  Future<WorkspaceProcess> spawnExec(
+      String executable, List<String> args, WorkspaceOptions options);
+
+  /// Releases resources held for the workspace. Called by
+  /// `Workspace.dispose`; running processes are not affected.
+  Future<void> dispose();
+}
+
+/// Creates the backend of a workspace rooted at [rootPath].
+typedef ExecutionBackendFactory = ExecutionBackend Function(
+    String rootPath, String id);
@@ -1,8 +1,13 @@
 import 'dart:io';
 import 'package:path/path.dart' as p;
+import '../models/process_priority.dart';
 import '../models/workspace_options.dart';
 import '../models/workspace_process.dart';
+import '../native/in_process_launcher.dart';
 import '../native/native_process_impl.dart';
+import 'cpu_allocator.dart';
+import 'execution_backend.dart';
+import 'netns_pool.dart';
 import 'shell_wrapper.dart';
 
 /// Service responsible for spawning processes via the native launcher binary.
@@ -10,17 +15,26 @@ import 'shell_wrapper.dart';
 /// This service acts as a bridge between Dart and the Rust-based native
 /// launcher, handling argument serialization and process lifecycle management.
 ///
+/// When [InProcessLauncher] is enabled, the same launcher code runs as a
+/// shared library inside the Dart process instead.
+///
 /// The launcher binary provides cross-platform sandboxing using:
 /// - **Linux**: Bubblewrap (bwrap)
 /// - **Windows**: Job Objects
 /// - **macOS**: Seatbelt (sandbox-exec)
-class LauncherService {
+///
+/// This is the default [ExecutionBackend] of every workspace.
+class LauncherService implements ExecutionBackend {
   /// Root directory path of the workspace.
   final String rootPath;
 
   /// Unique identifier for this workspace instance.
   final String id;
 
+  /// Numbers the side files (traces, output stats, samples, termination
+  /// reasons) of this service's commands.
+  int _sideFiles = 0;
+
   /// Creates a new launcher service for the given workspace.
   ///
   /// Parameters:
@@ -43,6 +57,7 @@ class LauncherService {
   ///   WorkspaceOptions(),
   /// );
   /// ```
+  @override
   Future<WorkspaceProcess> spawnShell(
       String commandLine, WorkspaceOptions options) async {
     final shellArgs = ShellWrapper.wrap(commandLine);
@@ -65,25 +80,107 @@ class LauncherService {
   ///   WorkspaceOptions(),
   /// );
   /// ```
+  @override
   Future<WorkspaceProcess> spawnExec(
       String executable, List<String> args, WorkspaceOptions options) async {
     final flatArgs = [executable, ...args];
     return _spawnInternal(flatArgs, options);
   }
 
+  /// Returns this workspace's CPU group, if it was given one; each command
+  /// owns its launcher process.
+  @override
+  Future<void> dispose() async {
+    if (Platform.isLinux) CpuAllocator.shared.release(id);
+  }
+
   /// Internal method that spawns the native launcher with serialized arguments.
   Future<WorkspaceProcess> _spawnInternal(
       List<String> commandArgs, WorkspaceOptions options) async {
-    final launcherPath = await _findBinary();
-    final nativeArgs = _buildNativeArgs(options, commandArgs);
+    final traceFile = _traceFile(options);
+    final terminationFile =
+        _sideFile(options.idleTimeout != null && Platform.isLinux, 'exit');
+    // Both are handled by the launcher binary's supervision loop. With the
+    // in-process launcher enabled, it starts the binary itself: a `dart:io`
+    // child would let `dart:io` reap in-process children too.
+    final viaBinary = traceFile != null || terminationFile != null;
+    final inProcess = _inProcessLauncher();
+    final launcherPath =
+        inProcess == null || viaBinary ? await findBinary() : null;
+    final lease = _leaseNetworkNamespace(options);
+    final statsFile = _sideFile(options.outputFilter != null, 'stats');
+    final sampleFile = _sideFile(
+        options.sampleInterval != null && Platform.isLinux, 'samples');
+    final nativeArgs = _buildNativeArgs(options, commandArgs, lease,
+        traceFile, statsFile, sampleFile, terminationFile);
+
+    final Process process;
+    try {
+      process = inProcess != null
+          ? inProcess.start(viaBinary
+              ? _hostArgs([launcherPath!, ...nativeArgs])
+              : nativeArgs)
+          : await Process.start(
+              launcherPath!,
+              nativeArgs,
+              mode: ProcessStartMode.normal,
+            );
+    } catch (_) {
+      lease?.release();
+      rethrow;
+    }
+
+    final wrapped = NativeProcessImpl(process,
+        timeout: options.timeout,
+        traceFile: traceFile,
+        statsFile: statsFile,
+        sampleFile: sampleFile,
+        sampleInterval: options.sampleInterval,
+        terminationFile: terminationFile);
+    if (lease != null) wrapped.exitCode.whenComplete(lease.release);
+    return wrapped;
+  }
+
+  /// Launcher arguments running [command] without a sandbox in the
+  /// workspace; used to start the binary, which applies its own.
+  List<String> _hostArgs(List<String> command) =>
+      ['--id', id, '--workspace', rootPath, '--', ...command];
+
+  /// Returns the in-process launcher when enabled and safe to use.
+  ///
+  /// Namespace pool holders are `dart:io` processes whose exit handling
+  /// would reap in-process children, so the binary is used while they run.
+  InProcessLauncher? _inProcessLauncher() {
+    if (NetworkNamespacePool.shared != null) return null;
+    return InProcessLauncher.shared;
+  }
 
-    final process = await Process.start(
-      launcherPath,
-      nativeArgs,
-      mode: ProcessStartMode.normal,
-    );
+  /// Where the launcher should write the file-access trace, or `null` when
+  /// not tracing. Only the Linux launcher can trace.
+  String? _traceFile(WorkspaceOptions opts) =>
+      _sideFile(opts.traceFileAccess && Platform.isLinux, 'trace');
 
-    return NativeProcessImpl(process, timeout: options.timeout);
+  /// A fresh temp path for a JSON file the launcher writes on exit, or
+  /// `null` when [wanted] is false.
+  String? _sideFile(bool wanted, String kind) {
+    if (!wanted) return null;
+    return p.join(Directory.systemTemp.path,
+        'ws_${kind}_${id}_${pid}_${_sideFiles++}.json');
+  }
+
+  /// Leases a pooled network namespace for sandboxed no-network commands.
+  ///
+  /// Returns `null` when pooling is not active or no namespace is idle, in
+  /// which case the launcher creates a fresh namespace as usual. The
+  /// lightweight profile's Landlock sandbox cannot join a pooled namespace,
+  /// so it does not lease one and starve Bubblewrap execs of them.
+  NetnsLease? _leaseNetworkNamespace(WorkspaceOptions opts) {
+    if (!opts.sandbox ||
+        opts.allowNetwork ||
+        opts.sandboxProfile == SandboxProfile.lightweight) {
+      return null;
+    }
+    return NetworkNamespacePool.shared?.tryAcquire();
   }
 
   /// Builds the argument list for the native launcher binary.
@@ -93,16 +190,77 @@ class LauncherService {
   ///
   /// Arguments include:
   /// - Workspace ID and root path
-  /// - Sandbox and network flags
+  /// - Sandbox, profile and network flags (plus a pooled namespace, if leased)
+  /// - CPU affinity, nice level, scheduling policy and I/O class
+  /// - Output redirect files, output filters and the files the launcher
+  ///   reports through (file-access trace, output stats, resource samples,
+  ///   idle termination)
   /// - Working directory override
+  /// - Shared cache mounts and package mirror forwarding
   /// - Environment variables
   /// - Command and arguments
-  List<String> _buildNativeArgs(
-      WorkspaceOptions opts, List<String> commandArgs) {
+  List<String> _buildNativeArgs(WorkspaceOptions opts,
+      List<String> commandArgs, NetnsLease? lease, String? traceFile,
+      String? statsFile, String? sampleFile, String? terminationFile) {
     final args = ['--id', id, '--workspace', rootPath];
 
     if (opts.sandbox) args.add('--sandbox');
+    if (opts.sandboxProfile == SandboxProfile.lightweight) args.add('--light');
     if (!opts.allowNetwork) args.add('--no-net');
+    if (lease != null) args.addAll(['--netns-pid', '${lease.holderPid}']);
+    if (opts.priority case final priority?) {
+      args.addAll(_priorityArgs(priority));
+    }
+
+    final mirror = opts.packageMirror;
+    final caches = [
+      for (final cache in opts.caches)
+        if (mirror == null || !cache.env.containsKey('CARGO_HOME')) cache,
+      if (mirror != null) mirror.cargoHome,
+    ];
+    for (final cache in caches) {
+      args.addAll(
+          [cache.exclusive ? '--cache-exclusive' : '--cache', cache.path]);
+      for (final entry in cache.writable) {
+        args.addAll(['--cache-writable', p.join(cache.path, entry)]);
+      }
+    }
+    if (mirror != null) {
+      args.addAll(['--forward', '${mirror.port}=${mirror.socketPath ?? ''}']);
+    }
+
+    // Redirect paths are resolved against the workspace by the caller.
+    for (final (stream, redirect) in [
+      ('stdout', opts.stdoutTo),
+      ('stderr', opts.stderrTo),
+    ]) {
+      if (redirect == null) continue;
+      args.addAll(['--$stream-file', redirect.path]);
+      if (redirect.append) args.add('--$stream-append');
+      if (redirect.tee) args.add('--$stream-tee');
+    }
+
+    if (traceFile != null) args.addAll(['--trace-file', traceFile]);
+    if (opts.outputFilter case final filter?) {
+      args.addAll(filter.launcherArgs);
+      args.addAll(['--output-stats', statsFile!]);
+    }
+    if (sampleFile != null) {
+      args.addAll([
+        '--sample-file',
+        sampleFile,
+        '--sample-interval',
+        '${opts.sampleInterval!.inMilliseconds}',
+      ]);
+    }
+    if (terminationFile != null) {
+      args.addAll([
+        '--idle-timeout',
+        '${opts.idleTimeout!.inMilliseconds}',
+        '--termination-file',
+        terminationFile,
+      ]);
+    }
 
     if (opts.workingDirectoryOverride != null) {
       final absCwd = p.join(rootPath, opts.workingDirectoryOverride!);
@@ -111,7 +269,18 @@ class LauncherService {
 
     final env = <String, String>{};
     if (opts.includeParentEnv) env.addAll(Platform.environment);
+    for (final cache in caches) {
+      env.addAll(cache.env);
+    }
+    if (mirror != null) env.addAll(mirror.env);
     env.addAll(opts.env);
+    for (final cache in caches) {
+      cache.appendEnv.forEach((key, value) {
+        final current = env[key];
+        env[key] =
+            current == null || current.isEmpty ? value : '$current $value';
+      });
+    }
     env.forEach((k, v) => args.addAll(['--env', '$k=$v']));
 
     args.add('--');
@@ -120,6 +289,25 @@ class LauncherService {
     return args;
   }
 
+  /// Launcher flags for [priority]. Only the nice level is applied outside
+  /// Linux, and nothing on Windows.
+  List<String> _priorityArgs(ProcessPriority priority) {
+    if (Platform.isWindows) return const [];
+    final nice = [if (priority.nice case final nice?) '--nice=$nice'];
+    if (!Platform.isLinux) return nice;
+    final cpus = switch (priority.cpus) {
+      null => null,
+      final set when set.isSpread => CpuAllocator.shared.assign(id, set),
+      final set => ([...set.cpus!]..sort()),
+    };
+    return [
+      ...nice,
+      if (cpus != null) ...['--cpus', CpuTopology.formatList(cpus)],
+      if (priority.scheduling case final policy?) ...['--sched', policy.name],
+      if (priority.io case final io?) ...['--io-priority', io.launcherValue],
+    ];
+  }
+
   /// Locates the native launcher binary for the current platform.
   ///
   /// Searches in the following order:
@@ -127,15 +315,36 @@ class LauncherService {
   /// 2. Development build: `native/target/release/workspace_launcher`
   /// 3. Project bin directory: `bin/<os>/x64/workspace_launcher`
   ///
+  /// The path found is cached for the rest of the process; a failed search
+  /// is retried on the next call.
+  ///
   /// Throws [UnsupportedError] if the current platform is not supported.
   /// Throws [StateError] if the binary cannot be found in any location.
-  Future<String> _findBinary() async {
+  static Future<String> findBinary() {
+    final name =
+        Platform.isWindows ? 'workspace_launcher.exe' : 'workspace_launcher';
+    return _binary ??=
+        _findArtifact(name).catchError((Object e, StackTrace stack) {
+      _binary = null;
+      Error.throwWithStackTrace(e, stack);
+    });
+  }
+
+  static Future<String>? _binary;
+
+  /// Locates the launcher shared library used for in-process spawning.
+  ///
+  /// Searched in the same locations as [findBinary]. Only Linux and macOS
+  /// builds provide the library.
+  static Future<String> findLibrary() => _findArtifact(Platform.isMacOS
+      ? 'libworkspace_launcher.dylib'
+      : 'libworkspace_launcher.so');
+
+  static Future<String> _findArtifact(String binName) async {
     String osFolder;
-    String binName = 'workspace_launcher';
 
     if (Platform.isWindows) {
       osFolder = 'windows';
-      binName = '$binName.exe';
     } else if (Platform.isLinux) {
       osFolder = 'linux';
     } else if (Platform.isMacOS) {
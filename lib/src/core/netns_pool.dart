@@ -0,0 +1,189 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import 'launcher_service.dart';
+
+/// Pool of pre-created, loopback-only network namespaces (Linux only).
+///
+/// By default every sandboxed command with `allowNetwork: false` asks
+/// Bubblewrap for a fresh network namespace (`--unshare-net`). Creating and
+/// tearing those down is slow and serializes on a kernel lock when many
+/// commands start at once. While the pool is warm, no-network commands join
+/// an idle namespace instead; the namespace is reset and returned to the
+/// pool when the command exits. A namespace that still contains processes
+/// the command left behind (e.g. a daemon listening on loopback) is retired
+/// instead and replaced by a fresh one, so later leases never see them.
+///
+/// When no namespace is idle, or the pool is not running, commands fall
+/// back to `--unshare-net`, so enabling the pool never blocks an exec.
+///
+/// Example:
+/// ```
+/// await NetworkNamespacePool.warmUp(size: 8);
+/// // ... run many `allowNetwork: false` workspaces ...
+/// await NetworkNamespacePool.shutdown();
+/// ```
+class NetworkNamespacePool {
+  static NetworkNamespacePool? _shared;
+
+  /// The process-wide pool, or `null` when [warmUp] has not been called.
+  static NetworkNamespacePool? get shared => _shared;
+
+  /// Target number of namespaces kept alive.
+  final int size;
+
+  final _idle = <_NetnsHolder>[];
+  final _all = <_NetnsHolder>{};
+  bool _closed = false;
+  int _leases = 0;
+
+  NetworkNamespacePool._(this.size);
+
+  /// Starts the shared pool with [size] namespaces.
+  ///
+  /// Does nothing on platforms other than Linux. Calling this again while a
+  /// pool is running returns the existing pool.
+  static Future<NetworkNamespacePool?> warmUp({int size = 4}) async {
+    if (!Platform.isLinux) return null;
+    if (_shared != null) return _shared;
+
+    final pool = NetworkNamespacePool._(size);
+    _shared = pool;
+    await Future.wait(List.generate(size, (_) => pool._spawnHolder()));
+    return pool;
+  }
+
+  /// Terminates all namespace holders and disables pooling.
+  static Future<void> shutdown() async {
+    final pool = _shared;
+    _shared = null;
+    if (pool == null) return;
+
+    pool._closed = true;
+    pool._idle.clear();
+    await Future.wait(pool._all.map((h) => h.close()));
+    pool._all.clear();
+  }
+
+  /// Number of namespaces currently available for lease.
+  int get idleCount => _idle.length;
+
+  /// Number of leases handed out since the pool started.
+  int get leaseCount => _leases;
+
+  /// Leases an idle namespace, or returns `null` if none is available.
+  ///
+  /// The caller must pass the lease's [NetnsLease.holderPid] to the launcher
+  /// and call [NetnsLease.release] once the command has exited.
+  NetnsLease? tryAcquire() {
+    if (_closed || _idle.isEmpty) return null;
+    final holder = _idle.removeLast();
+    _leases++;
+    return NetnsLease._(this, holder);
+  }
+
+  Future<void> _release(_NetnsHolder holder) async {
+    if (_closed) return;
+    final ok = await holder.reset();
+    if (_closed) {
+      await holder.close();
+    } else if (ok) {
+      _idle.add(holder);
+    } else {
+      _all.remove(holder);
+      await holder.close();
+      await _spawnHolder();
+    }
+  }
+
+  Future<void> _spawnHolder() async {
+    try {
+      final holder = await _NetnsHolder.start();
+      if (_closed) {
+        await holder.close();
+        return;
+      }
+      _all.add(holder);
+      _idle.add(holder);
+    } catch (_) {
+      // User namespaces may be disabled; execs fall back to --unshare-net.
+    }
+  }
+}
+
+/// An exclusive lease on a pooled network namespace.
+class NetnsLease {
+  final NetworkNamespacePool _pool;
+  final _NetnsHolder _holder;
+  bool _released = false;
+
+  NetnsLease._(this._pool, this._holder);
+
+  /// PID of the process owning the leased namespace.
+  int get holderPid => _holder.pid;
+
+  /// Returns the namespace to the pool after resetting it, or replaces it
+  /// if the command left processes behind in it.
+  void release() {
+    if (_released) return;
+    _released = true;
+    _pool._release(_holder);
+  }
+}
+
+/// A launcher process running in `--netns-holder` mode.
+class _NetnsHolder {
+  final Process _process;
+  final _replies = StreamController<String>.broadcast();
+
+  _NetnsHolder._(this._process) {
+    _process.stdout
+        .transform(utf8.decoder)
+        .transform(const LineSplitter())
+        .listen((line) => _replies.add(line.trim()), onDone: _replies.close);
+    _process.stderr.drain<void>();
+  }
+
+  int get pid => _process.pid;
+
+  static Future<_NetnsHolder> start() async {
+    final launcher = await LauncherService.findBinary();
+    final process = await Process.start(launcher, ['--netns-holder']);
+    final holder = _NetnsHolder._(process);
+    if (!await holder._awaitReady()) {
+      process.kill(ProcessSignal.sigkill);
+      throw StateError('Network namespace holder failed to start');
+    }
+    return holder;
+  }
+
+  /// Resets the namespace; `false` means it is occupied or the holder died.
+  Future<bool> reset() async {
+    final ready = _awaitReady();
+    try {
+      _process.stdin.writeln('reset');
+      await _process.stdin.flush();
+    } catch (_) {
+      return false;
+    }
+    return ready;
+  }
+
+  Future<bool> _awaitReady() {
+    return _replies.stream.first
+        .then((reply) => reply == 'ready')
+        .timeout(const Duration(seconds: 5), onTimeout: () => false)
+        .catchError((_) => false);
+  }
+
+  Future<void> close() async {
+    try {
+      await _process.stdin.close();
+    } catch (_) {}
+    await _process.exitCode.timeout(const Duration(seconds: 2), onTimeout: () {
+      _process.kill(ProcessSignal.sigkill);
+      return -1;
+    });
+  }
+}
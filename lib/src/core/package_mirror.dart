@@ -0,0 +1,332 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+
+import '../models/cache_mount.dart';
+
+/// Local read-through caching proxy for package registries.
+///
+/// Serves npm, PyPI, pub.dev and crates.io over plain HTTP on
+/// `127.0.0.1`, storing every response under [cacheDir]. Package archives
+/// are immutable and never refetched; index/metadata documents are reused
+/// for [metadataTtl] and served stale when the upstream registry is
+/// unreachable. With [offline] set, only cached content is served, which
+/// lets no-network workspaces install from a pre-warmed cache.
+///
+/// Workspaces using the mirror (see [WorkspaceOptions.packageMirror]) get
+/// registry settings injected through [env], and can reach it even with
+/// `allowNetwork: false`: on Linux the mirror also listens on a unix
+/// socket that the launcher relays onto the sandbox loopback; on macOS the
+/// Seatbelt profile allows the mirror port. The Linux lightweight profile
+/// blocks all IP sockets without network access, so the mirror is not
+/// reachable there.
+///
+/// Example:
+/// ```
+/// final mirror = await PackageMirror.start(cacheDir: '/var/cache/mirror');
+/// final ws = Workspace.ephemeral(
+///   options: WorkspaceOptions(allowNetwork: false, packageMirror: mirror),
+/// );
+/// await ws.exec('npm install'); // fetched once, then served from disk
+/// await mirror.close();
+/// ```
+class PackageMirror {
+  static const _routes = {
+    'npm': _Route('https://registry.npmjs.org/',
+        accept: 'application/vnd.npm.install-v1+json; q=1.0, */*; q=0.8',
+        immutableMarker: '/-/',
+        rewrites: {'https://registry.npmjs.org/': 'npm/'}),
+    'pypi': _Route('https://pypi.org/',
+        accept: 'text/html',
+        rewrites: {'https://files.pythonhosted.org/': 'pyfiles/'}),
+    'pyfiles': _Route('https://files.pythonhosted.org/', immutable: true),
+    'pub': _Route('https://pub.dev/',
+        accept: 'application/vnd.pub.v2+json',
+        immutableMarker: '/archives/',
+        rewrites: {'https://pub.dev/': 'pub/'}),
+    'cargo-index': _Route('https://index.crates.io/',
+        rewrites: {'https://static.crates.io/crates': 'cargo-dl'}),
+    'cargo-dl': _Route('https://static.crates.io/crates/', immutable: true),
+  };
+
+  /// Directory holding cached responses and generated tool configuration.
+  final String cacheDir;
+
+  /// How long index and metadata documents are served without refetching.
+  final Duration metadataTtl;
+
+  /// Whether to serve only cached content and never contact registries.
+  final bool offline;
+
+  final HttpServer _tcpServer;
+  final HttpServer? _unixServer;
+  final Directory? _socketDir;
+  final HttpClient _client = HttpClient();
+  final _inFlight = <String, Future<_Entry?>>{};
+
+  int _hits = 0;
+  int _misses = 0;
+
+  PackageMirror._(this.cacheDir, this.metadataTtl, this.offline,
+      this._tcpServer, this._unixServer, this._socketDir);
+
+  /// Starts the mirror on a loopback port.
+  ///
+  /// Pass a fixed [port] to keep generated URLs stable across restarts;
+  /// by default an ephemeral port is chosen.
+  static Future<PackageMirror> start({
+    required String cacheDir,
+    Duration metadataTtl = const Duration(minutes: 5),
+    bool offline = false,
+    int port = 0,
+  }) async {
+    await Directory(cacheDir).create(recursive: true);
+    final tcp = await HttpServer.bind(InternetAddress.loopbackIPv4, port);
+
+    HttpServer? unix;
+    Directory? socketDir;
+    if (Platform.isLinux) {
+      socketDir = await Directory.systemTemp.createTemp('ws_mirror_');
+      final address = InternetAddress(p.join(socketDir.path, 'mirror.sock'),
+          type: InternetAddressType.unix);
+      unix = await HttpServer.bind(address, 0);
+    }
+
+    final mirror =
+        PackageMirror._(cacheDir, metadataTtl, offline, tcp, unix, socketDir);
+    await mirror._writeCargoConfig();
+    tcp.listen(mirror._handle);
+    unix?.listen(mirror._handle);
+    return mirror;
+  }
+
+  /// Loopback port the mirror listens on.
+  int get port => _tcpServer.port;
+
+  /// Base URL of the mirror, without a trailing slash.
+  String get baseUrl => 'http://127.0.0.1:$port';
+
+  /// Unix socket the launcher relays into no-network sandboxes (Linux only).
+  String? get socketPath => _unixServer?.address.address;
+
+  /// Requests served from the local cache.
+  int get hits => _hits;
+
+  /// Requests that had to be fetched from an upstream registry.
+  int get misses => _misses;
+
+  String get _cargoHome => p.join(cacheDir, 'cargo-home');
+
+  /// Cargo home configured to use the mirror as its crates.io source.
+  ///
+  /// Cargo reads source replacement only from config files, so the mirror
+  /// owns a `CARGO_HOME`; it replaces [CacheMount.cargo] when both are used.
+  /// Like that preset, only the package cache entries are writable in
+  /// sandboxes: the generated `config.toml` is read-only, so a workspace
+  /// cannot redirect the others' crates.io source.
+  CacheMount get cargoHome => CacheMount(_cargoHome,
+      env: {'CARGO_HOME': _cargoHome}, writable: CacheMount.cargoEntries);
+
+  /// Environment variables pointing package managers at the mirror.
+  Map<String, String> get env => {
+        'npm_config_registry': '$baseUrl/npm/',
+        'npm_config_audit': 'false',
+        'npm_config_fund': 'false',
+        'PIP_INDEX_URL': '$baseUrl/pypi/simple/',
+        'PIP_TRUSTED_HOST': '127.0.0.1',
+        'PUB_HOSTED_URL': '$baseUrl/pub',
+        ...cargoHome.env,
+      };
+
+  /// Stops serving and releases the unix socket.
+  Future<void> close() async {
+    await _tcpServer.close(force: true);
+    await _unixServer?.close(force: true);
+    _client.close(force: true);
+    try {
+      await _socketDir?.delete(recursive: true);
+    } catch (_) {}
+  }
+
+  Future<void> _writeCargoConfig() async {
+    await Directory(_cargoHome).create(recursive: true);
+    await _writeAtomic(
+        File(p.join(_cargoHome, 'config.toml')),
+        utf8.encode('[source.crates-io]\n'
+            'replace-with = "workspace-mirror"\n\n'
+            '[source.workspace-mirror]\n'
+            'registry = "sparse+$baseUrl/cargo-index/"\n'));
+  }
+
+  Future<void> _handle(HttpRequest request) async {
+    final response = request.response;
+    try {
+      if (request.method != 'GET' && request.method != 'HEAD') {
+        response.statusCode = HttpStatus.methodNotAllowed;
+        return;
+      }
+
+      final segments = request.uri.pathSegments;
+      final route = segments.isEmpty ? null : _routes[segments.first];
+      final rest = segments.skip(1).toList();
+      if (route == null ||
+          rest.isEmpty ||
+          rest.any((s) => s.isEmpty || s == '.' || s == '..')) {
+        response.statusCode = HttpStatus.notFound;
+        return;
+      }
+
+      final key = [segments.first, ...rest.map(Uri.encodeComponent)];
+      final upstream = Uri.parse(
+          '${route.upstream}${rest.map(Uri.encodeComponent).join('/')}'
+          '${request.uri.hasQuery ? '?${request.uri.query}' : ''}');
+      final immutable = route.isImmutable(request.uri.path);
+      final entry = await _lookup(key, upstream, route, immutable,
+          cacheable: !request.uri.hasQuery);
+      if (entry == null) {
+        response.statusCode = HttpStatus.notFound;
+        return;
+      }
+
+      // Archives are served verbatim; only index documents carry URLs.
+      final body = immutable || route.rewrites.isEmpty
+          ? entry.body
+          : _rewrite(entry.body, route.rewrites);
+      response.headers.contentType = ContentType.parse(entry.contentType);
+      response.contentLength = body.length;
+      if (request.method == 'GET') response.add(body);
+    } catch (_) {
+      response.statusCode = HttpStatus.badGateway;
+    } finally {
+      await response.close();
+    }
+  }
+
+  /// Returns the cached entry for [key], fetching it when missing or stale.
+  ///
+  /// Concurrent requests for the same resource share one upstream fetch.
+  Future<_Entry?> _lookup(
+      List<String> key, Uri upstream, _Route route, bool immutable,
+      {required bool cacheable}) async {
+    final dir = p.joinAll([cacheDir, ...key]);
+    final cached = cacheable ? await _Entry.read(dir) : null;
+    if (cached != null &&
+        (offline ||
+            immutable ||
+            DateTime.now().difference(cached.fetchedAt) < metadataTtl)) {
+      _hits++;
+      return cached;
+    }
+    if (offline) return null;
+
+    final flightKey = upstream.toString();
+    final fetch = _inFlight[flightKey] ??=
+        _fetch(upstream, route).then((entry) async {
+      if (entry != null && cacheable) await entry.write(dir);
+      return entry;
+    }).whenComplete(() => _inFlight.remove(flightKey));
+
+    try {
+      final entry = await fetch;
+      if (entry != null) {
+        _misses++;
+        return entry;
+      }
+    } catch (_) {
+      if (cached == null) rethrow;
+    }
+    // Upstream failed or no longer has it: prefer a stale copy.
+    if (cached != null) _hits++;
+    return cached;
+  }
+
+  Future<_Entry?> _fetch(Uri upstream, _Route route) async {
+    final request = await _client.getUrl(upstream);
+    if (route.accept != null) {
+      request.headers.set(HttpHeaders.acceptHeader, route.accept!);
+    }
+    final response = await request.close();
+    if (response.statusCode != HttpStatus.ok) {
+      await response.drain<void>();
+      return null;
+    }
+    final builder = BytesBuilder(copy: false);
+    await response.forEach(builder.add);
+    return _Entry(
+      builder.takeBytes(),
+      response.headers.contentType?.toString() ?? 'application/octet-stream',
+      DateTime.now(),
+    );
+  }
+
+  /// Points absolute registry URLs in [body] back at the mirror.
+  List<int> _rewrite(List<int> body, Map<String, String> rewrites) {
+    var text = utf8.decode(body, allowMalformed: true);
+    rewrites.forEach((from, to) {
+      text = text.replaceAll(from, '$baseUrl/$to');
+    });
+    return utf8.encode(text);
+  }
+}
+
+/// Writes [bytes] to a temporary sibling and renames it over [file], so
+/// readers never observe a partial file.
+Future<void> _writeAtomic(File file, List<int> bytes) async {
+  final tmp = File('${file.path}.$pid.tmp');
+  await tmp.writeAsBytes(bytes, flush: true);
+  await tmp.rename(file.path);
+}
+
+class _Route {
+  final String upstream;
+  final String? accept;
+  final bool immutable;
+  final String? immutableMarker;
+  final Map<String, String> rewrites;
+
+  const _Route(this.upstream,
+      {this.accept,
+      this.immutable = false,
+      this.immutableMarker,
+      this.rewrites = const {}});
+
+  bool isImmutable(String path) =>
+      immutable || (immutableMarker != null && path.contains(immutableMarker!));
+}
+
+/// A cached response: `#body` holds the raw bytes, `#meta` the headers.
+///
+/// `#` never appears in an encoded path segment, so these names cannot
+/// collide with a cached child resource.
+class _Entry {
+  final List<int> body;
+  final String contentType;
+  final DateTime fetchedAt;
+
+  _Entry(this.body, this.contentType, this.fetchedAt);
+
+  static Future<_Entry?> read(String dir) async {
+    try {
+      final meta = jsonDecode(await File(p.join(dir, '#meta')).readAsString())
+          as Map<String, dynamic>;
+      final body = await File(p.join(dir, '#body')).readAsBytes();
+      return _Entry(body, meta['contentType'] as String,
+          DateTime.parse(meta['fetchedAt'] as String));
+    } catch (_) {
+      return null;
+    }
+  }
+
+  Future<void> write(String dir) async {
+    await Directory(dir).create(recursive: true);
+    await _writeAtomic(File(p.join(dir, '#body')), body);
+    await _writeAtomic(
+        File(p.join(dir, '#meta')),
+        utf8.encode(jsonEncode({
+          'contentType': contentType,
+          'fetchedAt': fetchedAt.toIso8601String(),
+        })));
+  }
+}
@@ -0,0 +1,60 @@
+import 'dart:async';
+
+import '../fs/file_system_service.dart';
+import '../models/disk_usage.dart';
+import '../models/workspace_process.dart';
+
+/// Kills a workspace's commands once its disk usage exceeds a [DiskQuota].
+///
+/// While at least one tracked process runs, usage is refreshed every
+/// [DiskQuota.checkInterval]. Each check only re-lists directories the
+/// file watcher reported as changed (see [FileSystemService.usage]), so
+/// checking often stays cheap. When the quota is exceeded every tracked
+/// process is killed and reports [WorkspaceProcess.isCancelled].
+class QuotaEnforcer {
+  final FileSystemService _fs;
+
+  /// The enforced quota.
+  final DiskQuota quota;
+
+  final _running = <WorkspaceProcess>{};
+  Timer? _timer;
+  bool _checking = false;
+
+  /// Creates an enforcer for the workspace behind [_fs].
+  QuotaEnforcer(this._fs, this.quota);
+
+  /// Watches [process] until it exits.
+  void track(WorkspaceProcess process) {
+    _running.add(process);
+    _timer ??= Timer.periodic(quota.checkInterval, (_) => _check());
+    process.exitCode.then((_) {
+      _running.remove(process);
+      if (_running.isEmpty) {
+        _timer?.cancel();
+        _timer = null;
+      }
+    });
+  }
+
+  /// Stops checking; running processes are left alone.
+  void dispose() {
+    _timer?.cancel();
+    _timer = null;
+    _running.clear();
+  }
+
+  Future<void> _check() async {
+    if (_checking) return;
+    _checking = true;
+    try {
+      if (quota.isExceededBy(await _fs.usage())) {
+        for (final process in List.of(_running)) {
+          process.kill();
+        }
+      }
+    } finally {
+      _checking = false;
+    }
+  }
+}
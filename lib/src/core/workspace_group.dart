@@ -0,0 +1,285 @@
+import 'dart:async';
+import 'dart:io';
+
+import '../../workspace_sandbox.dart';
+import 'launcher_service.dart';
+
+/// Runs the same command across many workspaces with bounded parallelism.
+///
+/// [execEach] starts the command in at most [concurrency] members at a
+/// time and emits each member's [GroupMemberResult] as soon as it exits;
+/// [exec] waits for all of them and returns a [GroupSummary] with the
+/// success count and latency percentiles. A member whose command cannot
+/// be started reports the error in its result instead of failing the
+/// group.
+///
+/// [options] apply to every member's command, on top of each workspace's
+/// own defaults. The launcher is located once for the whole group before
+/// the first command starts, rather than by every member at once.
+///
+/// Example:
+/// ```
+/// final group = await WorkspaceGroup.ephemeral(24,
+///     concurrency: 8,
+///     options: WorkspaceOptions(sandboxProfile: SandboxProfile.lightweight));
+/// final summary = await group.exec('dart test');
+/// print('${summary.successCount}/${summary.length} passed, '
+///     'p90 ${summary.percentile(90).inMilliseconds} ms');
+/// await group.dispose();
+/// ```
+class WorkspaceGroup {
+  /// The workspaces commands run in, in index order.
+  final List<Workspace> members;
+
+  /// Maximum number of commands running at once.
+  final int concurrency;
+
+  /// Options every command of the group runs with.
+  final WorkspaceOptions? options;
+
+  final bool _ownsMembers;
+
+  /// Groups existing [members]; [dispose] leaves them open.
+  ///
+  /// [concurrency] defaults to the number of processors.
+  WorkspaceGroup(Iterable<Workspace> members, {int? concurrency, this.options})
+      : members = List.unmodifiable(members),
+        concurrency = _checkConcurrency(concurrency),
+        _ownsMembers = false;
+
+  WorkspaceGroup._owned(this.members, int? concurrency)
+      : concurrency = _checkConcurrency(concurrency),
+        options = null,
+        _ownsMembers = true;
+
+  /// Creates [count] temporary workspaces with [options] as their
+  /// defaults, as [Workspace.ephemeral] (or [WorkspaceManager.ephemeral]
+  /// when [manager] is given). [dispose] deletes them.
+  ///
+  /// If any creation fails, the workspaces already created are disposed
+  /// before the error is rethrown.
+  static Future<WorkspaceGroup> ephemeral(int count,
+      {int? concurrency,
+      WorkspaceOptions? options,
+      WorkspaceManager? manager}) async {
+    // Checked first: a bad value must not leave the members behind.
+    final limit = _checkConcurrency(concurrency);
+    final created = <Workspace>[];
+    Workspace track(Workspace ws) {
+      created.add(ws);
+      return ws;
+    }
+
+    // Future.wait lets every creation finish, so none is left behind on
+    // failure.
+    final List<Workspace> members;
+    try {
+      members = manager == null
+          ? [
+              for (var i = 0; i < count; i++)
+                track(Workspace.ephemeral(options: options)),
+            ]
+          : await Future.wait([
+              for (var i = 0; i < count; i++)
+                manager.ephemeral(options: options).then(track),
+            ]);
+    } catch (_) {
+      // A failed cleanup must not hide why the group could not be made.
+      await Future.wait([
+        for (final ws in created) ws.dispose().catchError((Object _) {}),
+      ]);
+      rethrow;
+    }
+    return WorkspaceGroup._owned(List.unmodifiable(members), limit);
+  }
+
+  static int _checkConcurrency(int? concurrency) {
+    final value = concurrency ?? Platform.numberOfProcessors;
+    if (value < 1) {
+      throw ArgumentError.value(value, 'concurrency', 'Must be at least 1');
+    }
+    return value;
+  }
+
+  /// Number of members.
+  int get length => members.length;
+
+  /// Runs [command] in every member and emits each result as the member's
+  /// command exits, in completion order.
+  ///
+  /// [options] replace the group's for this run. Cancelling the
+  /// subscription stops starting new commands; running ones finish.
+  Stream<GroupMemberResult> execEach(Object command,
+      {WorkspaceOptions? options}) {
+    final runOptions = options ?? this.options;
+    late final StreamController<GroupMemberResult> controller;
+    var next = 0;
+    var running = 0;
+    var cancelled = false;
+
+    Future<void> run(int index) async {
+      final workspace = members[index];
+      final watch = Stopwatch()..start();
+      GroupMemberResult member;
+      try {
+        final result = await workspace.exec(command, options: runOptions);
+        member = GroupMemberResult(index, workspace,
+            result: result, latency: watch.elapsed);
+      } catch (e) {
+        member = GroupMemberResult(index, workspace,
+            error: e, latency: watch.elapsed);
+      }
+      if (!cancelled) controller.add(member);
+    }
+
+    void pump() {
+      while (!cancelled && running < concurrency && next < members.length) {
+        running++;
+        run(next++).whenComplete(() {
+          running--;
+          if (running == 0 && (cancelled || next == members.length)) {
+            controller.close();
+          } else {
+            pump();
+          }
+        });
+      }
+    }
+
+    controller = StreamController(
+      onListen: () async {
+        await _locateLauncher();
+        if (members.isEmpty) {
+          controller.close();
+        } else {
+          pump();
+        }
+      },
+      onCancel: () => cancelled = true,
+    );
+    return controller.stream;
+  }
+
+  /// Runs [command] in every member and summarizes the results.
+  Future<GroupSummary> exec(Object command, {WorkspaceOptions? options}) async {
+    final watch = Stopwatch()..start();
+    final results = await execEach(command, options: options).toList();
+    results.sort((a, b) => a.index.compareTo(b.index));
+    return GroupSummary(results, elapsed: watch.elapsed);
+  }
+
+  /// Disposes the members if the group created them.
+  Future<void> dispose() async {
+    if (!_ownsMembers) return;
+    await Future.wait([for (final ws in members) ws.dispose()]);
+  }
+
+  /// Resolves the launcher binary once, so that members starting together
+  /// find it cached instead of each searching the disk.
+  static Future<void> _locateLauncher() async {
+    if (InProcessLauncher.shared != null) return;
+    try {
+      await LauncherService.findBinary();
+    } catch (_) {
+      // Each member's exec reports it.
+    }
+  }
+}
+
+/// The outcome of one member's command in a [WorkspaceGroup].
+class GroupMemberResult {
+  /// Position of the workspace in [WorkspaceGroup.members].
+  final int index;
+
+  /// The workspace the command ran in.
+  final Workspace workspace;
+
+  /// The command's result, or `null` if it could not be run.
+  final CommandResult? result;
+
+  /// Why the command could not be run, if it could not.
+  final Object? error;
+
+  /// Time from asking the workspace to run the command until its result,
+  /// process start included.
+  final Duration latency;
+
+  /// Creates a member result.
+  const GroupMemberResult(this.index, this.workspace,
+      {this.result, this.error, required this.latency});
+
+  /// Whether the command ran and exited with `0`.
+  bool get isSuccess => result?.isSuccess ?? false;
+
+  @override
+  String toString() => 'GroupMemberResult($index, '
+      '${error == null ? 'exitCode: ${result?.exitCode}' : 'error: $error'}, '
+      '${latency.inMilliseconds}ms)';
+}
+
+/// Results of a [WorkspaceGroup.exec] run across all members.
+class GroupSummary {
+  /// Every member's result, in member order.
+  final List<GroupMemberResult> results;
+
+  /// Wall time of the whole run.
+  final Duration elapsed;
+
+  /// Member latencies, ascending.
+  final List<Duration> _latencies;
+
+  /// Summarizes [results].
+  GroupSummary(List<GroupMemberResult> results, {required this.elapsed})
+      : results = List.unmodifiable(results),
+        _latencies = [for (final r in results) r.latency]..sort();
+
+  /// Number of members.
+  int get length => results.length;
+
+  /// Members whose command exited with `0`.
+  int get successCount => results.where((r) => r.isSuccess).length;
+
+  /// Members whose command failed or could not be run.
+  int get failureCount => length - successCount;
+
+  /// Whether every member succeeded.
+  bool get allSucceeded => successCount == length;
+
+  /// The results that did not succeed.
+  Iterable<GroupMemberResult> get failures =>
+      results.where((r) => !r.isSuccess);
+
+  /// The latency [p] percent of the members stayed within (nearest rank),
+  /// for `0 < p <= 100`. [Duration.zero] for an empty group.
+  Duration percentile(num p) {
+    if (p <= 0 || p > 100) {
+      throw RangeError.range(p, 0, 100, 'p', 'Must be in (0, 100]');
+    }
+    if (_latencies.isEmpty) return Duration.zero;
+    final rank = (p / 100 * _latencies.length).ceil();
+    return _latencies[rank - 1];
+  }
+
+  /// Median latency.
+  Duration get p50 => percentile(50);
+
+  /// 90th percentile latency.
+  Duration get p90 => percentile(90);
+
+  /// 99th percentile latency.
+  Duration get p99 => percentile(99);
+
+  /// Slowest member.
+  Duration get maxLatency =>
+      _latencies.isEmpty ? Duration.zero : _latencies.last;
+
+  /// Mean latency.
+  Duration get meanLatency => _latencies.isEmpty
+      ? Duration.zero
+      : _latencies.reduce((a, b) => a + b) ~/ _latencies.length;
+
+  @override
+  String toString() => 'GroupSummary($successCount/$length succeeded, '
+      'p50: ${p50.inMilliseconds}ms, p90: ${p90.inMilliseconds}ms, '
+      'elapsed: ${elapsed.inMilliseconds}ms)';
+}
@@ -0,0 +1,682 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:isolate';
+
+import '../../workspace_sandbox.dart';
+import '../util/forwarded_process.dart';
+import '../util/json_output.dart';
+import 'command_watcher.dart';
+import 'cpu_allocator.dart';
+
+/// Hosts workspaces on a fixed set of worker isolates.
+///
+/// A plain [Workspace] runs its event bus, UTF-8 decoding and result
+/// buffering on the isolate that created it, so hundreds of concurrent
+/// processes all compete for one core. The manager instead shards
+/// workspaces across [isolateCount] worker isolates (placing each new one
+/// on the least loaded worker) and hands out lightweight proxies with the
+/// same [Workspace] API.
+///
+/// Process output, exit codes and [Workspace.onEvent] traffic are batched:
+/// everything a worker produces in one event-loop turn crosses to the
+/// caller in a single message, with consecutive chunks of the same stream
+/// merged. Events are only forwarded while the proxy's [Workspace.onEvent]
+/// has listeners. [Workspace.fs] and [Workspace.git] work directly on disk
+/// from the caller.
+///
+/// Process-wide services are per isolate: enable [InProcessLauncher] or
+/// [NetworkNamespacePool] in [start]'s `setup`, which runs on every worker.
+/// Options holding a [PackageMirror] cannot be sent to a worker. A
+/// [CpuSet.spread] is resolved on the manager's isolate before options are
+/// sent, so that workspaces on different workers are balanced against each
+/// other; a workspace's default spread is pinned when it is created.
+///
+/// Example:
+/// ```
+/// final manager = await WorkspaceManager.start(isolates: 4);
+/// final workspaces = await Future.wait(
+///     [for (var i = 0; i < 100; i++) manager.ephemeral()]);
+/// await Future.wait([for (final ws in workspaces) ws.exec('make test')]);
+/// await manager.close();
+/// ```
+class WorkspaceManager {
+  final List<_Shard> _shards;
+  final _workspaces = <_WorkspaceProxy>{};
+  bool _closed = false;
+
+  /// Source of [CpuAllocator] owner names, unique across managers.
+  static var _nextOwner = 0;
+
+  WorkspaceManager._(this._shards);
+
+  /// Starts [isolates] worker isolates (default: one per processor).
+  ///
+  /// [setup] runs on each worker before it accepts workspaces; it is sent
+  /// to the workers, so it must only capture sendable values.
+  static Future<WorkspaceManager> start(
+      {int? isolates, Future<void> Function()? setup}) async {
+    final count = isolates ?? Platform.numberOfProcessors;
+    if (count < 1) {
+      throw ArgumentError.value(count, 'isolates', 'Must be at least 1');
+    }
+    final shards = <_Shard>[];
+    try {
+      for (var i = 0; i < count; i++) {
+        shards.add(await _Shard.spawn(i, setup));
+      }
+    } catch (_) {
+      for (final shard in shards) {
+        shard.kill();
+      }
+      rethrow;
+    }
+    return WorkspaceManager._(shards);
+  }
+
+  /// Number of worker isolates.
+  int get isolateCount => _shards.length;
+
+  /// Number of workspaces created and not yet disposed.
+  int get workspaceCount => _workspaces.length;
+
+  /// Creates a temporary workspace on a worker, as [Workspace.ephemeral].
+  Future<Workspace> ephemeral({String? id, WorkspaceOptions? options}) =>
+      _create(null, id, options);
+
+  /// Opens a persistent workspace on a worker, as [Workspace.at].
+  Future<Workspace> at(String path, {String? id, WorkspaceOptions? options}) =>
+      _create(path, id, options);
+
+  /// Disposes all workspaces and stops the worker isolates.
+  Future<void> close() async {
+    if (_closed) return;
+    _closed = true;
+    await Future.wait([for (final ws in List.of(_workspaces)) ws.dispose()]);
+    for (final shard in _shards) {
+      shard.kill();
+    }
+  }
+
+  Future<Workspace> _create(
+      String? path, String? id, WorkspaceOptions? options) async {
+    if (_closed) throw StateError('WorkspaceManager has been closed');
+    _checkSendable(options);
+    final shard = _shards.reduce((a, b) => b.load < a.load ? b : a);
+    final key = shard.nextKey++;
+    final owner = 'manager:${_nextOwner++}';
+    // Counted before the first await, so that concurrent creates see this
+    // workspace and spread over the shards.
+    shard.pending++;
+    final String rootPath;
+    try {
+      final defaults = _withoutToken(_pinCpus(options, owner));
+      rootPath = await shard.request<String>(
+          (req) => _Create(req, key, path, id, defaults));
+    } catch (_) {
+      _releaseCpus(owner);
+      rethrow;
+    } finally {
+      shard.pending--;
+    }
+    final proxy = _WorkspaceProxy(
+        this, shard, key, owner, rootPath, options?.diskQuota);
+    shard.workspaces[key] = proxy;
+    _workspaces.add(proxy);
+    return proxy;
+  }
+}
+
+/// Rejects options that hold unsendable resources.
+void _checkSendable(WorkspaceOptions? options) {
+  if (options?.packageMirror != null) {
+    throw ArgumentError.value(options, 'options',
+        'PackageMirror cannot be used with WorkspaceManager workspaces');
+  }
+}
+
+/// Replaces a [CpuSet.spread] in [options] with the CPUs this isolate's
+/// [CpuAllocator] assigns to [owner].
+WorkspaceOptions? _pinCpus(WorkspaceOptions? options, String owner) {
+  final priority = options?.priority;
+  final cpus = priority?.cpus;
+  if (priority == null || cpus == null || !cpus.isSpread) return options;
+  if (!Platform.isLinux) return options;
+  return options!.copyWith(
+      priority: ProcessPriority(
+          cpus: CpuSet(CpuAllocator.shared.assign(owner, cpus)),
+          nice: priority.nice,
+          scheduling: priority.scheduling,
+          io: priority.io));
+}
+
+/// Frees the CPU groups [_pinCpus] assigned to [owner].
+void _releaseCpus(String owner) {
+  if (Platform.isLinux) CpuAllocator.shared.release(owner);
+}
+
+/// Replaces the caller's token with a fresh one that has no listeners.
+///
+/// The worker substitutes its own token, cancelled by a [_Cancel] message
+/// (or right away when the caller's token was already cancelled).
+WorkspaceOptions? _withoutToken(WorkspaceOptions? options) {
+  final token = options?.cancellationToken;
+  if (token == null) return options;
+  final placeholder = CancellationToken();
+  if (token.isCancelled) placeholder.cancel();
+  return options!.copyWith(cancellationToken: placeholder);
+}
+
+/// Caller-side handle of one worker isolate.
+class _Shard {
+  final int index;
+  final Isolate _isolate;
+  final SendPort _commands;
+  final ReceivePort _inbox;
+  final workspaces = <int, _WorkspaceProxy>{};
+  final _processes = <int, ForwardedProcess>{};
+  final _requests = <int, Completer<Object?>>{};
+  int nextKey = 0;
+
+  /// Workspaces being created on this worker.
+  int pending = 0;
+  int _nextRequest = 0;
+  int _nextProcess = 0;
+  bool _alive = true;
+
+  _Shard._(this.index, this._isolate, this._commands, this._inbox);
+
+  /// Spawns a worker and waits until [setup] has run there.
+  static Future<_Shard> spawn(
+      int index, Future<void> Function()? setup) async {
+    final inbox = ReceivePort();
+    final handshake = Completer<Object?>();
+    // The first message is the worker's command port (or a setup error);
+    // everything after it is a batch.
+    void Function(Object?) route = handshake.complete;
+    inbox.listen((message) => route(message));
+    try {
+      final isolate = await Isolate.spawn(_shardMain, (inbox.sendPort, setup),
+          debugName: 'workspace_sandbox shard $index');
+      final hello = await handshake.future;
+      if (hello is! SendPort) {
+        isolate.kill(priority: Isolate.immediate);
+        final (error, stack) = hello as (Object, String);
+        Error.throwWithStackTrace(error, StackTrace.fromString(stack));
+      }
+      final shard = _Shard._(index, isolate, hello, inbox);
+      route = shard._onBatch;
+      return shard;
+    } catch (_) {
+      inbox.close();
+      rethrow;
+    }
+  }
+
+  Future<T> request<T>(_Request Function(int req) build) {
+    if (!_alive) {
+      return Future.error(StateError('WorkspaceManager has been closed'));
+    }
+    final req = _nextRequest++;
+    final completer = Completer<Object?>();
+    _requests[req] = completer;
+    _commands.send(build(req));
+    return completer.future.then((value) => value as T);
+  }
+
+  /// Workspaces placed on this worker, including those being created.
+  int get load => workspaces.length + pending;
+
+  void send(Object message) => _commands.send(message);
+
+  /// Registers a process proxy; [ForwardedProcess.kill] sends a [_Kill].
+  (int, ForwardedProcess) register() {
+    final key = _nextProcess++;
+    final process = ForwardedProcess(onKill: () => send(_Kill(key)));
+    _processes[key] = process;
+    process.finished.then((_) => _processes.remove(key));
+    return (key, process);
+  }
+
+  void kill() {
+    _alive = false;
+    _inbox.close();
+    _isolate.kill(priority: Isolate.immediate);
+    for (final completer in _requests.values) {
+      completer.completeError(StateError('WorkspaceManager has been closed'));
+    }
+    _requests.clear();
+  }
+
+  void _onBatch(Object? batch) {
+    for (final message in batch as List<Object?>) {
+      switch (message) {
+        case _Reply(:final req, :final value, :final error, :final stack):
+          final completer = _requests.remove(req);
+          if (error != null) {
+            completer?.completeError(error, StackTrace.fromString(stack!));
+          } else {
+            completer?.complete(value);
+          }
+        case _Output(:final process, :final isError, :final text):
+          _processes[process]?.deliverOutput(text, isError: isError);
+        case _StreamDone(:final process, :final isError):
+          _processes[process]?.deliverDone(isError: isError);
+        case _Stats(:final process, :final stats):
+          _processes[process]?.deliverStats(stats);
+        case _Exit(
+            :final process,
+            :final code,
+            :final cancelled,
+            :final terminationReason,
+            :final fileAccess,
+            :final outputStats
+          ):
+          _processes[process]?.deliverExit(code,
+              cancelled: cancelled,
+              terminationReason: terminationReason,
+              fileAccess: fileAccess,
+              outputStats: outputStats);
+        case _Event(:final workspace, :final event):
+          workspaces[workspace]?.emit(event);
+      }
+    }
+  }
+}
+
+/// A [Workspace] whose processes run on a worker isolate.
+class _WorkspaceProxy implements Workspace {
+  final WorkspaceManager _manager;
+  final _Shard _shard;
+  final int _key;
+
+  /// Name of this workspace's CPU groups in [CpuAllocator.shared].
+  final String _owner;
+
+  @override
+  final String rootPath;
+
+  @override
+  final FileSystemService fs;
+
+  @override
+  late final GitService git = GitService(rootPath);
+
+  late final _events = StreamController<WorkspaceEvent>.broadcast(
+    onListen: () => _shard.send(_Subscribe(_key, true)),
+    onCancel: () => _shard.send(_Subscribe(_key, false)),
+  );
+
+  bool _disposed = false;
+
+  /// Writes through [fs] are checked against [quota] on this isolate; the
+  /// worker kills commands that exceed it.
+  _WorkspaceProxy(this._manager, this._shard, this._key, this._owner,
+      this.rootPath, DiskQuota? quota)
+      : fs = FileSystemService(rootPath, quota: quota);
+
+  @override
+  Stream<WorkspaceEvent> get onEvent => _events.stream;
+
+  void emit(WorkspaceEvent event) {
+    if (!_events.isClosed) _events.add(event);
+  }
+
+  @override
+  Future<CommandResult> exec(Object command,
+      {WorkspaceOptions? options}) async {
+    _checkCommand(command);
+    _checkSendable(options);
+    final token = options?.cancellationToken;
+    final sent = _withoutToken(_pinCpus(options, _owner));
+    StreamSubscription<void>? cancel;
+    try {
+      return await _shard.request<CommandResult>((req) {
+        cancel = token?.onCancel.listen((_) => _shard.send(_Cancel(req)));
+        return _Exec(req, _key, command, sent, null);
+      });
+    } finally {
+      await cancel?.cancel();
+    }
+  }
+
+  @override
+  Future<WorkspaceProcess> execStream(Object command,
+      {WorkspaceOptions? options}) async {
+    _checkCommand(command);
+    _checkSendable(options);
+    final (key, process) = _shard.register();
+    final token = options?.cancellationToken;
+    final sent = _withoutToken(_pinCpus(options, _owner));
+    StreamSubscription<void>? cancel;
+    try {
+      process.pid = await _shard.request<int>((req) {
+        cancel = token?.onCancel.listen((_) => _shard.send(_Cancel(req)));
+        return _Exec(req, _key, command, sent, key);
+      });
+    } catch (_) {
+      await cancel?.cancel();
+      process.abandon();
+      rethrow;
+    }
+    // The token can cancel the command until it exits.
+    process.finished.whenComplete(() => cancel?.cancel());
+    return process;
+  }
+
+  @override
+  Future<DiskUsage> usage() => fs.usage();
+
+  /// Decodes the forwarded stdout on this isolate.
+  @override
+  Future<JsonCommandResult> execJson(Object command,
+          {WorkspaceOptions? options}) async =>
+      collectJson(await execStream(command, options: options));
+
+  /// Decodes the forwarded stdout on this isolate.
+  @override
+  Stream<Object?> execNdjson(Object command,
+      {WorkspaceOptions? options}) async* {
+    final process = await execStream(command, options: options);
+    yield* decodeNdjson(process, command);
+  }
+
+  /// Watches files on this isolate and reruns through [execStream].
+  @override
+  Stream<CommandResult> watch(Object command,
+          {List<String>? paths,
+          Duration debounce = const Duration(milliseconds: 200),
+          bool runImmediately = true,
+          WorkspaceOptions? options}) =>
+      CommandWatcher(this, command,
+              paths: paths,
+              debounce: debounce,
+              runImmediately: runImmediately,
+              options: options)
+          .results;
+
+  @override
+  Future<void> dispose() async {
+    if (_disposed) return;
+    _disposed = true;
+    _manager._workspaces.remove(this);
+    try {
+      await _shard.request<void>((req) => _Dispose(req, _key));
+    } on StateError {
+      // The manager was closed and took the worker down with it.
+    }
+    _shard.workspaces.remove(_key);
+    _releaseCpus(_owner);
+    await fs.dispose();
+    await _events.close();
+  }
+
+  /// Validates locally so that misuse fails like [Workspace.exec] does.
+  static void _checkCommand(Object command) {
+    if (command is List<String>) {
+      if (command.isEmpty) {
+        throw ArgumentError('Command list cannot be empty');
+      }
+    } else if (command is! String) {
+      throw ArgumentError(
+          'Command must be String (shell) or List<String> (binary)');
+    }
+  }
+}
+
+// --- Worker isolate ---
+
+Future<void> _shardMain((SendPort, Future<void> Function()?) init) async {
+  final (reply, setup) = init;
+  try {
+    await setup?.call();
+  } catch (e, st) {
+    reply.send((e, st.toString()));
+    return;
+  }
+  final commands = ReceivePort();
+  final host = _ShardHost(_Outbox(reply));
+  commands.listen((message) => host.handle(message as _Command));
+  reply.send(commands.sendPort);
+}
+
+/// Worker-side owner of the sharded workspaces and their processes.
+class _ShardHost {
+  final _Outbox _outbox;
+  final _workspaces = <int, Workspace>{};
+  final _events = <int, StreamSubscription<WorkspaceEvent>>{};
+  final _processes = <int, WorkspaceProcess>{};
+  final _tokens = <int, CancellationToken>{};
+
+  _ShardHost(this._outbox);
+
+  Future<void> handle(_Command message) async {
+    switch (message) {
+      case _Create(:final req, :final key, :final path, :final id):
+        await _reply(req, () async {
+          final ws = path == null
+              ? Workspace.ephemeral(id: id, options: message.options)
+              : Workspace.at(path, id: id, options: message.options);
+          _workspaces[key] = ws;
+          return ws.rootPath;
+        });
+      case _Exec():
+        await _reply(message.req, () => _exec(message));
+      case _Kill(:final process):
+        _processes[process]?.kill();
+      case _Cancel(:final req):
+        _tokens[req]?.cancel();
+      case _Subscribe(:final key, :final listen):
+        await _events.remove(key)?.cancel();
+        final ws = _workspaces[key];
+        if (listen && ws != null) {
+          _events[key] =
+              ws.onEvent.listen((event) => _outbox.add(_Event(key, event)));
+        }
+      case _Dispose(:final req, :final key):
+        await _reply(req, () async {
+          await _events.remove(key)?.cancel();
+          await _workspaces.remove(key)?.dispose();
+          return null;
+        });
+    }
+  }
+
+  Future<Object?> _exec(_Exec message) async {
+    final ws = _workspaces[message.key];
+    if (ws == null) throw StateError('Workspace has been disposed');
+    var options = message.options;
+    final placeholder = options?.cancellationToken;
+    if (placeholder != null) {
+      final token = CancellationToken();
+      if (placeholder.isCancelled) token.cancel();
+      _tokens[message.req] = token;
+      options = options!.copyWith(cancellationToken: token);
+    }
+
+    final key = message.process;
+    if (key == null) {
+      try {
+        return await ws.exec(message.command, options: options);
+      } finally {
+        _tokens.remove(message.req);
+      }
+    }
+
+    final process = await ws.execStream(message.command, options: options);
+    _processes[key] = process;
+    process.stdout.listen((text) => _outbox.addOutput(key, false, text),
+        onDone: () => _outbox.add(_StreamDone(key, false)));
+    process.stderr.listen((text) => _outbox.addOutput(key, true, text),
+        onDone: () => _outbox.add(_StreamDone(key, true)));
+    process.stats.listen((stats) => _outbox.add(_Stats(key, stats)));
+    process.exitCode.then((code) async {
+      final fileAccess = await process.fileAccess;
+      final outputStats = await process.outputStats;
+      _processes.remove(key);
+      _tokens.remove(message.req);
+      _outbox.add(_Exit(key, code, process.isCancelled,
+          process.terminationReason, fileAccess, outputStats));
+    });
+    return process.pid;
+  }
+
+  Future<void> _reply(int req, Future<Object?> Function() body) async {
+    try {
+      _outbox.add(_Reply(req, await body(), null, null));
+    } catch (e, st) {
+      _outbox.add(_Reply(req, null, e, st.toString()));
+    }
+  }
+}
+
+/// Collects worker messages and sends them once per event-loop turn.
+class _Outbox {
+  /// Flush early once a batch gets this long.
+  static const _maxBatch = 512;
+
+  final SendPort _port;
+  var _batch = <Object>[];
+  bool _scheduled = false;
+
+  _Outbox(this._port);
+
+  void add(Object message) {
+    _batch.add(message);
+    if (_batch.length >= _maxBatch) {
+      _flush();
+    } else if (!_scheduled) {
+      _scheduled = true;
+      Timer.run(_flush);
+    }
+  }
+
+  /// Appends to the previous chunk when it belongs to the same stream.
+  void addOutput(int process, bool isError, String text) {
+    final last = _batch.isEmpty ? null : _batch.last;
+    if (last is _Output && last.process == process && last.isError == isError) {
+      _batch.last = _Output(process, isError, last.text + text);
+      return;
+    }
+    add(_Output(process, isError, text));
+  }
+
+  void _flush() {
+    _scheduled = false;
+    if (_batch.isEmpty) return;
+    final batch = _batch;
+    _batch = [];
+    try {
+      _port.send(batch);
+    } catch (_) {
+      // A value in the batch could not be sent (e.g. an exotic error);
+      // resend each message on its own, degrading errors to text.
+      for (final message in batch) {
+        try {
+          _port.send([message]);
+        } catch (_) {
+          if (message is _Reply) {
+            _port.send([
+              _Reply(message.req, null,
+                  RemoteError('${message.error}', '${message.stack}'),
+                  message.stack ?? '')
+            ]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// --- Messages ---
+
+/// Caller-to-worker messages.
+sealed class _Command {}
+
+/// A command answered with a [_Reply].
+sealed class _Request extends _Command {
+  final int req;
+  _Request(this.req);
+}
+
+class _Create extends _Request {
+  final int key;
+  final String? path;
+  final String? id;
+  final WorkspaceOptions? options;
+  _Create(super.req, this.key, this.path, this.id, this.options);
+}
+
+class _Exec extends _Request {
+  final int key;
+  final Object command;
+  final WorkspaceOptions? options;
+
+  /// Key of the streamed process, or `null` for a collected [Workspace.exec].
+  final int? process;
+  _Exec(super.req, this.key, this.command, this.options, this.process);
+}
+
+class _Dispose extends _Request {
+  final int key;
+  _Dispose(super.req, this.key);
+}
+
+class _Kill extends _Command {
+  final int process;
+  _Kill(this.process);
+}
+
+class _Cancel extends _Command {
+  final int req;
+  _Cancel(this.req);
+}
+
+class _Subscribe extends _Command {
+  final int key;
+  final bool listen;
+  _Subscribe(this.key, this.listen);
+}
+
+class _Reply {
+  final int req;
+  final Object? value;
+  final Object? error;
+  final String? stack;
+  _Reply(this.req, this.value, this.error, this.stack);
+}
+
+class _Output {
+  final int process;
+  final bool isError;
+  final String text;
+  _Output(this.process, this.isError, this.text);
+}
+
+class _StreamDone {
+  final int process;
+  final bool isError;
+  _StreamDone(this.process, this.isError);
+}
+
+class _Stats {
+  final int process;
+  final ProcessStats stats;
+  _Stats(this.process, this.stats);
+}
+
+class _Exit {
+  final int process;
+  final int code;
+  final bool cancelled;
+  final TerminationReason? terminationReason;
+  final FileAccess? fileAccess;
+  final OutputStats? outputStats;
+  _Exit(this.process, this.code, this.cancelled, this.terminationReason,
+      this.fileAccess, this.outputStats);
+}
+
+class _Event {
+  final int workspace;
+  final WorkspaceEvent event;
+  _Event(this.workspace, this.event);
+}
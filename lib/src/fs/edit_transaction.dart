@@ -0,0 +1,251 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:math';
+
+import '../core/path_security.dart';
+import '../models/file_edit.dart';
+import '../util/unified_patch.dart';
+
+/// Applies a batch of [FileEdit]s all-or-nothing.
+///
+/// Edits are first applied in memory; any failure throws before a file is
+/// touched. New contents are then written to temporary files next to their
+/// targets and renamed over them. If a rename fails, files already replaced
+/// are restored from the contents read at the start.
+class EditTransaction {
+  final PathSecurity _security;
+
+  /// Called with the first changed relative path and the growth in bytes
+  /// and inodes before anything is written; throwing aborts the
+  /// transaction.
+  final Future<void> Function(String path, int bytes, int inodes)? reserve;
+
+  /// Original content by resolved path (`null`: did not exist).
+  final _original = <String, String?>{};
+
+  /// Staged content by resolved path (`null`: deleted).
+  final _staged = <String, String?>{};
+
+  /// Workspace-relative path by resolved path, in first-touch order.
+  final _paths = <String, String>{};
+
+  /// Creates a transaction for the workspace guarded by [_security].
+  EditTransaction(this._security, {this.reserve});
+
+  /// Resolved paths of every file the transaction read or staged.
+  Iterable<String> get touchedPaths => _paths.keys;
+
+  /// Validates and applies [edits], returning the relative paths of the
+  /// files that changed.
+  Future<List<String>> apply(List<FileEdit> edits) async {
+    // Load every file named up front in parallel; patch targets are loaded
+    // as their sections are reached.
+    await Future.wait([
+      for (final edit in edits)
+        if (_pathOf(edit) case final path?) _load(path),
+    ]);
+    for (final edit in edits) {
+      await _stage(edit);
+    }
+    if (reserve case final reserve?) await _reserve(reserve);
+    return _commit();
+  }
+
+  static String? _pathOf(FileEdit edit) => switch (edit) {
+        ReplaceEdit(:final path) ||
+        WriteEdit(:final path) ||
+        DeleteEdit(:final path) =>
+          path,
+        PatchEdit(:final path) => path,
+      };
+
+  Future<String> _load(String path) async {
+    final resolved = _security.resolve(path);
+    _paths.putIfAbsent(resolved, () => path);
+    if (!_original.containsKey(resolved)) {
+      if (await Directory(resolved).exists()) {
+        throw EditException('Path is a directory', path);
+      }
+      final file = File(resolved);
+      _original[resolved] =
+          await file.exists() ? await file.readAsString() : null;
+    }
+    return resolved;
+  }
+
+  /// Current content of [path] with earlier edits applied.
+  Future<String?> _current(String path) async {
+    final resolved = await _load(path);
+    return _staged.containsKey(resolved)
+        ? _staged[resolved]
+        : _original[resolved];
+  }
+
+  Future<void> _set(String path, String? content) async {
+    _staged[await _load(path)] = content;
+  }
+
+  Future<void> _stage(FileEdit edit) async {
+    switch (edit) {
+      case ReplaceEdit(
+          :final path,
+          :final search,
+          :final replacement,
+          :final all
+        ):
+        final text = await _current(path);
+        if (text == null) throw EditException('File not found', path);
+        if (search.isEmpty) throw EditException('Empty search text', path);
+        final count = search.allMatches(text).length;
+        if (count == 0 || (!all && count > 1)) {
+          throw EditException(
+              count == 0
+                  ? 'Search text not found'
+                  : 'Search text found $count times, expected once',
+              path);
+        }
+        await _set(
+            path,
+            all
+                ? text.replaceAll(search, replacement)
+                : text.replaceFirst(search, replacement));
+      case WriteEdit(:final path, :final content):
+        await _set(path, content);
+      case DeleteEdit(:final path):
+        if (await _current(path) == null) {
+          throw EditException('File not found', path);
+        }
+        await _set(path, null);
+      case PatchEdit(:final patch, :final path):
+        await _stagePatch(patch, path);
+    }
+  }
+
+  Future<void> _stagePatch(String patch, String? target) async {
+    final List<FilePatch> files;
+    try {
+      files = parseUnifiedDiff(patch);
+    } on FormatException catch (e) {
+      throw EditException('Invalid patch: ${e.message}', target ?? '<patch>');
+    }
+    if (target != null && files.length != 1) {
+      throw EditException(
+          'Patch has ${files.length} files but a single path was given',
+          target);
+    }
+    for (final file in files) {
+      final from = target ?? file.oldPath;
+      final to = target ?? file.newPath;
+      final name = (to ?? from)!;
+      final String base;
+      if (from == null) {
+        if (await _current(to!) != null) {
+          throw EditException('File already exists', to);
+        }
+        base = '';
+      } else {
+        base = await _current(from) ??
+            (throw EditException('File not found', from));
+      }
+      final result = applyHunks(base, file.hunks, name);
+      if (from != null && from != to) await _set(from, null);
+      if (to != null) await _set(to, result);
+    }
+  }
+
+  Future<void> _reserve(
+      Future<void> Function(String, int, int) reserve) async {
+    var bytes = 0, inodes = 0;
+    String? first;
+    for (final MapEntry(key: path, value: staged) in _staged.entries) {
+      final original = _original[path];
+      if (staged == original) continue;
+      first ??= _paths[path];
+      bytes += (staged == null ? 0 : utf8.encode(staged).length) -
+          (original == null ? 0 : utf8.encode(original).length);
+      if (original == null) inodes++;
+      if (staged == null) inodes--;
+    }
+    if (first != null) await reserve(first, bytes, inodes);
+  }
+
+  Future<List<String>> _commit() async {
+    final changed = [
+      for (final path in _staged.keys)
+        if (_staged[path] != _original[path]) path,
+    ];
+    final suffix = '.${Random().nextInt(1 << 32).toRadixString(36)}.tmp';
+
+    // Write every new content to a temporary file first.
+    final temps = <String, String>{};
+    try {
+      await Future.wait([
+        for (final path in changed)
+          if (_staged[path] case final content?)
+            _writeTemp(path, '$path$suffix', content)
+                .then((temp) => temps[path] = temp),
+      ]);
+    } catch (_) {
+      await _deleteAll(temps.values);
+      rethrow;
+    }
+
+    // Then swap them in, undoing on failure.
+    final done = <String>[];
+    try {
+      for (final path in changed) {
+        final temp = temps[path];
+        if (temp != null) {
+          await File(temp).rename(path);
+        } else {
+          await File(path).delete();
+        }
+        done.add(path);
+      }
+    } catch (_) {
+      for (final path in done) {
+        await _restore(path);
+      }
+      await _deleteAll([
+        for (final path in changed)
+          if (!done.contains(path) && temps[path] != null) temps[path]!,
+      ]);
+      rethrow;
+    }
+    return [for (final path in changed) _paths[path]!];
+  }
+
+  /// Writes [content] to [temp]. Existing files are copied first so the
+  /// replacement keeps their permissions.
+  Future<String> _writeTemp(String path, String temp, String content) async {
+    final file = File(temp);
+    if (_original[path] != null) {
+      await File(path).copy(temp);
+    } else {
+      await file.parent.create(recursive: true);
+    }
+    await file.writeAsString(content, flush: true);
+    return temp;
+  }
+
+  Future<void> _restore(String path) async {
+    final original = _original[path];
+    try {
+      if (original == null) {
+        await File(path).delete();
+      } else {
+        await File(path).writeAsString(original, flush: true);
+      }
+    } catch (_) {
+      // Best effort: the original error is more useful to the caller.
+    }
+  }
+
+  static Future<void> _deleteAll(Iterable<String> paths) async {
+    for (final path in paths) {
+      try {
+        await File(path).delete();
+      } catch (_) {}
+    }
+  }
+}
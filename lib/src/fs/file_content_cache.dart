@@ -0,0 +1,183 @@
+import 'dart:collection';
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:path/path.dart' as p;
+
+/// Bounded, least-recently-used cache of file contents.
+///
+/// Used by [FileSystemService] when enabled, so files read many times in a
+/// row (manifests, configuration, sources under edit) are read from disk
+/// and decoded once. Entries are keyed by resolved path and validated on
+/// every lookup against the file's modification time, change time and
+/// size; a rename over the file or any write changes at least one of them.
+/// The service also evicts entries on its own writes and on file watcher
+/// events, which catches writes that keep the size within the timestamp
+/// resolution.
+///
+/// Sizes are counted in bytes: the raw contents plus, once a file has been
+/// read as text, two bytes per UTF-16 code unit of the decoded string.
+class FileContentCache {
+  /// Upper bound on [sizeBytes].
+  final int maxBytes;
+
+  /// Largest file that is cached; larger files are read from disk every
+  /// time so that one of them cannot flush the whole cache.
+  final int maxFileBytes;
+
+  /// Entries from least to most recently used.
+  final _entries = LinkedHashMap<String, _Entry>();
+
+  int _sizeBytes = 0;
+  int _hits = 0;
+  int _misses = 0;
+  int _evictions = 0;
+  int _invalidations = 0;
+
+  /// Creates an empty cache holding at most [maxBytes] bytes of content
+  /// (32 MiB by default). [maxFileBytes] defaults to an eighth of it.
+  FileContentCache({this.maxBytes = 32 << 20, int? maxFileBytes})
+      : maxFileBytes = maxFileBytes ?? maxBytes ~/ 8 {
+    if (maxBytes <= 0) {
+      throw ArgumentError.value(maxBytes, 'maxBytes', 'must be positive');
+    }
+  }
+
+  /// Bytes currently held.
+  int get sizeBytes => _sizeBytes;
+
+  /// Number of cached files.
+  int get length => _entries.length;
+
+  /// Reads served from the cache.
+  int get hits => _hits;
+
+  /// Reads that went to disk, including reads of files too large to cache.
+  int get misses => _misses;
+
+  /// Entries dropped to stay within [maxBytes].
+  int get evictions => _evictions;
+
+  /// Entries dropped because the file changed or was written.
+  int get invalidations => _invalidations;
+
+  /// Share of reads served from the cache, or 0 before the first read.
+  double get hitRate {
+    final total = _hits + _misses;
+    return total == 0 ? 0 : _hits / total;
+  }
+
+  /// Returns the bytes of the file at [path], an absolute resolved path.
+  ///
+  /// The result is a copy, so callers may modify it.
+  ///
+  /// Throws [FileSystemException] if the file doesn't exist.
+  Future<Uint8List> readBytes(String path) async =>
+      Uint8List.fromList((await _lookup(path)).bytes);
+
+  /// Returns the contents of the file at [path] decoded as UTF-8.
+  ///
+  /// Throws [FileSystemException] if the file doesn't exist or is not
+  /// valid UTF-8.
+  Future<String> readString(String path) async {
+    final entry = await _lookup(path);
+    if (entry.text case final text?) return text;
+    final String text;
+    try {
+      text = utf8.decode(entry.bytes);
+    } on FormatException catch (e) {
+      throw FileSystemException(
+          "Failed to decode data using encoding 'utf-8': ${e.message}", path);
+    }
+    // Files too large to cache have no entry to keep the text in.
+    if (identical(_entries[path], entry)) {
+      entry.text = text;
+      _sizeBytes += text.length * 2;
+      _trim();
+    }
+    return text;
+  }
+
+  /// Drops the entry for [path], if any.
+  void invalidate(String path) {
+    final entry = _entries.remove(path);
+    if (entry == null) return;
+    _sizeBytes -= entry.size;
+    _invalidations++;
+  }
+
+  /// Drops [path] and every entry below it.
+  void invalidateTree(String path) {
+    invalidate(path);
+    final prefix = path.endsWith(p.separator) ? path : '$path${p.separator}';
+    for (final key in [..._entries.keys.where((k) => k.startsWith(prefix))]) {
+      invalidate(key);
+    }
+  }
+
+  /// Drops every entry. Metrics are kept.
+  void clear() {
+    _entries.clear();
+    _sizeBytes = 0;
+  }
+
+  Future<_Entry> _lookup(String path) async {
+    final stat = await FileStat.stat(path);
+    if (stat.type != FileSystemEntityType.file) {
+      invalidate(path);
+      throw FileSystemException('File not found', path);
+    }
+    final cached = _entries.remove(path);
+    if (cached != null) {
+      if (cached.matches(stat)) {
+        _entries[path] = cached;
+        _hits++;
+        return cached;
+      }
+      _sizeBytes -= cached.size;
+      _invalidations++;
+    }
+    _misses++;
+    // Stamped with the stat taken before reading: a write racing with the
+    // read changes the stat, so the next lookup misses instead of serving
+    // stale bytes.
+    final entry = _Entry(stat, await File(path).readAsBytes());
+    if (entry.bytes.length <= maxFileBytes) {
+      final previous = _entries.remove(path);
+      if (previous != null) _sizeBytes -= previous.size;
+      _entries[path] = entry;
+      _sizeBytes += entry.size;
+      _trim();
+    }
+    return entry;
+  }
+
+  void _trim() {
+    while (_sizeBytes > maxBytes && _entries.isNotEmpty) {
+      final oldest = _entries.keys.first;
+      _sizeBytes -= _entries.remove(oldest)!.size;
+      _evictions++;
+    }
+  }
+}
+
+class _Entry {
+  final DateTime modified;
+  final DateTime changed;
+  final int length;
+  final Uint8List bytes;
+  String? text;
+
+  _Entry(FileStat stat, this.bytes)
+      : modified = stat.modified,
+        changed = stat.changed,
+        length = stat.size;
+
+  int get size => bytes.length + (text?.length ?? 0) * 2;
+
+  bool matches(FileStat stat) =>
+      stat.size == length &&
+      stat.modified == modified &&
+      stat.changed == changed;
+}
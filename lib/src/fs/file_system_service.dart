@@ -1,44 +1,249 @@
+import 'dart:async';
+import 'dart:convert';
 import 'dart:io';
+import 'dart:math';
+import 'dart:typed_data';
+import 'package:path/path.dart' as p;
 import '../core/path_security.dart';
+import '../models/disk_usage.dart';
+import '../models/file_edit.dart';
+import '../models/text_diff.dart';
 import '../util/file_system_helpers.dart';
+import '../util/isolate_pool.dart';
+import '../util/myers_diff.dart';
+import '../util/tree_walker.dart';
+import 'edit_transaction.dart';
+import 'file_content_cache.dart';
+import 'usage_tracker.dart';
 
 /// High-level file system service with path security validation.
 ///
 /// All operations are scoped to the workspace root directory and prevent
 /// path traversal attacks by validating paths before execution.
+///
+/// [tree], [grep], [find] and [copy] walk whole directory trees, so they run
+/// on an [IsolatePool] and keep the caller's isolate free for process output
+/// and events. [diff] does the same for large files.
+///
+/// [readFile] and [readBytes] can be served from a [FileContentCache]; see
+/// [enableCache]. [usage] is maintained incrementally and writes are checked
+/// against [quota].
 class FileSystemService {
+  /// Combined size above which [diff] runs on the isolate pool.
+  static const _inlineDiffBytes = 256 * 1024;
+
   final PathSecurity _security;
+  final IsolatePool? _pool;
+
+  /// Limits enforced on writes through this service, if any.
+  final DiskQuota? quota;
+
+  FileContentCache? _cache;
+  UsageTracker? _usage;
+  StreamSubscription<FileSystemEvent>? _watch;
+
+  /// Growth held by quota-checked writes still in flight, which [usage]
+  /// may not show yet.
+  int _reservedBytes = 0;
+  int _reservedInodes = 0;
 
   /// Creates a file system service for the given workspace root.
   ///
   /// All file operations will be restricted to paths within [rootPath].
-  FileSystemService(String rootPath) : _security = PathSecurity(rootPath);
+  /// Heavy operations use [pool], or [IsolatePool.shared] when omitted.
+  /// Writes that would exceed [quota] throw [QuotaExceededException].
+  FileSystemService(String rootPath, {IsolatePool? pool, this.quota})
+      : _security = PathSecurity(rootPath),
+        _pool = pool;
+
+  IsolatePool get _workers => _pool ?? IsolatePool.shared;
 
   /// The absolute path to the workspace root directory.
   String get rootPath => _security.rootPath;
 
+  /// The content cache, or `null` unless [enableCache] was called.
+  FileContentCache? get cache => _cache;
+
+  /// Serves [readFile] and [readBytes] from a [FileContentCache] of at most
+  /// [maxBytes] bytes and returns it, for example to read its hit and miss
+  /// counts.
+  ///
+  /// Cached contents are checked against the file's timestamps and size on
+  /// every read, evicted by this service's own writes, and evicted when the
+  /// workspace root's file watcher (inotify on Linux) reports a change.
+  /// Calling this again replaces the cache.
+  ///
+  /// Example:
+  /// ```
+  /// final cache = ws.fs.enableCache(maxBytes: 16 << 20);
+  /// await ws.fs.readFile('package.json'); // miss
+  /// await ws.fs.readFile('package.json'); // hit
+  /// print(cache.hitRate); // 0.5
+  /// ```
+  FileContentCache enableCache({int maxBytes = 32 << 20, int? maxFileBytes}) {
+    final cache = _cache =
+        FileContentCache(maxBytes: maxBytes, maxFileBytes: maxFileBytes);
+    _startWatch();
+    return cache;
+  }
+
+  /// Drops the content cache.
+  Future<void> disableCache() async {
+    _cache = null;
+    if (_usage == null) await _stopWatch();
+  }
+
+  /// Returns the bytes and inodes used below the workspace root.
+  ///
+  /// The first call walks the whole tree. After that, the workspace root's
+  /// file watcher (inotify on Linux) marks the directories that changed
+  /// and only those are listed again, so repeated calls cost little more
+  /// than the changes since the last one. Where file watching is not
+  /// supported, the tree is walked again after every command.
+  ///
+  /// Example:
+  /// ```
+  /// final usage = await ws.fs.usage();
+  /// print('${usage.bytes} bytes in ${usage.inodes} inodes');
+  /// ```
+  Future<DiskUsage> usage() => _tracker.refresh();
+
+  /// Tells the service that a command may have changed files.
+  ///
+  /// Only needed without a file watcher: the next [usage] call then walks
+  /// the whole tree again. Workspaces call this when a command exits.
+  void noteExternalChanges() {
+    if (_watch == null) _usage?.markAllChanged();
+  }
+
+  /// Stops the file watcher and drops the content cache and usage records.
+  Future<void> dispose() async {
+    _cache = null;
+    _usage = null;
+    await _stopWatch();
+  }
+
+  UsageTracker get _tracker {
+    if (_usage case final usage?) return usage;
+    _startWatch();
+    return _usage = UsageTracker(rootPath);
+  }
+
+  void _startWatch() {
+    if (_watch != null || !FileSystemEntity.isWatchSupported) return;
+    _watch = Directory(rootPath).watch(recursive: true).listen(_onWatchEvent,
+        // Events may have been lost; fall back to the stat checks and a
+        // full walk.
+        onError: (_) {
+      _cache?.clear();
+      _usage?.markAllChanged();
+    });
+  }
+
+  Future<void> _stopWatch() async {
+    final watch = _watch;
+    _watch = null;
+    await watch?.cancel();
+  }
+
+  void _onWatchEvent(FileSystemEvent event) {
+    final path = p.canonicalize(event.path);
+    // Deletions and moves may take whole directories with them.
+    final contentOnly =
+        event is FileSystemModifyEvent || event is FileSystemCreateEvent;
+    _changed(path, tree: !contentOnly);
+    if (event is FileSystemMoveEvent && event.destination != null) {
+      _changed(p.canonicalize(event.destination!), tree: true);
+    }
+  }
+
+  /// Drops cached contents of the resolved [path] (and everything below it
+  /// with [tree]) and marks it for the next [usage] pass.
+  void _changed(String path, {bool tree = false}) {
+    if (tree) {
+      _cache?.invalidateTree(path);
+    } else {
+      _cache?.invalidate(path);
+    }
+    _usage?.markChanged(path);
+  }
+
+  /// Throws [QuotaExceededException] if adding [bytes] and [inodes] (either
+  /// may be negative) would take the workspace over [quota]. Writes that do
+  /// not grow usage always pass.
+  ///
+  /// Otherwise the growth stays reserved, and counts against the quota of
+  /// concurrent writes, until the returned function is called once the
+  /// write is done and its change marked.
+  Future<void Function()> _reserve(String relativePath,
+      {required int bytes, required int inodes}) async {
+    final quota = this.quota;
+    if (quota == null || (bytes <= 0 && inodes <= 0)) return _noRelease;
+    // Held before the first await, so that writes checked at the same time
+    // see each other.
+    final heldBytes = max(bytes, 0), heldInodes = max(inodes, 0);
+    _reservedBytes += heldBytes;
+    _reservedInodes += heldInodes;
+    var held = true;
+    void release() {
+      if (!held) return;
+      held = false;
+      _reservedBytes -= heldBytes;
+      _reservedInodes -= heldInodes;
+    }
+
+    try {
+      final current = await usage();
+      final after = DiskUsage(
+          bytes: current.bytes + _reservedBytes - heldBytes + bytes,
+          files: current.files + _reservedInodes - heldInodes + inodes,
+          directories: current.directories);
+      if (quota.isExceededBy(after)) {
+        throw QuotaExceededException(quota, after, relativePath);
+      }
+    } catch (_) {
+      release();
+      rethrow;
+    }
+    return release;
+  }
+
+  static void _noRelease() {}
+
   /// Writes text content to a file.
   ///
   /// Creates parent directories automatically if they don't exist.
   ///
   /// Throws [SecurityException] if [relativePath] attempts to escape the workspace.
+  /// Throws [QuotaExceededException] if the write would exceed [quota].
   ///
   /// Example:
   /// ```
   /// await fs.writeFile('config.json', '{"debug": true}');
   /// ```
   Future<File> writeFile(String relativePath, String content) async {
+    // The encoded size is needed up front to check the quota.
+    if (quota != null) return writeBytes(relativePath, utf8.encode(content));
     final file = File(_security.resolve(relativePath));
     await file.parent.create(recursive: true);
-    return file.writeAsString(content);
+    try {
+      return await file.writeAsString(content);
+    } finally {
+      _changed(file.path);
+    }
   }
 
   /// Reads text content from a file.
   ///
+  /// Served from [cache] when enabled.
+  ///
   /// Throws [FileSystemException] if the file doesn't exist.
   /// Throws [SecurityException] if [relativePath] attempts to escape the workspace.
   Future<String> readFile(String relativePath) async {
     final file = File(_security.resolve(relativePath));
+    if (_cache case final cache?) {
+      return _cached(relativePath, () => cache.readString(file.path));
+    }
     if (!await file.exists()) {
       throw FileSystemException('File not found', relativePath);
     }
@@ -49,6 +254,8 @@ class FileSystemService {
   ///
   /// Creates parent directories automatically if they don't exist.
   ///
+  /// Throws [QuotaExceededException] if the write would exceed [quota].
+  ///
   /// Example:
   /// ```
   /// final imageBytes = await http.readBytes('https://example.com/image.png');
@@ -56,15 +263,33 @@ class FileSystemService {
   /// ```
   Future<File> writeBytes(String relativePath, List<int> bytes) async {
     final file = File(_security.resolve(relativePath));
-    await file.parent.create(recursive: true);
-    return file.writeAsBytes(bytes);
+    var release = _noRelease;
+    if (quota != null) {
+      final existing = await FileStat.stat(file.path);
+      final replaces = existing.type == FileSystemEntityType.file;
+      release = await _reserve(relativePath,
+          bytes: bytes.length - (replaces ? existing.size : 0),
+          inodes: replaces ? 0 : 1);
+    }
+    try {
+      await file.parent.create(recursive: true);
+      return await file.writeAsBytes(bytes);
+    } finally {
+      _changed(file.path);
+      release();
+    }
   }
 
   /// Reads binary data from a file.
   ///
+  /// Served from [cache] when enabled.
+  ///
   /// Throws [FileSystemException] if the file doesn't exist.
   Future<List<int>> readBytes(String relativePath) async {
     final file = File(_security.resolve(relativePath));
+    if (_cache case final cache?) {
+      return _cached(relativePath, () => cache.readBytes(file.path));
+    }
     if (!await file.exists()) {
       throw FileSystemException('File not found', relativePath);
     }
@@ -94,39 +319,155 @@ class FileSystemService {
 
   /// Generates a visual tree of the workspace directory structure.
   ///
+  /// Paths ignored by `.gitignore`/`.wsignore` files and dependency
+  /// directories such as `node_modules` are left out unless
+  /// [includeIgnored] is set; see [TreeWalker].
+  ///
   /// See [FileSystemHelpers.tree] for output format details.
-  Future<String> tree({int? maxDepth}) async {
+  Future<String> tree({int? maxDepth, bool includeIgnored = false}) async {
+    final root = _security.rootPath;
     final depth = maxDepth ?? 5;
-    return FileSystemHelpers.tree(_security.rootPath, maxDepth: depth);
+    return _offloadText(
+        _workers,
+        () => FileSystemHelpers.tree(root,
+            maxDepth: depth, includeIgnored: includeIgnored));
   }
 
   /// Searches for text patterns in workspace files.
   ///
+  /// Ignored paths are skipped as in [tree].
+  ///
   /// See [FileSystemHelpers.grep] for details on pattern matching.
   Future<String> grep(String pattern,
-      {bool recursive = true, bool caseSensitive = true}) async {
-    return FileSystemHelpers.grep(_security.rootPath, pattern,
-        recursive: recursive, caseSensitive: caseSensitive);
+      {bool recursive = true,
+      bool caseSensitive = true,
+      bool includeIgnored = false}) async {
+    final root = _security.rootPath;
+    return _offloadText(
+        _workers,
+        () => FileSystemHelpers.grep(root, pattern,
+            recursive: recursive,
+            caseSensitive: caseSensitive,
+            includeIgnored: includeIgnored));
   }
 
   /// Finds files matching a glob pattern.
   ///
+  /// Ignored paths are skipped as in [tree].
+  ///
   /// See [FileSystemHelpers.find] for pattern syntax.
-  Future<List<String>> find(String pattern) async {
-    return FileSystemHelpers.find(_security.rootPath, pattern);
+  Future<List<String>> find(String pattern,
+      {bool includeIgnored = false}) async {
+    final root = _security.rootPath;
+    // NUL cannot occur in a path, so it separates the results.
+    final joined = await _offloadText(
+        _workers,
+        () async => (await FileSystemHelpers.find(root, pattern,
+                includeIgnored: includeIgnored))
+            .join('\x00'));
+    return joined.isEmpty ? [] : joined.split('\x00');
+  }
+
+  /// Compares two text files line by line.
+  ///
+  /// Files of equal size are compared byte for byte first, so identical
+  /// files return [TextDiff.isIdentical] without being decoded or split.
+  /// Otherwise the files are diffed with [diffText], on the isolate pool
+  /// when they are large. Hunk labels are the given relative paths.
+  ///
+  /// Throws [FileSystemException] if either file doesn't exist.
+  /// Throws [SecurityException] if a path attempts to escape the workspace.
+  ///
+  /// Example:
+  /// ```
+  /// final diff = await fs.diff('expected.txt', 'out/actual.txt');
+  /// if (!diff.isIdentical) print(diff.unified);
+  /// ```
+  Future<TextDiff> diff(String oldPath, String newPath,
+      {int context = 3}) async {
+    final oldFile = File(_security.resolve(oldPath));
+    final newFile = File(_security.resolve(newPath));
+    for (final (file, path) in [(oldFile, oldPath), (newFile, newPath)]) {
+      if (!await file.exists()) {
+        throw FileSystemException('File not found', path);
+      }
+    }
+    final size = await oldFile.length() + await newFile.length();
+    if (size <= _inlineDiffBytes) {
+      return _diffFiles(oldFile.path, newFile.path, oldPath, newPath, context);
+    }
+    return _offloadDiff(
+        _workers, oldFile.path, newFile.path, oldPath, newPath, context);
+  }
+
+  /// Applies search/replace edits, writes, deletions and unified-diff
+  /// patches across many files as one all-or-nothing operation.
+  ///
+  /// Every edit is validated in memory first (search texts must match,
+  /// patch hunks must apply), so a failing edit throws [EditException]
+  /// before any file changes. New contents are written to temporary files
+  /// and renamed over their targets; if that fails midway, replaced files
+  /// are restored. Concurrent writers to the same files are not locked out.
+  ///
+  /// Returns the relative paths of the files that changed. Throws
+  /// [QuotaExceededException], before any file changes, if the result
+  /// would exceed [quota].
+  ///
+  /// Example:
+  /// ```
+  /// final changed = await fs.applyEdits([
+  ///   FileEdit.replace('lib/api.dart', 'fetchUser(', 'loadUser(', all: true),
+  ///   FileEdit.patch(await fs.readFile('fix.patch')),
+  /// ]);
+  /// ```
+  Future<List<String>> applyEdits(List<FileEdit> edits) async {
+    var release = _noRelease;
+    final transaction = EditTransaction(_security,
+        reserve: quota == null
+            ? null
+            : (path, bytes, inodes) async {
+                release = await _reserve(path, bytes: bytes, inodes: inodes);
+              });
+    try {
+      return await transaction.apply(edits);
+    } finally {
+      for (final path in transaction.touchedPaths) {
+        _changed(path);
+      }
+      release();
+    }
   }
 
   /// Copies a file or directory.
   ///
   /// Both paths are relative to the workspace root.
   ///
+  /// Throws [QuotaExceededException] if the copy would exceed [quota];
+  /// existing files at [destRel] are not credited.
+  ///
   /// Example:
   /// ```
   /// await fs.copy('template.txt', 'output/file.txt');
   /// ```
   Future<void> copy(String srcRel, String destRel) async {
-    await FileSystemHelpers.copy(
-        _security.resolve(srcRel), _security.resolve(destRel));
+    final src = _security.resolve(srcRel);
+    final dest = _security.resolve(destRel);
+    var release = _noRelease;
+    if (quota != null) {
+      await usage();
+      final copied = await _tracker.usageAt(src);
+      release = await _reserve(destRel,
+          bytes: copied.bytes, inodes: copied.inodes);
+    }
+    try {
+      await _workers.run(() async {
+        await FileSystemHelpers.copy(src, dest);
+        return Uint8List(0);
+      });
+    } finally {
+      _changed(dest, tree: true);
+      release();
+    }
   }
 
   /// Moves a file or directory.
@@ -138,8 +479,14 @@ class FileSystemService {
   /// await fs.move('old_name.txt', 'new_name.txt');
   /// ```
   Future<void> move(String srcRel, String destRel) async {
-    await FileSystemHelpers.move(
-        _security.resolve(srcRel), _security.resolve(destRel));
+    final src = _security.resolve(srcRel);
+    final dest = _security.resolve(destRel);
+    try {
+      await FileSystemHelpers.move(src, dest);
+    } finally {
+      _changed(src, tree: true);
+      _changed(dest, tree: true);
+    }
   }
 
   /// Deletes a file or directory.
@@ -148,6 +495,61 @@ class FileSystemService {
   ///
   /// Throws [FileSystemException] if the path doesn't exist.
   Future<void> delete(String relativePath) async {
-    await FileSystemHelpers.delete(_security.resolve(relativePath));
+    final path = _security.resolve(relativePath);
+    try {
+      await FileSystemHelpers.delete(path);
+    } finally {
+      _changed(path, tree: true);
+    }
+  }
+
+  /// Reports a missing file by its workspace-relative path, as the uncached
+  /// reads do.
+  Future<T> _cached<T>(
+      String relativePath, Future<T> Function() read) async {
+    try {
+      return await read();
+    } on FileSystemException catch (e) {
+      if (e.message != 'File not found') rethrow;
+      throw FileSystemException('File not found', relativePath);
+    }
+  }
+}
+
+/// Runs [task] on [pool] and transfers its text back as UTF-8.
+///
+/// Top-level so that the closure sent to the worker captures only [task].
+Future<String> _offloadText(
+    IsolatePool pool, Future<String> Function() task) async {
+  final bytes = await pool.run(() async => utf8.encoder.convert(await task()));
+  return utf8.decode(bytes);
+}
+
+/// Runs [_diffFiles] on [pool].
+Future<TextDiff> _offloadDiff(IsolatePool pool, String oldFile,
+    String newFile, String fromLabel, String toLabel, int context) async {
+  final bytes = await pool.run(() async => encodeTextDiff(
+      await _diffFiles(oldFile, newFile, fromLabel, toLabel, context)));
+  return decodeTextDiff(bytes);
+}
+
+/// Diffs two files, skipping the line diff when their bytes are equal.
+Future<TextDiff> _diffFiles(String oldFile, String newFile, String fromLabel,
+    String toLabel, int context) async {
+  final (oldBytes, newBytes) =
+      await (File(oldFile).readAsBytes(), File(newFile).readAsBytes()).wait;
+  if (_sameBytes(oldBytes, newBytes)) {
+    return TextDiff(fromLabel, toLabel, const []);
+  }
+  return diffText(utf8.decode(oldBytes, allowMalformed: true),
+      utf8.decode(newBytes, allowMalformed: true),
+      context: context, fromLabel: fromLabel, toLabel: toLabel);
+}
+
+bool _sameBytes(Uint8List a, Uint8List b) {
+  if (a.length != b.length) return false;
+  for (var i = 0; i < a.length; i++) {
+    if (a[i] != b[i]) return false;
   }
+  return true;
 }
@@ -0,0 +1,190 @@
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+
+import '../models/disk_usage.dart';
+
+/// Incrementally maintained disk usage of a directory tree.
+///
+/// Keeps, per directory, the total size and count of the files directly in
+/// it and the set of its subdirectories. Changes are reported with
+/// [markChanged], which only marks the containing directory dirty; [refresh]
+/// then re-lists the dirty directories alone, scans subdirectories that
+/// appeared and drops the records of those that went away. The first
+/// [refresh] walks the whole tree.
+///
+/// Paths are keyed by [p.canonicalize], as the file watcher's events are
+/// reported, so that case differences on Windows still match.
+class UsageTracker {
+  /// Canonical path of the tracked directory.
+  final String rootPath;
+
+  /// Records by canonical directory path.
+  final _dirs = <String, _DirRecord>{};
+
+  /// Directories to re-list on the next [refresh].
+  final _dirty = <String>{};
+
+  int _bytes = 0;
+  int _files = 0;
+  Future<DiskUsage>? _refreshing;
+
+  /// Creates a tracker; nothing is read until [refresh].
+  UsageTracker(String rootPath) : rootPath = p.canonicalize(rootPath) {
+    _dirty.add(rootPath);
+  }
+
+  /// Usage as of the last [refresh].
+  DiskUsage get current => DiskUsage(
+      bytes: _bytes,
+      files: _files,
+      directories: _dirs.isEmpty ? 0 : _dirs.length - 1);
+
+  /// Notes that the entry at [path] was created, modified, deleted or
+  /// moved.
+  void markChanged(String path) {
+    path = p.canonicalize(path);
+    if (_dirs.containsKey(path)) _dirty.add(path);
+    // The nearest known ancestor picks up a new or vanished entry; new
+    // directories below it are scanned in full.
+    var dir = p.dirname(path);
+    while (!_dirs.containsKey(dir)) {
+      if (!p.isWithin(rootPath, dir)) {
+        dir = rootPath;
+        break;
+      }
+      dir = p.dirname(dir);
+    }
+    _dirty.add(dir);
+  }
+
+  /// Marks every directory dirty, so the next [refresh] re-lists the whole
+  /// tree. Used when changes may have been missed.
+  void markAllChanged() {
+    _dirty
+      ..add(rootPath)
+      ..addAll(_dirs.keys);
+  }
+
+  /// Re-lists dirty directories and returns the updated usage.
+  ///
+  /// Concurrent calls share one pass; directories marked during a pass are
+  /// handled before it completes.
+  Future<DiskUsage> refresh() =>
+      _refreshing ??= _drain().whenComplete(() => _refreshing = null);
+
+  /// Usage of the entry at [path], as of the last [refresh] for a
+  /// directory (which counts itself among [DiskUsage.directories]).
+  Future<DiskUsage> usageAt(String path) async {
+    path = p.canonicalize(path);
+    if (!_dirs.containsKey(path)) {
+      final stat = await FileStat.stat(path);
+      return stat.type == FileSystemEntityType.notFound
+          ? const DiskUsage(bytes: 0, files: 0, directories: 0)
+          : DiskUsage(
+              bytes: stat.type == FileSystemEntityType.file ? stat.size : 0,
+              files: 1,
+              directories: 0);
+    }
+    var bytes = 0, files = 0, directories = 0;
+    final pending = [path];
+    while (pending.isNotEmpty) {
+      final record = _dirs[pending.removeLast()];
+      if (record == null) continue;
+      bytes += record.bytes;
+      files += record.files;
+      directories++;
+      pending.addAll(record.children);
+    }
+    return DiskUsage(bytes: bytes, files: files, directories: directories);
+  }
+
+  Future<DiskUsage> _drain() async {
+    while (_dirty.isNotEmpty) {
+      final dir = _dirty.first;
+      _dirty.remove(dir);
+      await _relist(dir);
+    }
+    return current;
+  }
+
+  Future<void> _relist(String dir) async {
+    final entities = <FileSystemEntity>[];
+    try {
+      await for (final entity in Directory(dir).list(followLinks: false)) {
+        entities.add(entity);
+      }
+    } on FileSystemException {
+      if (dir == rootPath) {
+        _replace(dir, _DirRecord(0, 0, const {}));
+      } else {
+        _drop(dir);
+      }
+      return;
+    }
+
+    final children = {
+      for (final entity in entities)
+        if (entity is Directory) p.canonicalize(entity.path),
+    };
+    final sizes = await Future.wait([
+      for (final entity in entities)
+        if (entity is File) _sizeOf(entity),
+    ]);
+    final files = entities.length - children.length;
+    final bytes = sizes.fold(0, (sum, size) => sum + size);
+
+    final previous = _dirs[dir];
+    if (previous != null) {
+      for (final child in previous.children.difference(children)) {
+        _drop(child);
+      }
+    }
+    for (final child in children) {
+      if (!_dirs.containsKey(child)) _dirty.add(child);
+    }
+    _replace(dir, _DirRecord(bytes, files, children));
+  }
+
+  /// Size of [file], or 0 if it vanished since the listing.
+  static Future<int> _sizeOf(File file) async {
+    final size = (await file.stat()).size;
+    return size < 0 ? 0 : size;
+  }
+
+  void _replace(String dir, _DirRecord record) {
+    final previous = _dirs[dir];
+    if (previous != null) {
+      _bytes -= previous.bytes;
+      _files -= previous.files;
+    }
+    _dirs[dir] = record;
+    _bytes += record.bytes;
+    _files += record.files;
+  }
+
+  /// Removes the records of [dir] and everything below it.
+  void _drop(String dir) {
+    final record = _dirs.remove(dir);
+    _dirty.remove(dir);
+    if (record == null) return;
+    _bytes -= record.bytes;
+    _files -= record.files;
+    for (final child in record.children) {
+      _drop(child);
+    }
+  }
+}
+
+class _DirRecord {
+  /// Total size of the files directly in the directory.
+  final int bytes;
+
+  /// Number of non-directory entries directly in the directory.
+  final int files;
+
+  /// Canonical paths of the subdirectories.
+  final Set<String> children;
+
+  _DirRecord(this.bytes, this.files, this.children);
+}
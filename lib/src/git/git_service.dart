@@ -0,0 +1,134 @@
+import 'dart:convert';
+import 'dart:io';
+
+import '../core/launcher_service.dart';
+import '../models/git_status.dart';
+import '../native/in_process_launcher.dart';
+
+/// Git queries on a workspace, answered by the launcher without spawning
+/// `git`.
+///
+/// The launcher reads the index, `HEAD` and the worktree directly. It
+/// trusts the stat data recorded in the index and only hashes files whose
+/// size or timestamps changed, like `git status` does.
+///
+/// While [InProcessLauncher] is enabled the query runs inside the shared
+/// library, which keeps a cache per workspace between calls: the parsed
+/// index, the flattened `HEAD` tree, hashes of files that no longer match
+/// the index and, with `untrackedCache`, directory listings. Otherwise each
+/// call starts the launcher binary and nothing is reused.
+///
+/// Clean/smudge filters, `core.autocrlf` and submodule contents are not
+/// evaluated; renames are reported as a deletion plus an addition.
+/// Repositories using a split or sparse index are answered by running
+/// `git status` instead.
+///
+/// Example:
+/// ```
+/// final status = await ws.git.status();
+/// for (final entry in status.entries) {
+///   print(entry); // " M lib/main.dart"
+/// }
+/// ```
+class GitService {
+  /// Workspace root; the repository is found from here upwards.
+  final String rootPath;
+
+  /// Creates a git service for the workspace at [rootPath].
+  GitService(this.rootPath);
+
+  /// Reports staged, unstaged and untracked changes below [rootPath], as
+  /// `git status --porcelain` would inside it, with paths relative to
+  /// [rootPath].
+  ///
+  /// Set [untrackedCache] to skip re-reading directories whose modification
+  /// time did not change since the previous call (in-process only).
+  ///
+  /// Throws [GitException] if the workspace is not in a git repository or
+  /// the repository cannot be read.
+  Future<GitStatus> status(
+      {GitUntracked untracked = GitUntracked.normal,
+      bool untrackedCache = false}) async {
+    final native = InProcessLauncher.shared;
+    final json = native != null
+        ? await native.gitStatus(rootPath, _flags(untracked, untrackedCache))
+        : await _runLauncher(untracked);
+    final decoded = jsonDecode(json) as Map<String, dynamic>;
+    if (decoded['unsupported'] != null) return _runGit(untracked);
+    return GitStatus.fromJson(decoded);
+  }
+
+  /// Paths that differ from `HEAD`: staged, modified, deleted and, unless
+  /// [includeUntracked] is `false`, untracked files (listed individually).
+  Future<List<String>> changedFiles(
+      {bool includeUntracked = true, bool untrackedCache = false}) async {
+    final result = await status(
+        untracked: includeUntracked ? GitUntracked.all : GitUntracked.no,
+        untrackedCache: untrackedCache);
+    // A path removed from the index but still on disk is listed twice.
+    return {for (final entry in result.entries) entry.path}.toList();
+  }
+
+  static int _flags(GitUntracked untracked, bool untrackedCache) =>
+      (untrackedCache ? InProcessLauncher.gitUntrackedCache : 0) |
+      switch (untracked) {
+        GitUntracked.no => InProcessLauncher.gitUntrackedNo,
+        GitUntracked.normal => 0,
+        GitUntracked.all => InProcessLauncher.gitUntrackedAll,
+      };
+
+  /// Asks `git` itself, for repositories the launcher cannot read.
+  Future<GitStatus> _runGit(GitUntracked untracked) async {
+    Future<String?> git(List<String> args) async {
+      final result =
+          await Process.run('git', args, workingDirectory: rootPath);
+      return result.exitCode == 0 ? (result.stdout as String).trim() : null;
+    }
+
+    final result = await Process.run(
+        'git',
+        [
+          'status',
+          '--porcelain=v1',
+          '-z',
+          '--no-renames',
+          '--untracked-files=${untracked.name}',
+          '--',
+          '.',
+        ],
+        workingDirectory: rootPath);
+    if (result.exitCode != 0) {
+      throw GitException((result.stderr as String).trim());
+    }
+    // Porcelain paths are relative to the repository root.
+    final prefix = await git(['rev-parse', '--show-prefix']) ?? '';
+    final entries = [
+      for (final record in (result.stdout as String).split('\x00'))
+        if (record.length > 3)
+          GitFileStatus(
+              record.substring(3 + prefix.length), record[0], record[1]),
+    ]..sort((a, b) => a.path.compareTo(b.path));
+    return GitStatus(
+      branch: await git(['symbolic-ref', '--short', '-q', 'HEAD']),
+      head: await git(['rev-parse', '-q', '--verify', 'HEAD']),
+      entries: entries,
+    );
+  }
+
+  Future<String> _runLauncher(GitUntracked untracked) async {
+    final launcher = await LauncherService.findBinary();
+    final result = await Process.run(launcher, [
+      '--git-status',
+      '--workspace',
+      rootPath,
+      '--git-untracked',
+      untracked.name,
+    ]);
+    if (result.exitCode != 0) {
+      final message = (result.stderr as String).trim();
+      throw GitException(
+          message.replaceFirst(RegExp(r'^\[Launcher\] ERROR: '), ''));
+    }
+    return result.stdout as String;
+  }
+}
@@ -0,0 +1,166 @@
+import 'package:path/path.dart' as p;
+
+/// A host directory shared read-write across sandboxed workspaces.
+///
+/// Sandboxes normally expose tool caches (`~/.npm`, `~/.cargo`, ...)
+/// read-only, so every workspace re-downloads the same dependencies. A
+/// cache mount makes [path] writable inside the sandbox and points the
+/// package manager at it through [env], so the first install populates the
+/// cache and later workspaces get cache hits.
+///
+/// Tool homes that also hold configuration or executables (`CARGO_HOME`,
+/// `PUB_CACHE`, ...) list the content entries in [writable]: only those
+/// are writable inside the sandbox and the rest of [path] is read-only, so
+/// one workspace cannot plant configuration, init scripts or `bin/` shims
+/// that run in the next.
+///
+/// The launcher holds an advisory lock on `<path>.lock` for the lifetime of
+/// each command: shared by default, or exclusive when [exclusive] is set for
+/// tools whose cache layout is not safe for concurrent writers. Maintenance
+/// jobs (pruning, rebuilding) can take the exclusive lock to keep commands
+/// out while they run.
+///
+/// Example:
+/// ```
+/// final ws = Workspace.ephemeral(
+///   options: WorkspaceOptions(
+///     caches: CacheMount.defaults('/var/cache/agents'),
+///   ),
+/// );
+/// await ws.exec('npm install'); // populates /var/cache/agents/npm
+/// ```
+class CacheMount {
+  /// Absolute host path of the cache directory. Created if missing.
+  final String path;
+
+  /// Environment variables that direct the tool to [path].
+  final Map<String, String> env;
+
+  /// Values appended, space-separated, to the command's environment
+  /// variable of the same name rather than replacing it.
+  final Map<String, String> appendEnv;
+
+  /// Whether commands using this cache must run one at a time.
+  final bool exclusive;
+
+  /// Entries of [path] the sandbox may write, relative to it; directories
+  /// end in `/`. Empty makes all of [path] writable.
+  final List<String> writable;
+
+  /// Creates a cache mount for an arbitrary directory.
+  const CacheMount(this.path,
+      {this.env = const {},
+      this.appendEnv = const {},
+      this.exclusive = false,
+      this.writable = const []});
+
+  /// npm content-addressed cache (`npm_config_cache`).
+  factory CacheMount.npm(String root) {
+    final dir = p.join(root, 'npm');
+    return CacheMount(dir, env: {'npm_config_cache': dir});
+  }
+
+  /// Yarn classic cache (`YARN_CACHE_FOLDER`).
+  factory CacheMount.yarn(String root) {
+    final dir = p.join(root, 'yarn');
+    return CacheMount(dir, env: {'YARN_CACHE_FOLDER': dir});
+  }
+
+  /// pnpm content-addressable store (`npm_config_store_dir`).
+  factory CacheMount.pnpm(String root) {
+    final dir = p.join(root, 'pnpm');
+    return CacheMount(dir, env: {'npm_config_store_dir': dir});
+  }
+
+  /// pip wheel and HTTP cache (`PIP_CACHE_DIR`).
+  factory CacheMount.pip(String root) {
+    final dir = p.join(root, 'pip');
+    return CacheMount(dir, env: {'PIP_CACHE_DIR': dir});
+  }
+
+  /// Dart/Flutter package cache (`PUB_CACHE`).
+  ///
+  /// Only downloaded packages are shared; globally activated packages and
+  /// their `bin/` scripts stay read-only.
+  factory CacheMount.pub(String root) {
+    final dir = p.join(root, 'pub');
+    return CacheMount(dir, env: {'PUB_CACHE': dir}, writable: const [
+      'hosted/',
+      'hosted-hashes/',
+      'git/',
+      '_temp/',
+      'active_roots/',
+      'README.md',
+    ]);
+  }
+
+  /// Cargo registry and git checkouts (`CARGO_HOME`).
+  ///
+  /// Cargo serializes access to its package cache with its own lock.
+  /// `config.toml`, credentials and installed binaries stay read-only.
+  factory CacheMount.cargo(String root) {
+    final dir = p.join(root, 'cargo');
+    return CacheMount(dir, env: {'CARGO_HOME': dir}, writable: cargoEntries);
+  }
+
+  /// The entries of a `CARGO_HOME` cargo writes while fetching packages.
+  static const cargoEntries = [
+    'registry/',
+    'git/',
+    '.package-cache',
+    '.package-cache-mutate',
+    '.global-cache',
+  ];
+
+  /// Go module cache (`GOMODCACHE`).
+  factory CacheMount.go(String root) {
+    final dir = p.join(root, 'gomod');
+    return CacheMount(dir, env: {'GOMODCACHE': dir});
+  }
+
+  /// Maven local repository, added to the command's `MAVEN_OPTS`.
+  ///
+  /// Maven does not coordinate concurrent writers, so commands using this
+  /// cache are serialized.
+  factory CacheMount.maven(String root) {
+    final dir = p.join(root, 'm2');
+    return CacheMount(dir,
+        appendEnv: {
+          'MAVEN_OPTS': '-Dmaven.repo.local=${p.join(dir, 'repository')}',
+        },
+        exclusive: true,
+        writable: const ['repository/']);
+  }
+
+  /// Gradle user home (`GRADLE_USER_HOME`).
+  ///
+  /// `gradle.properties` and init scripts stay read-only; the caches,
+  /// wrapper distributions and daemon state Gradle writes at run time are
+  /// shared.
+  factory CacheMount.gradle(String root) {
+    final dir = p.join(root, 'gradle');
+    return CacheMount(dir, env: {'GRADLE_USER_HOME': dir}, writable: const [
+      'caches/',
+      'wrapper/',
+      'daemon/',
+      'native/',
+      '.tmp/',
+    ]);
+  }
+
+  /// All presets, each in its own subdirectory of [root].
+  static List<CacheMount> defaults(String root) => [
+        CacheMount.npm(root),
+        CacheMount.yarn(root),
+        CacheMount.pnpm(root),
+        CacheMount.pip(root),
+        CacheMount.pub(root),
+        CacheMount.cargo(root),
+        CacheMount.go(root),
+        CacheMount.maven(root),
+        CacheMount.gradle(root),
+      ];
+
+  @override
+  String toString() => 'CacheMount($path${exclusive ? ', exclusive' : ''})';
+}
@@ -1,3 +1,8 @@
+import 'file_access.dart';
+import 'output_filter.dart';
+import 'output_redirect.dart';
+import 'workspace_process.dart';
+
 /// Final result of a command executed inside a workspace.
 ///
 /// Similar to [ProcessResult] from `dart:io`, but tailored for the workspace
@@ -39,6 +44,26 @@ class CommandResult {
   /// [exitCode] is set.
   final bool isCancelled;
 
+  /// Why the process was ended early, if it was; see
+  /// [WorkspaceProcess.terminationReason].
+  final TerminationReason? terminationReason;
+
+  /// Where stdout went when redirected with [WorkspaceOptions.stdoutTo].
+  ///
+  /// [stdout] is empty in that case unless the redirect tees.
+  final RedirectedOutput? stdoutFile;
+
+  /// Where stderr went when redirected with [WorkspaceOptions.stderrTo].
+  final RedirectedOutput? stderrFile;
+
+  /// Files the command read and wrote, when run with
+  /// [WorkspaceOptions.traceFileAccess]; see [WorkspaceProcess.fileAccess].
+  final FileAccess? fileAccess;
+
+  /// Output byte counts before and after [WorkspaceOptions.outputFilter];
+  /// see [WorkspaceProcess.outputStats].
+  final OutputStats? outputStats;
+
   /// Creates an immutable command execution result.
   const CommandResult({
     required this.exitCode,
@@ -46,6 +71,11 @@ class CommandResult {
     required this.stderr,
     required this.duration,
     this.isCancelled = false,
+    this.terminationReason,
+    this.stdoutFile,
+    this.stderrFile,
+    this.fileAccess,
+    this.outputStats,
   });
 
   /// Convenience flag indicating whether [exitCode] equals `0`.
@@ -63,3 +93,23 @@ class CommandResult {
         ')';
   }
 }
+
+/// Result of [Workspace.execJson]: a [CommandResult] whose stdout was
+/// decoded as one JSON document while it streamed in.
+///
+/// [stdout] is always empty; the text is never held as a whole.
+class JsonCommandResult extends CommandResult {
+  /// The decoded document: `Map`, `List`, `String`, `num`, `bool` or
+  /// `null`, as returned by `jsonDecode`.
+  final Object? json;
+
+  /// Creates a result holding the decoded [json].
+  const JsonCommandResult({
+    required this.json,
+    required super.exitCode,
+    required super.stderr,
+    required super.duration,
+    super.isCancelled,
+    super.terminationReason,
+  }) : super(stdout: '');
+}
@@ -0,0 +1,78 @@
+/// Space used by a workspace, as returned by [Workspace.usage].
+///
+/// Sizes are apparent file sizes (what `du --apparent-size` reports), not
+/// allocated blocks. Symbolic links are counted as files of size zero and
+/// never followed.
+class DiskUsage {
+  /// Total size of all files, in bytes.
+  final int bytes;
+
+  /// Number of files, links and other non-directory entries.
+  final int files;
+
+  /// Number of directories below the root.
+  final int directories;
+
+  /// Creates a usage snapshot.
+  const DiskUsage(
+      {required this.bytes, required this.files, required this.directories});
+
+  /// Number of inodes in use: [files] plus [directories].
+  int get inodes => files + directories;
+
+  @override
+  String toString() =>
+      'DiskUsage(bytes: $bytes, files: $files, directories: $directories)';
+}
+
+/// Disk limits for a workspace, set with [WorkspaceOptions.diskQuota].
+///
+/// Writes through [FileSystemService] that would cross a limit throw
+/// [QuotaExceededException] before touching the disk. Commands are
+/// checked while they run and killed once the workspace is over a limit.
+class DiskQuota {
+  /// Largest total file size in bytes, or `null` for no limit.
+  final int? maxBytes;
+
+  /// Largest number of inodes ([DiskUsage.inodes]), or `null` for no
+  /// limit.
+  final int? maxInodes;
+
+  /// How often usage is checked while commands run.
+  final Duration checkInterval;
+
+  /// Creates a quota.
+  const DiskQuota(
+      {this.maxBytes,
+      this.maxInodes,
+      this.checkInterval = const Duration(milliseconds: 500)});
+
+  /// Whether [usage] is over a limit.
+  bool isExceededBy(DiskUsage usage) =>
+      (maxBytes != null && usage.bytes > maxBytes!) ||
+      (maxInodes != null && usage.inodes > maxInodes!);
+
+  @override
+  String toString() =>
+      'DiskQuota(maxBytes: $maxBytes, maxInodes: $maxInodes)';
+}
+
+/// Thrown when a write would take a workspace over its [DiskQuota].
+class QuotaExceededException implements Exception {
+  /// The quota that would be exceeded.
+  final DiskQuota quota;
+
+  /// Usage the write would have resulted in.
+  final DiskUsage usage;
+
+  /// Workspace-relative path of the rejected write.
+  final String path;
+
+  /// Creates a quota exception.
+  const QuotaExceededException(this.quota, this.usage, this.path);
+
+  @override
+  String toString() =>
+      'QuotaExceededException: writing $path would exceed $quota '
+      '(${usage.bytes} bytes, ${usage.inodes} inodes)';
+}
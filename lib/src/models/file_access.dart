@@ -0,0 +1,46 @@
+import 'package:path/path.dart' as p;
+
+/// Files a command read and wrote, recorded with
+/// [WorkspaceOptions.traceFileAccess].
+///
+/// Paths are absolute, deduplicated and sorted, as seen by the command
+/// (inside a Bubblewrap sandbox the workspace keeps its host path). A file
+/// the command wrote before reading it is only listed in [writes]; a file
+/// it read and then overwrote is in both. Creating, deleting and renaming
+/// count as writes (both ends of a rename), and calls are recorded whether
+/// or not they succeed, so lookups of missing files show up as reads.
+/// `/proc`, `/dev` and `/sys` are left out.
+class FileAccess {
+  /// Files and directories opened for reading.
+  final List<String> reads;
+
+  /// Files and directories created, modified, renamed or deleted.
+  final List<String> writes;
+
+  /// Creates an access record.
+  const FileAccess({required this.reads, required this.writes});
+
+  /// Parses the launcher's trace output.
+  factory FileAccess.fromJson(Map<String, Object?> json) => FileAccess(
+        reads: [...json['reads'] as List<Object?>].cast<String>(),
+        writes: [...json['writes'] as List<Object?>].cast<String>(),
+      );
+
+  /// The accesses below [root], as paths relative to it.
+  ///
+  /// Useful to key caches on the workspace inputs alone, leaving out
+  /// toolchains and system libraries.
+  FileAccess relativeTo(String root) => FileAccess(
+        reads: _within(reads, root),
+        writes: _within(writes, root),
+      );
+
+  static List<String> _within(List<String> paths, String root) => [
+        for (final path in paths)
+          if (p.isWithin(root, path)) p.relative(path, from: root),
+      ];
+
+  @override
+  String toString() =>
+      'FileAccess(reads: ${reads.length}, writes: ${writes.length})';
+}
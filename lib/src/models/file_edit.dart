@@ -0,0 +1,108 @@
+/// One change applied by `fs.applyEdits`.
+///
+/// Edits to the same file apply in list order, each seeing the result of
+/// the previous ones.
+///
+/// Example:
+/// ```
+/// await ws.fs.applyEdits([
+///   FileEdit.replace('lib/a.dart', 'oldName(', 'newName('),
+///   FileEdit.write('lib/b.dart', 'void main() {}\n'),
+///   FileEdit.patch(diff.unified),
+///   FileEdit.delete('lib/legacy.dart'),
+/// ]);
+/// ```
+sealed class FileEdit {
+  const FileEdit();
+
+  /// Replaces [search] in [path] with [replacement].
+  ///
+  /// [search] must occur exactly once unless [all] is set, in which case it
+  /// must occur at least once and every occurrence is replaced.
+  const factory FileEdit.replace(String path, String search, String replacement,
+      {bool all}) = ReplaceEdit;
+
+  /// Creates or overwrites [path] with [content].
+  const factory FileEdit.write(String path, String content) = WriteEdit;
+
+  /// Deletes the file at [path], which must exist.
+  const factory FileEdit.delete(String path) = DeleteEdit;
+
+  /// Applies a unified diff, such as `git diff` output or
+  /// [TextDiff.unified].
+  ///
+  /// Target files come from the `---` / `+++` headers (`a/` and `b/`
+  /// prefixes are stripped, `/dev/null` creates or deletes a file). Pass
+  /// [path] to apply a single-file patch to another file.
+  const factory FileEdit.patch(String patch, {String? path}) = PatchEdit;
+}
+
+/// A search/replace edit; see [FileEdit.replace].
+final class ReplaceEdit extends FileEdit {
+  /// File path relative to the workspace root.
+  final String path;
+
+  /// Exact text to find.
+  final String search;
+
+  /// Text inserted instead.
+  final String replacement;
+
+  /// Whether to replace every occurrence.
+  final bool all;
+
+  /// Creates a search/replace edit.
+  const ReplaceEdit(this.path, this.search, this.replacement,
+      {this.all = false});
+}
+
+/// A whole-file write; see [FileEdit.write].
+final class WriteEdit extends FileEdit {
+  /// File path relative to the workspace root.
+  final String path;
+
+  /// New file content.
+  final String content;
+
+  /// Creates a write edit.
+  const WriteEdit(this.path, this.content);
+}
+
+/// A file deletion; see [FileEdit.delete].
+final class DeleteEdit extends FileEdit {
+  /// File path relative to the workspace root.
+  final String path;
+
+  /// Creates a delete edit.
+  const DeleteEdit(this.path);
+}
+
+/// A unified diff; see [FileEdit.patch].
+final class PatchEdit extends FileEdit {
+  /// The unified diff text.
+  final String patch;
+
+  /// Overrides the target of a single-file patch.
+  final String? path;
+
+  /// Creates a patch edit.
+  const PatchEdit(this.patch, {this.path});
+}
+
+/// Exception thrown when an edit cannot be applied.
+///
+/// Thrown by `fs.applyEdits` before any file is written, e.g. when a search
+/// text or patch hunk does not match.
+class EditException implements Exception {
+  /// Human-readable error message.
+  final String message;
+
+  /// Path of the file the failing edit targets.
+  final String path;
+
+  /// Creates an edit exception.
+  EditException(this.message, this.path);
+
+  @override
+  String toString() => 'EditException: $message (path: "$path")';
+}
@@ -0,0 +1,99 @@
+/// Which untracked files [GitStatus] reports, as `git status -u<mode>`.
+enum GitUntracked {
+  /// None.
+  no,
+
+  /// Untracked files, with directories that hold no tracked file collapsed
+  /// into one `dir/` entry.
+  normal,
+
+  /// Every untracked file individually.
+  all,
+}
+
+/// Status of one changed path.
+///
+/// [index] and [worktree] are the `XY` codes of `git status --porcelain`:
+/// `' '` unchanged, `M` modified, `A` added, `D` deleted, `T` type changed,
+/// `U` unmerged and `?` untracked.
+class GitFileStatus {
+  /// Path relative to the workspace root, with `/` separators. Collapsed
+  /// untracked directories end with `/`.
+  final String path;
+
+  /// Change staged in the index relative to `HEAD`.
+  final String index;
+
+  /// Change in the working tree relative to the index.
+  final String worktree;
+
+  /// Creates a file status.
+  const GitFileStatus(this.path, this.index, this.worktree);
+
+  /// Whether the path is not tracked.
+  bool get isUntracked => index == '?';
+
+  /// Whether the path has unresolved merge conflicts.
+  bool get isConflicted =>
+      index == 'U' ||
+      worktree == 'U' ||
+      (index == 'A' && worktree == 'A') ||
+      (index == 'D' && worktree == 'D');
+
+  /// Whether the index differs from `HEAD`.
+  bool get isStaged => !isUntracked && !isConflicted && index != ' ';
+
+  /// The porcelain status line, e.g. `MM lib/a.dart`.
+  @override
+  String toString() => '$index$worktree $path';
+}
+
+/// Result of `ws.git.status()`.
+class GitStatus {
+  /// Checked-out branch, or `null` when `HEAD` is detached.
+  final String? branch;
+
+  /// Full id of the commit `HEAD` points to, or `null` before the first
+  /// commit.
+  final String? head;
+
+  /// Changed paths, sorted by path.
+  final List<GitFileStatus> entries;
+
+  /// Creates a status.
+  const GitStatus(
+      {required this.branch, required this.head, required this.entries});
+
+  /// Decodes the launcher's JSON form.
+  factory GitStatus.fromJson(Map<String, dynamic> json) => GitStatus(
+        branch: json['branch'] as String?,
+        head: json['head'] as String?,
+        entries: [
+          for (final entry in json['entries'] as List)
+            GitFileStatus(entry['path'] as String, entry['index'] as String,
+                entry['worktree'] as String),
+        ],
+      );
+
+  /// Whether nothing is staged, modified or untracked.
+  bool get isClean => entries.isEmpty;
+
+  @override
+  String toString() => [
+        '## ${branch ?? 'HEAD (no branch)'}',
+        ...entries.map((e) => e.toString()),
+      ].join('\n');
+}
+
+/// Thrown when the git status of a workspace cannot be read, for example
+/// because it is not inside a git repository.
+class GitException implements Exception {
+  /// Human-readable error message.
+  final String message;
+
+  /// Creates a git exception.
+  GitException(this.message);
+
+  @override
+  String toString() => 'GitException: $message';
+}
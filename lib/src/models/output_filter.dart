@@ -0,0 +1,107 @@
+/// Normalization the launcher applies to a command's output before it
+/// reaches Dart, set with [WorkspaceOptions.outputFilter].
+///
+/// Progress bars and colored logs are mostly redraws; filtering them in the
+/// launcher keeps them out of the stream chunks, [CommandResult.stdout] and
+/// tee'd redirect files. Output a redirect writes to its file directly
+/// (without `tee`) never passes through the launcher and is left as is.
+///
+/// Example:
+/// ```
+/// final result = await ws.run('npm install',
+///     options: WorkspaceOptions(outputFilter: OutputFilter()));
+/// print(result.outputStats); // bytes saved by the filter
+/// ```
+class OutputFilter {
+  /// Drops ANSI escape sequences: colors, cursor movement and window
+  /// titles.
+  final bool stripAnsi;
+
+  /// Keeps only the final text of a line redrawn after `\r`, as a terminal
+  /// would show it. `\r\n` line endings are preserved.
+  final bool collapseCarriageReturns;
+
+  /// Emits a run of identical lines once, followed by a
+  /// `[previous line repeated N more times]` line.
+  final bool foldRepeats;
+
+  /// Creates a filter; every stage is on unless disabled.
+  const OutputFilter({
+    this.stripAnsi = true,
+    this.collapseCarriageReturns = true,
+    this.foldRepeats = true,
+  });
+
+  /// Launcher flags enabling the selected stages.
+  List<String> get launcherArgs => [
+        if (stripAnsi) '--strip-ansi',
+        if (collapseCarriageReturns) '--collapse-cr',
+        if (foldRepeats) '--fold-repeats',
+      ];
+
+  /// Serializes the filter for the remote launcher protocol.
+  Map<String, Object?> toJson() => {
+        'stripAnsi': stripAnsi,
+        'collapseCarriageReturns': collapseCarriageReturns,
+        'foldRepeats': foldRepeats,
+      };
+
+  /// Inverse of [toJson].
+  factory OutputFilter.fromJson(Map<String, Object?> json) => OutputFilter(
+        stripAnsi: json['stripAnsi'] == true,
+        collapseCarriageReturns: json['collapseCarriageReturns'] == true,
+        foldRepeats: json['foldRepeats'] == true,
+      );
+}
+
+/// Bytes one output stream carried before and after normalization.
+class OutputBytes {
+  /// Bytes the command wrote.
+  final int raw;
+
+  /// Bytes forwarded after filtering, including repeat markers.
+  final int normalized;
+
+  /// Creates a byte count.
+  const OutputBytes({required this.raw, required this.normalized});
+
+  /// Parses one stream's counts from the launcher's stats file.
+  factory OutputBytes.fromJson(Map<String, Object?> json) => OutputBytes(
+        raw: json['raw'] as int,
+        normalized: json['normalized'] as int,
+      );
+
+  /// Serializes the counts in the launcher's format.
+  Map<String, Object?> toJson() => {'raw': raw, 'normalized': normalized};
+
+  @override
+  String toString() => '$raw -> $normalized bytes';
+}
+
+/// Output volume of a command run with [WorkspaceOptions.outputFilter].
+///
+/// Only output that passed through the launcher is counted: a stream
+/// redirected to a file without `tee` reports zero.
+class OutputStats {
+  /// Standard output counts.
+  final OutputBytes stdout;
+
+  /// Standard error counts. Launcher diagnostics are not included.
+  final OutputBytes stderr;
+
+  /// Creates output stats.
+  const OutputStats({required this.stdout, required this.stderr});
+
+  /// Parses the launcher's stats file.
+  factory OutputStats.fromJson(Map<String, Object?> json) => OutputStats(
+        stdout: OutputBytes.fromJson(json['stdout'] as Map<String, Object?>),
+        stderr: OutputBytes.fromJson(json['stderr'] as Map<String, Object?>),
+      );
+
+  /// Serializes the stats in the launcher's format.
+  Map<String, Object?> toJson() =>
+      {'stdout': stdout.toJson(), 'stderr': stderr.toJson()};
+
+  @override
+  String toString() => 'OutputStats(stdout: $stdout, stderr: $stderr)';
+}
@@ -0,0 +1,54 @@
+/// Sends a process output stream straight to a file in the workspace.
+///
+/// The launcher opens the file and hands it to the child as its stdout or
+/// stderr, so the output never passes through Dart. Use this for large
+/// build logs instead of collecting [CommandResult.stdout] and writing it
+/// back with `fs.writeFile`.
+///
+/// Example:
+/// ```
+/// final result = await ws.exec('make', options: WorkspaceOptions(
+///   stdoutTo: OutputRedirect('logs/build.log'),
+/// ));
+/// print('${result.stdoutFile!.bytes} bytes in ${result.stdoutFile!.path}');
+/// ```
+class OutputRedirect {
+  /// File path relative to the workspace root. Parent directories are
+  /// created as needed.
+  final String path;
+
+  /// Whether to append to an existing file instead of truncating it.
+  final bool append;
+
+  /// Whether to also deliver the output to the process streams.
+  ///
+  /// Tee'd output is copied by the launcher, so it costs a pipe round trip
+  /// but still does not need to be written back from Dart.
+  final bool tee;
+
+  /// Creates a redirect to [path].
+  const OutputRedirect(this.path, {this.append = false, this.tee = false});
+
+  /// Returns a copy pointing at [path], keeping the other settings.
+  OutputRedirect withPath(String path) =>
+      OutputRedirect(path, append: append, tee: tee);
+
+  @override
+  String toString() =>
+      'OutputRedirect($path${append ? ', append' : ''}${tee ? ', tee' : ''})';
+}
+
+/// Output written to a file by an [OutputRedirect].
+class RedirectedOutput {
+  /// File path relative to the workspace root, as given in the redirect.
+  final String path;
+
+  /// Number of bytes the command wrote to the file.
+  final int bytes;
+
+  /// Creates a redirected output summary.
+  const RedirectedOutput(this.path, this.bytes);
+
+  @override
+  String toString() => 'RedirectedOutput($path, $bytes bytes)';
+}
@@ -0,0 +1,164 @@
+/// CPU scheduling policy for a command, replacing the default
+/// `SCHED_OTHER`.
+enum CpuScheduling {
+  /// `SCHED_BATCH`: scheduled like normal tasks, but never preempts an
+  /// interactive one on wakeup. Suits builds and test runs.
+  batch,
+
+  /// `SCHED_IDLE`: runs only when no other task wants the CPU.
+  idle,
+}
+
+/// I/O scheduling class and level of a command, as set by `ionice`.
+class IoPriority {
+  /// Whether the command only gets disk time nobody else asks for.
+  final bool isIdle;
+
+  /// Best-effort level from 0 (highest) to 7; unused when [isIdle].
+  final int level;
+
+  /// The best-effort class at [level]; processes default to level 4.
+  const IoPriority.bestEffort([this.level = 4]) : isIdle = false;
+
+  /// The idle class.
+  const IoPriority.idle()
+      : isIdle = true,
+        level = 0;
+
+  /// The launcher's `--io-priority` value.
+  String get launcherValue => isIdle ? 'idle' : 'best-effort:$level';
+
+  /// Inverse of [launcherValue].
+  factory IoPriority.parse(String value) => value == 'idle'
+      ? const IoPriority.idle()
+      : IoPriority.bestEffort(int.parse(value.split(':').last));
+
+  @override
+  bool operator ==(Object other) =>
+      other is IoPriority && other.isIdle == isIdle && other.level == level;
+
+  @override
+  int get hashCode => Object.hash(isIdle, level);
+}
+
+/// The CPUs a command may run on.
+///
+/// Either a fixed list, or a spread: the CPUs this process may use, minus
+/// [exclude], split into groups (one per NUMA node with [byNumaNode],
+/// and/or [width] CPUs each), with every workspace pinned to the group
+/// holding the fewest workspaces when its first command starts. A
+/// workspace keeps its group until it is disposed.
+///
+/// Example, keeping cores 0-3 free for a server:
+/// ```
+/// WorkspaceOptions(
+///     priority: ProcessPriority(
+///         cpus: CpuSet.spread(exclude: {0, 1, 2, 3}, width: 4)));
+/// ```
+class CpuSet {
+  /// Explicit CPU numbers, or `null` for a spread.
+  final List<int>? cpus;
+
+  /// CPUs a spread never uses.
+  final Set<int> exclude;
+
+  /// CPUs per group of a spread; `null` keeps each group whole.
+  final int? width;
+
+  /// Whether a spread's groups follow NUMA nodes, so that a workspace's
+  /// threads share a memory controller.
+  final bool byNumaNode;
+
+  /// Exactly [cpus].
+  const CpuSet(List<int> this.cpus)
+      : exclude = const {},
+        width = null,
+        byNumaNode = false;
+
+  /// A group of CPUs picked per workspace.
+  const CpuSet.spread(
+      {this.exclude = const {}, this.width, this.byNumaNode = false})
+      : assert(width == null || width > 0),
+        cpus = null;
+
+  /// Whether CPUs are picked per workspace.
+  bool get isSpread => cpus == null;
+
+  /// Serializes the set for the remote launcher protocol. A spread is
+  /// resolved on the host that runs the command.
+  Map<String, Object?> toJson() => {
+        'cpus': cpus,
+        'exclude': exclude.toList(),
+        'width': width,
+        'byNumaNode': byNumaNode,
+      };
+
+  /// Inverse of [toJson].
+  factory CpuSet.fromJson(Map<String, Object?> json) {
+    final cpus = json['cpus'] as List?;
+    if (cpus != null) return CpuSet(cpus.cast<int>());
+    return CpuSet.spread(
+      exclude: (json['exclude'] as List? ?? const []).cast<int>().toSet(),
+      width: json['width'] as int?,
+      byNumaNode: json['byNumaNode'] == true,
+    );
+  }
+}
+
+/// How the launcher schedules a command, set with
+/// [WorkspaceOptions.priority] and applied right before exec, so that
+/// every process of the command inherits it.
+///
+/// Keeps background workspaces from competing with latency-sensitive work
+/// on the same host. Raising [nice], both [scheduling] policies and both
+/// [io] classes need no privileges; a negative [nice] does. Only [nice]
+/// is applied on macOS, and nothing on Windows.
+///
+/// Example:
+/// ```
+/// final ws = Workspace.ephemeral(
+///     options: WorkspaceOptions(priority: ProcessPriority.background));
+/// ```
+class ProcessPriority {
+  /// CPUs the command may run on (Linux).
+  final CpuSet? cpus;
+
+  /// Nice level, from -20 (most favored) to 19.
+  final int? nice;
+
+  /// CPU scheduling policy (Linux).
+  final CpuScheduling? scheduling;
+
+  /// I/O scheduling class (Linux).
+  final IoPriority? io;
+
+  /// Creates a priority; unset fields keep the launcher's own settings.
+  const ProcessPriority({this.cpus, this.nice, this.scheduling, this.io});
+
+  /// Nice 10, `SCHED_BATCH` and idle I/O: work that should only use what
+  /// the rest of the host leaves over.
+  static const background = ProcessPriority(
+      nice: 10, scheduling: CpuScheduling.batch, io: IoPriority.idle());
+
+  /// Serializes the priority for the remote launcher protocol.
+  Map<String, Object?> toJson() => {
+        'cpus': cpus?.toJson(),
+        'nice': nice,
+        'scheduling': scheduling?.name,
+        'io': io?.launcherValue,
+      };
+
+  /// Inverse of [toJson].
+  factory ProcessPriority.fromJson(Map<String, Object?> json) {
+    final cpus = json['cpus'];
+    final scheduling = json['scheduling'] as String?;
+    final io = json['io'] as String?;
+    return ProcessPriority(
+      cpus: cpus is Map<String, Object?> ? CpuSet.fromJson(cpus) : null,
+      nice: json['nice'] as int?,
+      scheduling:
+          scheduling == null ? null : CpuScheduling.values.byName(scheduling),
+      io: io == null ? null : IoPriority.parse(io),
+    );
+  }
+}
@@ -0,0 +1,94 @@
+/// A resource sample of a running command's process tree, recorded with
+/// [WorkspaceOptions.sampleInterval].
+///
+/// Totals cover every live process the command started. CPU time also
+/// includes descendants that exited and were waited for; memory, threads
+/// and I/O only count processes still running at [elapsed].
+class ProcessStats {
+  /// Time since the command started.
+  final Duration elapsed;
+
+  /// User and system CPU time consumed so far.
+  final Duration cpuTime;
+
+  /// CPU cores kept busy on average since the previous sample (or since
+  /// the start, for the first one): `1.0` is one core fully used.
+  final double cpuUsage;
+
+  /// Resident memory of the tree.
+  final int rssBytes;
+
+  /// Threads across the tree.
+  final int threads;
+
+  /// Processes in the tree.
+  final int processes;
+
+  /// Bytes passed to read calls so far, pipes and sockets included.
+  final int readBytes;
+
+  /// Bytes passed to write calls so far, pipes and sockets included.
+  final int writeBytes;
+
+  /// Creates a sample.
+  const ProcessStats({
+    required this.elapsed,
+    required this.cpuTime,
+    required this.cpuUsage,
+    required this.rssBytes,
+    required this.threads,
+    required this.processes,
+    required this.readBytes,
+    required this.writeBytes,
+  });
+
+  /// Parses one line of the launcher's sample file, computing [cpuUsage]
+  /// against [previous].
+  factory ProcessStats.fromLauncher(Map<String, Object?> json,
+      {ProcessStats? previous}) {
+    final elapsed = Duration(milliseconds: json['elapsedMs'] as int);
+    final cpuTime = Duration(microseconds: json['cpuUs'] as int);
+    final wall = elapsed - (previous?.elapsed ?? Duration.zero);
+    final cpu = cpuTime - (previous?.cpuTime ?? Duration.zero);
+    return ProcessStats(
+      elapsed: elapsed,
+      cpuTime: cpuTime,
+      cpuUsage: wall > Duration.zero
+          ? cpu.inMicroseconds / wall.inMicroseconds
+          : 0,
+      rssBytes: json['rssBytes'] as int,
+      threads: json['threads'] as int,
+      processes: json['processes'] as int,
+      readBytes: json['readBytes'] as int,
+      writeBytes: json['writeBytes'] as int,
+    );
+  }
+
+  /// Serializes the sample for the remote launcher protocol.
+  Map<String, Object?> toJson() => {
+        'elapsedMs': elapsed.inMilliseconds,
+        'cpuUs': cpuTime.inMicroseconds,
+        'cpuUsage': cpuUsage,
+        'rssBytes': rssBytes,
+        'threads': threads,
+        'processes': processes,
+        'readBytes': readBytes,
+        'writeBytes': writeBytes,
+      };
+
+  /// Inverse of [toJson].
+  factory ProcessStats.fromJson(Map<String, Object?> json) => ProcessStats(
+        elapsed: Duration(milliseconds: json['elapsedMs'] as int),
+        cpuTime: Duration(microseconds: json['cpuUs'] as int),
+        cpuUsage: (json['cpuUsage'] as num).toDouble(),
+        rssBytes: json['rssBytes'] as int,
+        threads: json['threads'] as int,
+        processes: json['processes'] as int,
+        readBytes: json['readBytes'] as int,
+        writeBytes: json['writeBytes'] as int,
+      );
+
+  @override
+  String toString() => 'ProcessStats(cpu: ${cpuUsage.toStringAsFixed(2)}, '
+      'rss: ${rssBytes ~/ 1024} KiB, processes: $processes)';
+}
@@ -0,0 +1,132 @@
+/// Kind of a line in a [DiffHunk].
+enum DiffLineKind {
+  /// Present in both texts.
+  context,
+
+  /// Only in the old text.
+  removed,
+
+  /// Only in the new text.
+  added,
+}
+
+/// One line of a [DiffHunk].
+class DiffLine {
+  /// Whether the line is context, removed or added.
+  final DiffLineKind kind;
+
+  /// Line content without its line terminator.
+  final String text;
+
+  /// Whether this is the last line of its text and has no trailing newline.
+  final bool missingNewline;
+
+  /// Creates a diff line.
+  const DiffLine(this.kind, this.text, {this.missingNewline = false});
+
+  /// The line as it appears in unified diff output.
+  String get unified {
+    final prefix = switch (kind) {
+      DiffLineKind.context => ' ',
+      DiffLineKind.removed => '-',
+      DiffLineKind.added => '+',
+    };
+    return missingNewline
+        ? '$prefix$text\n\\ No newline at end of file\n'
+        : '$prefix$text\n';
+  }
+
+  @override
+  String toString() => unified.trimRight();
+}
+
+/// A group of nearby changes with surrounding context lines.
+class DiffHunk {
+  /// First old line covered by the hunk (1-based).
+  final int oldStart;
+
+  /// Number of old lines covered (context and removed).
+  final int oldCount;
+
+  /// First new line covered by the hunk (1-based).
+  final int newStart;
+
+  /// Number of new lines covered (context and added).
+  final int newCount;
+
+  /// The hunk's lines in order.
+  final List<DiffLine> lines;
+
+  /// Creates a hunk.
+  const DiffHunk(
+      this.oldStart, this.oldCount, this.newStart, this.newCount, this.lines);
+
+  /// The `@@ -a,b +c,d @@` header line, without a newline.
+  ///
+  /// Follows GNU diff: a count of 1 is omitted and an empty range points at
+  /// the line before it.
+  String get header =>
+      '@@ -${_range(oldStart, oldCount)} +${_range(newStart, newCount)} @@';
+
+  static String _range(int start, int count) => switch (count) {
+        0 => '${start - 1},0',
+        1 => '$start',
+        _ => '$start,$count',
+      };
+
+  /// The hunk in unified diff format.
+  String get unified => '$header\n${lines.map((l) => l.unified).join()}';
+
+  @override
+  String toString() => header;
+}
+
+/// Line-based difference between two texts.
+///
+/// Returned by [diffText] and `fs.diff`. Use [hunks] for structured access
+/// or [unified] for `diff -u` compatible text.
+///
+/// Example:
+/// ```
+/// final diff = await ws.fs.diff('expected.txt', 'actual.txt');
+/// if (!diff.isIdentical) print(diff.unified);
+/// ```
+class TextDiff {
+  /// Label of the old text in the `---` line.
+  final String fromLabel;
+
+  /// Label of the new text in the `+++` line.
+  final String toLabel;
+
+  /// Changed regions, in order. Empty when the texts are equal.
+  final List<DiffHunk> hunks;
+
+  /// Creates a diff from its hunks.
+  const TextDiff(this.fromLabel, this.toLabel, this.hunks);
+
+  /// Whether both texts are equal.
+  bool get isIdentical => hunks.isEmpty;
+
+  /// Number of removed lines.
+  int get deletions => _count(DiffLineKind.removed);
+
+  /// Number of added lines.
+  int get additions => _count(DiffLineKind.added);
+
+  int _count(DiffLineKind kind) => hunks.fold(
+      0, (sum, h) => sum + h.lines.where((l) => l.kind == kind).length);
+
+  /// The diff in unified format, or an empty string for equal texts.
+  String get unified {
+    if (hunks.isEmpty) return '';
+    final out = StringBuffer('--- $fromLabel\n+++ $toLabel\n');
+    for (final hunk in hunks) {
+      out.write(hunk.unified);
+    }
+    return out.toString();
+  }
+
+  @override
+  String toString() =>
+      'TextDiff($fromLabel -> $toLabel, +$additions -$deletions)';
+}
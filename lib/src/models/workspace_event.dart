@@ -1,3 +1,5 @@
+import 'process_stats.dart';
+
 /// Base class for all events occurring within a workspace.
 ///
 /// Events are emitted through the [Workspace.onEvent] stream to provide
@@ -6,6 +8,7 @@
 /// See also:
 /// - [ProcessOutputEvent]: Emitted when a process writes to stdout/stderr
 /// - [ProcessLifecycleEvent]: Emitted when a process starts or stops
+/// - [ProcessStatsEvent]: Emitted with resource samples of a running process
 sealed class WorkspaceEvent {
   /// Timestamp when this event was created.
   final DateTime timestamp = DateTime.now();
@@ -100,6 +103,39 @@ class ProcessLifecycleEvent extends WorkspaceEvent {
       '[LIFECYCLE] Process $pid ($command) -> ${state.name} ${exitCode != null ? "(Code $exitCode)" : ""}';
 }
 
+/// Emitted with each resource sample of a process started with
+/// [WorkspaceOptions.sampleInterval].
+///
+/// Example:
+/// ```
+/// ws.onEvent.listen((event) {
+///   if (event is ProcessStatsEvent && event.stats.cpuUsage < 0.01) {
+///     print('${event.command} looks stuck');
+///   }
+/// });
+/// ```
+class ProcessStatsEvent extends WorkspaceEvent {
+  /// Process identifier (PID).
+  final int pid;
+
+  /// The original command that spawned this process.
+  final String command;
+
+  /// The sample.
+  final ProcessStats stats;
+
+  /// Creates a process stats event.
+  ProcessStatsEvent({
+    required String workspaceId,
+    required this.pid,
+    required this.command,
+    required this.stats,
+  }) : super(workspaceId);
+
+  @override
+  String toString() => '[STATS] Process $pid ($command) $stats';
+}
+
 /// Lifecycle states of a process.
 enum ProcessState {
   /// Process has been spawned and is running.
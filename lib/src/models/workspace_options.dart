@@ -1,5 +1,12 @@
 import 'dart:async';
 
+import '../core/package_mirror.dart';
+import 'cache_mount.dart';
+import 'disk_usage.dart';
+import 'output_filter.dart';
+import 'output_redirect.dart';
+import 'process_priority.dart';
+
 /// Cooperative cancellation token for running processes.
 ///
 /// Allows external cancellation of long-running processes without directly
@@ -44,6 +51,21 @@ class CancellationToken {
   }
 }
 
+/// Isolation profile used when [WorkspaceOptions.sandbox] is enabled.
+enum SandboxProfile {
+  /// Full platform sandbox (Bubblewrap namespaces on Linux).
+  strict,
+
+  /// Lower-overhead sandbox applied inside the launcher before exec.
+  ///
+  /// On Linux this uses Landlock (read-only host, writable workspace and
+  /// temp directories) plus a seccomp filter that blocks non-local sockets
+  /// when network access is disabled. The host filesystem stays visible and
+  /// there is no PID isolation. Falls back to [strict] on kernels without
+  /// Landlock. Other platforms treat this the same as [strict].
+  lightweight,
+}
+
 /// Configuration options for running commands in a workspace.
 ///
 /// Allows customization of:
@@ -110,6 +132,85 @@ class WorkspaceOptions {
   /// is blocked at the sandbox level.
   final bool allowNetwork;
 
+  /// Isolation profile to use when [sandbox] is `true`.
+  ///
+  /// Defaults to [SandboxProfile.strict] when `null`.
+  final SandboxProfile? sandboxProfile;
+
+  /// Shared dependency caches made writable inside the sandbox.
+  ///
+  /// See [CacheMount] for presets and locking semantics.
+  final List<CacheMount> caches;
+
+  /// Local registry mirror used for package installs.
+  ///
+  /// When set, npm, pip, pub and cargo are pointed at the mirror, which
+  /// stays reachable even when [allowNetwork] is `false`.
+  final PackageMirror? packageMirror;
+
+  /// Writes stdout to a workspace file instead of collecting it.
+  ///
+  /// The path is validated like [FileSystemService] paths.
+  final OutputRedirect? stdoutTo;
+
+  /// Writes stderr to a workspace file instead of collecting it.
+  ///
+  /// Launcher diagnostics still go to the stderr stream.
+  final OutputRedirect? stderrTo;
+
+  /// Disk limits for the whole workspace.
+  ///
+  /// Only read from the options a workspace is created with: writes
+  /// through [FileSystemService] that would exceed it fail, and running
+  /// commands are killed once usage is over it.
+  final DiskQuota? diskQuota;
+
+  /// Records the files the command tree reads and writes in
+  /// [CommandResult.fileAccess] (and [WorkspaceProcess.fileAccess]).
+  ///
+  /// Needs a Linux launcher; elsewhere the result stays `null`. Every
+  /// traced open, create, rename or delete is a round trip to the launcher
+  /// (around 10-15 µs), so leave it off unless the sets are needed, e.g. to
+  /// key a build cache. Traced commands always use the launcher binary,
+  /// not the [InProcessLauncher].
+  ///
+  /// The traced tree runs in its own process group, and processes left
+  /// behind in it are killed when the command exits.
+  final bool traceFileAccess;
+
+  /// Normalization applied to the command's output in the launcher; see
+  /// [OutputFilter]. Raw and filtered byte counts are reported in
+  /// [CommandResult.outputStats].
+  final OutputFilter? outputFilter;
+
+  /// Samples the command tree's CPU time, memory, threads and I/O at this
+  /// interval, as [WorkspaceProcess.stats] and [ProcessStatsEvent]s.
+  ///
+  /// Linux only; `null` (the default) disables sampling. A sample reads a
+  /// few `/proc` files per process (tens of microseconds each), so
+  /// intervals of a second or more are cheap enough to leave on.
+  final Duration? sampleInterval;
+
+  /// Kills the command once its process tree has written no output, used
+  /// no CPU time and read or written no bytes for this long, reporting
+  /// [TerminationReason.idle].
+  ///
+  /// Catches commands stuck waiting for input or deadlocked well before
+  /// [timeout]. Checked by the Linux launcher binary (it is ignored
+  /// elsewhere); detection lands between one and 1.25 times the limit.
+  /// Commands that poll in a loop keep using CPU time and never count as
+  /// idle.
+  final Duration? idleTimeout;
+
+  /// CPU affinity, nice level, scheduling policy and I/O class the
+  /// launcher gives the command before exec.
+  ///
+  /// Use [ProcessPriority.background] (or a [CpuSet.spread] of cores) to
+  /// keep builds and tests off the CPUs and disks a latency-sensitive
+  /// service on the same host needs. Commands run by the in-process
+  /// launcher get the same settings.
+  final ProcessPriority? priority;
+
   /// Creates workspace execution options.
   const WorkspaceOptions({
     this.timeout,
@@ -119,6 +220,17 @@ class WorkspaceOptions {
     this.workingDirectoryOverride,
     this.sandbox = false,
     this.allowNetwork = true,
+    this.sandboxProfile,
+    this.caches = const [],
+    this.packageMirror,
+    this.stdoutTo,
+    this.stderrTo,
+    this.diskQuota,
+    this.traceFileAccess = false,
+    this.outputFilter,
+    this.sampleInterval,
+    this.idleTimeout,
+    this.priority,
   });
 
   /// Creates a copy of these options with the given fields replaced.
@@ -136,6 +248,17 @@ class WorkspaceOptions {
     String? workingDirectoryOverride,
     bool? sandbox,
     bool? allowNetwork,
+    SandboxProfile? sandboxProfile,
+    List<CacheMount>? caches,
+    PackageMirror? packageMirror,
+    OutputRedirect? stdoutTo,
+    OutputRedirect? stderrTo,
+    DiskQuota? diskQuota,
+    bool? traceFileAccess,
+    OutputFilter? outputFilter,
+    Duration? sampleInterval,
+    Duration? idleTimeout,
+    ProcessPriority? priority,
   }) {
     return WorkspaceOptions(
       timeout: timeout ?? this.timeout,
@@ -146,6 +269,17 @@ class WorkspaceOptions {
           workingDirectoryOverride ?? this.workingDirectoryOverride,
       sandbox: sandbox ?? this.sandbox,
       allowNetwork: allowNetwork ?? this.allowNetwork,
+      sandboxProfile: sandboxProfile ?? this.sandboxProfile,
+      caches: caches ?? this.caches,
+      packageMirror: packageMirror ?? this.packageMirror,
+      stdoutTo: stdoutTo ?? this.stdoutTo,
+      stderrTo: stderrTo ?? this.stderrTo,
+      diskQuota: diskQuota ?? this.diskQuota,
+      traceFileAccess: traceFileAccess ?? this.traceFileAccess,
+      outputFilter: outputFilter ?? this.outputFilter,
+      sampleInterval: sampleInterval ?? this.sampleInterval,
+      idleTimeout: idleTimeout ?? this.idleTimeout,
+      priority: priority ?? this.priority,
     );
   }
 }
@@ -1,5 +1,9 @@
 import 'dart:async';
 
+import 'file_access.dart';
+import 'output_filter.dart';
+import 'process_stats.dart';
+
 /// Represents a running process inside a workspace.
 ///
 /// Provides access to the process's output streams and allows waiting for
@@ -33,12 +37,31 @@ abstract class WorkspaceProcess {
   /// It emits error messages and diagnostic output as they are received.
   Stream<String> get stderr;
 
+  /// Resource samples of the process tree while it runs.
+  ///
+  /// Broadcast; emits every [WorkspaceOptions.sampleInterval] and closes
+  /// before [exitCode] completes. Empty unless sampling was requested and
+  /// the launcher can sample (Linux only).
+  Stream<ProcessStats> get stats;
+
   /// Completes when the process exits, yielding its exit code.
   ///
   /// The exit code is platform-specific, but typically `0` indicates
   /// success and non-zero values indicate errors.
   Future<int> get exitCode;
 
+  /// Files the process tree read and wrote, available once it exited.
+  ///
+  /// Completes with `null` unless [WorkspaceOptions.traceFileAccess] was
+  /// set and the launcher could trace the command (Linux only).
+  Future<FileAccess?> get fileAccess;
+
+  /// Output byte counts before and after filtering, available once the
+  /// process exited.
+  ///
+  /// Completes with `null` unless [WorkspaceOptions.outputFilter] was set.
+  Future<OutputStats?> get outputStats;
+
   /// The operating system process identifier.
   ///
   /// Used internally for event correlation and process tracking.
@@ -51,6 +74,40 @@ abstract class WorkspaceProcess {
   /// by a timeout.
   bool get isCancelled;
 
+  /// Why the process was ended early, once it exited; `null` if it ran to
+  /// completion.
+  TerminationReason? get terminationReason;
+
+  /// Completes with the first match of [pattern] in the process output.
+  ///
+  /// Matching runs over a bounded tail of each stream, so markers split
+  /// across chunks are found, and output received before the call counts.
+  /// stderr is searched too unless [includeStderr] is `false`.
+  ///
+  /// Throws [TimeoutException] if nothing matches within [timeout], or
+  /// [StateError] if the process exits first.
+  ///
+  /// Example:
+  /// ```
+  /// final server = await ws.execStream('npm run dev');
+  /// final m = await server.waitForOutput(RegExp(r'localhost:(\d+)'),
+  ///     timeout: Duration(seconds: 30));
+  /// print('Dev server on port ${m.group(1)}');
+  /// ```
+  Future<RegExpMatch> waitForOutput(RegExp pattern,
+      {Duration? timeout, bool includeStderr = true});
+
+  /// Completes once a TCP connection to [host]:[port] succeeds.
+  ///
+  /// The probe connects from the host, so the port must be reachable from
+  /// outside the sandbox (`allowNetwork: true` on Linux, where no-network
+  /// sandboxes have a private loopback).
+  ///
+  /// Throws [TimeoutException] if the port does not accept within
+  /// [timeout], or [StateError] if the process exits first.
+  Future<void> waitForPort(int port,
+      {String host = '127.0.0.1', Duration? timeout});
+
   /// Attempts to terminate the underlying process.
   ///
   /// Sends SIGTERM on Unix platforms and calls `TerminateProcess` on Windows.
@@ -65,3 +122,17 @@ abstract class WorkspaceProcess {
   /// ```
   void kill();
 }
+
+/// Why a process was ended before it finished on its own.
+enum TerminationReason {
+  /// [WorkspaceProcess.kill] was called, directly or through a
+  /// [CancellationToken] or disk quota.
+  killed,
+
+  /// [WorkspaceOptions.timeout] elapsed.
+  timeout,
+
+  /// The process tree wrote no output and used no CPU time for
+  /// [WorkspaceOptions.idleTimeout].
+  idle,
+}
@@ -0,0 +1,275 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import '../core/launcher_service.dart';
+import '../git/git_service.dart';
+import '../models/git_status.dart';
+
+typedef _PostCObject
+    = Pointer<NativeFunction<Int8 Function(Int64, Pointer<Dart_CObject>)>>;
+
+typedef _SpawnNative = Int64 Function(Int32, Pointer<Pointer<Uint8>>,
+    _PostCObject, Int64, Int64, Int64, Pointer<Uint8>, IntPtr);
+typedef _Spawn = int Function(int, Pointer<Pointer<Uint8>>, _PostCObject, int,
+    int, int, Pointer<Uint8>, int);
+typedef _KillNative = Int32 Function(Int64, Int32);
+typedef _Kill = int Function(int, int);
+typedef _ReleaseNative = Void Function(Int64);
+typedef _Release = void Function(int);
+typedef _GitStatusNative = Pointer<Uint8> Function(
+    Pointer<Uint8>, Int32, Pointer<Uint8>, IntPtr);
+typedef _GitStatus = Pointer<Uint8> Function(
+    Pointer<Uint8>, int, Pointer<Uint8>, int);
+typedef _StringFreeNative = Void Function(Pointer<Uint8>);
+typedef _StringFree = void Function(Pointer<Uint8>);
+typedef _MallocNative = Pointer<Void> Function(IntPtr);
+typedef _Malloc = Pointer<Void> Function(int);
+typedef _FreeNative = Void Function(Pointer<Void>);
+typedef _Free = void Function(Pointer<Void>);
+
+/// Spawns sandboxed commands through the launcher shared library.
+///
+/// By default every exec starts the `workspace_launcher` binary, which then
+/// starts the command. While this launcher is enabled, [LauncherService]
+/// instead calls into `libworkspace_launcher` via `dart:ffi`: the same
+/// isolation strategies run in-process and the command becomes a direct
+/// child of the Dart process, saving one process start per exec. Output and
+/// exit codes arrive through native ports. Each command leads its own
+/// process group, which [Process.kill] signals as a whole, so background
+/// children stop with it as they do under the binary.
+///
+/// Available on Linux and macOS. Exit statuses are collected with
+/// `waitid`/`wait4` on the command's pid; `dart:io` reaps *any* child while
+/// one of its own processes is running. So while this launcher is enabled,
+/// execs that need the binary (file-access tracing, idle detection) start
+/// it through this launcher too, and in-process spawning is skipped while
+/// `NetworkNamespacePool` holders are alive. `Process.start` and
+/// `Process.run` elsewhere in the program can still take an in-process
+/// command's exit status, which is then reported as `-1`; do not run them
+/// concurrently with in-process execs.
+///
+/// Example:
+/// ```
+/// await InProcessLauncher.enable();
+/// await ws.exec('echo fast'); // no launcher process
+/// InProcessLauncher.disable();
+/// ```
+class InProcessLauncher {
+  static InProcessLauncher? _shared;
+
+  /// The enabled launcher, or `null` when commands use the launcher binary.
+  static InProcessLauncher? get shared => _shared;
+
+  final String _libraryPath;
+  final _Spawn _spawn;
+  final _Kill _kill;
+  final _Release _release;
+  final _Malloc _malloc;
+  final _Free _free;
+
+  InProcessLauncher._(
+      this._libraryPath, DynamicLibrary lib, DynamicLibrary libc)
+      : _spawn = lib.lookupFunction<_SpawnNative, _Spawn>('wsl_spawn'),
+        _kill = lib.lookupFunction<_KillNative, _Kill>('wsl_kill'),
+        _release = lib.lookupFunction<_ReleaseNative, _Release>('wsl_release'),
+        _malloc = libc.lookupFunction<_MallocNative, _Malloc>('malloc'),
+        _free = libc.lookupFunction<_FreeNative, _Free>('free');
+
+  /// Loads the shared library and routes new execs through it.
+  ///
+  /// Returns `null` (and keeps using the launcher binary) on Windows or
+  /// when the library cannot be found or loaded.
+  static Future<InProcessLauncher?> enable() async {
+    if (_shared != null) return _shared;
+    if (!Platform.isLinux && !Platform.isMacOS) return null;
+    try {
+      final path = await LauncherService.findLibrary();
+      _shared = InProcessLauncher._(
+          path, DynamicLibrary.open(path), DynamicLibrary.process());
+    } catch (_) {
+      return null;
+    }
+    return _shared;
+  }
+
+  /// Routes new execs back through the launcher binary.
+  ///
+  /// Commands already started keep running.
+  static void disable() => _shared = null;
+
+  /// Starts a command from launcher-style [args].
+  ///
+  /// Throws [ProcessException] if the arguments are invalid or the command
+  /// cannot be spawned.
+  Process start(List<String> args) {
+    final stdoutPort = ReceivePort();
+    final stderrPort = ReceivePort();
+    final exitPort = ReceivePort();
+
+    final encoded = args.map(utf8.encode).toList();
+    final argv = _malloc(sizeOf<Pointer<Uint8>>() * args.length)
+        .cast<Pointer<Uint8>>();
+    const errorLength = 1024;
+    final error = _malloc(errorLength).cast<Uint8>();
+    final pid = () {
+      try {
+        for (var i = 0; i < encoded.length; i++) {
+          final bytes = encoded[i];
+          final str = _malloc(bytes.length + 1).cast<Uint8>();
+          str.asTypedList(bytes.length + 1)
+            ..setAll(0, bytes)
+            ..[bytes.length] = 0;
+          argv[i] = str;
+        }
+        return _spawn(
+            args.length,
+            argv,
+            NativeApi.postCObject,
+            stdoutPort.sendPort.nativePort,
+            stderrPort.sendPort.nativePort,
+            exitPort.sendPort.nativePort,
+            error,
+            errorLength);
+      } finally {
+        for (var i = 0; i < encoded.length; i++) {
+          _free(argv[i].cast());
+        }
+        _free(argv.cast());
+      }
+    }();
+
+    if (pid < 0) {
+      final message = _decodeString(error, errorLength);
+      _free(error.cast());
+      stdoutPort.close();
+      stderrPort.close();
+      exitPort.close();
+      throw ProcessException(args.isEmpty ? '' : args.last, args, message);
+    }
+    _free(error.cast());
+
+    return _InProcessChild(this, pid, stdoutPort, stderrPort, exitPort);
+  }
+
+  /// Computes the git status of the repository containing [root], returning
+  /// the launcher's JSON; see [GitService].
+  ///
+  /// [flags] combines [gitUntrackedCache], [gitUntrackedNo] and
+  /// [gitUntrackedAll]. The library keeps its status cache for [root]
+  /// between calls. The call blocks while the worktree is scanned, so it
+  /// runs on a helper isolate. Throws [GitException] on failure.
+  Future<String> gitStatus(String root, int flags) {
+    final libraryPath = _libraryPath;
+    return Isolate.run(() => _gitStatus(libraryPath, root, flags));
+  }
+
+  /// [gitStatus] flag: reuse directory listings that did not change.
+  static const gitUntrackedCache = 1;
+
+  /// [gitStatus] flag: do not report untracked files.
+  static const gitUntrackedNo = 2;
+
+  /// [gitStatus] flag: report untracked files without collapsing
+  /// directories.
+  static const gitUntrackedAll = 4;
+
+  static String _gitStatus(String libraryPath, String root, int flags) {
+    // Opening an already loaded library returns the same handle, so the
+    // native cache is shared with every isolate.
+    final lib = DynamicLibrary.open(libraryPath);
+    final libc = DynamicLibrary.process();
+    final status =
+        lib.lookupFunction<_GitStatusNative, _GitStatus>('wsl_git_status');
+    final release =
+        lib.lookupFunction<_StringFreeNative, _StringFree>('wsl_string_free');
+    final malloc = libc.lookupFunction<_MallocNative, _Malloc>('malloc');
+    final free = libc.lookupFunction<_FreeNative, _Free>('free');
+
+    final bytes = utf8.encode(root);
+    final path = malloc(bytes.length + 1).cast<Uint8>();
+    path.asTypedList(bytes.length + 1)
+      ..setAll(0, bytes)
+      ..[bytes.length] = 0;
+    const errorLength = 1024;
+    final error = malloc(errorLength).cast<Uint8>();
+    try {
+      final json = status(path, flags, error, errorLength);
+      if (json == nullptr) {
+        throw GitException(_decodeString(error, errorLength));
+      }
+      try {
+        return _decodeString(json);
+      } finally {
+        release(json);
+      }
+    } finally {
+      free(path.cast());
+      free(error.cast());
+    }
+  }
+
+  /// Decodes a NUL-terminated UTF-8 string of at most [maxLength] bytes.
+  static String _decodeString(Pointer<Uint8> value, [int? maxLength]) {
+    var length = 0;
+    while ((maxLength == null || length < maxLength) && value[length] != 0) {
+      length++;
+    }
+    return utf8.decode(value.asTypedList(length));
+  }
+}
+
+/// A command spawned by [InProcessLauncher], adapted to [Process].
+class _InProcessChild implements Process {
+  final InProcessLauncher _launcher;
+
+  @override
+  final int pid;
+
+  @override
+  final Stream<List<int>> stdout;
+
+  @override
+  final Stream<List<int>> stderr;
+
+  @override
+  final Future<int> exitCode;
+
+  @override
+  final IOSink stdin = IOSink(_DiscardingConsumer());
+
+  _InProcessChild(this._launcher, this.pid, ReceivePort stdoutPort,
+      ReceivePort stderrPort, ReceivePort exitPort)
+      : stdout = _chunks(stdoutPort),
+        stderr = _chunks(stderrPort),
+        exitCode = exitPort.first.then((code) {
+          exitPort.close();
+          _launcher._release(pid);
+          return code as int;
+        });
+
+  /// Ends the stream at the `null` end-of-stream marker.
+  static Stream<List<int>> _chunks(ReceivePort port) {
+    return port.takeWhile((message) {
+      if (message != null) return true;
+      port.close();
+      return false;
+    }).cast<Uint8List>();
+  }
+
+  @override
+  bool kill([ProcessSignal signal = ProcessSignal.sigterm]) =>
+      _launcher._kill(pid, signal.signalNumber) == 0;
+}
+
+/// Commands spawned in-process have no stdin; writes are dropped.
+class _DiscardingConsumer implements StreamConsumer<List<int>> {
+  @override
+  Future addStream(Stream<List<int>> stream) => stream.drain<void>();
+
+  @override
+  Future close() => Future.value();
+}
@@ -1,7 +1,11 @@
 import 'dart:async';
 import 'dart:convert';
 import 'dart:io';
+import '../models/file_access.dart';
+import '../models/output_filter.dart';
+import '../models/process_stats.dart';
 import '../models/workspace_process.dart';
+import '../util/output_waiters.dart';
 
 /// Native process implementation that wraps [Process] with stream management.
 ///
@@ -9,39 +13,95 @@ import '../models/workspace_process.dart';
 /// - UTF-8 decoding with malformed byte tolerance (for Windows CP850/ANSI)
 /// - Timeout management with graceful and forceful termination
 /// - Broadcast streams for stdout/stderr to allow multiple listeners
-class NativeProcessImpl implements WorkspaceProcess {
+/// - Output waiters matched over a bounded tail of each stream
+class NativeProcessImpl with OutputWaiters implements WorkspaceProcess {
   final Process _process;
   final _stdoutCtrl = StreamController<String>.broadcast();
   final _stderrCtrl = StreamController<String>.broadcast();
+  final _statsCtrl = StreamController<ProcessStats>.broadcast();
   final _exitCodeCompleter = Completer<int>();
 
   Timer? _timeoutTimer;
   bool _isCancelled = false;
+  TerminationReason? _terminationReason;
+
+  @override
+  late final Future<FileAccess?> fileAccess;
+
+  @override
+  late final Future<OutputStats?> outputStats;
 
   /// Creates a native process wrapper with optional timeout.
   ///
   /// If [timeout] is provided, the process will be killed automatically
-  /// after the duration elapses.
+  /// after the duration elapses. [traceFile] and [statsFile] are read (and
+  /// deleted) for [fileAccess] and [outputStats] once the process exits.
+  /// [sampleFile] is followed every [sampleInterval] for [stats], and
+  /// [terminationFile] tells whether the launcher ended an idle command.
   ///
   /// The stdout/stderr streams are immediately attached and decoded as UTF-8
   /// with malformed byte tolerance to handle non-Unicode output (e.g.,
   /// Windows console apps using CP850 encoding).
-  NativeProcessImpl(this._process, {Duration? timeout}) {
+  NativeProcessImpl(this._process,
+      {Duration? timeout,
+      String? traceFile,
+      String? statsFile,
+      String? sampleFile,
+      Duration? sampleInterval,
+      String? terminationFile}) {
+    // Read eagerly so the side files are removed even if nobody asks.
+    fileAccess = switch (traceFile) {
+      final path? => exitCode.then((_) => _readSideFile(path)).then(
+          (json) => json == null ? null : FileAccess.fromJson(json)),
+      null => Future.value(),
+    };
+    outputStats = switch (statsFile) {
+      final path? => exitCode.then((_) => _readSideFile(path)).then(
+          (json) => json == null ? null : OutputStats.fromJson(json)),
+      null => Future.value(),
+    };
+
     const decoder = Utf8Decoder(allowMalformed: true);
 
     _process.stdout.transform(decoder).listen(
-          (data) => _stdoutCtrl.add(data),
-          onDone: () => _stdoutCtrl.close(),
+          (data) {
+            recordOutput(data, fromStderr: false);
+            _stdoutCtrl.add(data);
+          },
+          onDone: () {
+            _stdoutCtrl.close();
+            recordStreamDone();
+          },
           onError: (e) => _stdoutCtrl.add('[Stream Error: $e]'),
         );
 
     _process.stderr.transform(decoder).listen(
-          (data) => _stderrCtrl.add(data),
-          onDone: () => _stderrCtrl.close(),
+          (data) {
+            recordOutput(data, fromStderr: true);
+            _stderrCtrl.add(data);
+          },
+          onDone: () {
+            _stderrCtrl.close();
+            recordStreamDone();
+          },
           onError: (e) => _stderrCtrl.add('[Stream Error: $e]'),
         );
 
-    _process.exitCode.then((code) {
+    final samples = sampleFile == null
+        ? null
+        : _SampleTail(File(sampleFile), sampleInterval!, _statsCtrl.add);
+
+    _process.exitCode.then((code) async {
+      // Every sample is delivered before the exit.
+      await samples?.finish();
+      _statsCtrl.close();
+      if (terminationFile != null) {
+        final json = await _readSideFile(terminationFile);
+        if (json?['reason'] == 'idle') {
+          _isCancelled = true;
+          _terminationReason ??= TerminationReason.idle;
+        }
+      }
       if (!_exitCodeCompleter.isCompleted) {
         _exitCodeCompleter.complete(code);
       }
@@ -50,6 +110,7 @@ class NativeProcessImpl implements WorkspaceProcess {
 
     if (timeout != null) {
       _timeoutTimer = Timer(timeout, () {
+        _terminationReason ??= TerminationReason.timeout;
         kill();
         if (!_stderrCtrl.isClosed) {
           _stderrCtrl.add('\n[timeout]\n');
@@ -64,6 +125,9 @@ class NativeProcessImpl implements WorkspaceProcess {
   @override
   Stream<String> get stderr => _stderrCtrl.stream;
 
+  @override
+  Stream<ProcessStats> get stats => _statsCtrl.stream;
+
   @override
   Future<int> get exitCode => _exitCodeCompleter.future;
 
@@ -73,10 +137,14 @@ class NativeProcessImpl implements WorkspaceProcess {
   @override
   bool get isCancelled => _isCancelled;
 
+  @override
+  TerminationReason? get terminationReason => _terminationReason;
+
   @override
   void kill() {
     if (_isCancelled) return;
     _isCancelled = true;
+    _terminationReason ??= TerminationReason.killed;
 
     _process.kill(ProcessSignal.sigterm);
 
@@ -84,4 +152,79 @@ class NativeProcessImpl implements WorkspaceProcess {
       _process.kill(ProcessSignal.sigkill);
     });
   }
+
+  /// Parses and removes a JSON file the launcher writes on exit; `null` if
+  /// it wrote none, e.g. because it was killed.
+  static Future<Map<String, Object?>?> _readSideFile(String path) async {
+    final file = File(path);
+    try {
+      return jsonDecode(await file.readAsString()) as Map<String, Object?>;
+    } on Exception {
+      return null;
+    } finally {
+      try {
+        await file.delete();
+      } on FileSystemException {
+        // Never written.
+      }
+    }
+  }
+}
+
+/// Follows the launcher's sample file, parsing each complete line.
+///
+/// The launcher appends whole lines, so a read stops at the last newline
+/// and resumes from there.
+class _SampleTail {
+  final File _file;
+  final void Function(ProcessStats) _onSample;
+  late final Timer _timer;
+  Future<void>? _reading;
+  int _offset = 0;
+  ProcessStats? _last;
+
+  _SampleTail(this._file, Duration interval, this._onSample) {
+    _timer = Timer.periodic(interval, (_) => _reading ??= _read());
+  }
+
+  /// Delivers the remaining samples and removes the file.
+  Future<void> finish() async {
+    _timer.cancel();
+    await _reading;
+    await _read();
+    try {
+      await _file.delete();
+    } on FileSystemException {
+      // Never written.
+    }
+  }
+
+  Future<void> _read() async {
+    try {
+      final raf = await _file.open();
+      try {
+        final length = await raf.length();
+        if (length <= _offset) return;
+        await raf.setPosition(_offset);
+        final bytes = await raf.read(length - _offset);
+        final end = bytes.lastIndexOf(0x0a);
+        if (end < 0) return;
+        _offset += end + 1;
+        final text = utf8.decode(bytes.sublist(0, end));
+        for (final line in const LineSplitter().convert(text)) {
+          final stats = ProcessStats.fromLauncher(
+              jsonDecode(line) as Map<String, Object?>,
+              previous: _last);
+          _last = stats;
+          _onSample(stats);
+        }
+      } finally {
+        await raf.close();
+      }
+    } on FileSystemException {
+      // Not created yet, or the launcher failed before sampling.
+    } finally {
+      _reading = null;
+    }
+  }
 }
@@ -0,0 +1,190 @@
+import 'dart:async';
+import 'dart:io';
+
+import '../core/launcher_service.dart';
+import '../models/workspace_process.dart';
+import 'launcher_protocol.dart';
+
+/// Serves launcher requests from [RemoteLauncher] clients.
+///
+/// The daemon accepts framed connections (see [FrameType]), multiplexes
+/// any number of workspaces and processes per connection, and runs each
+/// command through the local [LauncherService], so all isolation options
+/// apply on the daemon's host. Output is streamed back as it arrives.
+///
+/// Commands run with the daemon's privileges for whoever can connect:
+/// bind to loopback or a unix socket, and set [token] when the endpoint is
+/// reachable by others. Workspace files are not transferred; the workspace
+/// root must exist at the same path on the daemon's host (the same
+/// machine, or shared storage).
+///
+/// Example:
+/// ```
+/// final daemon = await LauncherDaemon.bind(InternetAddress.loopbackIPv4, 0);
+/// final remote = await RemoteLauncher.connect([daemon.endpoint]);
+/// final ws = Workspace.ephemeral(backend: remote.backendFor);
+/// ```
+class LauncherDaemon {
+  final ServerSocket _server;
+
+  /// Address clients connect to: `tcp://host:port` or `unix:///path`.
+  final Uri endpoint;
+
+  /// Shared secret clients must present, if any.
+  final String? token;
+
+  /// Concurrency hint sent to clients for placement.
+  final int capacity;
+
+  final _connections = <_DaemonConnection>{};
+
+  LauncherDaemon._(this._server, this.endpoint, this.token, this.capacity) {
+    _server.listen((socket) {
+      final connection = _DaemonConnection(this, socket);
+      _connections.add(connection);
+    });
+  }
+
+  /// Listens on [address]:[port]. Pass an [InternetAddress] of type
+  /// [InternetAddressType.unix] (and port 0) for a unix socket.
+  ///
+  /// [capacity] defaults to the number of processors.
+  static Future<LauncherDaemon> bind(Object address, int port,
+      {String? token, int? capacity}) async {
+    final server = await ServerSocket.bind(address, port);
+    final bound = server.address;
+    final endpoint = bound.type == InternetAddressType.unix
+        ? Uri(scheme: 'unix', path: bound.address)
+        : Uri(scheme: 'tcp', host: bound.address, port: server.port);
+    return LauncherDaemon._(
+        server, endpoint, token, capacity ?? Platform.numberOfProcessors);
+  }
+
+  /// Number of connected clients.
+  int get connectionCount => _connections.length;
+
+  /// Stops accepting connections, kills running processes and drops all
+  /// clients.
+  Future<void> close() async {
+    await _server.close();
+    for (final connection in List.of(_connections)) {
+      connection.close();
+    }
+  }
+}
+
+/// One client connection and the processes it started.
+class _DaemonConnection {
+  final LauncherDaemon _daemon;
+  final Socket _socket;
+  final _decoder = FrameDecoder();
+  final _processes = <int, WorkspaceProcess>{};
+  final _launchers = <String, LauncherService>{};
+  bool _authenticated = false;
+  bool _closed = false;
+
+  _DaemonConnection(this._daemon, this._socket) {
+    _socket.listen(_onData,
+        onDone: close, onError: (Object _) => close(), cancelOnError: true);
+  }
+
+  void _onData(List<int> chunk) {
+    try {
+      for (final frame in _decoder.add(chunk)) {
+        _handle(frame);
+      }
+    } on FormatException {
+      close();
+    }
+  }
+
+  void _handle(Frame frame) {
+    if (!_authenticated) {
+      final hello = frame.type == FrameType.hello ? frame.json : null;
+      if (hello == null ||
+          hello['version'] != protocolVersion ||
+          (_daemon.token != null && hello['token'] != _daemon.token)) {
+        close();
+        return;
+      }
+      _authenticated = true;
+      _send(Frame.json(FrameType.hello, 0,
+          {'version': protocolVersion, 'capacity': _daemon.capacity}));
+      return;
+    }
+    switch (frame.type) {
+      case FrameType.spawn:
+        _spawn(frame.channel, frame.json);
+      case FrameType.kill:
+        _processes[frame.channel]?.kill();
+      default:
+        close();
+    }
+  }
+
+  Future<void> _spawn(int channel, Map<String, Object?> request) async {
+    final WorkspaceProcess process;
+    try {
+      final launcher = _launchers.putIfAbsent(
+          '${request['workspace']}\u0000${request['root']}',
+          () => LauncherService(
+              request['root'] as String, request['workspace'] as String));
+      final options =
+          decodeOptions(request['options'] as Map<String, Object?>);
+      final shell = request['shell'] as String?;
+      final argv = (request['exec'] as List?)?.cast<String>();
+      process = shell != null
+          ? await launcher.spawnShell(shell, options)
+          : await launcher.spawnExec(argv!.first, argv.sublist(1), options);
+    } catch (e) {
+      _send(Frame.json(FrameType.error, channel, {'message': '$e'}));
+      return;
+    }
+    if (_closed) {
+      process.kill();
+      return;
+    }
+
+    _processes[channel] = process;
+    _send(Frame.json(FrameType.started, channel, {'pid': process.pid}));
+    process.stdout.listen(
+        (text) => _send(Frame.text(FrameType.stdout, channel, text)),
+        onDone: () => _send(
+            Frame.json(FrameType.streamEnd, channel, {'stderr': false})));
+    process.stderr.listen(
+        (text) => _send(Frame.text(FrameType.stderr, channel, text)),
+        onDone: () => _send(
+            Frame.json(FrameType.streamEnd, channel, {'stderr': true})));
+    process.stats.listen(
+        (stats) => _send(Frame.json(FrameType.stats, channel, stats.toJson())));
+    process.exitCode.then((code) async {
+      final access = await process.fileAccess;
+      final stats = await process.outputStats;
+      _processes.remove(channel);
+      _send(Frame.json(FrameType.exit, channel, {
+        'code': code,
+        'cancelled': process.isCancelled,
+        'terminationReason': process.terminationReason?.name,
+        if (access != null)
+          'fileAccess': {'reads': access.reads, 'writes': access.writes},
+        if (stats != null) 'outputStats': stats.toJson(),
+      }));
+    });
+  }
+
+  void _send(Frame frame) {
+    if (!_closed) _socket.add(frame.encode());
+  }
+
+  /// Kills this client's processes; nobody is left to read their output.
+  void close() {
+    if (_closed) return;
+    _closed = true;
+    _daemon._connections.remove(this);
+    for (final process in _processes.values) {
+      process.kill();
+    }
+    _processes.clear();
+    _socket.destroy();
+  }
+}
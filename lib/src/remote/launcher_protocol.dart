@@ -0,0 +1,233 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import '../models/cache_mount.dart';
+import '../models/output_filter.dart';
+import '../models/output_redirect.dart';
+import '../models/process_priority.dart';
+import '../models/process_stats.dart';
+import '../models/workspace_options.dart';
+
+/// Frame types of the launcher daemon protocol.
+///
+/// Every frame is `u32 length | u8 type | u32 channel | payload` (big
+/// endian, `length` counts everything after itself). Channel 0 is the
+/// connection itself; each spawned process gets a client-chosen channel.
+/// Control payloads are UTF-8 JSON, output payloads are raw UTF-8 text.
+enum FrameType {
+  /// Client → daemon on channel 0: `{"version", "token"}`. The daemon
+  /// answers `{"version", "capacity"}` or closes the connection.
+  hello,
+
+  /// Client → daemon: `{"workspace", "root", "shell" | "exec", "options"}`.
+  spawn,
+
+  /// Daemon → client: `{"pid"}` once the process runs.
+  started,
+
+  /// Daemon → client: a chunk of stdout.
+  stdout,
+
+  /// Daemon → client: a chunk of stderr.
+  stderr,
+
+  /// Daemon → client: `{"stderr": bool}` when an output stream ends.
+  streamEnd,
+
+  /// Daemon → client: `{"code", "cancelled", "terminationReason"}`.
+  exit,
+
+  /// Client → daemon: terminate the channel's process.
+  kill,
+
+  /// Daemon → client: `{"message"}` when a spawn failed.
+  error,
+
+  /// Daemon → client: a resource sample, as [ProcessStats.toJson].
+  stats,
+}
+
+/// Version exchanged in [FrameType.hello].
+const protocolVersion = 1;
+
+/// Upper bound on a single frame, guarding against corrupt length fields.
+const maxFrameLength = 16 * 1024 * 1024;
+
+/// One decoded protocol frame.
+class Frame {
+  final FrameType type;
+  final int channel;
+  final Uint8List payload;
+
+  Frame(this.type, this.channel, this.payload);
+
+  /// Builds a frame with a JSON payload.
+  factory Frame.json(FrameType type, int channel, Map<String, Object?> body) =>
+      Frame(type, channel, utf8.encoder.convert(jsonEncode(body)));
+
+  /// Builds a frame with a UTF-8 text payload.
+  factory Frame.text(FrameType type, int channel, String text) =>
+      Frame(type, channel, utf8.encoder.convert(text));
+
+  /// The payload decoded as a JSON object.
+  Map<String, Object?> get json =>
+      jsonDecode(utf8.decode(payload)) as Map<String, Object?>;
+
+  /// The payload decoded as UTF-8 text.
+  String get text => utf8.decode(payload, allowMalformed: true);
+
+  /// Serializes the frame for the wire.
+  Uint8List encode() {
+    final bytes = Uint8List(9 + payload.length);
+    ByteData.sublistView(bytes)
+      ..setUint32(0, 5 + payload.length)
+      ..setUint8(4, type.index)
+      ..setUint32(5, channel);
+    bytes.setRange(9, bytes.length, payload);
+    return bytes;
+  }
+}
+
+/// Splits a byte stream into [Frame]s.
+class FrameDecoder {
+  Uint8List _buffer = Uint8List(0);
+
+  /// Appends [chunk] and returns every frame completed by it.
+  ///
+  /// Throws [FormatException] on an unknown type or oversized frame; the
+  /// connection should be dropped then.
+  List<Frame> add(List<int> chunk) {
+    _buffer = _buffer.isEmpty && chunk is Uint8List
+        ? chunk
+        : (BytesBuilder(copy: false)
+              ..add(_buffer)
+              ..add(chunk))
+            .takeBytes();
+    final frames = <Frame>[];
+    var offset = 0;
+    while (_buffer.length - offset >= 4) {
+      final view = ByteData.sublistView(_buffer, offset);
+      final length = view.getUint32(0);
+      if (length < 5 || length > maxFrameLength) {
+        throw FormatException('Invalid frame length $length');
+      }
+      if (_buffer.length - offset < 4 + length) break;
+      final typeIndex = view.getUint8(4);
+      if (typeIndex >= FrameType.values.length) {
+        throw FormatException('Unknown frame type $typeIndex');
+      }
+      frames.add(Frame(
+        FrameType.values[typeIndex],
+        view.getUint32(5),
+        Uint8List.sublistView(_buffer, offset + 9, offset + 4 + length),
+      ));
+      offset += 4 + length;
+    }
+    _buffer = Uint8List.sublistView(_buffer, offset);
+    return frames;
+  }
+}
+
+/// Connects to a daemon endpoint: `tcp://host:port` or `unix:///path`.
+Future<Socket> connectEndpoint(Uri endpoint) {
+  switch (endpoint.scheme) {
+    case 'tcp':
+      return Socket.connect(endpoint.host, endpoint.port);
+    case 'unix':
+      return Socket.connect(
+          InternetAddress(endpoint.path, type: InternetAddressType.unix), 0);
+    default:
+      throw ArgumentError.value(
+          endpoint, 'endpoint', 'Expected a tcp:// or unix:// URI');
+  }
+}
+
+/// Serializes the options a daemon needs to run a command.
+///
+/// Throws [ArgumentError] for a [WorkspaceOptions.packageMirror], which is
+/// a local server and cannot be used from another host.
+Map<String, Object?> encodeOptions(WorkspaceOptions options) {
+  if (options.packageMirror != null) {
+    throw ArgumentError.value(options, 'options',
+        'PackageMirror cannot be used with a remote execution backend');
+  }
+  Map<String, Object?>? redirect(OutputRedirect? r) => r == null
+      ? null
+      : {'path': r.path, 'append': r.append, 'tee': r.tee};
+  return {
+    'timeoutMs': options.timeout?.inMilliseconds,
+    'env': options.env,
+    'includeParentEnv': options.includeParentEnv,
+    'cwd': options.workingDirectoryOverride,
+    'sandbox': options.sandbox,
+    'allowNetwork': options.allowNetwork,
+    'profile': options.sandboxProfile?.name,
+    'caches': [
+      for (final cache in options.caches)
+        {
+          'path': cache.path,
+          'env': cache.env,
+          'appendEnv': cache.appendEnv,
+          'exclusive': cache.exclusive,
+          'writable': cache.writable,
+        },
+    ],
+    'stdoutTo': redirect(options.stdoutTo),
+    'stderrTo': redirect(options.stderrTo),
+    'traceFileAccess': options.traceFileAccess,
+    'outputFilter': options.outputFilter?.toJson(),
+    'sampleIntervalMs': options.sampleInterval?.inMilliseconds,
+    'idleTimeoutMs': options.idleTimeout?.inMilliseconds,
+    'priority': options.priority?.toJson(),
+  };
+}
+
+/// Inverse of [encodeOptions].
+WorkspaceOptions decodeOptions(Map<String, Object?> json) {
+  OutputRedirect? redirect(Object? r) {
+    if (r is! Map) return null;
+    return OutputRedirect(r['path'] as String,
+        append: r['append'] == true, tee: r['tee'] == true);
+  }
+
+  final timeout = json['timeoutMs'] as int?;
+  final profile = json['profile'] as String?;
+  final filter = json['outputFilter'];
+  final sampleInterval = json['sampleIntervalMs'] as int?;
+  final idleTimeout = json['idleTimeoutMs'] as int?;
+  final priority = json['priority'];
+  return WorkspaceOptions(
+    timeout: timeout == null ? null : Duration(milliseconds: timeout),
+    env: (json['env'] as Map? ?? const {}).cast<String, String>(),
+    includeParentEnv: json['includeParentEnv'] != false,
+    workingDirectoryOverride: json['cwd'] as String?,
+    sandbox: json['sandbox'] == true,
+    allowNetwork: json['allowNetwork'] != false,
+    sandboxProfile:
+        profile == null ? null : SandboxProfile.values.byName(profile),
+    caches: [
+      for (final cache in json['caches'] as List? ?? const [])
+        CacheMount(cache['path'] as String,
+            env: (cache['env'] as Map).cast<String, String>(),
+            appendEnv: (cache['appendEnv'] as Map? ?? const {})
+                .cast<String, String>(),
+            exclusive: cache['exclusive'] == true,
+            writable: (cache['writable'] as List? ?? const []).cast<String>()),
+    ],
+    stdoutTo: redirect(json['stdoutTo']),
+    stderrTo: redirect(json['stderrTo']),
+    traceFileAccess: json['traceFileAccess'] == true,
+    outputFilter: filter is Map<String, Object?>
+        ? OutputFilter.fromJson(filter)
+        : null,
+    sampleInterval: sampleInterval == null
+        ? null
+        : Duration(milliseconds: sampleInterval),
+    idleTimeout:
+        idleTimeout == null ? null : Duration(milliseconds: idleTimeout),
+    priority: priority is Map<String, Object?>
+        ? ProcessPriority.fromJson(priority)
+        : null,
+  );
+}
@@ -0,0 +1,290 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+
+import '../core/execution_backend.dart';
+import '../models/file_access.dart';
+import '../models/output_filter.dart';
+import '../models/process_stats.dart';
+import '../models/workspace_options.dart';
+import '../models/workspace_process.dart';
+import '../util/forwarded_process.dart';
+import 'launcher_protocol.dart';
+
+/// Chooses the daemon a new workspace runs on.
+///
+/// Receives the connected daemons (never empty) and the workspace id.
+typedef DaemonPlacement = RemoteDaemon Function(
+    List<RemoteDaemon> daemons, String workspaceId);
+
+/// Runs workspace commands on one or more [LauncherDaemon]s.
+///
+/// Connections are multiplexed: every workspace and process placed on a
+/// daemon shares its single socket. Pass [backendFor] as the `backend` of
+/// [Workspace.ephemeral] or [Workspace.at]; each workspace is placed once,
+/// when it is created, by the [DaemonPlacement] policy (by default the
+/// daemon with the fewest workspaces per unit of advertised capacity).
+///
+/// File operations (`ws.fs`) stay local, so the workspace root must be
+/// visible at the same path on the daemons' hosts.
+///
+/// Example:
+/// ```
+/// final remote = await RemoteLauncher.connect([
+///   Uri.parse('tcp://build-1:7070'),
+///   Uri.parse('tcp://build-2:7070'),
+/// ], token: secret);
+/// final ws = Workspace.at('/shared/project', backend: remote.backendFor);
+/// await ws.exec('make -j8');
+/// ```
+class RemoteLauncher {
+  /// Connected daemons, in the order given to [connect].
+  final List<RemoteDaemon> daemons;
+
+  final DaemonPlacement _placement;
+
+  RemoteLauncher._(this.daemons, this._placement);
+
+  /// Connects to every endpoint (`tcp://host:port` or `unix:///path`).
+  ///
+  /// Throws if any daemon is unreachable or rejects [token].
+  static Future<RemoteLauncher> connect(List<Uri> endpoints,
+      {String? token, DaemonPlacement? placement}) async {
+    if (endpoints.isEmpty) {
+      throw ArgumentError.value(endpoints, 'endpoints', 'Must not be empty');
+    }
+    final daemons = <RemoteDaemon>[];
+    try {
+      for (final endpoint in endpoints) {
+        daemons.add(await RemoteDaemon._connect(endpoint, token));
+      }
+    } catch (_) {
+      for (final daemon in daemons) {
+        daemon.close();
+      }
+      rethrow;
+    }
+    return RemoteLauncher._(daemons, placement ?? leastLoaded);
+  }
+
+  /// Default placement: fewest workspaces relative to capacity.
+  static RemoteDaemon leastLoaded(
+      List<RemoteDaemon> daemons, String workspaceId) {
+    double load(RemoteDaemon d) => (d.workspaces + 1) / d.capacity;
+    return daemons.reduce((a, b) => load(b) < load(a) ? b : a);
+  }
+
+  /// Places a workspace on a daemon and returns its backend.
+  ///
+  /// Matches [ExecutionBackendFactory], so it can be passed as `backend`
+  /// directly. Throws [StateError] if no daemon is connected.
+  ExecutionBackend backendFor(String rootPath, String id) {
+    final connected = daemons.where((d) => d.isConnected).toList();
+    if (connected.isEmpty) {
+      throw StateError('No launcher daemon is connected');
+    }
+    final daemon = _placement(connected, id);
+    daemon.workspaces++;
+    return _RemoteBackend(daemon, rootPath, id);
+  }
+
+  /// Closes all connections; processes still running on the daemons are
+  /// killed by them.
+  void close() {
+    for (final daemon in daemons) {
+      daemon.close();
+    }
+  }
+}
+
+/// A connection to one [LauncherDaemon].
+class RemoteDaemon {
+  /// The daemon's address.
+  final Uri endpoint;
+
+  /// Concurrency the daemon advertised (its processor count by default).
+  final int capacity;
+
+  /// Workspaces currently placed on this daemon.
+  int workspaces = 0;
+
+  final Socket _socket;
+  final _processes = <int, ForwardedProcess>{};
+  final _spawns = <int, Completer<int>>{};
+  int _nextChannel = 1;
+  bool _connected = true;
+
+  RemoteDaemon._(this.endpoint, this.capacity, this._socket);
+
+  static Future<RemoteDaemon> _connect(Uri endpoint, String? token) async {
+    final socket = await connectEndpoint(endpoint);
+    final decoder = FrameDecoder();
+    final frames = StreamController<Frame>();
+    // The socket stream can only be listened to once; route it through a
+    // controller that the connection takes over after the handshake.
+    final subscription = socket.listen(
+        (chunk) {
+          try {
+            decoder.add(chunk).forEach(frames.add);
+          } on FormatException catch (e) {
+            frames.addError(e);
+          }
+        },
+        onDone: frames.close,
+        onError: frames.addError);
+    socket.add(Frame.json(FrameType.hello, 0,
+        {'version': protocolVersion, 'token': token}).encode());
+
+    final iterator = StreamIterator(frames.stream);
+    final int capacity;
+    try {
+      if (!await iterator.moveNext().timeout(const Duration(seconds: 10)) ||
+          iterator.current.type != FrameType.hello) {
+        throw SocketException('Launcher daemon at $endpoint refused the '
+            'connection (version or token mismatch)');
+      }
+      capacity = iterator.current.json['capacity'] as int? ?? 1;
+    } catch (_) {
+      await subscription.cancel();
+      socket.destroy();
+      rethrow;
+    }
+
+    final daemon =
+        RemoteDaemon._(endpoint, capacity < 1 ? 1 : capacity, socket);
+    () async {
+      try {
+        while (await iterator.moveNext()) {
+          daemon._handle(iterator.current);
+        }
+      } catch (_) {
+        // Corrupt stream or socket error: treat as disconnected.
+      }
+      daemon._disconnected();
+    }();
+    return daemon;
+  }
+
+  /// Whether the connection is still open.
+  bool get isConnected => _connected;
+
+  /// Processes currently running through this connection.
+  int get activeProcesses => _processes.length;
+
+  Future<WorkspaceProcess> _spawn(Map<String, Object?> request) async {
+    if (!_connected) {
+      throw SocketException('Launcher daemon at $endpoint is disconnected');
+    }
+    final channel = _nextChannel++;
+    final process = ForwardedProcess(onKill: () => _kill(channel));
+    final started = Completer<int>();
+    _processes[channel] = process;
+    _spawns[channel] = started;
+    process.finished.then((_) => _processes.remove(channel));
+    _socket.add(Frame.json(FrameType.spawn, channel, request).encode());
+    try {
+      process.pid = await started.future;
+    } catch (_) {
+      process.abandon();
+      rethrow;
+    }
+    return process;
+  }
+
+  void _kill(int channel) {
+    if (_connected) {
+      _socket.add(Frame(FrameType.kill, channel, Uint8List(0)).encode());
+    }
+  }
+
+  void _handle(Frame frame) {
+    final channel = frame.channel;
+    final process = _processes[channel];
+    switch (frame.type) {
+      case FrameType.started:
+        _spawns.remove(channel)?.complete(frame.json['pid'] as int);
+      case FrameType.error:
+        _spawns.remove(channel)?.completeError(ProcessException(
+            '', const [], '${frame.json['message']}'));
+      case FrameType.stdout:
+        process?.deliverOutput(frame.text, isError: false);
+      case FrameType.stderr:
+        process?.deliverOutput(frame.text, isError: true);
+      case FrameType.stats:
+        process?.deliverStats(ProcessStats.fromJson(frame.json));
+      case FrameType.streamEnd:
+        process?.deliverDone(isError: frame.json['stderr'] == true);
+      case FrameType.exit:
+        final body = frame.json;
+        final access = body['fileAccess'];
+        final stats = body['outputStats'];
+        final reason = body['terminationReason'] as String?;
+        process?.deliverExit(body['code'] as int,
+            cancelled: body['cancelled'] == true,
+            terminationReason:
+                reason == null ? null : TerminationReason.values.byName(reason),
+            fileAccess: access is Map<String, Object?>
+                ? FileAccess.fromJson(access)
+                : null,
+            outputStats: stats is Map<String, Object?>
+                ? OutputStats.fromJson(stats)
+                : null);
+      default:
+        break;
+    }
+  }
+
+  /// Fails pending spawns and ends running processes with exit code -1.
+  void _disconnected() {
+    _connected = false;
+    final error =
+        SocketException('Connection to launcher daemon $endpoint was lost');
+    for (final spawn in _spawns.values) {
+      spawn.completeError(error);
+    }
+    _spawns.clear();
+    for (final process in List.of(_processes.values)) {
+      process.abandon();
+    }
+  }
+
+  /// Closes the connection.
+  void close() {
+    if (!_connected) return;
+    _socket.destroy();
+    _disconnected();
+  }
+}
+
+/// Backend of one workspace placed on a [RemoteDaemon].
+class _RemoteBackend implements ExecutionBackend {
+  final RemoteDaemon _daemon;
+  final String _rootPath;
+  final String _id;
+  bool _disposed = false;
+
+  _RemoteBackend(this._daemon, this._rootPath, this._id);
+
+  @override
+  Future<WorkspaceProcess> spawnShell(
+          String commandLine, WorkspaceOptions options) =>
+      _daemon._spawn(_request(options)..['shell'] = commandLine);
+
+  @override
+  Future<WorkspaceProcess> spawnExec(
+          String executable, List<String> args, WorkspaceOptions options) =>
+      _daemon._spawn(_request(options)..['exec'] = [executable, ...args]);
+
+  Map<String, Object?> _request(WorkspaceOptions options) => {
+        'workspace': _id,
+        'root': _rootPath,
+        'options': encodeOptions(options),
+      };
+
+  @override
+  Future<void> dispose() async {
+    if (_disposed) return;
+    _disposed = true;
+    _daemon.workspaces--;
+  }
+}
@@ -1,6 +1,8 @@
 import 'dart:io';
 import 'package:path/path.dart' as p;
 
+import 'tree_walker.dart';
+
 /// Low-level file system utilities for workspace operations.
 ///
 /// Provides cross-platform implementations of common file operations
@@ -8,8 +10,10 @@ import 'package:path/path.dart' as p;
 class FileSystemHelpers {
   /// Generates a visual tree representation of a directory structure.
   ///
-  /// Uses a flattened traversal strategy for OS consistency. Hidden files
-  /// (starting with '.') are automatically excluded.
+  /// Hidden files (starting with '.') are automatically excluded, and so
+  /// are paths ignored by `.gitignore`/`.wsignore` files or listed in
+  /// [TreeWalker.defaultExcludes] unless [includeIgnored] is set. Ignored
+  /// and too deep directories are not read at all.
   ///
   /// Parameters:
   /// - [rootPath]: Absolute path to the directory to visualize
@@ -28,51 +32,35 @@ class FileSystemHelpers {
   /// final tree = await FileSystemHelpers.tree('/path/to/project', maxDepth: 3);
   /// print(tree);
   /// ```
-  static Future<String> tree(String rootPath, {int maxDepth = 5}) async {
+  static Future<String> tree(String rootPath,
+      {int maxDepth = 5, bool includeIgnored = false}) async {
     final dir = Directory(rootPath);
     if (!await dir.exists()) return '';
 
     final buffer = StringBuffer();
     buffer.writeln(p.basename(rootPath));
 
-    List<FileSystemEntity> entities;
-    try {
-      await Future.delayed(const Duration(milliseconds: 10));
-      entities = await dir.list(recursive: true, followLinks: false).toList();
-    } catch (_) {
-      return buffer.toString();
-    }
-
-    final paths = <String>[];
-    for (var entity in entities) {
-      final relative = p.relative(entity.path, from: rootPath);
-      final parts = p.split(relative);
-      if (parts.length > maxDepth) continue;
-      if (parts.any((part) => part.startsWith('.'))) continue;
-      paths.add(relative);
-    }
-
-    paths.sort((a, b) => a.toLowerCase().compareTo(b.toLowerCase()));
+    final walker = _walker(rootPath, includeIgnored,
+        maxDepth: maxDepth, includeHidden: false);
+    final paths = [
+      await for (final entry in walker.walk()) entry.relativePath.split('/')
+    ]..sort(_compareSegments);
 
     if (paths.isEmpty) return buffer.toString();
 
     final openLevels = <int, bool>{};
 
     for (var i = 0; i < paths.length; i++) {
-      final path = paths[i];
-      final parts = p.split(path);
+      final parts = paths[i];
       final level = parts.length - 1;
       final name = parts.last;
 
       bool isLast = true;
       if (i + 1 < paths.length) {
-        final nextPath = paths[i + 1];
-        final nextParts = p.split(nextPath);
+        final nextParts = paths[i + 1];
         if (nextParts.length > level) {
-          final currentParent =
-              level == 0 ? '' : p.joinAll(parts.sublist(0, level));
-          final nextParent =
-              level == 0 ? '' : p.joinAll(nextParts.sublist(0, level));
+          final currentParent = parts.sublist(0, level).join('/');
+          final nextParent = nextParts.sublist(0, level).join('/');
           if (currentParent == nextParent) isLast = false;
         }
       }
@@ -90,9 +78,42 @@ class FileSystemHelpers {
     return buffer.toString();
   }
 
+  /// Orders paths segment by segment, case-insensitively, so a directory's
+  /// contents directly follow it.
+  static int _compareSegments(List<String> a, List<String> b) {
+    for (var i = 0; i < a.length && i < b.length; i++) {
+      final order = a[i].toLowerCase().compareTo(b[i].toLowerCase());
+      if (order != 0) return order;
+    }
+    return a.length.compareTo(b.length);
+  }
+
+  /// Extensions of files [grep] never reads.
+  static const _binaryExtensions = {
+    '.png',
+    '.jpg',
+    '.jpeg',
+    '.gif',
+    '.bmp',
+    '.exe',
+    '.dll',
+    '.so',
+    '.dylib',
+    '.bin',
+    '.zip',
+    '.tar',
+    '.gz',
+    '.pdf',
+    '.ico'
+  };
+
+  /// Number of files [grep] reads at once.
+  static const _grepBatch = 16;
+
   /// Searches for text patterns in files within a directory.
   ///
-  /// Automatically skips binary files (images, executables, archives).
+  /// Automatically skips binary files (images, executables, archives) and,
+  /// unless [includeIgnored] is set, ignored paths (see [tree]).
   /// Limits results to 500 matches to prevent memory exhaustion.
   ///
   /// Parameters:
@@ -101,10 +122,11 @@ class FileSystemHelpers {
   /// - [recursive]: Whether to search subdirectories (default: true)
   /// - [caseSensitive]: Whether to match case (default: true)
   ///
-  /// Returns formatted results with file paths and line numbers:
+  /// Returns formatted results with file paths and line numbers, ordered
+  /// by path:
   /// ```
-  /// src/main.dart:42: print('Hello World');
   /// lib/util.dart:15: // Hello comment
+  /// src/main.dart:42: print('Hello World');
   /// ```
   ///
   /// Example:
@@ -116,65 +138,63 @@ class FileSystemHelpers {
   /// );
   /// ```
   static Future<String> grep(String rootPath, String pattern,
-      {bool recursive = true, bool caseSensitive = true}) async {
+      {bool recursive = true,
+      bool caseSensitive = true,
+      bool includeIgnored = false}) async {
     final results = <String>[];
     final dir = Directory(rootPath);
     if (!await dir.exists()) return '';
 
-    Stream<FileSystemEntity> stream =
-        dir.list(recursive: recursive, followLinks: false);
+    final walker =
+        _walker(rootPath, includeIgnored, maxDepth: recursive ? null : 1);
+    final files = [
+      await for (final entry in walker.walk())
+        if (!entry.isDirectory &&
+            !_binaryExtensions.contains(p.extension(entry.path).toLowerCase()))
+          entry
+    ]..sort((a, b) => a.relativePath.compareTo(b.relativePath));
 
-    try {
-      await for (final entity in stream) {
-        if (entity is File) {
-          const binaryExts = {
-            '.png',
-            '.jpg',
-            '.jpeg',
-            '.gif',
-            '.bmp',
-            '.exe',
-            '.dll',
-            '.so',
-            '.dylib',
-            '.bin',
-            '.zip',
-            '.tar',
-            '.gz',
-            '.pdf',
-            '.ico'
-          };
-          if (binaryExts.contains(p.extension(entity.path).toLowerCase())) {
-            continue;
-          }
+    // Files are read a batch at a time; results stay in path order.
+    for (var i = 0; i < files.length; i += _grepBatch) {
+      final batch = files.skip(i).take(_grepBatch);
+      final matches = await Future.wait(batch.map(
+          (file) => _grepFile(rootPath, file.path, pattern, caseSensitive)));
+      for (final match in matches.expand((lines) => lines)) {
+        results.add(match);
+        if (results.length > 500) {
+          results.add('...');
+          return results.join('\n');
+        }
+      }
+    }
 
-          try {
-            final lines = await entity.readAsLines();
-            for (var i = 0; i < lines.length; i++) {
-              final line = lines[i];
-              final match = caseSensitive
-                  ? line.contains(pattern)
-                  : line.toLowerCase().contains(pattern.toLowerCase());
-              if (match) {
-                final relPath = p.relative(entity.path, from: rootPath);
-                final trimmed = line.trim();
-                final preview = trimmed.length > 100
-                    ? '${trimmed.substring(0, 100)}...'
-                    : trimmed;
-                results.add('$relPath:${i + 1}: $preview');
+    return results.join('\n');
+  }
 
-                if (results.length > 500) {
-                  results.add('...');
-                  return results.join('\n');
-                }
-              }
-            }
-          } catch (_) {}
+  static Future<List<String>> _grepFile(
+      String rootPath, String path, String pattern, bool caseSensitive) async {
+    final results = <String>[];
+    try {
+      final lines = await File(path).readAsLines();
+      final needle = caseSensitive ? pattern : pattern.toLowerCase();
+      for (var i = 0; i < lines.length; i++) {
+        final line = lines[i];
+        final match = caseSensitive
+            ? line.contains(needle)
+            : line.toLowerCase().contains(needle);
+        if (match) {
+          final relPath = p.relative(path, from: rootPath);
+          final trimmed = line.trim();
+          final preview = trimmed.length > 100
+              ? '${trimmed.substring(0, 100)}...'
+              : trimmed;
+          results.add('$relPath:${i + 1}: $preview');
+          // Nothing past the overall limit is reported.
+          if (results.length > 500) break;
         }
       }
     } catch (_) {}
-
-    return results.join('\n');
+    return results;
   }
 
   /// Finds files matching a glob pattern.
@@ -183,7 +203,8 @@ class FileSystemHelpers {
   /// - `*` matches any sequence of characters
   /// - `?` matches a single character
   ///
-  /// Matching is case-insensitive.
+  /// Matching is case-insensitive. Ignored paths are skipped unless
+  /// [includeIgnored] is set (see [tree]).
   ///
   /// Example:
   /// ```
@@ -191,9 +212,9 @@ class FileSystemHelpers {
   /// final testFiles = await FileSystemHelpers.find('/project', 'test_*.dart');
   /// ```
   ///
-  /// Returns a list of relative file paths matching the pattern.
-  static Future<List<String>> find(String rootPath, String pattern) async {
-    final results = <String>[];
+  /// Returns a sorted list of relative file paths matching the pattern.
+  static Future<List<String>> find(String rootPath, String pattern,
+      {bool includeIgnored = false}) async {
     final dir = Directory(rootPath);
     if (!await dir.exists()) return [];
 
@@ -201,15 +222,22 @@ class FileSystemHelpers {
         '^${RegExp.escape(pattern).replaceAll(r'\*', '.*').replaceAll(r'\?', '.')}\$',
         caseSensitive: false);
 
-    await for (final entity in dir.list(recursive: true, followLinks: false)) {
-      if (regex.hasMatch(p.basename(entity.path))) {
-        results.add(p.relative(entity.path, from: rootPath));
-      }
-    }
-
-    return results;
+    final walker = _walker(rootPath, includeIgnored);
+    return [
+      await for (final entry in walker.walk())
+        if (regex.hasMatch(p.basename(entry.path)))
+          p.relative(entry.path, from: rootPath)
+    ]..sort();
   }
 
+  static TreeWalker _walker(String rootPath, bool includeIgnored,
+          {int? maxDepth, bool includeHidden = true}) =>
+      TreeWalker(rootPath,
+          excludes: includeIgnored ? const {} : TreeWalker.defaultExcludes,
+          respectIgnoreFiles: !includeIgnored,
+          includeHidden: includeHidden,
+          maxDepth: maxDepth);
+
   /// Copies a file or directory recursively.
   ///
   /// If [srcPath] is a file, copies it to [destPath].
@@ -0,0 +1,140 @@
+import 'dart:async';
+
+import '../models/file_access.dart';
+import '../models/output_filter.dart';
+import '../models/process_stats.dart';
+import '../models/workspace_process.dart';
+import 'output_waiters.dart';
+
+/// A [WorkspaceProcess] running elsewhere (another isolate or host) whose
+/// output, stream ends and exit are delivered as messages.
+///
+/// Messages may arrive together with the reply that created the process,
+/// before the caller's `await execStream(...)` has resumed and attached
+/// listeners. They are held back until the next event-loop turn, matching
+/// a local process, whose first chunk never arrives synchronously.
+class ForwardedProcess with OutputWaiters implements WorkspaceProcess {
+  final void Function() _onKill;
+  final _stdoutCtrl = StreamController<String>.broadcast();
+  final _stderrCtrl = StreamController<String>.broadcast();
+  final _statsCtrl = StreamController<ProcessStats>.broadcast();
+  final _exitCodeCompleter = Completer<int>();
+  final _fileAccessCompleter = Completer<FileAccess?>();
+  final _outputStatsCompleter = Completer<OutputStats?>();
+  final _finished = Completer<void>();
+  int _unsettled = 3;
+
+  /// Messages held back until the caller had a chance to listen.
+  List<void Function()>? _pending = [];
+  bool _isCancelled = false;
+  TerminationReason? _terminationReason;
+
+  @override
+  int pid = 0;
+
+  /// Creates a process proxy; [onKill] forwards [kill] to the real process.
+  ForwardedProcess({required void Function() onKill}) : _onKill = onKill {
+    Timer.run(() {
+      final pending = _pending!;
+      _pending = null;
+      for (final deliver in pending) {
+        deliver();
+      }
+    });
+  }
+
+  @override
+  Stream<String> get stdout => _stdoutCtrl.stream;
+
+  @override
+  Stream<String> get stderr => _stderrCtrl.stream;
+
+  @override
+  Stream<ProcessStats> get stats => _statsCtrl.stream;
+
+  @override
+  Future<int> get exitCode => _exitCodeCompleter.future;
+
+  @override
+  Future<FileAccess?> get fileAccess => _fileAccessCompleter.future;
+
+  @override
+  Future<OutputStats?> get outputStats => _outputStatsCompleter.future;
+
+  @override
+  bool get isCancelled => _isCancelled;
+
+  @override
+  TerminationReason? get terminationReason => _terminationReason;
+
+  /// Completes once the exit code and both stream ends were delivered, i.e.
+  /// when no further message can concern this process.
+  Future<void> get finished => _finished.future;
+
+  @override
+  void kill() {
+    if (_isCancelled || _exitCodeCompleter.isCompleted) return;
+    _isCancelled = true;
+    _terminationReason = TerminationReason.killed;
+    _onKill();
+  }
+
+  /// Delivers a chunk of decoded output.
+  void deliverOutput(String text, {required bool isError}) => _deliver(() {
+        recordOutput(text, fromStderr: isError);
+        (isError ? _stderrCtrl : _stdoutCtrl).add(text);
+      });
+
+  /// Delivers a resource sample.
+  void deliverStats(ProcessStats stats) => _deliver(() {
+        if (!_statsCtrl.isClosed) _statsCtrl.add(stats);
+      });
+
+  /// Delivers the end of one output stream.
+  void deliverDone({required bool isError}) => _deliver(() {
+        final ctrl = isError ? _stderrCtrl : _stdoutCtrl;
+        if (ctrl.isClosed) return;
+        ctrl.close();
+        recordStreamDone();
+        _settle();
+      });
+
+  /// Delivers the exit code and, for traced or filtered commands, the
+  /// files accessed and output counts.
+  void deliverExit(int code,
+          {bool cancelled = false,
+          TerminationReason? terminationReason,
+          FileAccess? fileAccess,
+          OutputStats? outputStats}) =>
+      _deliver(() {
+        _isCancelled |= cancelled;
+        _terminationReason ??= terminationReason;
+        if (_exitCodeCompleter.isCompleted) return;
+        _statsCtrl.close();
+        _exitCodeCompleter.complete(code);
+        _fileAccessCompleter.complete(fileAccess);
+        _outputStatsCompleter.complete(outputStats);
+        _settle();
+      });
+
+  /// Ends the process as if it exited with [code] and closed both streams,
+  /// e.g. when it failed to start or the connection to it was lost.
+  void abandon([int code = -1]) {
+    deliverDone(isError: false);
+    deliverDone(isError: true);
+    deliverExit(code);
+  }
+
+  void _settle() {
+    if (--_unsettled == 0) _finished.complete();
+  }
+
+  void _deliver(void Function() message) {
+    final pending = _pending;
+    if (pending != null) {
+      pending.add(message);
+    } else {
+      message();
+    }
+  }
+}
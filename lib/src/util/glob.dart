@@ -0,0 +1,47 @@
+/// Compiles a glob over `/`-separated relative paths into a [RegExp].
+///
+/// - `*` matches within one path segment, `?` one character of it
+/// - `**` matches any number of segments (`src/**/*.dart`)
+/// - `{a,b}` matches either alternative
+///
+/// A pattern without `/` matches the file name in any directory, so
+/// `*.dart` matches `lib/src/a.dart`. Like shell globbing, wildcards never
+/// match a segment starting with `.`, which keeps `.git` and `.dart_tool`
+/// out of `**` unless the pattern names them.
+RegExp globToRegExp(String glob) {
+  const anySegment = r'(?!\.)[^/]*';
+  const anyDirs = '(?:$anySegment/)*';
+  final out = StringBuffer('^');
+  if (!glob.contains('/')) out.write(anyDirs);
+  var depth = 0;
+  for (var i = 0; i < glob.length; i++) {
+    final c = glob[i];
+    final segmentStart = i == 0 || glob[i - 1] == '/';
+    switch (c) {
+      case '*' when i + 1 < glob.length && glob[i + 1] == '*':
+        i++;
+        if (i + 1 < glob.length && glob[i + 1] == '/') {
+          i++;
+          out.write(anyDirs);
+        } else {
+          out.write('$anyDirs$anySegment');
+        }
+      case '*':
+        out.write(segmentStart ? anySegment : '[^/]*');
+      case '?':
+        out.write(segmentStart ? r'(?!\.)[^/]' : '[^/]');
+      case '{':
+        depth++;
+        out.write('(?:');
+      case '}' when depth > 0:
+        depth--;
+        out.write(')');
+      case ',' when depth > 0:
+        out.write('|');
+      default:
+        out.write(RegExp.escape(c));
+    }
+  }
+  out.write(r'$');
+  return RegExp(out.toString());
+}
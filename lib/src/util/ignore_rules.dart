@@ -0,0 +1,152 @@
+/// Ignore rules from `.gitignore`-style files, chained by directory.
+///
+/// Each [IgnoreRules] holds the patterns of one file and points to the
+/// rules of the directories above it. As in git, the last matching pattern
+/// of the deepest file decides, `!pattern` re-includes, a trailing `/`
+/// matches directories only, and a pattern containing a `/` other than a
+/// trailing one is anchored to the directory of its file; other patterns
+/// match the name at any depth.
+class IgnoreRules {
+  /// Rules of the enclosing directories, consulted when no pattern here
+  /// matches.
+  final IgnoreRules? parent;
+
+  /// Directory of the ignore file, relative to the walk root with `/`
+  /// separators (`''` for the root).
+  final String base;
+
+  final List<_Pattern> _patterns;
+
+  IgnoreRules._(this.parent, this.base, this._patterns);
+
+  /// Parses the contents of an ignore file located in [base], on top of
+  /// [parent]. Returns [parent] itself when [text] holds no patterns.
+  static IgnoreRules? parse(String text,
+      {String base = '', IgnoreRules? parent}) {
+    final patterns = [
+      for (final line in text.split('\n'))
+        if (_Pattern.parse(line) case final pattern?) pattern,
+    ];
+    return patterns.isEmpty ? parent : IgnoreRules._(parent, base, patterns);
+  }
+
+  /// Whether [path] (relative to the walk root, `/`-separated) is ignored.
+  bool isIgnored(String path, {required bool isDirectory}) {
+    for (IgnoreRules? rules = this; rules != null; rules = rules.parent) {
+      final String relative;
+      if (rules.base.isEmpty) {
+        relative = path;
+      } else if (path.startsWith('${rules.base}/')) {
+        relative = path.substring(rules.base.length + 1);
+      } else {
+        continue;
+      }
+      for (final pattern in rules._patterns.reversed) {
+        if (pattern.matches(relative, isDirectory)) return !pattern.negated;
+      }
+    }
+    return false;
+  }
+}
+
+class _Pattern {
+  final RegExp regex;
+  final bool negated;
+  final bool directoryOnly;
+  final bool anchored;
+
+  _Pattern(this.regex,
+      {required this.negated,
+      required this.directoryOnly,
+      required this.anchored});
+
+  static _Pattern? parse(String line) {
+    if (line.endsWith('\r')) line = line.substring(0, line.length - 1);
+    if (line.isEmpty || line.startsWith('#')) return null;
+    // Trailing spaces are dropped unless escaped.
+    while (line.endsWith(' ') && !line.endsWith(r'\ ')) {
+      line = line.substring(0, line.length - 1);
+    }
+    final negated = line.startsWith('!');
+    if (negated || line.startsWith(r'\!') || line.startsWith(r'\#')) {
+      line = line.substring(1);
+    }
+    final directoryOnly = line.endsWith('/');
+    if (directoryOnly) line = line.substring(0, line.length - 1);
+    if (line.isEmpty) return null;
+    final anchored = line.contains('/');
+    if (line.startsWith('/')) line = line.substring(1);
+    return _Pattern(_compile(line),
+        negated: negated, directoryOnly: directoryOnly, anchored: anchored);
+  }
+
+  bool matches(String path, bool isDirectory) {
+    if (directoryOnly && !isDirectory) return false;
+    final subject =
+        anchored ? path : path.substring(path.lastIndexOf('/') + 1);
+    return regex.hasMatch(subject);
+  }
+
+  /// Translates the wildcards of gitignore(5). Unlike workspace globs,
+  /// wildcards here also match names starting with `.`.
+  static RegExp _compile(String glob) {
+    final out = StringBuffer('^');
+    for (var i = 0; i < glob.length; i++) {
+      final c = glob[i];
+      final segmentStart = i == 0 || glob[i - 1] == '/';
+      switch (c) {
+        case '*' when i + 1 < glob.length && glob[i + 1] == '*':
+          final segmentEnd = i + 2 == glob.length || glob[i + 2] == '/';
+          i++;
+          if (!segmentStart || !segmentEnd) {
+            out.write('[^/]*');
+          } else if (i + 1 == glob.length) {
+            // Trailing `/**`: everything inside.
+            out.write('.*');
+          } else {
+            // `**/`: zero or more directories.
+            i++;
+            out.write('(?:.*/)?');
+          }
+        case '*':
+          out.write('[^/]*');
+        case '?':
+          out.write('[^/]');
+        case '[':
+          final end = _classEnd(glob, i);
+          if (end < 0) {
+            out.write(r'\[');
+          } else {
+            var body = glob.substring(i + 1, end);
+            final negated = body.startsWith('!') || body.startsWith('^');
+            if (negated) body = body.substring(1);
+            final escaped = body
+                .replaceAll(r'\', r'\\')
+                .replaceAll('[', r'\[')
+                .replaceAll(']', r'\]');
+            out.write('[${negated ? '^' : ''}$escaped]');
+            i = end;
+          }
+        case r'\' when i + 1 < glob.length:
+          i++;
+          out.write(RegExp.escape(glob[i]));
+        default:
+          out.write(RegExp.escape(c));
+      }
+    }
+    out.write(r'$');
+    return RegExp(out.toString());
+  }
+
+  /// Index of the `]` closing the class opened at [start], or -1.
+  static int _classEnd(String glob, int start) {
+    var i = start + 1;
+    if (i < glob.length && (glob[i] == '!' || glob[i] == '^')) i++;
+    // A `]` right after the opening bracket is a literal.
+    if (i < glob.length && glob[i] == ']') i++;
+    for (; i < glob.length; i++) {
+      if (glob[i] == ']') return i;
+    }
+    return -1;
+  }
+}
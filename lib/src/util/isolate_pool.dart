@@ -0,0 +1,210 @@
+import 'dart:async';
+import 'dart:collection';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+/// A task run on a pool isolate. It is sent to the worker, so it must only
+/// capture sendable values (strings, numbers, plain objects).
+typedef IsolateTask = Future<Uint8List> Function();
+
+/// A size-bounded pool of long-lived isolates for heavy file system work.
+///
+/// Tree rendering, grep and recursive copies walk whole directory trees and
+/// build large results. Running them on the caller's isolate stalls output
+/// streaming and events of every workspace in the meantime, so
+/// [FileSystemService] submits them here instead. Results come back as
+/// [TransferableTypedData], which moves the bytes between isolates without
+/// copying them.
+///
+/// Workers are started on demand, run one task at a time and exit after
+/// [idleTimeout] without work; tasks beyond [size] wait in a queue.
+///
+/// Example:
+/// ```
+/// final pool = IsolatePool(size: 2);
+/// final bytes = await pool.run(() async => utf8.encoder.convert('done'));
+/// await pool.close();
+/// ```
+class IsolatePool {
+  static IsolatePool? _shared;
+
+  /// The pool used by [FileSystemService] unless another one is given.
+  ///
+  /// Sized to the number of processors minus one (for the caller's
+  /// isolate), between 1 and 4.
+  static IsolatePool get shared => _shared ??= IsolatePool();
+
+  /// Maximum number of worker isolates.
+  final int size;
+
+  /// How long an idle worker is kept before it exits.
+  final Duration idleTimeout;
+
+  final _workers = <_Worker>[];
+  final _queue = Queue<_Job>();
+  bool _closed = false;
+
+  /// Creates a pool of at most [size] isolates.
+  IsolatePool({int? size, this.idleTimeout = const Duration(seconds: 2)})
+      : size = size ?? (Platform.numberOfProcessors - 1).clamp(1, 4);
+
+  /// Number of worker isolates currently alive.
+  int get workerCount => _workers.length;
+
+  /// Runs [task] on a worker isolate and returns its bytes.
+  ///
+  /// Errors thrown by [task] are rethrown here with the worker's stack
+  /// trace; errors that cannot be sent between isolates arrive as
+  /// [RemoteError].
+  Future<Uint8List> run(IsolateTask task) {
+    if (_closed) {
+      return Future.error(StateError('IsolatePool has been closed'));
+    }
+    final job = _Job(task);
+    _queue.add(job);
+    _dispatch();
+    return job.completer.future;
+  }
+
+  /// Stops all workers. Queued tasks fail with a [StateError]; running
+  /// tasks are abandoned.
+  Future<void> close() async {
+    _closed = true;
+    if (identical(_shared, this)) _shared = null;
+    while (_queue.isNotEmpty) {
+      _queue
+          .removeFirst()
+          .completer
+          .completeError(StateError('IsolatePool has been closed'));
+    }
+    for (final worker in List.of(_workers)) {
+      _retire(worker);
+    }
+  }
+
+  void _dispatch() {
+    for (final worker in List.of(_workers)) {
+      if (_queue.isEmpty) return;
+      if (worker.ready && worker.job == null) {
+        worker.start(_queue.removeFirst());
+      }
+    }
+    // Workers still starting up will take the first queued jobs.
+    var starting = _workers.where((w) => !w.ready).length;
+    while (_queue.length > starting && _workers.length < size) {
+      _spawn();
+      starting++;
+    }
+  }
+
+  Future<void> _spawn() async {
+    final worker = _Worker(this);
+    _workers.add(worker);
+    try {
+      worker.isolate = await Isolate.spawn(_workerMain, worker.port.sendPort,
+          onExit: worker.port.sendPort,
+          onError: worker.port.sendPort,
+          debugName: 'workspace_sandbox fs worker');
+    } catch (e, st) {
+      _workers.remove(worker);
+      worker.port.close();
+      // Without workers nothing would ever drain the queue.
+      if (_workers.isEmpty) {
+        while (_queue.isNotEmpty) {
+          _queue.removeFirst().completer.completeError(e, st);
+        }
+      }
+    }
+  }
+
+  void _retire(_Worker worker) {
+    _workers.remove(worker);
+    worker.idleTimer?.cancel();
+    worker.port.close();
+    worker.isolate?.kill(priority: Isolate.immediate);
+    worker.job?.completer.completeError(StateError('Worker isolate stopped'));
+    worker.job = null;
+  }
+}
+
+class _Job {
+  final IsolateTask task;
+  final completer = Completer<Uint8List>();
+
+  _Job(this.task);
+}
+
+/// Main-isolate side of one worker.
+class _Worker {
+  final IsolatePool _pool;
+  final port = ReceivePort();
+  Isolate? isolate;
+  SendPort? _commands;
+  _Job? job;
+  Timer? idleTimer;
+
+  _Worker(this._pool) {
+    port.listen(_onMessage);
+  }
+
+  bool get ready => _commands != null;
+
+  void start(_Job next) {
+    idleTimer?.cancel();
+    job = next;
+    _commands!.send(next.task);
+  }
+
+  void _onMessage(Object? message) {
+    switch (message) {
+      case SendPort commands:
+        _commands = commands;
+        _pool._dispatch();
+        if (job == null) _idle();
+      case (TransferableTypedData result,):
+        _finish()?.complete(result.materialize().asUint8List());
+      case (Object error, String stack):
+        _finish()?.completeError(error, StackTrace.fromString(stack));
+      case null:
+        // onExit
+        _pool._retire(this);
+        _pool._dispatch();
+      case [Object? error, Object? stack]:
+        // onError; the isolate exits since errors are fatal.
+        final failed = job;
+        job = null;
+        failed?.completer.completeError(RemoteError('$error', '$stack'));
+    }
+  }
+
+  Completer<Uint8List>? _finish() {
+    final done = job?.completer;
+    job = null;
+    _pool._dispatch();
+    if (job == null) _idle();
+    return done;
+  }
+
+  void _idle() {
+    idleTimer?.cancel();
+    idleTimer = Timer(_pool.idleTimeout, () => _pool._retire(this));
+  }
+}
+
+Future<void> _workerMain(SendPort reply) async {
+  final commands = ReceivePort();
+  reply.send(commands.sendPort);
+  await for (final task in commands) {
+    try {
+      final bytes = await (task as IsolateTask)();
+      reply.send((TransferableTypedData.fromList([bytes]),));
+    } catch (e, st) {
+      try {
+        reply.send((e, st.toString()));
+      } catch (_) {
+        reply.send((RemoteError('$e', '$st'), st.toString()));
+      }
+    }
+  }
+}
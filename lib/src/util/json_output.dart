@@ -0,0 +1,73 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import '../models/command_result.dart';
+import '../models/workspace_process.dart';
+import 'output_window.dart';
+
+/// Decodes the stdout of [process] as one JSON document.
+///
+/// Chunks are fed to a chunked JSON parser as they arrive, so only the
+/// object graph is built; the text is never accumulated. Waits for the
+/// process to exit, then throws the [FormatException] if stdout was not a
+/// single valid document.
+Future<JsonCommandResult> collectJson(WorkspaceProcess process) async {
+  final stopwatch = Stopwatch()..start();
+  final stderr = StringBuffer();
+  final stderrDone = process.stderr.forEach(stderr.write);
+
+  Object? value;
+  FormatException? error;
+  try {
+    value = await json.decoder.bind(process.stdout).single;
+  } on FormatException catch (e) {
+    error = e;
+  }
+
+  final code = await process.exitCode;
+  await stderrDone;
+  stopwatch.stop();
+  if (error != null) throw error;
+  return JsonCommandResult(
+    json: value,
+    exitCode: code,
+    stderr: stderr.toString(),
+    duration: stopwatch.elapsed,
+    isCancelled: process.isCancelled,
+    terminationReason: process.terminationReason,
+  );
+}
+
+/// Decodes the stdout of [process] as newline-delimited JSON, one record
+/// per non-blank line.
+///
+/// Only the current line is buffered. A line that is not valid JSON is
+/// emitted as a [FormatException] error and decoding continues. After the
+/// last record, a non-zero exit code is emitted as a [ProcessException]
+/// carrying the tail of stderr. Cancelling the subscription kills the
+/// process.
+Stream<Object?> decodeNdjson(WorkspaceProcess process, Object command) async* {
+  final stderrTail = OutputWindow(4096);
+  final stderrDone = process.stderr.forEach(stderrTail.add);
+  var finished = false;
+  try {
+    yield* process.stdout
+        .transform(const LineSplitter())
+        .where((line) => line.trim().isNotEmpty)
+        .map(jsonDecode);
+    finished = true;
+  } finally {
+    if (!finished) process.kill();
+  }
+
+  final code = await process.exitCode;
+  await stderrDone;
+  if (code != 0 && !process.isCancelled) {
+    final (executable, arguments) = command is List<String>
+        ? (command.first, command.sublist(1))
+        : (command.toString(), const <String>[]);
+    throw ProcessException(
+        executable, arguments, stderrTail.text.trim(), code);
+  }
+}
@@ -0,0 +1,258 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import '../models/text_diff.dart';
+
+/// Computes a line diff of [oldText] and [newText] with [context] lines
+/// around each change.
+///
+/// Uses Myers' O(ND) algorithm in its linear-space form, so memory stays
+/// proportional to the input even for large, very different texts. Lines
+/// are interned to integers first and common leading and trailing lines
+/// are skipped before the search. Equal texts return without splitting.
+///
+/// Example:
+/// ```
+/// final diff = diffText('a\nb\n', 'a\nc\n');
+/// print(diff.unified);
+/// ```
+TextDiff diffText(String oldText, String newText,
+    {int context = 3, String fromLabel = 'a', String toLabel = 'b'}) {
+  if (context < 0) {
+    throw ArgumentError.value(context, 'context', 'Must not be negative');
+  }
+  if (oldText == newText) return TextDiff(fromLabel, toLabel, const []);
+
+  final oldLines = splitLines(oldText);
+  final newLines = splitLines(newText);
+  final ids = <String, int>{};
+  int intern(String line) => ids.putIfAbsent(line, () => ids.length);
+  final a = Int32List.fromList([for (final l in oldLines) intern(l)]);
+  final b = Int32List.fromList([for (final l in newLines) intern(l)]);
+
+  final myers = _Myers(a, b)..compare(0, a.length, 0, b.length);
+  return TextDiff(fromLabel, toLabel,
+      _hunks(oldLines, newLines, myers.removed, myers.added, context));
+}
+
+/// Splits [text] into lines that keep their `\n`, so a final line without
+/// one never equals the same line with one.
+List<String> splitLines(String text) {
+  final lines = <String>[];
+  var start = 0;
+  while (start < text.length) {
+    final nl = text.indexOf('\n', start);
+    final end = nl < 0 ? text.length : nl + 1;
+    lines.add(text.substring(start, end));
+    start = end;
+  }
+  return lines;
+}
+
+/// Linear-space Myers diff marking removed and added lines.
+class _Myers {
+  final Int32List a;
+  final Int32List b;
+  final Uint8List removed;
+  final Uint8List added;
+
+  _Myers(this.a, this.b)
+      : removed = Uint8List(a.length),
+        added = Uint8List(b.length);
+
+  void compare(int aLo, int aHi, int bLo, int bHi) {
+    while (aLo < aHi && bLo < bHi && a[aLo] == b[bLo]) {
+      aLo++;
+      bLo++;
+    }
+    while (aLo < aHi && bLo < bHi && a[aHi - 1] == b[bHi - 1]) {
+      aHi--;
+      bHi--;
+    }
+    if (aLo == aHi || bLo == bHi) {
+      removed.fillRange(aLo, aHi, 1);
+      added.fillRange(bLo, bHi, 1);
+      return;
+    }
+
+    final split = _middle(aLo, aHi, bLo, bHi);
+    if (split == null) {
+      removed.fillRange(aLo, aHi, 1);
+      added.fillRange(bLo, bHi, 1);
+      return;
+    }
+    final (x, y) = split;
+    compare(aLo, x, bLo, y);
+    compare(x, aHi, y, bHi);
+  }
+
+  /// Runs the forward and backward searches until they overlap and returns
+  /// the overlap point, which lies on an optimal edit path.
+  (int, int)? _middle(int aLo, int aHi, int bLo, int bHi) {
+    final n = aHi - aLo;
+    final m = bHi - bLo;
+    final maxD = (n + m + 1) ~/ 2;
+    final offset = maxD;
+    final length = 2 * maxD + 2;
+    final forward = Int32List(length)..fillRange(0, length, -1);
+    final backward = Int32List(length)..fillRange(0, length, -1);
+    forward[offset + 1] = 0;
+    backward[offset + 1] = 0;
+    final delta = n - m;
+    final checkForward = delta.isOdd;
+    var fStart = 0, fEnd = 0, bStart = 0, bEnd = 0;
+
+    for (var d = 0; d < maxD; d++) {
+      for (var k = -d + fStart; k <= d - fEnd; k += 2) {
+        final i = offset + k;
+        var x = k == -d || (k != d && forward[i - 1] < forward[i + 1])
+            ? forward[i + 1]
+            : forward[i - 1] + 1;
+        var y = x - k;
+        while (x < n && y < m && a[aLo + x] == b[bLo + y]) {
+          x++;
+          y++;
+        }
+        forward[i] = x;
+        if (x > n) {
+          fEnd += 2;
+        } else if (y > m) {
+          fStart += 2;
+        } else if (checkForward) {
+          final j = offset + delta - k;
+          if (j >= 0 && j < length && backward[j] != -1) {
+            if (x >= n - backward[j]) return (aLo + x, bLo + y);
+          }
+        }
+      }
+
+      for (var k = -d + bStart; k <= d - bEnd; k += 2) {
+        final i = offset + k;
+        var x = k == -d || (k != d && backward[i - 1] < backward[i + 1])
+            ? backward[i + 1]
+            : backward[i - 1] + 1;
+        var y = x - k;
+        while (x < n && y < m && a[aHi - 1 - x] == b[bHi - 1 - y]) {
+          x++;
+          y++;
+        }
+        backward[i] = x;
+        if (x > n) {
+          bEnd += 2;
+        } else if (y > m) {
+          bStart += 2;
+        } else if (!checkForward) {
+          final j = offset + delta - k;
+          if (j >= 0 && j < length && forward[j] != -1) {
+            final fx = forward[j];
+            final fy = fx - (j - offset);
+            if (fx >= n - x) return (aLo + fx, bLo + fy);
+          }
+        }
+      }
+    }
+    return null;
+  }
+}
+
+/// Groups the marked lines into hunks with [context] lines around them.
+List<DiffHunk> _hunks(List<String> oldLines, List<String> newLines,
+    Uint8List removed, Uint8List added, int context) {
+  // Walk both texts once, recording where each change run starts and ends.
+  final runs = <(int, int, int, int)>[]; // oldFrom, oldTo, newFrom, newTo
+  var i = 0, j = 0;
+  while (i < oldLines.length || j < newLines.length) {
+    if ((i < oldLines.length && removed[i] == 1) ||
+        (j < newLines.length && added[j] == 1)) {
+      final oi = i, nj = j;
+      while (i < oldLines.length && removed[i] == 1) {
+        i++;
+      }
+      while (j < newLines.length && added[j] == 1) {
+        j++;
+      }
+      runs.add((oi, i, nj, j));
+    } else {
+      i++;
+      j++;
+    }
+  }
+
+  final hunks = <DiffHunk>[];
+  var r = 0;
+  while (r < runs.length) {
+    // Merge runs separated by at most 2 * context unchanged lines.
+    var last = r;
+    while (last + 1 < runs.length &&
+        runs[last + 1].$1 - runs[last].$2 <= 2 * context) {
+      last++;
+    }
+    final (firstOld, _, firstNew, _) = runs[r];
+    final (_, lastOld, _, lastNew) = runs[last];
+    final lead = _min(context, firstOld);
+    final trail = _min(context, oldLines.length - lastOld);
+
+    final lines = <DiffLine>[];
+    void emit(DiffLineKind kind, String line) => lines.add(DiffLine(
+        kind,
+        line.endsWith('\n') ? line.substring(0, line.length - 1) : line,
+        missingNewline: !line.endsWith('\n')));
+
+    var oi = firstOld - lead;
+    var nj = firstNew - lead;
+    for (var k = r; k <= last; k++) {
+      final (oFrom, oTo, nFrom, nTo) = runs[k];
+      while (oi < oFrom) {
+        emit(DiffLineKind.context, oldLines[oi++]);
+        nj++;
+      }
+      assert(nj == nFrom);
+      while (oi < oTo) {
+        emit(DiffLineKind.removed, oldLines[oi++]);
+      }
+      while (nj < nTo) {
+        emit(DiffLineKind.added, newLines[nj++]);
+      }
+    }
+    for (var k = 0; k < trail; k++) {
+      emit(DiffLineKind.context, oldLines[oi++]);
+      nj++;
+    }
+
+    final oldStart = firstOld - lead;
+    final newStart = firstNew - lead;
+    hunks.add(DiffHunk(oldStart + 1, oi - oldStart, newStart + 1,
+        nj - newStart, lines));
+    r = last + 1;
+  }
+  return hunks;
+}
+
+int _min(int a, int b) => a < b ? a : b;
+
+/// Serializes [diff] for transfer from an [IsolatePool] worker.
+Uint8List encodeTextDiff(TextDiff diff) => utf8.encoder.convert(jsonEncode([
+      diff.fromLabel,
+      diff.toLabel,
+      for (final h in diff.hunks)
+        [
+          h.oldStart,
+          h.oldCount,
+          h.newStart,
+          h.newCount,
+          for (final l in h.lines) [l.kind.index, l.text, l.missingNewline],
+        ],
+    ]));
+
+/// Inverse of [encodeTextDiff].
+TextDiff decodeTextDiff(Uint8List bytes) {
+  final json = jsonDecode(utf8.decode(bytes)) as List;
+  return TextDiff(json[0] as String, json[1] as String, [
+    for (final h in json.skip(2).cast<List>())
+      DiffHunk(h[0] as int, h[1] as int, h[2] as int, h[3] as int, [
+        for (final l in h.skip(4).cast<List>())
+          DiffLine(DiffLineKind.values[l[0] as int], l[1] as String,
+              missingNewline: l[2] as bool),
+      ]),
+  ]);
+}
@@ -0,0 +1,96 @@
+import 'dart:async';
+import 'dart:io';
+
+import '../models/workspace_process.dart';
+import 'output_window.dart';
+
+/// Readiness waiters shared by [WorkspaceProcess] implementations.
+///
+/// Implementations feed every decoded chunk to [recordOutput] before
+/// emitting it and call [recordStreamDone] when each output stream closes.
+mixin OutputWaiters implements WorkspaceProcess {
+  final _stdoutWindow = OutputWindow();
+  final _stderrWindow = OutputWindow();
+  final _waiters = <_OutputWaiter>[];
+  int _openStreams = 2;
+
+  /// Adds [data] to the stream's window and completes matching waiters.
+  void recordOutput(String data, {required bool fromStderr}) {
+    final window = fromStderr ? _stderrWindow : _stdoutWindow;
+    window.add(data);
+    if (_waiters.isEmpty) return;
+    _waiters.removeWhere((waiter) {
+      if (fromStderr && !waiter.includeStderr) return false;
+      final match = window.match(waiter.pattern);
+      if (match == null) return false;
+      waiter.completer.complete(match);
+      return true;
+    });
+  }
+
+  /// Fails pending waiters once both streams are drained: no more output
+  /// can arrive.
+  void recordStreamDone() {
+    if (--_openStreams > 0) return;
+    for (final waiter in _waiters) {
+      waiter.completer.completeError(
+          StateError('Process output ended before ${waiter.pattern} matched'));
+    }
+    _waiters.clear();
+  }
+
+  @override
+  Future<RegExpMatch> waitForOutput(RegExp pattern,
+      {Duration? timeout, bool includeStderr = true}) {
+    final existing = _stdoutWindow.match(pattern) ??
+        (includeStderr ? _stderrWindow.match(pattern) : null);
+    if (existing != null) return Future.value(existing);
+    if (_openStreams == 0) {
+      return Future.error(
+          StateError('Process exited before output matched $pattern'));
+    }
+
+    final waiter = _OutputWaiter(pattern, includeStderr);
+    _waiters.add(waiter);
+    final future = waiter.completer.future;
+    if (timeout == null) return future;
+    return future.timeout(timeout, onTimeout: () {
+      _waiters.remove(waiter);
+      throw TimeoutException('No output matched $pattern', timeout);
+    });
+  }
+
+  @override
+  Future<void> waitForPort(int port,
+      {String host = '127.0.0.1', Duration? timeout}) async {
+    final deadline = timeout == null ? null : DateTime.now().add(timeout);
+    var exited = false;
+    exitCode.whenComplete(() => exited = true);
+
+    while (true) {
+      try {
+        final socket = await Socket.connect(host, port,
+            timeout: const Duration(milliseconds: 250));
+        socket.destroy();
+        return;
+      } on SocketException {
+        // Not listening yet.
+      }
+      if (exited) {
+        throw StateError('Process exited before $host:$port accepted');
+      }
+      if (deadline != null && DateTime.now().isAfter(deadline)) {
+        throw TimeoutException('$host:$port is not accepting', timeout);
+      }
+      await Future.delayed(const Duration(milliseconds: 50));
+    }
+  }
+}
+
+class _OutputWaiter {
+  final RegExp pattern;
+  final bool includeStderr;
+  final completer = Completer<RegExpMatch>();
+
+  _OutputWaiter(this.pattern, this.includeStderr);
+}
@@ -0,0 +1,29 @@
+/// Bounded tail of a text stream, used to match patterns across chunks.
+///
+/// Processes deliver output in arbitrary chunks, so a marker such as
+/// `Listening on :3000` may be split between two reads. The window keeps
+/// the last [capacity] characters so a pattern that straddles a chunk
+/// boundary still matches, without retaining the full output.
+class OutputWindow {
+  /// Maximum number of characters retained.
+  final int capacity;
+
+  String _text = '';
+
+  /// Creates an empty window retaining at most [capacity] characters.
+  OutputWindow([this.capacity = 8192]);
+
+  /// The currently retained text.
+  String get text => _text;
+
+  /// Appends [chunk], discarding the oldest characters beyond [capacity].
+  void add(String chunk) {
+    final combined = _text + chunk;
+    _text = combined.length > capacity
+        ? combined.substring(combined.length - capacity)
+        : combined;
+  }
+
+  /// Returns the first match of [pattern] in the retained text, if any.
+  RegExpMatch? match(RegExp pattern) => pattern.firstMatch(_text);
+}
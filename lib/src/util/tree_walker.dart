@@ -0,0 +1,182 @@
+import 'dart:async';
+import 'dart:collection';
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+
+import 'ignore_rules.dart';
+
+/// A file or directory found by [TreeWalker].
+class WalkEntry {
+  /// Absolute path.
+  final String path;
+
+  /// Path relative to the walk root, with `/` separators.
+  final String relativePath;
+
+  /// Whether the entry is a directory. Links are never followed and count
+  /// as files.
+  final bool isDirectory;
+
+  /// Number of path segments below the root; 1 for top-level entries.
+  final int depth;
+
+  /// Creates a walk entry.
+  const WalkEntry(this.path, this.relativePath,
+      {required this.isDirectory, required this.depth});
+}
+
+/// Walks a directory tree in parallel, skipping ignored paths.
+///
+/// Shared by the `tree`, `find` and `grep` helpers. Each directory is read
+/// with one non-recursive listing, up to [concurrency] directories at a
+/// time. Its `.gitignore` and `.wsignore` files (same syntax, `.wsignore`
+/// wins) are compiled once, on top of the rules of the directories above
+/// it and the repository's `.git/info/exclude`. Directories that are
+/// excluded, ignored or deeper than [maxDepth] are never listed.
+class TreeWalker {
+  /// Directory names skipped at any depth unless [excludes] says otherwise:
+  /// version control metadata and dependency or tool caches.
+  static const defaultExcludes = {
+    '.git',
+    '.hg',
+    '.svn',
+    '.dart_tool',
+    'node_modules',
+    '__pycache__',
+  };
+
+  /// Absolute path of the directory to walk.
+  final String rootPath;
+
+  /// Names skipped at any depth.
+  final Set<String> excludes;
+
+  /// Whether `.gitignore` and `.wsignore` files are honored.
+  final bool respectIgnoreFiles;
+
+  /// Whether names starting with `.` are included.
+  final bool includeHidden;
+
+  /// Deepest [WalkEntry.depth] reported; `null` for no limit.
+  final int? maxDepth;
+
+  /// Number of directories listed at once.
+  final int concurrency;
+
+  /// Creates a walker; nothing is read until [walk] is listened to.
+  TreeWalker(this.rootPath,
+      {this.excludes = defaultExcludes,
+      this.respectIgnoreFiles = true,
+      this.includeHidden = true,
+      this.maxDepth,
+      this.concurrency = 8});
+
+  /// Emits every entry that is not skipped, in no particular order.
+  ///
+  /// Unreadable directories are skipped silently. Cancelling the
+  /// subscription stops listing further directories.
+  Stream<WalkEntry> walk() {
+    final pending = Queue<_Directory>();
+    var active = 0;
+    var cancelled = false;
+    late final StreamController<WalkEntry> out;
+
+    void pump() {
+      while (!cancelled && active < concurrency && pending.isNotEmpty) {
+        active++;
+        _list(pending.removeFirst(), out.add, pending.add).whenComplete(() {
+          active--;
+          if (cancelled) return;
+          if (active == 0 && pending.isEmpty) {
+            out.close();
+          } else {
+            pump();
+          }
+        });
+      }
+    }
+
+    out = StreamController<WalkEntry>(
+      onListen: () async {
+        pending.add(_Directory(rootPath, '', 0, await _rootRules()));
+        pump();
+      },
+      onCancel: () => cancelled = true,
+    );
+    return out.stream;
+  }
+
+  Future<IgnoreRules?> _rootRules() async {
+    if (!respectIgnoreFiles) return null;
+    final text =
+        await _readOrNull(p.join(rootPath, '.git', 'info', 'exclude'));
+    return text == null ? null : IgnoreRules.parse(text);
+  }
+
+  Future<void> _list(_Directory dir, void Function(WalkEntry) emit,
+      void Function(_Directory) enqueue) async {
+    final entities = <FileSystemEntity>[];
+    try {
+      await for (final entity
+          in Directory(dir.path).list(followLinks: false)) {
+        entities.add(entity);
+      }
+    } on FileSystemException {
+      return;
+    }
+
+    var rules = dir.rules;
+    if (respectIgnoreFiles) {
+      for (final name in const ['.gitignore', '.wsignore']) {
+        if (!entities.any((e) => e is File && p.basename(e.path) == name)) {
+          continue;
+        }
+        final text = await _readOrNull(p.join(dir.path, name));
+        if (text != null) {
+          rules =
+              IgnoreRules.parse(text, base: dir.relativePath, parent: rules);
+        }
+      }
+    }
+
+    final depth = dir.depth + 1;
+    for (final entity in entities) {
+      final name = p.basename(entity.path);
+      if (excludes.contains(name)) continue;
+      if (!includeHidden && name.startsWith('.')) continue;
+      final isDirectory = entity is Directory;
+      final relative =
+          dir.relativePath.isEmpty ? name : '${dir.relativePath}/$name';
+      if (rules != null &&
+          rules.isIgnored(relative, isDirectory: isDirectory)) {
+        continue;
+      }
+      emit(WalkEntry(entity.path, relative,
+          isDirectory: isDirectory, depth: depth));
+      if (isDirectory && (maxDepth == null || depth < maxDepth!)) {
+        enqueue(_Directory(entity.path, relative, depth, rules));
+      }
+    }
+  }
+
+  static Future<String?> _readOrNull(String path) async {
+    try {
+      return await File(path).readAsString();
+    } on FileSystemException {
+      return null;
+    } on FormatException {
+      return null;
+    }
+  }
+}
+
+/// A directory waiting to be listed.
+class _Directory {
+  final String path;
+  final String relativePath;
+  final int depth;
+  final IgnoreRules? rules;
+
+  _Directory(this.path, this.relativePath, this.depth, this.rules);
+}
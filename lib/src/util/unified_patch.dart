@@ -0,0 +1,170 @@
+import '../models/file_edit.dart';
+import '../models/text_diff.dart';
+import 'myers_diff.dart';
+
+/// One file section of a unified diff.
+class FilePatch {
+  /// Path in the `---` header, or `null` for `/dev/null` (a new file).
+  final String? oldPath;
+
+  /// Path in the `+++` header, or `null` for `/dev/null` (a deletion).
+  final String? newPath;
+
+  /// The section's hunks, in order.
+  final List<DiffHunk> hunks;
+
+  /// Creates a file patch.
+  const FilePatch(this.oldPath, this.newPath, this.hunks);
+}
+
+final _hunkHeader = RegExp(r'^@@ -(\d+)(?:,(\d+))? \+(\d+)(?:,(\d+))? @@');
+
+/// Parses `diff -u` / `git diff` output into file sections.
+///
+/// Lines outside sections (`diff --git`, `index`, commit messages) are
+/// skipped. The `a/` and `b/` prefixes of paths are stripped in sections
+/// introduced by `diff --git`. Throws [FormatException] for malformed or
+/// truncated hunks, or when [patch] has no file section.
+List<FilePatch> parseUnifiedDiff(String patch) {
+  final lines = patch.split('\n');
+  if (lines.last.isEmpty) lines.removeLast();
+  final files = <FilePatch>[];
+  var gitPrefixes = false;
+  var i = 0;
+  while (i < lines.length) {
+    final line = lines[i];
+    if (line.startsWith('diff --git ')) gitPrefixes = true;
+    if (!line.startsWith('--- ') ||
+        i + 1 >= lines.length ||
+        !lines[i + 1].startsWith('+++ ')) {
+      i++;
+      continue;
+    }
+    final oldPath = _headerPath(line.substring(4), gitPrefixes ? 'a/' : null);
+    final newPath =
+        _headerPath(lines[i + 1].substring(4), gitPrefixes ? 'b/' : null);
+    gitPrefixes = false;
+    i += 2;
+
+    final hunks = <DiffHunk>[];
+    while (i < lines.length && lines[i].startsWith('@@')) {
+      final match = _hunkHeader.firstMatch(lines[i]);
+      if (match == null) {
+        throw FormatException('Malformed hunk header', lines[i]);
+      }
+      final oldCount = int.parse(match[2] ?? '1');
+      final newCount = int.parse(match[4] ?? '1');
+      // An empty range names the line before it; DiffHunk uses the next.
+      final oldStart = int.parse(match[1]!) + (oldCount == 0 ? 1 : 0);
+      final newStart = int.parse(match[3]!) + (newCount == 0 ? 1 : 0);
+      i++;
+
+      final body = <DiffLine>[];
+      var oldLeft = oldCount, newLeft = newCount;
+      while (oldLeft > 0 || newLeft > 0 ||
+          (i < lines.length && lines[i].startsWith(r'\'))) {
+        if (i >= lines.length) {
+          throw FormatException('Truncated hunk in ${newPath ?? oldPath}');
+        }
+        final text = lines[i++];
+        // Some tools strip the space of empty context lines.
+        final tag = text.isEmpty ? ' ' : text[0];
+        final content = text.isEmpty ? '' : text.substring(1);
+        switch (tag) {
+          case ' ':
+            body.add(DiffLine(DiffLineKind.context, content));
+            oldLeft--;
+            newLeft--;
+          case '-':
+            body.add(DiffLine(DiffLineKind.removed, content));
+            oldLeft--;
+          case '+':
+            body.add(DiffLine(DiffLineKind.added, content));
+            newLeft--;
+          case r'\':
+            if (body.isEmpty) throw FormatException('Misplaced marker', text);
+            final last = body.removeLast();
+            body.add(DiffLine(last.kind, last.text, missingNewline: true));
+          default:
+            throw FormatException('Unexpected line in hunk', text);
+        }
+        if (oldLeft < 0 || newLeft < 0) {
+          throw FormatException('Hunk longer than its header', lines[i - 1]);
+        }
+      }
+      hunks.add(DiffHunk(oldStart, oldCount, newStart, newCount, body));
+    }
+    files.add(FilePatch(oldPath, newPath, hunks));
+  }
+  if (files.isEmpty) {
+    throw const FormatException('No file sections found in patch');
+  }
+  return files;
+}
+
+String? _headerPath(String header, String? prefix) {
+  // Drop a trailing tab-separated timestamp.
+  final tab = header.indexOf('\t');
+  final path = (tab < 0 ? header : header.substring(0, tab)).trimRight();
+  if (path == '/dev/null') return null;
+  return prefix != null && path.startsWith(prefix)
+      ? path.substring(prefix.length)
+      : path;
+}
+
+/// Applies [hunks] to [text] and returns the patched text.
+///
+/// Each hunk must match exactly; like `patch`, a hunk is also accepted at
+/// the nearest offset from its stated line when the file has shifted.
+/// Throws [EditException] naming [path] when a hunk does not match.
+String applyHunks(String text, List<DiffHunk> hunks, String path) {
+  final lines = splitLines(text);
+  final out = StringBuffer();
+  var pos = 0;
+  var offset = 0;
+  for (var n = 0; n < hunks.length; n++) {
+    final hunk = hunks[n];
+    final before = [
+      for (final l in hunk.lines)
+        if (l.kind != DiffLineKind.added) _withNewline(l),
+    ];
+    final at = _locate(lines, before, hunk.oldStart - 1 + offset, pos);
+    if (at < 0) {
+      throw EditException(
+          'Hunk ${n + 1} (${hunk.header}) does not match the file', path);
+    }
+    out.writeAll(lines.getRange(pos, at));
+    for (final l in hunk.lines) {
+      if (l.kind != DiffLineKind.removed) out.write(_withNewline(l));
+    }
+    pos = at + before.length;
+    offset = at - (hunk.oldStart - 1);
+  }
+  out.writeAll(lines.getRange(pos, lines.length));
+  return out.toString();
+}
+
+String _withNewline(DiffLine line) =>
+    line.missingNewline ? line.text : '${line.text}\n';
+
+/// Finds [needle] in [lines] at or after [min], nearest to [expected].
+int _locate(List<String> lines, List<String> needle, int expected, int min) {
+  final max = lines.length - needle.length;
+  if (max < min) return -1;
+  final start = expected.clamp(min, max);
+  for (var delta = 0;; delta++) {
+    final below = start - delta, above = start + delta;
+    if (below < min && above > max) return -1;
+    if (above <= max && _matchesAt(lines, needle, above)) return above;
+    if (delta > 0 && below >= min && _matchesAt(lines, needle, below)) {
+      return below;
+    }
+  }
+}
+
+bool _matchesAt(List<String> lines, List<String> needle, int at) {
+  for (var k = 0; k < needle.length; k++) {
+    if (lines[at + k] != needle[k]) return false;
+  }
+  return true;
+}
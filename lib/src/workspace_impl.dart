@@ -1,12 +1,19 @@
 import 'dart:async';
 import 'dart:io';
 
+import 'package:path/path.dart' as p;
+
+import 'core/command_watcher.dart';
+import 'core/execution_backend.dart';
 import 'core/launcher_service.dart';
+import 'core/path_security.dart';
+import 'core/quota_enforcer.dart';
+import 'util/json_output.dart';
 import '../workspace_sandbox.dart';
 
 /// Internal implementation of the workspace logic.
 ///
-/// Coordinates between the launcher service (for process execution) and
+/// Coordinates between the execution backend (for process execution) and
 /// the file system service (for file operations), and manages the central
 /// event bus for reactive logging.
 ///
@@ -24,12 +31,27 @@ class WorkspaceImpl implements Workspace {
   /// Root directory reference.
   final Directory _directory;
 
-  late final LauncherService _launcher;
+  /// Runs commands; the local [LauncherService] unless another backend
+  /// was given.
+  final ExecutionBackend _launcher;
+
+  /// Validates output redirect targets.
+  final PathSecurity _security;
+
+  /// Kills commands once the workspace exceeds its disk quota, if any.
+  late final QuotaEnforcer? _quota = switch (defaultOptions.diskQuota) {
+    final quota? => QuotaEnforcer(fs, quota),
+    null => null,
+  };
 
   /// File system service for managing workspace files.
   @override
   final FileSystemService fs;
 
+  /// Git queries on the workspace, created on first use.
+  @override
+  late final GitService git = GitService(rootPath);
+
   /// Central event bus for broadcasting workspace events.
   final _eventController = StreamController<WorkspaceEvent>.broadcast();
 
@@ -44,22 +66,32 @@ class WorkspaceImpl implements Workspace {
   /// - [id]: Unique identifier for logging
   /// - [options]: Default configuration for all operations
   /// - [isTemporary]: Whether to delete the workspace on dispose
+  /// - [backend]: Creates the execution backend (default: [LauncherService])
   WorkspaceImpl(String rootPath, this.id,
-      {WorkspaceOptions? options, required this.isTemporary})
+      {WorkspaceOptions? options,
+      required this.isTemporary,
+      ExecutionBackendFactory? backend})
       : defaultOptions = options ?? const WorkspaceOptions(),
-        fs = FileSystemService(rootPath),
-        _directory = Directory(rootPath) {
-    _launcher = LauncherService(rootPath, id);
-  }
+        fs = FileSystemService(rootPath, quota: options?.diskQuota),
+        _security = PathSecurity(rootPath),
+        _directory = Directory(rootPath),
+        _launcher = (backend ?? LauncherService.new)(rootPath, id);
 
   /// Absolute path to the workspace root directory.
   @override
   String get rootPath => fs.rootPath;
 
+  /// Disk usage of the workspace; see [FileSystemService.usage].
+  @override
+  Future<DiskUsage> usage() => fs.usage();
+
   /// Disposes resources and closes the event stream.
   @override
   Future<void> dispose() async {
     await _eventController.close();
+    _quota?.dispose();
+    await _launcher.dispose();
+    await fs.dispose();
     if (isTemporary && await _directory.exists()) {
       try {
         await _directory.delete(recursive: true);
@@ -72,13 +104,19 @@ class WorkspaceImpl implements Workspace {
   /// Discriminates between shell (String) and binary (`List<String>`) execution.
   Future<CommandResult> exec(Object command,
       {WorkspaceOptions? options}) async {
-    final opts = _mergeOptions(options);
+    final merged = _mergeOptions(options);
+    final stdoutProbe = await _RedirectProbe.start(merged.stdoutTo, _security);
+    final stderrProbe = await _RedirectProbe.start(merged.stderrTo, _security);
+    final opts = merged.copyWith(
+      stdoutTo: stdoutProbe?.launcherRedirect,
+      stderrTo: stderrProbe?.launcherRedirect,
+    );
 
     if (command is String) {
       // Shell execution
       final process = await _launcher.spawnShell(command, opts);
       _attachToEventBus(process, command);
-      return _collectResult(process);
+      return _collectResult(process, stdoutProbe, stderrProbe);
     } else if (command is List<String>) {
       // Binary execution
       if (command.isEmpty) {
@@ -88,7 +126,7 @@ class WorkspaceImpl implements Workspace {
       final args = command.length > 1 ? command.sublist(1) : <String>[];
       final process = await _launcher.spawnExec(executable, args, opts);
       _attachToEventBus(process, command.join(' '));
-      return _collectResult(process);
+      return _collectResult(process, stdoutProbe, stderrProbe);
     } else {
       throw ArgumentError(
           'Command must be String (shell) or List<String> (binary)');
@@ -99,7 +137,13 @@ class WorkspaceImpl implements Workspace {
   @override
   Future<WorkspaceProcess> execStream(Object command,
       {WorkspaceOptions? options}) async {
-    final opts = _mergeOptions(options);
+    final merged = _mergeOptions(options);
+    final opts = merged.copyWith(
+      stdoutTo: (await _RedirectProbe.start(merged.stdoutTo, _security))
+          ?.launcherRedirect,
+      stderrTo: (await _RedirectProbe.start(merged.stderrTo, _security))
+          ?.launcherRedirect,
+    );
 
     if (command is String) {
       // Shell execution
@@ -122,11 +166,43 @@ class WorkspaceImpl implements Workspace {
     }
   }
 
+  /// Executes a command and decodes its stdout as JSON; see [collectJson].
+  @override
+  Future<JsonCommandResult> execJson(Object command,
+          {WorkspaceOptions? options}) async =>
+      collectJson(await execStream(command, options: options));
+
+  /// Executes a command and decodes its stdout as NDJSON; see
+  /// [decodeNdjson].
+  @override
+  Stream<Object?> execNdjson(Object command,
+      {WorkspaceOptions? options}) async* {
+    final process = await execStream(command, options: options);
+    yield* decodeNdjson(process, command);
+  }
+
+  /// Reruns a command on file changes; see [CommandWatcher].
+  @override
+  Stream<CommandResult> watch(Object command,
+          {List<String>? paths,
+          Duration debounce = const Duration(milliseconds: 200),
+          bool runImmediately = true,
+          WorkspaceOptions? options}) =>
+      CommandWatcher(this, command,
+              paths: paths,
+              debounce: debounce,
+              runImmediately: runImmediately,
+              options: options)
+          .results;
+
   /// Attaches a process to the central event bus.
   ///
-  /// Emits lifecycle and output events as the process runs.
+  /// Emits lifecycle, output and resource sample events as the process
+  /// runs. The process is also placed under the disk quota, and disk usage
+  /// is told about its writes when it exits.
   void _attachToEventBus(WorkspaceProcess process, String commandLabel) {
     final pid = process.pid;
+    _quota?.track(process);
 
     // Emit started event
     _eventController.add(ProcessLifecycleEvent(
@@ -158,8 +234,19 @@ class WorkspaceImpl implements Workspace {
       ));
     });
 
+    // Forward resource samples
+    process.stats.listen((stats) {
+      _eventController.add(ProcessStatsEvent(
+        workspaceId: id,
+        pid: pid,
+        command: commandLabel,
+        stats: stats,
+      ));
+    });
+
     // Emit stopped event when process exits
     process.exitCode.then((code) {
+      fs.noteExternalChanges();
       _eventController.add(ProcessLifecycleEvent(
         workspaceId: id,
         pid: pid,
@@ -184,11 +271,30 @@ class WorkspaceImpl implements Workspace {
           defaultOptions.workingDirectoryOverride,
       sandbox: defaultOptions.sandbox || override.sandbox,
       allowNetwork: override.allowNetwork,
+      sandboxProfile: override.sandboxProfile ?? defaultOptions.sandboxProfile,
+      caches: [
+        for (final cache in defaultOptions.caches)
+          if (!override.caches.any((c) => c.path == cache.path)) cache,
+        ...override.caches,
+      ],
+      packageMirror: override.packageMirror ?? defaultOptions.packageMirror,
+      stdoutTo: override.stdoutTo ?? defaultOptions.stdoutTo,
+      stderrTo: override.stderrTo ?? defaultOptions.stderrTo,
+      diskQuota: defaultOptions.diskQuota,
+      traceFileAccess:
+          defaultOptions.traceFileAccess || override.traceFileAccess,
+      outputFilter: override.outputFilter ?? defaultOptions.outputFilter,
+      sampleInterval: override.sampleInterval ?? defaultOptions.sampleInterval,
+      idleTimeout: override.idleTimeout ?? defaultOptions.idleTimeout,
+      priority: override.priority ?? defaultOptions.priority,
     );
   }
 
   /// Collects the full output from a process into a [CommandResult].
-  Future<CommandResult> _collectResult(WorkspaceProcess process) async {
+  ///
+  /// Redirected streams are reported by file and byte count via the probes.
+  Future<CommandResult> _collectResult(WorkspaceProcess process,
+      [_RedirectProbe? stdoutProbe, _RedirectProbe? stderrProbe]) async {
     final stdoutBuf = StringBuffer();
     final stderrBuf = StringBuffer();
     final stopwatch = Stopwatch()..start();
@@ -207,6 +313,55 @@ class WorkspaceImpl implements Workspace {
       stderr: stderrBuf.toString(),
       duration: stopwatch.elapsed,
       isCancelled: process.isCancelled,
+      terminationReason: process.terminationReason,
+      stdoutFile: await stdoutProbe?.finish(),
+      stderrFile: await stderrProbe?.finish(),
+      fileAccess: await process.fileAccess,
+      outputStats: await process.outputStats,
     );
   }
 }
+
+/// Tracks a redirect target so the bytes written by a command can be
+/// reported without reading the file.
+class _RedirectProbe {
+  final OutputRedirect redirect;
+  final String absolutePath;
+  final int startSize;
+
+  _RedirectProbe._(this.redirect, this.absolutePath, this.startSize);
+
+  /// Resolves [redirect] inside the workspace and records the current file
+  /// size when appending. Returns `null` when there is no redirect.
+  ///
+  /// Throws [SecurityException] if the path escapes the workspace or runs
+  /// through a symlink. The launcher opens the file without following
+  /// symlinks too; checking here reports it before the command starts.
+  static Future<_RedirectProbe?> start(
+      OutputRedirect? redirect, PathSecurity security) async {
+    if (redirect == null) return null;
+    final path = security.resolve(redirect.path);
+    var current = security.rootPath;
+    for (final part in p.split(p.relative(path, from: security.rootPath))) {
+      current = p.join(current, part);
+      if (await FileSystemEntity.isLink(current)) {
+        throw SecurityException(
+            'Output redirect runs through a symlink', redirect.path);
+      }
+    }
+    final file = File(path);
+    final size =
+        redirect.append && await file.exists() ? await file.length() : 0;
+    return _RedirectProbe._(redirect, path, size);
+  }
+
+  /// The redirect as passed to the launcher, with an absolute path.
+  OutputRedirect get launcherRedirect => redirect.withPath(absolutePath);
+
+  Future<RedirectedOutput> finish() async {
+    final file = File(absolutePath);
+    final size = await file.exists() ? await file.length() : 0;
+    return RedirectedOutput(
+        redirect.path, size > startSize ? size - startSize : 0);
+  }
+}
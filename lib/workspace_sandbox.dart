@@ -9,7 +9,7 @@
 /// - **Persistent workspaces**: Work on existing project directories
 /// - **Network isolation**: Block network access per workspace
 /// - **Real-time events**: Stream stdout/stderr and lifecycle events
-/// - **File system helpers**: Tree visualization, grep, glob search
+/// - **File system helpers**: Tree visualization, grep, glob search, diff
 ///
 /// ## Example
 ///
@@ -38,14 +38,42 @@ import 'src/models/command_result.dart';
 import 'src/models/workspace_options.dart';
 import 'src/models/workspace_process.dart';
 import 'src/models/workspace_event.dart';
+import 'src/models/disk_usage.dart';
 import 'src/fs/file_system_service.dart';
+import 'src/git/git_service.dart';
+import 'src/core/execution_backend.dart';
 
+export 'src/models/cache_mount.dart';
 export 'src/models/command_result.dart';
+export 'src/models/output_redirect.dart';
 export 'src/models/workspace_options.dart';
 export 'src/models/workspace_process.dart';
 export 'src/models/workspace_event.dart';
+export 'src/models/text_diff.dart';
+export 'src/models/file_edit.dart';
+export 'src/models/git_status.dart';
+export 'src/models/disk_usage.dart';
+export 'src/models/file_access.dart';
+export 'src/models/output_filter.dart';
+export 'src/models/process_stats.dart';
+export 'src/models/process_priority.dart';
 export 'src/fs/file_system_service.dart';
+export 'src/fs/file_content_cache.dart' show FileContentCache;
+export 'src/git/git_service.dart';
 export 'src/core/path_security.dart' show SecurityException;
+export 'src/core/netns_pool.dart' show NetworkNamespacePool;
+export 'src/core/package_mirror.dart' show PackageMirror;
+export 'src/core/workspace_manager.dart' show WorkspaceManager;
+export 'src/core/workspace_group.dart'
+    show WorkspaceGroup, GroupMemberResult, GroupSummary;
+export 'src/core/execution_backend.dart';
+export 'src/remote/launcher_daemon.dart' show LauncherDaemon;
+export 'src/remote/remote_launcher.dart'
+    show RemoteLauncher, RemoteDaemon, DaemonPlacement;
+export 'src/native/in_process_launcher.dart' show InProcessLauncher;
+export 'src/util/isolate_pool.dart' show IsolatePool, IsolateTask;
+export 'src/util/myers_diff.dart' show diffText;
+export 'src/util/tree_walker.dart' show TreeWalker, WalkEntry;
 
 /// Represents a secure, isolated workspace for executing commands.
 ///
@@ -72,6 +100,11 @@ abstract class Workspace {
   /// Provides secure file operations with automatic path validation.
   FileSystemService get fs;
 
+  /// Git status queries answered without spawning `git`.
+  ///
+  /// See [GitService] for what is cached between calls.
+  GitService get git;
+
   /// Creates a temporary workspace in the system temp directory.
   ///
   /// The workspace is automatically sandboxed and will be deleted when
@@ -87,13 +120,17 @@ abstract class Workspace {
   /// Parameters:
   /// - [id]: Optional unique identifier for logging/debugging
   /// - [options]: Optional configuration (timeout, env vars, network access)
-  factory Workspace.ephemeral({String? id, WorkspaceOptions? options}) {
+  /// - [backend]: Where commands run (default: the local launcher)
+  factory Workspace.ephemeral(
+      {String? id,
+      WorkspaceOptions? options,
+      ExecutionBackendFactory? backend}) {
     final wsId = id ?? _generateId();
     final tempDir = Directory.systemTemp.createTempSync('ws_sb_$wsId');
     final secureOpts =
         (options ?? const WorkspaceOptions()).copyWith(sandbox: true);
     return WorkspaceImpl(tempDir.path, wsId,
-        options: secureOpts, isTemporary: true);
+        options: secureOpts, isTemporary: true, backend: backend);
   }
 
   /// Creates a workspace at an existing directory path.
@@ -112,13 +149,24 @@ abstract class Workspace {
   /// - [path]: Absolute path to the workspace directory
   /// - [id]: Optional unique identifier
   /// - [options]: Optional configuration
-  factory Workspace.at(String path, {String? id, WorkspaceOptions? options}) {
+  /// - [backend]: Where commands run (default: the local launcher)
+  factory Workspace.at(String path,
+      {String? id,
+      WorkspaceOptions? options,
+      ExecutionBackendFactory? backend}) {
     final dir = Directory(path);
     if (!dir.existsSync()) dir.createSync(recursive: true);
     return WorkspaceImpl(dir.path, id ?? _generateId(),
-        options: options, isTemporary: false);
+        options: options, isTemporary: false, backend: backend);
   }
 
+  /// Bytes and inodes used by the workspace.
+  ///
+  /// Maintained incrementally from the file watcher; see
+  /// [FileSystemService.usage]. Limits are set with
+  /// [WorkspaceOptions.diskQuota].
+  Future<DiskUsage> usage();
+
   // --- EXECUTION ---
 
   /// Executes a command and waits for completion.
@@ -165,6 +213,72 @@ abstract class Workspace {
   Future<WorkspaceProcess> execStream(Object command,
       {WorkspaceOptions? options});
 
+  /// Executes a command and decodes its stdout as one JSON document.
+  ///
+  /// The output is parsed incrementally as it streams in, so tools that
+  /// print large documents (`npm ls --json`, `cargo metadata`) never have
+  /// their full text and object graph in memory at the same time.
+  /// [JsonCommandResult.stdout] is empty; stderr is collected as text.
+  ///
+  /// Throws [FormatException] once the process exits if stdout was not a
+  /// single valid JSON document.
+  ///
+  /// Example:
+  /// ```
+  /// final result = await ws.execJson(['cargo', 'metadata', '--no-deps']);
+  /// final packages = (result.json as Map)['packages'] as List;
+  /// ```
+  Future<JsonCommandResult> execJson(Object command,
+      {WorkspaceOptions? options});
+
+  /// Executes a command and emits each line of its stdout decoded as JSON
+  /// (newline-delimited JSON), as lines arrive.
+  ///
+  /// Blank lines are skipped. A line that is not valid JSON is emitted as
+  /// a [FormatException] error and the stream continues. If the command
+  /// exits with a non-zero code, a [ProcessException] with the tail of
+  /// stderr is emitted before the stream closes. Cancelling the
+  /// subscription kills the process.
+  ///
+  /// Example:
+  /// ```
+  /// final events = ws.execNdjson('cargo build --message-format=json');
+  /// await for (final event in events) {
+  ///   if (event case {'reason': 'compiler-message'}) print(event);
+  /// }
+  /// ```
+  Stream<Object?> execNdjson(Object command, {WorkspaceOptions? options});
+
+  /// Reruns [command] whenever files matching [paths] change.
+  ///
+  /// [paths] are globs relative to the workspace root: `*` and `?` stay
+  /// within a path segment, `**` spans directories, `{a,b}` alternates, and
+  /// a pattern without `/` matches file names anywhere. Wildcards skip
+  /// hidden directories such as `.git` and `.dart_tool`, so build output
+  /// there does not retrigger the command. By default any other file
+  /// counts.
+  ///
+  /// Changes are coalesced until none arrived for [debounce]. A change
+  /// while the command runs kills it and starts a fresh run; only results
+  /// of runs that were not superseded are emitted. With [runImmediately]
+  /// the command also runs once when the stream is listened to.
+  ///
+  /// Watching stops when the subscription is cancelled.
+  ///
+  /// Example:
+  /// ```
+  /// final sub = ws
+  ///     .watch('dart test', paths: ['lib/**/*.dart', 'test/**/*.dart'])
+  ///     .listen((result) => print(result.isSuccess ? 'green' : 'red'));
+  /// // ... later
+  /// await sub.cancel();
+  /// ```
+  Stream<CommandResult> watch(Object command,
+      {List<String>? paths,
+      Duration debounce = const Duration(milliseconds: 200),
+      bool runImmediately = true,
+      WorkspaceOptions? options});
+
   /// Disposes the workspace and cleans up resources.
   ///
   /// For ephemeral workspaces, deletes the temporary directory.
@@ -0,0 +1,100 @@
+//! Cold-start benchmark: wall time of `workspace_launcher -- true`.
+//!
+//! Measures launcher startup, supervision and teardown for a command that
+//! does no work, next to spawning `true` directly as a baseline. On Linux,
+//! `traced` adds `--trace-file` to a shell loop that opens a file
+//! `TRACE_OPENS` times (default 1000), next to the same loop untraced
+//! (`opens`), to show the per-open cost of file-access tracing.
+//!
+//! ```text
+//! cargo bench --bench cold_start
+//! LAUNCHER_BIN=/path/to/other/workspace_launcher cargo bench --bench cold_start
+//! ```
+//!
+//! `LAUNCHER_BIN` compares another build (e.g. an older release);
+//! `ITERATIONS` overrides the sample count (default 500).
+
+use std::env;
+use std::process::{Command, Stdio};
+use std::time::{Duration, Instant};
+
+fn main() {
+    let launcher = env::var("LAUNCHER_BIN")
+        .unwrap_or_else(|_| env!("CARGO_BIN_EXE_workspace_launcher").to_string());
+    let iterations = env::var("ITERATIONS")
+        .ok()
+        .and_then(|n| n.parse().ok())
+        .unwrap_or(500);
+    let workspace = env::temp_dir();
+    let workspace = workspace.to_string_lossy();
+
+    let mut direct = Command::new("true");
+    report("direct", &sample(&mut direct, iterations));
+
+    let mut launched = Command::new(&launcher);
+    launched.args(["--id", "bench", "--workspace", &workspace, "--", "true"]);
+    report("launcher", &sample(&mut launched, iterations));
+
+    if cfg!(target_os = "linux") {
+        let opens = env::var("TRACE_OPENS")
+            .ok()
+            .and_then(|n| n.parse().ok())
+            .unwrap_or(1000);
+        // A builtin redirect opens the file without spawning a process.
+        let script = format!("for i in $(seq {opens}); do read l < /etc/hostname; done");
+        let trace = env::temp_dir().join("ws_bench_trace.json");
+        let trace = trace.to_string_lossy();
+        let iterations = (iterations / 10).max(1);
+
+        let mut untraced = Command::new(&launcher);
+        untraced.args(["--id", "bench", "--workspace", &workspace]);
+        untraced.args(["--", "sh", "-c", &script]);
+        report("opens", &sample(&mut untraced, iterations));
+
+        let mut traced = Command::new(&launcher);
+        traced.args([
+            "--id",
+            "bench",
+            "--workspace",
+            &workspace,
+            "--trace-file",
+            &trace,
+        ]);
+        traced.args(["--", "sh", "-c", &script]);
+        report("traced", &sample(&mut traced, iterations));
+    }
+}
+
+fn sample(command: &mut Command, iterations: usize) -> Vec<Duration> {
+    command
+        .stdin(Stdio::null())
+        .stdout(Stdio::null())
+        .stderr(Stdio::null());
+    // Warm the page cache so the first sample is not an outlier.
+    for _ in 0..10 {
+        let _ = command.status();
+    }
+    let mut times: Vec<Duration> = (0..iterations)
+        .map(|_| {
+            let start = Instant::now();
+            let status = command.status().expect("spawn failed");
+            assert!(status.success(), "command failed: {status}");
+            start.elapsed()
+        })
+        .collect();
+    times.sort();
+    times
+}
+
+fn report(name: &str, sorted: &[Duration]) {
+    let total: Duration = sorted.iter().sum();
+    let n = u32::try_from(sorted.len()).unwrap_or(u32::MAX).max(1);
+    let pct = |p: usize| sorted[(sorted.len() * p / 100).min(sorted.len() - 1)];
+    println!(
+        "{name:>10}: mean {:>8.1?}  p50 {:>8.1?}  p95 {:>8.1?}  ({} runs)",
+        total / n,
+        pct(50),
+        pct(95),
+        sorted.len()
+    );
+}
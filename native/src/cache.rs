@@ -0,0 +1,100 @@
+//! Locking for shared, writable dependency caches.
+//!
+//! Each cache directory has a sibling `<dir>.lock` file. Commands hold a
+//! shared `flock` on it for their whole lifetime (exclusive for caches whose
+//! tools cannot cope with concurrent writers), so maintenance jobs can take
+//! the exclusive lock to keep commands out. The lock file lives outside the
+//! directory so sandboxed processes cannot remove or replace it.
+//!
+//! Caches limited to some writable entries get those entries created here,
+//! since the sandbox sees the rest of the directory read-only. An entry that
+//! is a symlink is refused: binding it would expose its target instead.
+
+use crate::strategies::base::CacheDir;
+use anyhow::{anyhow, Context, Result};
+use std::fs::{self, File, OpenOptions};
+
+/// Lock guards for the caches of one command; released on drop.
+pub struct CacheLocks {
+    _files: Vec<File>,
+}
+
+/// Creates every cache directory and acquires its lock, blocking until
+/// conflicting holders release theirs.
+pub fn acquire(caches: &[CacheDir]) -> Result<CacheLocks> {
+    let mut files = Vec::with_capacity(caches.len());
+
+    for cache in caches {
+        fs::create_dir_all(&cache.path)
+            .with_context(|| format!("Cannot create cache directory {}", cache.path))?;
+        for entry in &cache.writable {
+            create_entry(entry)?;
+        }
+
+        let lock_path = format!("{}.lock", cache.path.trim_end_matches(['/', '\\']));
+        let file = OpenOptions::new()
+            .create(true)
+            .truncate(false)
+            .write(true)
+            .open(&lock_path)
+            .with_context(|| format!("Cannot open cache lock {lock_path}"))?;
+
+        lock(&file, cache.exclusive).with_context(|| format!("Cannot lock {lock_path}"))?;
+        files.push(file);
+    }
+
+    Ok(CacheLocks { _files: files })
+}
+
+/// Creates a writable cache entry: a directory when `entry` ends in `/`, an
+/// empty file otherwise.
+fn create_entry(entry: &str) -> Result<()> {
+    let path = entry.trim_end_matches('/');
+    if let Ok(meta) = fs::symlink_metadata(path) {
+        if meta.file_type().is_symlink() {
+            return Err(anyhow!("Cache entry {path} is a symlink"));
+        }
+    }
+    if entry.ends_with('/') {
+        fs::create_dir_all(path)
+    } else {
+        if let Some(parent) = std::path::Path::new(path).parent() {
+            fs::create_dir_all(parent)
+                .with_context(|| format!("Cannot create cache entry {entry}"))?;
+        }
+        OpenOptions::new()
+            .create(true)
+            .truncate(false)
+            .write(true)
+            .open(path)
+            .map(drop)
+    }
+    .with_context(|| format!("Cannot create cache entry {entry}"))
+}
+
+#[cfg(unix)]
+fn lock(file: &File, exclusive: bool) -> std::io::Result<()> {
+    use std::os::fd::AsRawFd;
+
+    let op = if exclusive {
+        libc::LOCK_EX
+    } else {
+        libc::LOCK_SH
+    };
+    loop {
+        if unsafe { libc::flock(file.as_raw_fd(), op) } == 0 {
+            return Ok(());
+        }
+        let err = std::io::Error::last_os_error();
+        if err.kind() != std::io::ErrorKind::Interrupted {
+            return Err(err);
+        }
+    }
+}
+
+#[cfg(not(unix))]
+fn lock(_file: &File, _exclusive: bool) -> std::io::Result<()> {
+    // Advisory cache locks are not implemented on this platform; the tools'
+    // own locking applies.
+    Ok(())
+}
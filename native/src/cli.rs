@@ -0,0 +1,330 @@
+//! Command-line interface shared by the launcher binary and the FFI library.
+
+use crate::git::Untracked;
+use crate::normalize::OutputFilter;
+use crate::priority::{IoPriority, Priority, SchedPolicy};
+use crate::strategies::base::{
+    CacheDir, ExecutionContext, LoopbackForward, OutputFile, SampleFile,
+};
+use clap::Parser;
+use std::time::Duration;
+
+#[derive(Parser, Debug)]
+#[allow(clippy::struct_excessive_bools)]
+#[command(
+    name = "workspace_launcher",
+    version,
+    about = "Native isolation launcher for workspace_sandbox",
+    long_about = "Executes commands in isolated environments using platform-specific sandboxing"
+)]
+pub struct Args {
+    /// Hold a pooled loopback-only network namespace instead of running a command.
+    #[arg(long, exclusive = true)]
+    pub netns_holder: bool,
+
+    /// Run inside a sandbox: relay loopback ports to host sockets, then run
+    /// the command. Used internally by strategies honoring `--forward`.
+    #[arg(long, value_parser = parse_forward)]
+    pub relay: Vec<LoopbackForward>,
+
+    /// Run inside a sandbox: install the file-access tracing filter, hand
+    /// its listener to the launcher outside, then exec the command. Used
+    /// internally by strategies honoring `--trace-file`.
+    #[arg(long, conflicts_with = "relay")]
+    pub trace_exec: bool,
+
+    #[arg(long, required_unless_present_any = ["netns_holder", "relay", "trace_exec", "git_status"])]
+    pub id: Option<String>,
+
+    #[arg(long, required_unless_present_any = ["netns_holder", "relay", "trace_exec"])]
+    pub workspace: Option<String>,
+
+    /// Print the git status of the workspace as JSON instead of running a
+    /// command.
+    #[arg(long, requires = "workspace")]
+    pub git_status: bool,
+
+    /// Untracked files reported by `--git-status`: `no`, `normal` or `all`.
+    #[arg(long, value_parser = parse_untracked, requires = "git_status")]
+    pub git_untracked: Option<Untracked>,
+
+    #[arg(long)]
+    pub sandbox: bool,
+
+    #[arg(long)]
+    pub no_net: bool,
+
+    /// Prefer the lightweight in-process sandbox where the platform has one.
+    #[arg(long)]
+    pub light: bool,
+
+    /// PID of a netns holder whose namespace replaces `--unshare-net`.
+    #[arg(long)]
+    pub netns_pid: Option<u32>,
+
+    /// Shared cache directory, bound read-write under a shared lock.
+    #[arg(long)]
+    pub cache: Vec<String>,
+
+    /// Shared cache directory, bound read-write under an exclusive lock.
+    #[arg(long)]
+    pub cache_exclusive: Vec<String>,
+
+    /// Entry of a `--cache` directory that stays writable while the rest of
+    /// that cache is bound read-only. Directories end in `/`.
+    #[arg(long)]
+    pub cache_writable: Vec<String>,
+
+    /// Keep a host unix socket reachable as `127.0.0.1:PORT` in the sandbox.
+    #[arg(long, value_parser = parse_forward)]
+    pub forward: Vec<LoopbackForward>,
+
+    /// Write the child's stdout to this file instead of the pipe.
+    #[arg(long)]
+    pub stdout_file: Option<String>,
+
+    #[arg(long, requires = "stdout_file")]
+    pub stdout_append: bool,
+
+    /// Also forward redirected stdout to the launcher's stdout.
+    #[arg(long, requires = "stdout_file")]
+    pub stdout_tee: bool,
+
+    /// Write the child's stderr to this file instead of the pipe.
+    #[arg(long)]
+    pub stderr_file: Option<String>,
+
+    #[arg(long, requires = "stderr_file")]
+    pub stderr_append: bool,
+
+    /// Also forward redirected stderr to the launcher's stderr.
+    #[arg(long, requires = "stderr_file")]
+    pub stderr_tee: bool,
+
+    /// Record the files the command tree reads and writes, as JSON, in
+    /// this file (Linux).
+    #[arg(long)]
+    pub trace_file: Option<String>,
+
+    /// Append resource samples of the command tree, as JSON lines, to this
+    /// file (Linux).
+    #[arg(long)]
+    pub sample_file: Option<String>,
+
+    /// Milliseconds between resource samples.
+    #[arg(long, requires = "sample_file", default_value_t = 1000)]
+    pub sample_interval: u64,
+
+    /// Kill the command after this many milliseconds without output or CPU
+    /// use (Linux).
+    #[arg(long)]
+    pub idle_timeout: Option<u64>,
+
+    /// Write why the launcher ended the command, as JSON, to this file.
+    #[arg(long)]
+    pub termination_file: Option<String>,
+
+    /// Run the command on these CPUs only, as a list like `0-3,8`
+    /// (Linux).
+    #[arg(long, value_parser = parse_cpu_list)]
+    pub cpus: Option<CpuList>,
+
+    /// Nice level of the command; negative levels need privileges.
+    #[arg(long, allow_hyphen_values = true)]
+    pub nice: Option<i32>,
+
+    /// Scheduling policy of the command: `batch` or `idle` (Linux).
+    #[arg(long, value_parser = parse_sched_policy)]
+    pub sched: Option<SchedPolicy>,
+
+    /// I/O priority of the command: `idle` or `best-effort[:LEVEL]`
+    /// (Linux).
+    #[arg(long, value_parser = parse_io_priority)]
+    pub io_priority: Option<IoPriority>,
+
+    /// Drop ANSI escape sequences from the child's output.
+    #[arg(long)]
+    pub strip_ansi: bool,
+
+    /// Keep only the final text of lines redrawn with carriage returns.
+    #[arg(long)]
+    pub collapse_cr: bool,
+
+    /// Emit runs of identical output lines once, with a repeat count.
+    #[arg(long)]
+    pub fold_repeats: bool,
+
+    /// Write raw and normalized output byte counts, as JSON, to this file.
+    #[arg(long)]
+    pub output_stats: Option<String>,
+
+    #[arg(long)]
+    pub cwd: Option<String>,
+
+    #[arg(long, value_parser = parse_key_val)]
+    pub env: Vec<(String, String)>,
+
+    #[arg(last = true)]
+    pub command: Vec<String>,
+}
+
+fn parse_key_val(s: &str) -> Result<(String, String), String> {
+    let pos = s
+        .find('=')
+        .ok_or_else(|| format!("Invalid KEY=value format: no '=' found in `{s}`"))?;
+    Ok((s[..pos].to_string(), s[pos + 1..].to_string()))
+}
+
+fn parse_untracked(s: &str) -> Result<Untracked, String> {
+    match s {
+        "no" => Ok(Untracked::No),
+        "normal" => Ok(Untracked::Normal),
+        "all" => Ok(Untracked::All),
+        _ => Err(format!(
+            "Invalid untracked mode `{s}`: expected no, normal or all"
+        )),
+    }
+}
+
+/// CPU numbers given as a kernel CPU list.
+#[derive(Debug, Clone)]
+pub struct CpuList(pub Vec<usize>);
+
+/// Parses a kernel CPU list such as `0-3,8,10-11`.
+fn parse_cpu_list(s: &str) -> Result<CpuList, String> {
+    let mut cpus = Vec::new();
+    for part in s.split(',').map(str::trim).filter(|part| !part.is_empty()) {
+        let number = |n: &str| {
+            n.parse::<usize>()
+                .map_err(|e| format!("Invalid CPU `{n}` in `{s}`: {e}"))
+        };
+        match part.split_once('-') {
+            Some((first, last)) => {
+                let (first, last) = (number(first)?, number(last)?);
+                if first > last {
+                    return Err(format!("Invalid CPU range `{part}` in `{s}`"));
+                }
+                cpus.extend(first..=last);
+            }
+            None => cpus.push(number(part)?),
+        }
+    }
+    if cpus.is_empty() {
+        return Err(format!("Empty CPU list `{s}`"));
+    }
+    cpus.sort_unstable();
+    cpus.dedup();
+    Ok(CpuList(cpus))
+}
+
+/// Parses `idle` or `best-effort[:LEVEL]` (level 0-7, default 4).
+fn parse_io_priority(s: &str) -> Result<IoPriority, String> {
+    match s.split_once(':') {
+        None if s == "idle" => Ok(IoPriority::Idle),
+        None if s == "best-effort" => Ok(IoPriority::BestEffort(4)),
+        Some(("best-effort", level)) => match level.parse::<u8>() {
+            Ok(level @ 0..=7) => Ok(IoPriority::BestEffort(level)),
+            _ => Err(format!(
+                "Invalid I/O priority level `{level}`: expected 0-7"
+            )),
+        },
+        _ => Err(format!(
+            "Invalid I/O priority `{s}`: expected idle or best-effort[:LEVEL]"
+        )),
+    }
+}
+
+/// Parses `batch` or `idle`.
+fn parse_sched_policy(s: &str) -> Result<SchedPolicy, String> {
+    match s {
+        "batch" => Ok(SchedPolicy::Batch),
+        "idle" => Ok(SchedPolicy::Idle),
+        _ => Err(format!(
+            "Invalid scheduling policy `{s}`: expected batch or idle"
+        )),
+    }
+}
+
+fn parse_forward(s: &str) -> Result<LoopbackForward, String> {
+    let (port, socket) = s
+        .split_once('=')
+        .ok_or_else(|| format!("Invalid PORT=socket format: no '=' found in `{s}`"))?;
+    let port = port
+        .parse()
+        .map_err(|e| format!("Invalid port `{port}`: {e}"))?;
+    Ok(LoopbackForward {
+        port,
+        socket: socket.to_string(),
+    })
+}
+
+impl Args {
+    /// Builds the execution context for a command-running invocation.
+    ///
+    /// Callers must have handled the `--netns-holder`, `--relay` and
+    /// `--trace-exec` modes
+    /// and checked that a command is present.
+    #[must_use]
+    pub fn into_context(self) -> ExecutionContext {
+        ExecutionContext {
+            id: self.id.unwrap_or_default(),
+            root_path: self.workspace.unwrap_or_default(),
+            cmd: self.command[0].clone(),
+            args: self.command[1..].to_vec(),
+            env_vars: self.env.into_iter().collect(),
+            cwd: self.cwd,
+            allow_network: !self.no_net,
+            netns_pid: self.netns_pid,
+            caches: self
+                .cache
+                .into_iter()
+                .map(|path| (path, false))
+                .chain(self.cache_exclusive.into_iter().map(|path| (path, true)))
+                .map(|(path, exclusive)| {
+                    let prefix = format!("{}/", path.trim_end_matches('/'));
+                    let writable = self
+                        .cache_writable
+                        .iter()
+                        .filter(|entry| entry.starts_with(&prefix) && entry.len() > prefix.len())
+                        .cloned()
+                        .collect();
+                    CacheDir {
+                        path,
+                        exclusive,
+                        writable,
+                    }
+                })
+                .collect(),
+            forwards: self.forward,
+            stdout_file: self.stdout_file.map(|path| OutputFile {
+                path,
+                append: self.stdout_append,
+                tee: self.stdout_tee,
+            }),
+            stderr_file: self.stderr_file.map(|path| OutputFile {
+                path,
+                append: self.stderr_append,
+                tee: self.stderr_tee,
+            }),
+            trace_file: self.trace_file,
+            sample_file: self.sample_file.map(|path| SampleFile {
+                path,
+                interval: Duration::from_millis(self.sample_interval.max(1)),
+            }),
+            idle_timeout: self.idle_timeout.map(Duration::from_millis),
+            termination_file: self.termination_file,
+            priority: Priority {
+                cpus: self.cpus.map(|list| list.0).unwrap_or_default(),
+                nice: self.nice,
+                policy: self.sched,
+                io: self.io_priority,
+            },
+            output_filter: OutputFilter {
+                strip_ansi: self.strip_ansi,
+                collapse_cr: self.collapse_cr,
+                fold_repeats: self.fold_repeats,
+            },
+            output_stats: self.output_stats,
+        }
+    }
+}
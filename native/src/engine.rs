@@ -1,18 +1,33 @@
 //! Core execution engine for managing isolated process lifecycles.
 
-use anyhow::{anyhow, Result};
+use anyhow::{anyhow, Context, Result};
+use std::env;
+use std::fs::{self, File};
+use std::io;
+use std::path::{Component, Path, PathBuf};
 use std::process::Stdio;
-#[cfg(unix)]
-use tokio::signal::unix::{signal, SignalKind};
-#[cfg(windows)]
-use tokio::signal;
 
+#[cfg(unix)]
+use std::ffi::CString;
+#[cfg(unix)]
+use std::os::fd::{AsRawFd, FromRawFd};
+#[cfg(unix)]
+use std::os::unix::ffi::OsStrExt;
 #[cfg(unix)]
 use std::os::unix::process::ExitStatusExt;
 
-use crate::strategies::base::{ExecutionContext, IsolationStrategy};
+use crate::cache;
+use crate::normalize;
+#[cfg(target_os = "linux")]
+use crate::sample::{IdleWatch, Sampler};
+use crate::strategies::base::{ExecutionContext, IsolationStrategy, OutputFile};
 use crate::strategies::host::HostStrategy;
+use crate::supervise::{supervise, KillOnDrop, Monitors, Outcome, Signals};
+#[cfg(target_os = "linux")]
+use crate::trace;
 
+#[cfg(target_os = "linux")]
+use crate::strategies::landlock::LinuxLandlockStrategy;
 #[cfg(target_os = "linux")]
 use crate::strategies::linux::LinuxBwrapStrategy;
 #[cfg(target_os = "macos")]
@@ -25,23 +40,35 @@ pub struct Engine {
 }
 
 impl Engine {
+    /// Selects the isolation strategy for this platform.
+    ///
+    /// When `light` is set, Linux prefers the in-process Landlock + seccomp
+    /// strategy and falls back to Bubblewrap on kernels without Landlock.
+    /// Other platforms ignore `light`.
     #[must_use]
-    pub fn new(sandbox: bool) -> Self {
+    pub fn new(sandbox: bool, light: bool) -> Self {
         let strategy: Box<dyn IsolationStrategy> = if sandbox {
             #[cfg(target_os = "linux")]
             {
-                Box::new(LinuxBwrapStrategy)
+                if light && LinuxLandlockStrategy::is_supported() {
+                    Box::new(LinuxLandlockStrategy)
+                } else {
+                    Box::new(LinuxBwrapStrategy)
+                }
             }
             #[cfg(target_os = "windows")]
             {
+                let _ = light;
                 Box::new(WindowsJobStrategy)
             }
             #[cfg(target_os = "macos")]
             {
+                let _ = light;
                 Box::new(MacOsSandboxStrategy)
             }
             #[cfg(not(any(target_os = "linux", target_os = "windows", target_os = "macos")))]
             {
+                let _ = light;
                 Box::new(HostStrategy)
             }
         } else {
@@ -51,49 +78,142 @@ impl Engine {
         Engine { strategy }
     }
 
-    pub async fn run(&self, ctx: ExecutionContext) -> Result<i32> {
+    /// Builds the sandboxed command without spawning it.
+    pub fn build_command(&self, ctx: &ExecutionContext) -> Result<std::process::Command> {
+        self.strategy.build_command(ctx)
+    }
+
+    /// Runs the command to completion on the calling thread.
+    ///
+    /// Output, the child's exit and termination signals are all handled by
+    /// one readiness loop (see [`supervise`]), so no runtime or helper
+    /// threads are started on unix.
+    pub fn run(&self, ctx: &ExecutionContext) -> Result<i32> {
         eprintln!("[Launcher] Strategy: {}", self.strategy.name());
         eprintln!("[Launcher] Command: {} {:?}", ctx.cmd, ctx.args);
 
-        let cmd = self.strategy.build_command(&ctx)?;
+        // Held until this function returns, i.e. for the child's lifetime.
+        let _cache_locks = cache::acquire(&ctx.caches)?;
+
+        let mut command = self.strategy.build_command(ctx)?;
 
-        let mut child = tokio::process::Command::from(cmd)
-            .stdout(Stdio::piped())
-            .stderr(Stdio::piped())
-            .stdin(Stdio::null())
-            .kill_on_drop(true)
-            .spawn()
-            .map_err(|e| anyhow!("Process spawn failed: {e}"))?;
+        let stdout_file = ctx
+            .stdout_file
+            .as_ref()
+            .map(|output| open_output(&ctx.root_path, output))
+            .transpose()?;
+        let stderr_file = ctx
+            .stderr_file
+            .as_ref()
+            .map(|output| open_output(&ctx.root_path, output))
+            .transpose()?;
 
-        if let Some(pid) = child.id() {
-            eprintln!("[Launcher] PID: {pid}");
+        // Installed before spawning so that a termination request cannot
+        // slip in between.
+        let signals = Signals::new()?;
+
+        command
+            .stdout(child_stdio(ctx.stdout_file.as_ref(), stdout_file.as_ref())?)
+            .stderr(child_stdio(ctx.stderr_file.as_ref(), stderr_file.as_ref())?)
+            .stdin(Stdio::null());
+        #[cfg(unix)]
+        ctx.priority.attach(&mut command)?;
+        #[cfg(not(unix))]
+        if ctx.priority.is_set() {
+            return Err(anyhow!("CPU affinity and scheduling settings require unix"));
+        }
+        // Registered last: see `trace::attach`.
+        #[cfg(target_os = "linux")]
+        let tracing = ctx
+            .trace_file
+            .as_ref()
+            .map(|_| trace::attach(&mut command, self.strategy.traces_inside()))
+            .transpose()?;
+        #[cfg(not(target_os = "linux"))]
+        if ctx.trace_file.is_some() {
+            return Err(anyhow!("File-access tracing requires Linux"));
+        }
+        #[cfg(target_os = "linux")]
+        let mut sampler = ctx
+            .sample_file
+            .as_ref()
+            .map(|s| Sampler::new(s.interval, &s.path))
+            .transpose()?;
+        #[cfg(not(target_os = "linux"))]
+        let mut sampler = None;
+        #[cfg(not(target_os = "linux"))]
+        if ctx.sample_file.is_some() {
+            return Err(anyhow!("Resource sampling requires Linux"));
+        }
+        #[cfg(target_os = "linux")]
+        let mut idle = ctx.idle_timeout.map(IdleWatch::new).transpose()?;
+        #[cfg(not(target_os = "linux"))]
+        let mut idle = None;
+        #[cfg(not(target_os = "linux"))]
+        if ctx.idle_timeout.is_some() {
+            return Err(anyhow!("Idle detection requires Linux"));
         }
 
-        let mut child_stdout = child.stdout.take().expect("stdout not captured");
-        let mut child_stderr = child.stderr.take().expect("stderr not captured");
+        let mut child = KillOnDrop(
+            command
+                .spawn()
+                .map_err(|e| anyhow!("Process spawn failed: {e}"))?,
+        );
 
-        let stdout_task = tokio::spawn(async move {
-            let mut stdout = tokio::io::stdout();
-            let _ = tokio::io::copy(&mut child_stdout, &mut stdout).await;
-        });
+        eprintln!("[Launcher] PID: {}", child.id());
 
-        let stderr_task = tokio::spawn(async move {
-            let mut stderr = tokio::io::stderr();
-            let _ = tokio::io::copy(&mut child_stderr, &mut stderr).await;
-        });
+        #[cfg(target_os = "linux")]
+        let mut tracer = tracing
+            .map(|pending| pending.connect(child.id()))
+            .transpose()?;
+        #[cfg(not(target_os = "linux"))]
+        let mut tracer = None;
 
-        let exit_status = tokio::select! {
-            status = child.wait() => status,
-            () = wait_for_termination() => {
+        // Untee'd redirects hand the file to the child directly, so there is
+        // no pipe to pump and the file is simply dropped.
+        let outcome = supervise(
+            &mut child,
+            &signals,
+            stdout_file,
+            stderr_file,
+            ctx.output_filter,
+            Monitors {
+                tracer: tracer.as_mut(),
+                sampler: sampler.as_mut(),
+                idle: idle.as_mut(),
+            },
+        )?;
+
+        #[cfg(target_os = "linux")]
+        if let (Some(tracer), Some(path)) = (tracer, &ctx.trace_file) {
+            tracer.finish(path)?;
+        }
+
+        let status = match outcome {
+            Outcome::Exited(status, counts) => {
+                if let Some(path) = &ctx.output_stats {
+                    normalize::write_stats(path, counts)
+                        .with_context(|| format!("Cannot write output stats to {path}"))?;
+                }
+                status
+            }
+            Outcome::Terminated => {
                 eprintln!("[Launcher] Received termination signal");
-                let _ = child.kill().await;
+                return Ok(-1);
+            }
+            Outcome::Idle => {
+                let limit = ctx.idle_timeout.unwrap_or_default();
+                eprintln!(
+                    "[Launcher] No output or CPU use for {:.1}s, terminated",
+                    limit.as_secs_f64()
+                );
+                if let Some(path) = &ctx.termination_file {
+                    fs::write(path, r#"{"reason":"idle"}"#)
+                        .with_context(|| format!("Cannot write termination file {path}"))?;
+                }
                 return Ok(-1);
             }
         };
-
-        let _ = tokio::join!(stdout_task, stderr_task);
-
-        let status = exit_status.map_err(|e| anyhow!("Failed to wait for process: {e}"))?;
         let code = status.code().unwrap_or(-1);
 
         #[cfg(unix)]
@@ -107,18 +227,180 @@ impl Engine {
     }
 }
 
-async fn wait_for_termination() {
-    #[cfg(unix)]
-    {
-        let mut sigterm = signal(SignalKind::terminate()).expect("Failed to register SIGTERM");
-        let mut sigint = signal(SignalKind::interrupt()).expect("Failed to register SIGINT");
-        tokio::select! {
-            _ = sigterm.recv() => {},
-            _ = sigint.recv() => {},
+/// Opens (creating parent directories) a redirect target inside the
+/// workspace `root`.
+///
+/// The path is resolved beneath `root` without following symlinks, so a
+/// link the command left in the workspace cannot aim a redirect at a file
+/// outside it.
+pub(crate) fn open_output(root: &str, output: &OutputFile) -> Result<File> {
+    let root = normalize(Path::new(root))?;
+    let relative = workspace_relative(&root, Path::new(&output.path))
+        .filter(|relative| {
+            relative.file_name().is_some()
+                && relative
+                    .components()
+                    .all(|component| matches!(component, Component::Normal(_)))
+        })
+        .ok_or_else(|| anyhow!("Output file {} is outside the workspace", output.path))?;
+    open_beneath(&root, &relative, output.append)
+        .with_context(|| format!("Cannot open output file {}", output.path))
+}
+
+/// `path` made absolute with `.` and `..` removed lexically, as the Dart
+/// side normalizes the redirect paths it passes.
+fn normalize(path: &Path) -> io::Result<PathBuf> {
+    let mut normalized = if path.is_relative() {
+        env::current_dir()?
+    } else {
+        PathBuf::new()
+    };
+    for component in path.components() {
+        match component {
+            Component::CurDir => {}
+            Component::ParentDir => {
+                normalized.pop();
+            }
+            other => normalized.push(other),
+        }
+    }
+    Ok(normalized)
+}
+
+#[cfg(unix)]
+fn workspace_relative(root: &Path, path: &Path) -> Option<PathBuf> {
+    path.strip_prefix(root).ok().map(Path::to_path_buf)
+}
+
+/// Dart lower-cases canonical paths on Windows.
+#[cfg(not(unix))]
+fn workspace_relative(root: &Path, path: &Path) -> Option<PathBuf> {
+    let lower = |path: &Path| PathBuf::from(path.to_string_lossy().to_lowercase());
+    lower(path)
+        .strip_prefix(lower(root))
+        .ok()
+        .map(Path::to_path_buf)
+}
+
+#[cfg(unix)]
+fn output_flags(append: bool) -> libc::c_int {
+    let mode = if append {
+        libc::O_APPEND
+    } else {
+        libc::O_TRUNC
+    };
+    libc::O_WRONLY | libc::O_CREAT | libc::O_CLOEXEC | mode
+}
+
+/// Opens `relative` with `openat2(RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS)`,
+/// walking it one component at a time when parent directories are missing
+/// or the kernel predates `openat2` (5.6).
+#[cfg(target_os = "linux")]
+fn open_beneath(root: &Path, relative: &Path, append: bool) -> io::Result<File> {
+    let dir = File::open(root)?;
+    let flags = output_flags(append);
+    let path = CString::new(relative.as_os_str().as_bytes())?;
+    let mut how: libc::open_how = unsafe { std::mem::zeroed() };
+    how.flags = u64::try_from(flags).unwrap_or_default();
+    how.mode = 0o666;
+    how.resolve = libc::RESOLVE_BENEATH | libc::RESOLVE_NO_SYMLINKS;
+    let fd = unsafe {
+        libc::syscall(
+            libc::SYS_openat2,
+            dir.as_raw_fd(),
+            path.as_ptr(),
+            std::ptr::addr_of!(how),
+            std::mem::size_of::<libc::open_how>(),
+        )
+    };
+    if fd >= 0 {
+        return Ok(unsafe { File::from_raw_fd(i32::try_from(fd).unwrap_or(-1)) });
+    }
+    let err = io::Error::last_os_error();
+    match err.raw_os_error() {
+        Some(libc::ENOENT | libc::ENOSYS | libc::EPERM) => open_walk(&dir, relative, flags),
+        _ => Err(err),
+    }
+}
+
+#[cfg(all(unix, not(target_os = "linux")))]
+fn open_beneath(root: &Path, relative: &Path, append: bool) -> io::Result<File> {
+    open_walk(&File::open(root)?, relative, output_flags(append))
+}
+
+/// Opens `relative` under `root` one component at a time with
+/// `O_NOFOLLOW`, creating missing directories on the way.
+#[cfg(unix)]
+fn open_walk(root: &File, relative: &Path, flags: libc::c_int) -> io::Result<File> {
+    let mut dir = root.try_clone()?;
+    let mut components = relative.components().peekable();
+    while let Some(component) = components.next() {
+        let name = CString::new(component.as_os_str().as_bytes())?;
+        if components.peek().is_none() {
+            let fd = unsafe {
+                libc::openat(
+                    dir.as_raw_fd(),
+                    name.as_ptr(),
+                    flags | libc::O_NOFOLLOW,
+                    0o666 as libc::c_uint,
+                )
+            };
+            if fd < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            return Ok(unsafe { File::from_raw_fd(fd) });
+        }
+        if unsafe { libc::mkdirat(dir.as_raw_fd(), name.as_ptr(), 0o777) } < 0 {
+            let err = io::Error::last_os_error();
+            if err.kind() != io::ErrorKind::AlreadyExists {
+                return Err(err);
+            }
+        }
+        let fd = unsafe {
+            libc::openat(
+                dir.as_raw_fd(),
+                name.as_ptr(),
+                libc::O_RDONLY | libc::O_DIRECTORY | libc::O_NOFOLLOW | libc::O_CLOEXEC,
+            )
         };
+        if fd < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        dir = unsafe { File::from_raw_fd(fd) };
     }
-    #[cfg(windows)]
-    {
-        let _ = signal::ctrl_c().await;
+    Err(io::ErrorKind::InvalidInput.into())
+}
+
+/// Checks each component of `relative` with `lstat` before opening it, as
+/// Windows has no `O_NOFOLLOW`.
+#[cfg(not(unix))]
+fn open_beneath(root: &Path, relative: &Path, append: bool) -> io::Result<File> {
+    let mut path = root.to_path_buf();
+    for component in relative.components() {
+        path.push(component);
+        if fs::symlink_metadata(&path).is_ok_and(|meta| meta.file_type().is_symlink()) {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                format!("{} is a symlink", path.display()),
+            ));
+        }
+    }
+    if let Some(parent) = path.parent() {
+        fs::create_dir_all(parent)?;
+    }
+    fs::OpenOptions::new()
+        .create(true)
+        .write(true)
+        .append(append)
+        .truncate(!append)
+        .open(path)
+}
+
+/// The child's end of an output stream: the redirect file itself, or a pipe
+/// when the stream is not redirected or must also be tee'd.
+pub(crate) fn child_stdio(output: Option<&OutputFile>, file: Option<&File>) -> Result<Stdio> {
+    match (output, file) {
+        (Some(output), Some(file)) if !output.tee => Ok(Stdio::from(file.try_clone()?)),
+        _ => Ok(Stdio::piped()),
     }
 }
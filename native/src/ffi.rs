@@ -0,0 +1,606 @@
+//! C ABI for spawning sandboxed commands without a launcher process.
+//!
+//! The Dart package loads this crate as a shared library and calls
+//! [`wsl_spawn`] with the same arguments it would pass to the
+//! `workspace_launcher` binary. The command is sandboxed by the same
+//! strategies, but runs as a direct child of the Dart process.
+//!
+//! Output and completion are delivered asynchronously through Dart native
+//! ports using the `Dart_PostCObject` function Dart passes in:
+//! - stdout/stderr ports receive `Uint8List` chunks, then `null` at EOF
+//! - the exit port receives the exit code (`-1` when killed by a signal)
+//!
+//! Each child is supervised by its own thread, which also keeps
+//! `PR_SET_PDEATHSIG` based cleanup tied to the child's lifetime rather
+//! than to whichever Dart thread made the call.
+
+use crate::cache;
+use crate::cli::Args;
+use crate::engine::{child_stdio, open_output, Engine};
+use crate::git;
+use crate::normalize::{self, ByteCounts, Normalizer, OutputFilter};
+use crate::supervise::Sampler;
+use clap::Parser;
+use std::collections::HashMap;
+use std::ffi::{c_char, CStr, CString};
+use std::fs::File;
+use std::io::{self, Read, Write};
+use std::os::unix::process::CommandExt;
+use std::panic::{self, AssertUnwindSafe};
+use std::path::PathBuf;
+use std::process::{ChildStderr, ChildStdout, Stdio};
+use std::sync::mpsc;
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+
+const COBJECT_NULL: i32 = 0;
+const COBJECT_INT64: i32 = 3;
+const COBJECT_TYPED_DATA: i32 = 7;
+const TYPED_DATA_UINT8: i32 = 2;
+
+/// Prefix of the `Dart_CObject` struct covering the variants posted here.
+#[repr(C)]
+pub struct DartCObject {
+    ty: i32,
+    value: DartCObjectValue,
+}
+
+#[repr(C)]
+union DartCObjectValue {
+    as_int64: i64,
+    as_typed_data: TypedData,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct TypedData {
+    ty: i32,
+    length: isize,
+    values: *const u8,
+}
+
+/// Signature of `Dart_PostCObject` (`NativeApi.postCObject` in Dart).
+pub type PostCObject = unsafe extern "C" fn(port: i64, message: *mut DartCObject) -> bool;
+
+/// Resource usage of an exited child, as reported by `wait4`.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct WslRusage {
+    pub user_micros: i64,
+    pub system_micros: i64,
+    pub max_rss_kb: i64,
+}
+
+#[derive(Clone, Copy)]
+struct Poster(PostCObject);
+
+impl Poster {
+    fn post(self, port: i64, mut message: DartCObject) {
+        // Dart copies the message; a closed port is not an error here.
+        unsafe {
+            (self.0)(port, std::ptr::addr_of_mut!(message));
+        }
+    }
+
+    fn int(self, port: i64, value: i64) {
+        self.post(
+            port,
+            DartCObject {
+                ty: COBJECT_INT64,
+                value: DartCObjectValue { as_int64: value },
+            },
+        );
+    }
+
+    fn bytes(self, port: i64, data: &[u8]) {
+        self.post(
+            port,
+            DartCObject {
+                ty: COBJECT_TYPED_DATA,
+                value: DartCObjectValue {
+                    as_typed_data: TypedData {
+                        ty: TYPED_DATA_UINT8,
+                        length: isize::try_from(data.len()).unwrap_or(isize::MAX),
+                        values: data.as_ptr(),
+                    },
+                },
+            },
+        );
+    }
+
+    fn null(self, port: i64) {
+        self.post(
+            port,
+            DartCObject {
+                ty: COBJECT_NULL,
+                value: DartCObjectValue { as_int64: 0 },
+            },
+        );
+    }
+}
+
+/// Per-child state, keyed by pid until [`wsl_release`].
+///
+/// The child leads its own process group, whose id is not recycled while
+/// any member is alive, so [`wsl_kill`] can still reach what the command
+/// left behind after it exited.
+struct ChildState {
+    /// Available once the child has been reaped.
+    rusage: Option<WslRusage>,
+}
+
+fn children() -> &'static Mutex<HashMap<i32, ChildState>> {
+    static CHILDREN: OnceLock<Mutex<HashMap<i32, ChildState>>> = OnceLock::new();
+    CHILDREN.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+#[derive(Clone, Copy)]
+struct Ports {
+    stdout: i64,
+    stderr: i64,
+    exit: i64,
+}
+
+/// Spawns a sandboxed command described by launcher-style arguments.
+///
+/// `arg_values` holds `arg_count` arguments exactly as accepted by the
+/// launcher binary, without the program name. Returns the child pid, or `-1`
+/// after writing a NUL-terminated message into `error` (truncated to
+/// `error_len` bytes).
+///
+/// Blocks until the child has started, including while waiting for an
+/// exclusive cache lock.
+///
+/// # Safety
+///
+/// `arg_values` must point to `arg_count` valid NUL-terminated strings,
+/// `post` must be `Dart_PostCObject`, and `error` must be writable for
+/// `error_len` bytes.
+#[no_mangle]
+pub unsafe extern "C" fn wsl_spawn(
+    arg_count: i32,
+    arg_values: *const *const c_char,
+    post: PostCObject,
+    stdout_port: i64,
+    stderr_port: i64,
+    exit_port: i64,
+    error: *mut c_char,
+    error_len: usize,
+) -> i64 {
+    let count = usize::try_from(arg_count).unwrap_or(0);
+    let mut raw = vec!["workspace_launcher".to_string()];
+    for i in 0..count {
+        raw.push(
+            CStr::from_ptr(*arg_values.add(i))
+                .to_string_lossy()
+                .into_owned(),
+        );
+    }
+
+    let ports = Ports {
+        stdout: stdout_port,
+        stderr: stderr_port,
+        exit: exit_port,
+    };
+    match spawn(raw, Poster(post), ports) {
+        Ok(pid) => i64::from(pid),
+        Err(message) => {
+            write_error(&message, error, error_len);
+            -1
+        }
+    }
+}
+
+/// Sends `signal` to a child's process group, so that processes the
+/// command started in the background are stopped with it, as the launcher
+/// binary does.
+///
+/// Returns `0` on success, `-1` if the child is unknown or released, or
+/// nothing is left of its group.
+#[no_mangle]
+pub extern "C" fn wsl_kill(pid: i64, signal: i32) -> i32 {
+    let Ok(pid) = i32::try_from(pid) else {
+        return -1;
+    };
+    let table = children()
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner);
+    if table.contains_key(&pid) && unsafe { libc::killpg(pid, signal) } == 0 {
+        0
+    } else {
+        -1
+    }
+}
+
+/// Copies the resource usage of an exited child into `out`.
+///
+/// Returns `0` on success, `-1` if the child is unknown or still running.
+///
+/// # Safety
+///
+/// `out` must be valid for writing a [`WslRusage`].
+#[no_mangle]
+pub unsafe extern "C" fn wsl_rusage(pid: i64, out: *mut WslRusage) -> i32 {
+    let Ok(pid) = i32::try_from(pid) else {
+        return -1;
+    };
+    let table = children()
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner);
+    match table.get(&pid) {
+        Some(ChildState {
+            rusage: Some(rusage),
+            ..
+        }) => {
+            *out = *rusage;
+            0
+        }
+        _ => -1,
+    }
+}
+
+/// Forgets a child. Call once its exit code has been received.
+#[no_mangle]
+pub extern "C" fn wsl_release(pid: i64) {
+    if let Ok(pid) = i32::try_from(pid) {
+        children()
+            .lock()
+            .unwrap_or_else(std::sync::PoisonError::into_inner)
+            .remove(&pid);
+    }
+}
+
+/// `wsl_git_status` flag: reuse unchanged directory listings.
+pub const GIT_UNTRACKED_CACHE: i32 = 1;
+/// `wsl_git_status` flag: do not report untracked files.
+pub const GIT_UNTRACKED_NO: i32 = 2;
+/// `wsl_git_status` flag: report every untracked file, not collapsed
+/// directories.
+pub const GIT_UNTRACKED_ALL: i32 = 4;
+
+/// Status caches by workspace root, kept for the life of the process.
+fn git_caches() -> &'static Mutex<HashMap<PathBuf, Arc<Mutex<git::StatusCache>>>> {
+    static CACHES: OnceLock<Mutex<HashMap<PathBuf, Arc<Mutex<git::StatusCache>>>>> =
+        OnceLock::new();
+    CACHES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+/// Computes the git status of the repository containing `root` as JSON
+/// (see [`git::Status::to_json`]).
+///
+/// Unlike the launcher binary, repeated calls for the same root reuse the
+/// parsed index, `HEAD` tree and file hashes of earlier calls. `flags`
+/// combines the `GIT_*` constants.
+///
+/// Returns a string to free with [`wsl_string_free`], or null after writing
+/// a NUL-terminated message into `error`.
+///
+/// # Safety
+///
+/// `root` must be a valid NUL-terminated string and `error` must be
+/// writable for `error_len` bytes.
+#[no_mangle]
+pub unsafe extern "C" fn wsl_git_status(
+    root: *const c_char,
+    flags: i32,
+    error: *mut c_char,
+    error_len: usize,
+) -> *mut c_char {
+    let root = PathBuf::from(CStr::from_ptr(root).to_string_lossy().into_owned());
+    let options = git::StatusOptions {
+        untracked: if flags & GIT_UNTRACKED_NO != 0 {
+            git::Untracked::No
+        } else if flags & GIT_UNTRACKED_ALL != 0 {
+            git::Untracked::All
+        } else {
+            git::Untracked::Normal
+        },
+        untracked_cache: flags & GIT_UNTRACKED_CACHE != 0,
+    };
+    let cache = {
+        let mut caches = git_caches()
+            .lock()
+            .unwrap_or_else(std::sync::PoisonError::into_inner);
+        // Bound the memory held for workspaces that are long gone.
+        if caches.len() >= 64 && !caches.contains_key(&root) {
+            caches.clear();
+        }
+        Arc::clone(caches.entry(root.clone()).or_default())
+    };
+    let mut cache = cache
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner);
+    // A panic must not unwind into the Dart VM; the parsers return errors
+    // for corrupt data, so one would be a bug here.
+    let result = panic::catch_unwind(AssertUnwindSafe(|| git::status(&root, options, &mut cache)));
+    match result {
+        Ok(Ok(status)) => {
+            CString::new(status.to_json()).map_or(std::ptr::null_mut(), CString::into_raw)
+        }
+        Ok(Err(e)) => {
+            if let Some(json) = git::unsupported_json(&e) {
+                return CString::new(json).map_or(std::ptr::null_mut(), CString::into_raw);
+            }
+            write_error(&format!("{e:#}"), error, error_len);
+            std::ptr::null_mut()
+        }
+        Err(payload) => {
+            // The cache may be half-updated.
+            *cache = git::StatusCache::default();
+            let reason = payload
+                .downcast_ref::<&str>()
+                .copied()
+                .or_else(|| payload.downcast_ref::<String>().map(String::as_str))
+                .unwrap_or("unknown error");
+            write_error(
+                &format!("Cannot read the repository: {reason}"),
+                error,
+                error_len,
+            );
+            std::ptr::null_mut()
+        }
+    }
+}
+
+/// Frees a string returned by this library.
+///
+/// # Safety
+///
+/// `value` must come from a function of this library and not be freed yet.
+#[no_mangle]
+pub unsafe extern "C" fn wsl_string_free(value: *mut c_char) {
+    if !value.is_null() {
+        drop(CString::from_raw(value));
+    }
+}
+
+fn spawn(raw: Vec<String>, poster: Poster, ports: Ports) -> Result<i32, String> {
+    let args = Args::try_parse_from(raw).map_err(|e| e.to_string())?;
+    if args.netns_holder || !args.relay.is_empty() {
+        return Err("Helper modes are not available in-process".to_string());
+    }
+    if args.command.is_empty() {
+        return Err("No command provided".to_string());
+    }
+
+    let (tx, rx) = mpsc::channel();
+    thread::Builder::new()
+        .name("wsl-supervisor".to_string())
+        .spawn(move || supervise(args, poster, ports, &tx))
+        .map_err(|e| format!("Cannot start supervisor thread: {e}"))?;
+    rx.recv()
+        .map_err(|_| "Supervisor exited before spawning".to_string())?
+}
+
+fn supervise(
+    args: Args,
+    poster: Poster,
+    ports: Ports,
+    started: &mpsc::Sender<Result<i32, String>>,
+) {
+    let engine = Engine::new(args.sandbox, args.light);
+    let ctx = args.into_context();
+
+    let prepared = (|| -> anyhow::Result<_> {
+        // The tracer is polled by the launcher binary's supervision loop.
+        if ctx.trace_file.is_some() {
+            anyhow::bail!("File-access tracing requires the launcher binary");
+        }
+        // So is the idle check, which also needs to see every chunk.
+        if ctx.idle_timeout.is_some() {
+            anyhow::bail!("Idle detection requires the launcher binary");
+        }
+        let locks = cache::acquire(&ctx.caches)?;
+        let stdout_file = ctx
+            .stdout_file
+            .as_ref()
+            .map(|output| open_output(&ctx.root_path, output))
+            .transpose()?;
+        let stderr_file = ctx
+            .stderr_file
+            .as_ref()
+            .map(|output| open_output(&ctx.root_path, output))
+            .transpose()?;
+        let mut command = engine.build_command(&ctx)?;
+        command
+            .stdout(child_stdio(ctx.stdout_file.as_ref(), stdout_file.as_ref())?)
+            .stderr(child_stdio(ctx.stderr_file.as_ref(), stderr_file.as_ref())?)
+            .stdin(Stdio::null());
+        // Its own group, so that `wsl_kill` reaches background children.
+        command.process_group(0);
+        ctx.priority.attach(&mut command)?;
+        #[cfg(target_os = "linux")]
+        let sampler = ctx
+            .sample_file
+            .as_ref()
+            .map(|s| Sampler::new(s.interval, &s.path))
+            .transpose()?;
+        #[cfg(not(target_os = "linux"))]
+        let sampler: Option<Sampler> = match ctx.sample_file {
+            Some(_) => anyhow::bail!("Resource sampling requires Linux"),
+            None => None,
+        };
+        let child = command.spawn()?;
+        Ok((locks, child, stdout_file, stderr_file, sampler))
+    })();
+
+    let (_cache_locks, mut child, stdout_file, stderr_file, sampler) = match prepared {
+        Ok(ready) => ready,
+        Err(e) => {
+            let _ = started.send(Err(format!("{e:#}")));
+            return;
+        }
+    };
+
+    let Ok(pid) = i32::try_from(child.id()) else {
+        let _ = child.kill();
+        let _ = started.send(Err("Child pid out of range".to_string()));
+        return;
+    };
+    children()
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner)
+        .insert(pid, ChildState { rusage: None });
+    let _ = started.send(Ok(pid));
+
+    let filter = ctx.output_filter;
+    let readers = [
+        child
+            .stdout
+            .take()
+            .map(|s| spawn_reader::<ChildStdout>(s, stdout_file, filter, poster, ports.stdout)),
+        child
+            .stderr
+            .take()
+            .map(|s| spawn_reader::<ChildStderr>(s, stderr_file, filter, poster, ports.stderr)),
+    ];
+    // Streams redirected straight to a file have no reader: report EOF now.
+    if readers[0].is_none() {
+        poster.null(ports.stdout);
+    }
+    if readers[1].is_none() {
+        poster.null(ports.stderr);
+    }
+
+    let sampling = sampler.map(|sampler| spawn_sampler(sampler, child.id()));
+
+    let (code, rusage) = wait_for_exit(pid);
+    if let Some((stop, thread)) = sampling {
+        drop(stop);
+        let _ = thread.join();
+    }
+    if let Some(state) = children()
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner)
+        .get_mut(&pid)
+    {
+        state.rusage = Some(rusage);
+    }
+    let mut counts = [ByteCounts::default(); 2];
+    for (count, reader) in counts.iter_mut().zip(readers) {
+        if let Some(reader) = reader {
+            *count = reader.join().unwrap_or_default();
+        }
+    }
+    // Written before the exit is posted, so the caller can read it then.
+    if let Some(path) = &ctx.output_stats {
+        if let Err(e) = normalize::write_stats(path, counts) {
+            eprintln!("[Launcher] Cannot write output stats to {path}: {e}");
+        }
+    }
+    poster.int(ports.exit, i64::from(code));
+}
+
+fn spawn_reader<R: Read + Send + 'static>(
+    mut src: R,
+    mut tee: Option<File>,
+    filter: OutputFilter,
+    poster: Poster,
+    port: i64,
+) -> thread::JoinHandle<ByteCounts> {
+    thread::spawn(move || {
+        let mut normalizer = Normalizer::new(filter);
+        let mut buf = vec![0u8; 64 * 1024];
+        let mut out = Vec::new();
+        let mut forward = |data: &[u8]| {
+            if data.is_empty() {
+                return;
+            }
+            if let Some(file) = tee.as_mut() {
+                let _ = file.write_all(data);
+            }
+            poster.bytes(port, data);
+        };
+        loop {
+            match src.read(&mut buf) {
+                Ok(0) => break,
+                Ok(n) => {
+                    normalizer.push(&buf[..n], &mut out);
+                    forward(&out);
+                    out.clear();
+                }
+                Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+                Err(_) => break,
+            }
+        }
+        normalizer.finish(&mut out);
+        forward(&out);
+        poster.null(port);
+        normalizer.counts()
+    })
+}
+
+/// Records samples of `root` every interval until the returned sender is
+/// dropped.
+fn spawn_sampler(mut sampler: Sampler, root: u32) -> (mpsc::Sender<()>, thread::JoinHandle<()>) {
+    let (stop, stopped) = mpsc::channel::<()>();
+    let thread = thread::spawn(move || {
+        while let Err(mpsc::RecvTimeoutError::Timeout) = stopped.recv_timeout(sampler.interval()) {
+            sampler.record(root);
+        }
+    });
+    (stop, thread)
+}
+
+/// Waits for `pid` to exit and reaps it with `wait4`.
+fn wait_for_exit(pid: i32) -> (i32, WslRusage) {
+    let mut status = 0;
+    let mut usage: libc::rusage = unsafe { std::mem::zeroed() };
+    let reaped = loop {
+        let ret = unsafe {
+            libc::wait4(
+                pid,
+                std::ptr::addr_of_mut!(status),
+                0,
+                std::ptr::addr_of_mut!(usage),
+            )
+        };
+        if ret >= 0 {
+            break true;
+        }
+        if io::Error::last_os_error().kind() != io::ErrorKind::Interrupted {
+            break false;
+        }
+    };
+
+    // Without a status (another waiter reaped the child) report a failure
+    // rather than a made-up success.
+    let code = if reaped && libc::WIFEXITED(status) {
+        libc::WEXITSTATUS(status)
+    } else {
+        -1
+    };
+    let rusage = WslRusage {
+        user_micros: timeval_micros(usage.ru_utime),
+        system_micros: timeval_micros(usage.ru_stime),
+        max_rss_kb: max_rss_kb(usage.ru_maxrss),
+    };
+    (code, rusage)
+}
+
+// Field widths differ between platforms (`suseconds_t` is 32-bit on macOS).
+#[allow(clippy::useless_conversion)]
+fn timeval_micros(tv: libc::timeval) -> i64 {
+    i64::from(tv.tv_sec) * 1_000_000 + i64::from(tv.tv_usec)
+}
+
+/// `ru_maxrss` is in kilobytes on Linux but in bytes on macOS.
+#[allow(clippy::unnecessary_cast)]
+fn max_rss_kb(raw: libc::c_long) -> i64 {
+    let raw = raw as i64;
+    if cfg!(target_os = "macos") {
+        raw / 1024
+    } else {
+        raw
+    }
+}
+
+unsafe fn write_error(message: &str, error: *mut c_char, error_len: usize) {
+    if error.is_null() || error_len == 0 {
+        return;
+    }
+    let bytes = message.as_bytes();
+    let n = bytes.len().min(error_len - 1);
+    std::ptr::copy_nonoverlapping(bytes.as_ptr().cast::<c_char>(), error, n);
+    *error.add(n) = 0;
+}
@@ -0,0 +1,266 @@
+//! `.gitignore` matching.
+//!
+//! Implements the pattern rules of gitignore(5): `!` negation, trailing `/`
+//! for directories only, anchoring by a leading or inner `/`, and the
+//! `*`, `?`, `**` and `[...]` wildcards with `\` escapes. Within one
+//! directory the last matching pattern wins, and deeper `.gitignore` files
+//! take precedence over shallower ones and over `info/exclude`.
+
+use std::collections::HashMap;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+use std::time::SystemTime;
+
+/// One compiled line of an ignore file.
+#[derive(Debug)]
+pub struct Pattern {
+    glob: Vec<u8>,
+    negated: bool,
+    dir_only: bool,
+    anchored: bool,
+}
+
+impl Pattern {
+    fn parse(line: &[u8]) -> Option<Self> {
+        let mut line = line.strip_suffix(b"\r").unwrap_or(line);
+        if line.is_empty() || line[0] == b'#' {
+            return None;
+        }
+        // Trailing spaces are ignored unless escaped.
+        while line.ends_with(b" ") && !line.ends_with(b"\\ ") {
+            line = &line[..line.len() - 1];
+        }
+        let negated = line.first() == Some(&b'!');
+        if negated || line.starts_with(b"\\!") || line.starts_with(b"\\#") {
+            line = &line[1..];
+        }
+        let dir_only = line.ends_with(b"/");
+        if dir_only {
+            line = &line[..line.len() - 1];
+        }
+        if line.is_empty() {
+            return None;
+        }
+        let anchored = line.contains(&b'/');
+        let glob = line.strip_prefix(b"/").unwrap_or(line).to_vec();
+        Some(Self {
+            glob,
+            negated,
+            dir_only,
+            anchored,
+        })
+    }
+
+    /// Whether the pattern applies to `path`, given relative to the
+    /// directory of the ignore file that holds the pattern.
+    fn matches(&self, path: &[u8], is_dir: bool) -> bool {
+        if self.dir_only && !is_dir {
+            return false;
+        }
+        if self.anchored {
+            wildmatch(&self.glob, path)
+        } else {
+            let name = path.rsplit(|&b| b == b'/').next().unwrap_or(path);
+            wildmatch(&self.glob, name)
+        }
+    }
+}
+
+/// Parses the contents of an ignore file.
+pub fn parse(text: &[u8]) -> Vec<Pattern> {
+    text.split(|&b| b == b'\n')
+        .filter_map(Pattern::parse)
+        .collect()
+}
+
+/// The patterns of one ignore file.
+pub type Patterns = Arc<Vec<Pattern>>;
+
+/// Parsed ignore files keyed by path, reused while their modification time
+/// and size are unchanged.
+#[derive(Default)]
+pub struct IgnoreCache {
+    files: HashMap<PathBuf, (Option<SystemTime>, u64, Patterns)>,
+}
+
+impl IgnoreCache {
+    /// Patterns of the ignore file at `path`; empty when it does not exist.
+    pub fn load(&mut self, path: &Path) -> Patterns {
+        let Ok(meta) = fs::metadata(path) else {
+            self.files.remove(path);
+            return Arc::default();
+        };
+        let mtime = meta.modified().ok();
+        if let Some((cached_mtime, size, patterns)) = self.files.get(path) {
+            if *cached_mtime == mtime && *size == meta.len() {
+                return Arc::clone(patterns);
+            }
+        }
+        let patterns = Arc::new(fs::read(path).map(|text| parse(&text)).unwrap_or_default());
+        self.files.insert(
+            path.to_path_buf(),
+            (mtime, meta.len(), Arc::clone(&patterns)),
+        );
+        patterns
+    }
+}
+
+/// The ignore files in effect for the directory being walked, outermost
+/// first.
+#[derive(Default)]
+pub struct IgnoreStack {
+    levels: Vec<(String, Patterns)>,
+}
+
+impl IgnoreStack {
+    /// Adds the patterns of an ignore file in directory `base` (a
+    /// repository-relative path, `""` for the top level).
+    pub fn push(&mut self, base: &str, patterns: Patterns) {
+        self.levels.push((base.to_owned(), patterns));
+    }
+
+    pub fn pop(&mut self) {
+        self.levels.pop();
+    }
+
+    /// Whether the repository-relative `path` is ignored.
+    #[must_use]
+    pub fn is_ignored(&self, path: &str, is_dir: bool) -> bool {
+        for (base, patterns) in self.levels.iter().rev() {
+            let relative = if base.is_empty() {
+                path
+            } else {
+                match path
+                    .strip_prefix(base.as_str())
+                    .and_then(|rest| rest.strip_prefix('/'))
+                {
+                    Some(rest) => rest,
+                    None => continue,
+                }
+            };
+            if let Some(pattern) = patterns
+                .iter()
+                .rev()
+                .find(|p| p.matches(relative.as_bytes(), is_dir))
+            {
+                return !pattern.negated;
+            }
+        }
+        false
+    }
+}
+
+/// Matches `text` against a glob in which wildcards do not cross `/`,
+/// except for `**` as a whole path segment.
+fn wildmatch(glob: &[u8], text: &[u8]) -> bool {
+    let Some(&first) = glob.first() else {
+        return text.is_empty();
+    };
+    match first {
+        b'*' if glob.get(1) == Some(&b'*') => {
+            let rest = &glob[2..];
+            if rest.is_empty() {
+                // Trailing `**` matches everything below.
+                return true;
+            }
+            if let Some(rest) = rest.strip_prefix(b"/") {
+                // `**/` matches zero or more whole directories.
+                if wildmatch(rest, text) {
+                    return true;
+                }
+                return text
+                    .iter()
+                    .enumerate()
+                    .any(|(i, &b)| b == b'/' && wildmatch(rest, &text[i + 1..]));
+            }
+            // Anywhere else `**` behaves like `*`.
+            wildmatch(&glob[1..], text)
+        }
+        b'*' => {
+            let rest = &glob[1..];
+            for i in 0..=text.len() {
+                if wildmatch(rest, &text[i..]) {
+                    return true;
+                }
+                if i < text.len() && text[i] == b'/' {
+                    break;
+                }
+            }
+            false
+        }
+        b'?' => matches!(text.first(), Some(&b) if b != b'/') && wildmatch(&glob[1..], &text[1..]),
+        b'[' => match (text.first(), class(&glob[1..])) {
+            (Some(&b), Some((set, used))) if b != b'/' && set(b) => {
+                wildmatch(&glob[1 + used..], &text[1..])
+            }
+            (_, Some(_)) => false,
+            // An unterminated class is a literal `[`.
+            (_, None) => text.first() == Some(&b'[') && wildmatch(&glob[1..], &text[1..]),
+        },
+        b'\\' if glob.len() > 1 => {
+            text.first() == Some(&glob[1]) && wildmatch(&glob[2..], &text[1..])
+        }
+        _ => text.first() == Some(&first) && wildmatch(&glob[1..], &text[1..]),
+    }
+}
+
+/// Parses a bracket expression following `[`, returning a byte predicate
+/// and the number of glob bytes consumed including the closing `]`.
+fn class(glob: &[u8]) -> Option<(impl Fn(u8) -> bool, usize)> {
+    let mut i = 0;
+    let negated = matches!(glob.first(), Some(b'!' | b'^'));
+    if negated {
+        i += 1;
+    }
+    let mut ranges = Vec::<(u8, u8)>::new();
+    let mut named = Vec::<fn(&u8) -> bool>::new();
+    let mut first = true;
+    loop {
+        let &c = glob.get(i)?;
+        if c == b']' && !first {
+            break;
+        }
+        first = false;
+        if c == b'[' && glob.get(i + 1) == Some(&b':') {
+            let end = glob[i + 2..].windows(2).position(|w| w == b":]")?;
+            named.push(match &glob[i + 2..i + 2 + end] {
+                b"alnum" => u8::is_ascii_alphanumeric,
+                b"alpha" => u8::is_ascii_alphabetic,
+                b"digit" => u8::is_ascii_digit,
+                b"lower" => u8::is_ascii_lowercase,
+                b"upper" => u8::is_ascii_uppercase,
+                b"space" => u8::is_ascii_whitespace,
+                b"punct" => u8::is_ascii_punctuation,
+                b"xdigit" => u8::is_ascii_hexdigit,
+                _ => return None,
+            });
+            i += end + 4;
+            continue;
+        }
+        let low = if c == b'\\' {
+            i += 1;
+            *glob.get(i)?
+        } else {
+            c
+        };
+        i += 1;
+        if glob.get(i) == Some(&b'-') && glob.get(i + 1).is_some_and(|&b| b != b']') {
+            let mut high = glob[i + 1];
+            i += 2;
+            if high == b'\\' {
+                high = *glob.get(i)?;
+                i += 1;
+            }
+            ranges.push((low, high));
+        } else {
+            ranges.push((low, low));
+        }
+    }
+    let matcher = move |b: u8| {
+        let hit = ranges.iter().any(|&(low, high)| (low..=high).contains(&b))
+            || named.iter().any(|f| f(&b));
+        hit != negated
+    };
+    Some((matcher, i + 1))
+}
@@ -0,0 +1,156 @@
+//! Parser for the git index (`.git/index`), versions 2 to 4.
+
+use super::odb::{Oid, Sha1};
+use super::Unsupported;
+use anyhow::{bail, Context, Result};
+
+/// Cached stat data of an index entry, truncated to 32 bits as git stores
+/// it.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct StatData {
+    pub ctime: (u32, u32),
+    pub mtime: (u32, u32),
+    pub ino: u32,
+    pub size: u32,
+}
+
+/// One index entry.
+#[derive(Clone, Debug)]
+pub struct Entry {
+    pub path: String,
+    pub mode: u32,
+    pub oid: Oid,
+    pub stat: StatData,
+    /// Merge stage: 0 normally, 1-3 for unresolved conflicts.
+    pub stage: u8,
+    /// Sparse checkout: the file is intentionally absent from the worktree.
+    pub skip_worktree: bool,
+    /// Added with `git add -N`: tracked, but not staged yet.
+    pub intent_to_add: bool,
+}
+
+/// Parses an index file. Optional extensions are skipped; required ones
+/// (lower-case signatures: the split index `link` and the sparse index
+/// `sdir`) change what the entries mean and fail with [`Unsupported`].
+pub fn parse(data: &[u8]) -> Result<Vec<Entry>> {
+    if data.len() < 12 + 20 || &data[..4] != b"DIRC" {
+        bail!("Not a git index");
+    }
+    let (body, checksum) = data.split_at(data.len() - 20);
+    let mut sha = Sha1::new();
+    sha.update(body);
+    // A zero checksum means the index was written with index.skipHash.
+    if checksum != sha.finish() && checksum.iter().any(|&b| b != 0) {
+        bail!("Index checksum mismatch");
+    }
+
+    let version = be32(data, 4);
+    if !(2..=4).contains(&version) {
+        bail!(Unsupported(format!("index version {version}")));
+    }
+    let count = be32(data, 8) as usize;
+    // Every entry takes at least 62 bytes; a corrupt count must not
+    // reserve more than the file can hold.
+    let mut entries = Vec::with_capacity(count.min(body.len() / 62));
+    let mut pos = 12;
+    let mut previous = Vec::<u8>::new();
+
+    for _ in 0..count {
+        let offset = pos;
+        let field = |i: usize| be32(body, offset + i * 4);
+        if offset + 62 > body.len() {
+            bail!("Truncated index");
+        }
+        let stat = StatData {
+            ctime: (field(0), field(1)),
+            mtime: (field(2), field(3)),
+            ino: field(5),
+            size: field(9),
+        };
+        let mode = field(6);
+        let mut oid = [0u8; 20];
+        oid.copy_from_slice(&body[offset + 40..offset + 60]);
+        let flags = u16::from_be_bytes([body[offset + 60], body[offset + 61]]);
+        pos = offset + 62;
+        let mut extended = 0u16;
+        if flags & 0x4000 != 0 {
+            if version < 3 {
+                bail!("Extended index flags in a version 2 index");
+            }
+            let bytes = body.get(pos..pos + 2).context("Truncated index")?;
+            extended = u16::from_be_bytes([bytes[0], bytes[1]]);
+            pos += 2;
+        }
+
+        let path = if version == 4 {
+            // The path is the previous one with `strip` bytes removed from
+            // its end, followed by a NUL-terminated suffix.
+            let rest = body.get(pos..).context("Truncated index")?;
+            let (strip, used) = varint(rest).context("Truncated index")?;
+            pos += used;
+            let nul = body[pos..]
+                .iter()
+                .position(|&b| b == 0)
+                .context("Truncated index")?;
+            let keep = previous
+                .len()
+                .checked_sub(strip)
+                .context("Corrupt index path")?;
+            previous.truncate(keep);
+            previous.extend_from_slice(&body[pos..pos + nul]);
+            pos += nul + 1;
+            previous.clone()
+        } else {
+            let nul = body
+                .get(pos..)
+                .context("Truncated index")?
+                .iter()
+                .position(|&b| b == 0)
+                .context("Truncated index")?;
+            let path = body[pos..pos + nul].to_vec();
+            // Entries are NUL-padded to a multiple of eight bytes.
+            pos = offset + (pos - offset + nul + 8) / 8 * 8;
+            path
+        };
+
+        entries.push(Entry {
+            path: String::from_utf8_lossy(&path).into_owned(),
+            mode,
+            oid,
+            stat,
+            stage: u8::try_from((flags >> 12) & 3).unwrap_or(0),
+            skip_worktree: extended & 0x4000 != 0,
+            intent_to_add: extended & 0x2000 != 0,
+        });
+    }
+
+    // Each extension is a four-byte signature and a 32-bit size.
+    while let Some(signature) = pos.checked_add(8).and_then(|end| body.get(pos..end)) {
+        if signature[0].is_ascii_lowercase() {
+            bail!(Unsupported(match &signature[..4] {
+                b"link" => "split index".to_owned(),
+                b"sdir" => "sparse index".to_owned(),
+                other => format!("index extension {}", String::from_utf8_lossy(other)),
+            }));
+        }
+        pos = pos.saturating_add(8 + be32(signature, 4) as usize);
+    }
+    Ok(entries)
+}
+
+/// Offset-encoded integer of index v4 path compression.
+fn varint(bytes: &[u8]) -> Option<(usize, usize)> {
+    let mut value = usize::from(*bytes.first()? & 0x7f);
+    let mut used = 1;
+    let mut byte = bytes[0];
+    while byte & 0x80 != 0 {
+        byte = *bytes.get(used)?;
+        used += 1;
+        value = value.checked_add(1)?.checked_mul(128)? | usize::from(byte & 0x7f);
+    }
+    Some((value, used))
+}
+
+fn be32(bytes: &[u8], at: usize) -> u32 {
+    u32::from_be_bytes([bytes[at], bytes[at + 1], bytes[at + 2], bytes[at + 3]])
+}
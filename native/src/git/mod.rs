@@ -0,0 +1,770 @@
+//! `git status` without spawning git.
+//!
+//! Reads the repository directly: the index, `HEAD` and the objects of its
+//! tree, and the worktree. Nothing is written back; in particular the index
+//! is not refreshed the way `git status` does. Instead a [`StatusCache`]
+//! kept between calls remembers parsed files, the content ids of files
+//! whose stat data no longer matches the index, and optionally directory
+//! listings for the untracked scan.
+//!
+//! Not supported: clean/smudge filters and `core.autocrlf` (content is
+//! hashed as stored on disk), submodule contents (gitlinks are reported
+//! clean), rename detection, and object alternates. Split and sparse
+//! indexes fail with [`Unsupported`], for which callers report
+//! [`unsupported_json`] so that the Dart side runs git instead.
+
+pub mod ignore;
+pub mod index;
+pub mod odb;
+
+use anyhow::{anyhow, bail, Context, Result};
+use ignore::{IgnoreCache, IgnoreStack};
+use index::{Entry, StatData};
+use odb::{Kind, ObjectDb, Oid, TreeFiles};
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::fmt::Write;
+use std::fs::{self, Metadata};
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// How untracked files are reported, as `git status -u<mode>`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Untracked {
+    /// Not reported.
+    No,
+    /// Files, with wholly untracked directories collapsed into `dir/`.
+    Normal,
+    /// Every untracked file.
+    All,
+}
+
+/// Options of a status query.
+#[derive(Clone, Copy, Debug)]
+pub struct StatusOptions {
+    pub untracked: Untracked,
+    /// Reuse directory listings whose directory mtime did not change since
+    /// the previous call, skipping `readdir` for unchanged directories.
+    pub untracked_cache: bool,
+}
+
+impl Default for StatusOptions {
+    fn default() -> Self {
+        Self {
+            untracked: Untracked::Normal,
+            untracked_cache: false,
+        }
+    }
+}
+
+/// Status of one path, using the `XY` codes of `git status --porcelain`:
+/// `' '`, `M`odified, `A`dded, `D`eleted, `T`ype changed, `U`nmerged and
+/// `?` for untracked.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct FileStatus {
+    pub path: String,
+    pub index: char,
+    pub worktree: char,
+}
+
+/// Result of [`status`].
+#[derive(Clone, Debug, Default)]
+pub struct Status {
+    /// Checked-out branch; `None` when `HEAD` is detached.
+    pub branch: Option<String>,
+    /// Commit `HEAD` points to; `None` on an unborn branch.
+    pub head: Option<Oid>,
+    /// Changed paths, sorted, relative to the queried directory.
+    pub entries: Vec<FileStatus>,
+}
+
+impl Status {
+    /// Serializes the status as
+    /// `{"branch":..,"head":..,"entries":[{"path":..,"index":..,"worktree":..}]}`.
+    #[must_use]
+    pub fn to_json(&self) -> String {
+        let mut out = String::from("{\"branch\":");
+        match &self.branch {
+            Some(branch) => json_string(&mut out, branch),
+            None => out.push_str("null"),
+        }
+        out.push_str(",\"head\":");
+        match &self.head {
+            Some(head) => json_string(&mut out, &odb::to_hex(head)),
+            None => out.push_str("null"),
+        }
+        out.push_str(",\"entries\":[");
+        for (i, entry) in self.entries.iter().enumerate() {
+            if i > 0 {
+                out.push(',');
+            }
+            out.push_str("{\"path\":");
+            json_string(&mut out, &entry.path);
+            out.push_str(",\"index\":");
+            json_string(&mut out, entry.index.encode_utf8(&mut [0; 4]));
+            out.push_str(",\"worktree\":");
+            json_string(&mut out, entry.worktree.encode_utf8(&mut [0; 4]));
+            out.push('}');
+        }
+        out.push_str("]}");
+        out
+    }
+}
+
+/// A repository layout this reader cannot interpret correctly, as opposed
+/// to a corrupt or missing repository.
+#[derive(Debug)]
+pub struct Unsupported(pub String);
+
+impl std::fmt::Display for Unsupported {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "Unsupported repository feature: {}", self.0)
+    }
+}
+
+impl std::error::Error for Unsupported {}
+
+/// `{"unsupported":"<feature>"}` when `error` comes from [`Unsupported`],
+/// reported in place of a status so that the caller can ask git itself.
+#[must_use]
+pub fn unsupported_json(error: &anyhow::Error) -> Option<String> {
+    let feature = &error.downcast_ref::<Unsupported>()?.0;
+    let mut out = String::from("{\"unsupported\":");
+    json_string(&mut out, feature);
+    out.push('}');
+    Some(out)
+}
+
+pub(crate) fn json_string(out: &mut String, value: &str) {
+    out.push('"');
+    for c in value.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            '\n' => out.push_str("\\n"),
+            '\r' => out.push_str("\\r"),
+            '\t' => out.push_str("\\t"),
+            c if u32::from(c) < 0x20 => {
+                let _ = write!(out, "\\u{:04x}", u32::from(c));
+            }
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+}
+
+/// State reused between [`status`] calls on the same repository.
+#[derive(Default)]
+pub struct StatusCache {
+    /// Parsed index, valid while the index file's stat data is unchanged.
+    index: Option<(FileStat, Arc<Vec<Entry>>)>,
+    /// Flattened tree of the last `HEAD` commit.
+    head_tree: Option<(Oid, Arc<TreeFiles>)>,
+    /// Content ids of worktree files hashed earlier, by path.
+    hashes: HashMap<PathBuf, (FileStat, Oid)>,
+    ignores: IgnoreCache,
+    /// Directory listings for the untracked cache.
+    dirs: HashMap<PathBuf, (SystemTime, Listing)>,
+}
+
+/// Names in a directory, with whether each is a directory.
+type Listing = Arc<Vec<(String, bool)>>;
+
+/// Full-precision stat data used to validate cached results.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+struct FileStat {
+    mtime: (u64, u32),
+    ctime: (u64, u32),
+    ino: u64,
+    size: u64,
+}
+
+impl FileStat {
+    fn of(meta: &Metadata) -> Self {
+        let mtime = timestamp(meta.modified().ok());
+        #[cfg(unix)]
+        let (ctime, ino) = {
+            use std::os::unix::fs::MetadataExt;
+            let ctime = (
+                u64::try_from(meta.ctime()).unwrap_or(0),
+                u32::try_from(meta.ctime_nsec()).unwrap_or(0),
+            );
+            (ctime, meta.ino())
+        };
+        #[cfg(not(unix))]
+        let (ctime, ino) = (mtime, 0);
+        Self {
+            mtime,
+            ctime,
+            ino,
+            size: meta.len(),
+        }
+    }
+
+    /// Whether the index entry's stat data still describes this file.
+    #[allow(clippy::cast_possible_truncation)]
+    fn matches(&self, cached: &StatData) -> bool {
+        let same_time = |(secs, nanos): (u64, u32), (cached_secs, cached_nanos): (u32, u32)| {
+            secs as u32 == cached_secs && (cached_nanos == 0 || nanos == cached_nanos)
+        };
+        same_time(self.mtime, cached.mtime)
+            && (cfg!(not(unix)) || same_time(self.ctime, cached.ctime))
+            && (cached.ino == 0 || self.ino as u32 == cached.ino)
+            && self.size as u32 == cached.size
+    }
+}
+
+fn timestamp(time: Option<SystemTime>) -> (u64, u32) {
+    time.and_then(|t| t.duration_since(UNIX_EPOCH).ok())
+        .map_or((0, 0), |d| (d.as_secs(), d.subsec_nanos()))
+}
+
+/// Locations of a repository's files.
+struct Repo {
+    /// Top-level directory of the worktree.
+    top: PathBuf,
+    /// `.git` directory of this worktree.
+    git_dir: PathBuf,
+    /// Directory holding objects and shared refs (differs from `git_dir`
+    /// in linked worktrees).
+    common_dir: PathBuf,
+}
+
+/// Finds the repository containing `start` and the `/`-separated path of
+/// `start` relative to its top level (`""` at the top).
+fn discover(start: &Path) -> Result<(Repo, String)> {
+    let start =
+        fs::canonicalize(start).with_context(|| format!("Cannot access {}", start.display()))?;
+    let mut dir = start.as_path();
+    loop {
+        let dot_git = dir.join(".git");
+        let git_dir = if dot_git.is_dir() {
+            Some(dot_git)
+        } else if let Ok(text) = fs::read_to_string(&dot_git) {
+            let target = text
+                .strip_prefix("gitdir:")
+                .ok_or_else(|| anyhow!("Invalid .git file in {}", dir.display()))?
+                .trim();
+            Some(dir.join(target))
+        } else {
+            None
+        };
+        if let Some(git_dir) = git_dir {
+            let common_dir = fs::read_to_string(git_dir.join("commondir"))
+                .map_or_else(|_| git_dir.clone(), |common| git_dir.join(common.trim()));
+            let prefix = start
+                .strip_prefix(dir)
+                .unwrap_or(Path::new(""))
+                .components()
+                .map(|c| c.as_os_str().to_string_lossy())
+                .collect::<Vec<_>>()
+                .join("/");
+            let repo = Repo {
+                top: dir.to_path_buf(),
+                git_dir,
+                common_dir,
+            };
+            return Ok((repo, prefix));
+        }
+        dir = dir
+            .parent()
+            .ok_or_else(|| anyhow!("Not a git repository: {}", start.display()))?;
+    }
+}
+
+impl Repo {
+    /// Resolves `HEAD` to the checked-out branch and commit.
+    fn head(&self) -> Result<(Option<String>, Option<Oid>)> {
+        let mut target =
+            fs::read_to_string(self.git_dir.join("HEAD")).context("Cannot read HEAD")?;
+        let mut branch = None;
+        for _ in 0..5 {
+            let value = target.trim();
+            let Some(name) = value.strip_prefix("ref:") else {
+                let oid =
+                    odb::from_hex(value).ok_or_else(|| anyhow!("Invalid ref value {value:?}"))?;
+                return Ok((branch, Some(oid)));
+            };
+            let name = name.trim().to_owned();
+            if branch.is_none() {
+                branch = Some(name.strip_prefix("refs/heads/").unwrap_or(&name).to_owned());
+            }
+            match self.read_ref(&name) {
+                Some(next) => target = next,
+                // An unborn branch.
+                None => return Ok((branch, None)),
+            }
+        }
+        bail!("Symbolic ref loop at HEAD")
+    }
+
+    fn read_ref(&self, name: &str) -> Option<String> {
+        for dir in [&self.git_dir, &self.common_dir] {
+            if let Ok(value) = fs::read_to_string(dir.join(name)) {
+                return Some(value);
+            }
+        }
+        let packed = fs::read_to_string(self.common_dir.join("packed-refs")).ok()?;
+        packed.lines().find_map(|line| {
+            let (oid, ref_name) = line.split_once(' ')?;
+            (ref_name == name && !line.starts_with('#')).then(|| oid.to_owned())
+        })
+    }
+
+    /// Whether `core.fileMode` is on (the default): the last value set in a
+    /// `[core]` section of the repository config. Includes are not
+    /// followed.
+    fn file_mode(&self) -> bool {
+        let Ok(config) = fs::read_to_string(self.common_dir.join("config")) else {
+            return true;
+        };
+        let mut in_core = false;
+        let mut file_mode = true;
+        for line in config.lines() {
+            let mut line = line.trim();
+            if let Some(header) = line.strip_prefix('[') {
+                let Some((section, rest)) = header.split_once(']') else {
+                    continue;
+                };
+                // `[core "name"]` is a subsection, not `[core]`.
+                in_core = section.trim().eq_ignore_ascii_case("core");
+                line = rest.trim();
+            }
+            if !in_core {
+                continue;
+            }
+            let line = line.split(['#', ';']).next().unwrap_or_default();
+            let (key, value) = line.split_once('=').unwrap_or((line, "true"));
+            if !key.trim().eq_ignore_ascii_case("filemode") {
+                continue;
+            }
+            match value.trim().trim_matches('"').to_ascii_lowercase().as_str() {
+                "false" | "no" | "off" | "0" => file_mode = false,
+                "true" | "yes" | "on" | "1" | "" => file_mode = true,
+                _ => {}
+            }
+        }
+        file_mode
+    }
+}
+
+impl StatusCache {
+    fn index(&mut self, path: &Path) -> Result<Arc<Vec<Entry>>> {
+        let Ok(meta) = fs::metadata(path) else {
+            // A repository without commits or staged files has no index yet.
+            return Ok(Arc::default());
+        };
+        let stat = FileStat::of(&meta);
+        if let Some((cached, entries)) = &self.index {
+            if *cached == stat {
+                return Ok(Arc::clone(entries));
+            }
+        }
+        let data = fs::read(path).context("Cannot read the index")?;
+        let entries = Arc::new(index::parse(&data)?);
+        self.index = Some((stat, Arc::clone(&entries)));
+        Ok(entries)
+    }
+
+    fn head_tree(&mut self, repo: &Repo, head: Option<Oid>) -> Result<Arc<TreeFiles>> {
+        let Some(commit) = head else {
+            return Ok(Arc::default());
+        };
+        if let Some((cached, tree)) = &self.head_tree {
+            if *cached == commit {
+                return Ok(Arc::clone(tree));
+            }
+        }
+        let db = ObjectDb::open(&repo.common_dir.join("objects"))?;
+        let (kind, data) = db.read(&commit)?;
+        if kind != Kind::Commit {
+            bail!("HEAD does not point to a commit");
+        }
+        let tree = std::str::from_utf8(&data)
+            .ok()
+            .and_then(|text| text.strip_prefix("tree "))
+            .and_then(|text| odb::from_hex(text.get(..40)?))
+            .ok_or_else(|| anyhow!("Corrupt commit {}", odb::to_hex(&commit)))?;
+        let files = Arc::new(odb::flatten_tree(&db, &tree)?);
+        self.head_tree = Some((commit, Arc::clone(&files)));
+        Ok(files)
+    }
+
+    /// Content id of the worktree file at `path`, reusing an earlier hash
+    /// while the file's stat data is unchanged.
+    fn content_id(&mut self, path: &Path, meta: &Metadata) -> Result<Oid> {
+        let stat = FileStat::of(meta);
+        if let Some((cached, oid)) = self.hashes.get(path) {
+            if *cached == stat {
+                return Ok(*oid);
+            }
+        }
+        let started = timestamp(Some(SystemTime::now()));
+        let content = if meta.file_type().is_symlink() {
+            link_target(path)?
+        } else {
+            fs::read(path).with_context(|| format!("Cannot read {}", path.display()))?
+        };
+        let oid = odb::blob_id(&content);
+        // A file modified within the same clock tick as the hash could
+        // change again without its mtime moving, so only older files are
+        // remembered.
+        if stat.mtime < started {
+            self.hashes.insert(path.to_path_buf(), (stat, oid));
+        }
+        Ok(oid)
+    }
+
+    fn list_dir(&mut self, dir: &Path, use_cache: bool) -> Listing {
+        let mtime = fs::metadata(dir).and_then(|m| m.modified()).ok();
+        if use_cache {
+            if let (Some(mtime), Some((cached, entries))) = (mtime, self.dirs.get(dir)) {
+                if *cached == mtime {
+                    return Arc::clone(entries);
+                }
+            }
+        }
+        let started = SystemTime::now();
+        let mut entries = Vec::new();
+        if let Ok(read) = fs::read_dir(dir) {
+            for entry in read.flatten() {
+                let is_dir = entry.file_type().is_ok_and(|t| t.is_dir());
+                entries.push((entry.file_name().to_string_lossy().into_owned(), is_dir));
+            }
+        }
+        let entries = Arc::new(entries);
+        match mtime {
+            // As with hashes, a listing taken in the same tick as the last
+            // change is not trusted later.
+            Some(mtime) if use_cache && mtime < started => {
+                self.dirs
+                    .insert(dir.to_path_buf(), (mtime, Arc::clone(&entries)));
+            }
+            _ => {
+                self.dirs.remove(dir);
+            }
+        }
+        entries
+    }
+}
+
+#[cfg(unix)]
+fn link_target(path: &Path) -> Result<Vec<u8>> {
+    use std::os::unix::ffi::OsStrExt;
+    Ok(fs::read_link(path)?.as_os_str().as_bytes().to_vec())
+}
+
+#[cfg(not(unix))]
+fn link_target(path: &Path) -> Result<Vec<u8>> {
+    Ok(fs::read_link(path)?
+        .to_string_lossy()
+        .replace('\\', "/")
+        .into_bytes())
+}
+
+const TYPE_MASK: u32 = 0o170_000;
+const REGULAR: u32 = 0o100_000;
+const SYMLINK: u32 = 0o120_000;
+const GITLINK: u32 = 0o160_000;
+
+/// Computes the status of the repository containing `dir`, limited to the
+/// files below `dir`.
+pub fn status(dir: &Path, options: StatusOptions, cache: &mut StatusCache) -> Result<Status> {
+    let (repo, prefix) = discover(dir)?;
+    let (branch, head) = repo.head()?;
+    let index_path = repo.git_dir.join("index");
+    let index_mtime = fs::metadata(&index_path)
+        .map(|m| timestamp(m.modified().ok()))
+        .unwrap_or_default();
+    let entries = cache.index(&index_path)?;
+    let head_tree = cache.head_tree(&repo, head)?;
+    let file_mode = repo.file_mode();
+
+    let in_scope = |path: &str| {
+        prefix.is_empty()
+            || path
+                .strip_prefix(prefix.as_str())
+                .is_some_and(|rest| rest.starts_with('/'))
+    };
+    let mut changes = BTreeMap::<String, (char, char)>::new();
+
+    // Unmerged paths: stages present per path.
+    let mut conflicts = BTreeMap::<&str, u8>::new();
+    for entry in entries.iter().filter(|e| e.stage > 0 && in_scope(&e.path)) {
+        *conflicts.entry(&entry.path).or_default() |= 1 << (entry.stage - 1);
+    }
+    for (&path, &stages) in &conflicts {
+        changes.insert(path.to_owned(), conflict_code(stages));
+    }
+
+    for entry in entries.iter().filter(|e| e.stage == 0 && in_scope(&e.path)) {
+        let staged = if entry.intent_to_add {
+            ' '
+        } else {
+            match head_tree.get(&entry.path) {
+                None => 'A',
+                Some(&(mode, _)) if mode & TYPE_MASK != entry.mode & TYPE_MASK => 'T',
+                Some(&(mode, oid)) if oid != entry.oid || mode != entry.mode => 'M',
+                Some(_) => ' ',
+            }
+        };
+        let worktree = if entry.intent_to_add {
+            'A'
+        } else if entry.skip_worktree || entry.mode & TYPE_MASK == GITLINK {
+            ' '
+        } else {
+            worktree_change(
+                &repo.top.join(&entry.path),
+                entry,
+                index_mtime,
+                file_mode,
+                cache,
+            )?
+        };
+        if staged != ' ' || worktree != ' ' {
+            changes.insert(entry.path.clone(), (staged, worktree));
+        }
+    }
+
+    let indexed: HashSet<&str> = entries.iter().map(|e| e.path.as_str()).collect();
+    for path in head_tree.keys() {
+        if !indexed.contains(path.as_str()) && in_scope(path) {
+            changes.insert(path.clone(), ('D', ' '));
+        }
+    }
+
+    // A path deleted from the index but still on disk is listed twice, as
+    // git does.
+    let untracked = if options.untracked == Untracked::No {
+        Vec::new()
+    } else {
+        untracked_files(&repo, &prefix, &indexed, options, cache)
+    };
+
+    let strip = if prefix.is_empty() {
+        0
+    } else {
+        prefix.len() + 1
+    };
+    let mut entries: Vec<FileStatus> = changes
+        .into_iter()
+        .chain(untracked.into_iter().map(|path| (path, ('?', '?'))))
+        .map(|(path, (index, worktree))| FileStatus {
+            path: path[strip..].to_owned(),
+            index,
+            worktree,
+        })
+        .collect();
+    entries.sort_by(|a, b| a.path.cmp(&b.path));
+    Ok(Status {
+        branch,
+        head,
+        entries,
+    })
+}
+
+/// Porcelain code of an unmerged path from the set of stages present
+/// (bit 0: common ancestor, bit 1: ours, bit 2: theirs).
+fn conflict_code(stages: u8) -> (char, char) {
+    match stages {
+        0b001 => ('D', 'D'),
+        0b010 => ('A', 'U'),
+        0b011 => ('U', 'D'),
+        0b100 => ('U', 'A'),
+        0b101 => ('D', 'U'),
+        0b110 => ('A', 'A'),
+        _ => ('U', 'U'),
+    }
+}
+
+/// Untracked, not ignored paths below `prefix`.
+fn untracked_files(
+    repo: &Repo,
+    prefix: &str,
+    indexed: &HashSet<&str>,
+    options: StatusOptions,
+    cache: &mut StatusCache,
+) -> Vec<String> {
+    let mut tracked_dirs = HashSet::new();
+    for path in indexed {
+        let mut path = *path;
+        while let Some((parent, _)) = path.rsplit_once('/') {
+            if !tracked_dirs.insert(parent) {
+                break;
+            }
+            path = parent;
+        }
+    }
+
+    let mut stack = IgnoreStack::default();
+    if let Some(global) = global_excludes() {
+        stack.push("", cache.ignores.load(&global));
+    }
+    stack.push(
+        "",
+        cache
+            .ignores
+            .load(&repo.common_dir.join("info").join("exclude")),
+    );
+    // Ignore files of the directories above the queried one.
+    let mut ancestor = String::new();
+    for part in prefix.split('/').filter(|p| !p.is_empty()) {
+        stack.push(
+            &ancestor,
+            cache
+                .ignores
+                .load(&repo.top.join(&ancestor).join(".gitignore")),
+        );
+        ancestor = join(&ancestor, part);
+    }
+
+    let mut walker = Walker {
+        top: &repo.top,
+        tracked_files: indexed,
+        tracked_dirs: &tracked_dirs,
+        options,
+        cache,
+        found: Vec::new(),
+    };
+    walker.walk(prefix, &mut stack);
+    walker.found
+}
+
+/// Worktree status of a stage 0 entry against the file at `path`.
+fn worktree_change(
+    path: &Path,
+    entry: &Entry,
+    index_mtime: (u64, u32),
+    file_mode: bool,
+    cache: &mut StatusCache,
+) -> Result<char> {
+    let Ok(meta) = fs::symlink_metadata(path) else {
+        return Ok('D');
+    };
+    let kind = if meta.file_type().is_symlink() {
+        SYMLINK
+    } else if meta.is_file() {
+        REGULAR
+    } else {
+        return Ok('D');
+    };
+    if kind != entry.mode & TYPE_MASK {
+        return Ok('T');
+    }
+    if kind == REGULAR && file_mode && is_executable(&meta) != (entry.mode & 0o111 != 0) {
+        return Ok('M');
+    }
+
+    let stat = FileStat::of(&meta);
+    // A zero size in the index can also mean git "smudged" a racily clean
+    // entry, so only a non-zero mismatch proves a change.
+    #[allow(clippy::cast_possible_truncation)]
+    if entry.stat.size != 0 && stat.size as u32 != entry.stat.size {
+        return Ok('M');
+    }
+    // Entries modified in the same tick the index was written are racy:
+    // their stat data cannot prove the content unchanged.
+    let entry_mtime = (u64::from(entry.stat.mtime.0), entry.stat.mtime.1);
+    let racy = if entry.stat.mtime.1 == 0 {
+        entry_mtime.0 >= index_mtime.0
+    } else {
+        entry_mtime >= index_mtime
+    };
+    if stat.matches(&entry.stat) && !racy {
+        return Ok(' ');
+    }
+    let oid = cache.content_id(path, &meta)?;
+    Ok(if oid == entry.oid { ' ' } else { 'M' })
+}
+
+#[cfg(unix)]
+fn is_executable(meta: &Metadata) -> bool {
+    use std::os::unix::fs::PermissionsExt;
+    meta.permissions().mode() & 0o111 != 0
+}
+
+#[cfg(not(unix))]
+fn is_executable(_meta: &Metadata) -> bool {
+    false
+}
+
+/// The default `core.excludesFile`.
+fn global_excludes() -> Option<PathBuf> {
+    let config = std::env::var_os("XDG_CONFIG_HOME")
+        .filter(|v| !v.is_empty())
+        .map(PathBuf::from)
+        .or_else(|| std::env::var_os("HOME").map(|home| Path::new(&home).join(".config")))?;
+    Some(config.join("git").join("ignore"))
+}
+
+fn join(dir: &str, name: &str) -> String {
+    if dir.is_empty() {
+        name.to_owned()
+    } else {
+        format!("{dir}/{name}")
+    }
+}
+
+/// Scan for untracked files.
+struct Walker<'a> {
+    top: &'a Path,
+    tracked_files: &'a HashSet<&'a str>,
+    tracked_dirs: &'a HashSet<&'a str>,
+    options: StatusOptions,
+    cache: &'a mut StatusCache,
+    found: Vec<String>,
+}
+
+impl Walker<'_> {
+    fn walk(&mut self, dir: &str, stack: &mut IgnoreStack) {
+        let abs = self.top.join(dir);
+        stack.push(dir, self.cache.ignores.load(&abs.join(".gitignore")));
+        for (name, is_dir) in self
+            .cache
+            .list_dir(&abs, self.options.untracked_cache)
+            .iter()
+        {
+            if name == ".git" {
+                continue;
+            }
+            let path = join(dir, name);
+            if !is_dir {
+                if !self.tracked_files.contains(path.as_str()) && !stack.is_ignored(&path, false) {
+                    self.found.push(path);
+                }
+            } else if self.tracked_files.contains(path.as_str()) || stack.is_ignored(&path, true) {
+                // A gitlink, or a directory git never descends into.
+            } else if self.tracked_dirs.contains(path.as_str())
+                || self.options.untracked == Untracked::All
+            {
+                if self.top.join(&path).join(".git").exists()
+                    && !self.tracked_dirs.contains(path.as_str())
+                {
+                    // A nested repository is reported as a whole.
+                    self.found.push(format!("{path}/"));
+                } else {
+                    self.walk(&path, stack);
+                }
+            } else if self.has_untracked(&path, stack) {
+                self.found.push(format!("{path}/"));
+            }
+        }
+        stack.pop();
+    }
+
+    /// Whether an untracked directory holds anything that is not ignored.
+    fn has_untracked(&mut self, dir: &str, stack: &mut IgnoreStack) -> bool {
+        let abs = self.top.join(dir);
+        if abs.join(".git").exists() {
+            return true;
+        }
+        stack.push(dir, self.cache.ignores.load(&abs.join(".gitignore")));
+        let listing = self.cache.list_dir(&abs, self.options.untracked_cache);
+        let found = listing.iter().any(|(name, is_dir)| {
+            let path = join(dir, name);
+            !stack.is_ignored(&path, *is_dir) && (!is_dir || self.has_untracked(&path, stack))
+        });
+        stack.pop();
+        found
+    }
+}
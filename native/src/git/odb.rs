@@ -0,0 +1,499 @@
+//! Read-only access to a git object database: loose objects and packs.
+//!
+//! Only what status needs is implemented: reading commits and trees
+//! (resolving pack deltas) and hashing blobs. Alternates and
+//! multi-pack-index files are not consulted; packs are found through their
+//! `.idx` files.
+
+use anyhow::{anyhow, bail, Context, Result};
+use flate2::bufread::ZlibDecoder;
+use std::collections::HashMap;
+use std::fs::{self, File};
+use std::io::{BufReader, Read, Seek, SeekFrom};
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+
+/// A SHA-1 object id.
+pub type Oid = [u8; 20];
+
+/// Object kinds as numbered in pack files.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Kind {
+    Commit,
+    Tree,
+    Blob,
+    Tag,
+}
+
+impl Kind {
+    fn from_pack(ty: u8) -> Option<Self> {
+        match ty {
+            1 => Some(Self::Commit),
+            2 => Some(Self::Tree),
+            3 => Some(Self::Blob),
+            4 => Some(Self::Tag),
+            _ => None,
+        }
+    }
+
+    fn from_name(name: &[u8]) -> Option<Self> {
+        match name {
+            b"commit" => Some(Self::Commit),
+            b"tree" => Some(Self::Tree),
+            b"blob" => Some(Self::Blob),
+            b"tag" => Some(Self::Tag),
+            _ => None,
+        }
+    }
+}
+
+/// Formats an object id as 40 lowercase hex digits.
+#[must_use]
+pub fn to_hex(oid: &Oid) -> String {
+    use std::fmt::Write;
+    oid.iter().fold(String::with_capacity(40), |mut s, b| {
+        let _ = write!(s, "{b:02x}");
+        s
+    })
+}
+
+/// Parses 40 hex digits into an object id.
+#[must_use]
+pub fn from_hex(hex: &str) -> Option<Oid> {
+    let hex = hex.as_bytes();
+    if hex.len() != 40 {
+        return None;
+    }
+    let mut oid = [0u8; 20];
+    for (i, pair) in hex.chunks(2).enumerate() {
+        let digit = |c: u8| (c as char).to_digit(16);
+        oid[i] = u8::try_from(digit(pair[0])? * 16 + digit(pair[1])?).ok()?;
+    }
+    Some(oid)
+}
+
+/// Id of a blob with the given content, as `git hash-object` computes it.
+#[must_use]
+pub fn blob_id(content: &[u8]) -> Oid {
+    let mut sha = Sha1::new();
+    sha.update(format!("blob {}\0", content.len()).as_bytes());
+    sha.update(content);
+    sha.finish()
+}
+
+/// Objects of one repository.
+pub struct ObjectDb {
+    objects: PathBuf,
+    packs: Vec<Pack>,
+}
+
+impl ObjectDb {
+    /// Opens `<git-common-dir>/objects`.
+    pub fn open(objects: &Path) -> Result<Self> {
+        let mut packs = Vec::new();
+        if let Ok(entries) = fs::read_dir(objects.join("pack")) {
+            for entry in entries.flatten() {
+                let path = entry.path();
+                if path.extension().is_some_and(|e| e == "idx") {
+                    packs.push(Pack::open(&path)?);
+                }
+            }
+        }
+        Ok(Self {
+            objects: objects.to_path_buf(),
+            packs,
+        })
+    }
+
+    /// Reads an object, resolving deltas.
+    pub fn read(&self, oid: &Oid) -> Result<(Kind, Vec<u8>)> {
+        self.read_object(oid, 0)
+    }
+
+    /// Reads an object that is the base of `depth` deltas.
+    fn read_object(&self, oid: &Oid, depth: usize) -> Result<(Kind, Vec<u8>)> {
+        let hex = to_hex(oid);
+        let loose = self.objects.join(&hex[..2]).join(&hex[2..]);
+        if let Ok(file) = File::open(&loose) {
+            let mut data = Vec::new();
+            ZlibDecoder::new(BufReader::new(file))
+                .read_to_end(&mut data)
+                .with_context(|| format!("Corrupt loose object {hex}"))?;
+            let nul = data
+                .iter()
+                .position(|&b| b == 0)
+                .ok_or_else(|| anyhow!("Corrupt loose object {hex}"))?;
+            let kind = data[..nul]
+                .split(|&b| b == b' ')
+                .next()
+                .and_then(Kind::from_name)
+                .ok_or_else(|| anyhow!("Unknown object type in {hex}"))?;
+            return Ok((kind, data.split_off(nul + 1)));
+        }
+        for pack in &self.packs {
+            if let Some(offset) = pack.find(oid)? {
+                return pack.read_at(offset, self, depth);
+            }
+        }
+        bail!("Object {hex} not found")
+    }
+}
+
+/// A pack file and its version 2 index.
+struct Pack {
+    index: Vec<u8>,
+    count: usize,
+    data: Mutex<BufReader<File>>,
+}
+
+impl Pack {
+    fn open(idx: &Path) -> Result<Self> {
+        let index = fs::read(idx).with_context(|| format!("Cannot read {}", idx.display()))?;
+        if index.len() < 8 + 256 * 4 || index[..8] != [0xff, b't', b'O', b'c', 0, 0, 0, 2] {
+            bail!("Unsupported pack index {}", idx.display());
+        }
+        let count = be32(&index, 8 + 255 * 4)? as usize;
+        let pack = idx.with_extension("pack");
+        let data = File::open(&pack).with_context(|| format!("Cannot open {}", pack.display()))?;
+        Ok(Self {
+            index,
+            count,
+            data: Mutex::new(BufReader::new(data)),
+        })
+    }
+
+    fn find(&self, oid: &Oid) -> Result<Option<u64>> {
+        let fanout = |i: usize| be32(&self.index, 8 + i * 4).map(|n| n as usize);
+        let first = usize::from(oid[0]);
+        let mut lo = if first == 0 { 0 } else { fanout(first - 1)? };
+        let mut hi = fanout(first)?;
+        let names = 8 + 256 * 4;
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            let name = self
+                .index
+                .get(names + mid * 20..names + mid * 20 + 20)
+                .ok_or_else(|| anyhow!("Truncated pack index"))?;
+            match name.cmp(oid.as_slice()) {
+                std::cmp::Ordering::Less => lo = mid + 1,
+                std::cmp::Ordering::Greater => hi = mid,
+                std::cmp::Ordering::Equal => return self.offset(mid).map(Some),
+            }
+        }
+        Ok(None)
+    }
+
+    fn offset(&self, i: usize) -> Result<u64> {
+        let offsets = 8 + 256 * 4 + self.count * 24;
+        let small = be32(&self.index, offsets + i * 4)?;
+        if small & 0x8000_0000 == 0 {
+            return Ok(u64::from(small));
+        }
+        let large = offsets + self.count * 4 + (small & 0x7fff_ffff) as usize * 8;
+        Ok((u64::from(be32(&self.index, large)?) << 32) | u64::from(be32(&self.index, large + 4)?))
+    }
+
+    fn read_at(&self, offset: u64, db: &ObjectDb, depth: usize) -> Result<(Kind, Vec<u8>)> {
+        if depth > MAX_DELTA_DEPTH {
+            bail!("Pack delta chain too long");
+        }
+        let (ty, body, base) = {
+            let mut data = self
+                .data
+                .lock()
+                .unwrap_or_else(std::sync::PoisonError::into_inner);
+            data.seek(SeekFrom::Start(offset))?;
+            let mut byte = read_u8(&mut *data)?;
+            let ty = (byte >> 4) & 7;
+            let mut size = u64::from(byte & 15);
+            let mut shift = 4;
+            while byte & 0x80 != 0 {
+                if shift > 57 {
+                    bail!("Corrupt pack entry size");
+                }
+                byte = read_u8(&mut *data)?;
+                size |= u64::from(byte & 0x7f) << shift;
+                shift += 7;
+            }
+            let base = match ty {
+                6 => {
+                    byte = read_u8(&mut *data)?;
+                    let mut back = u64::from(byte & 0x7f);
+                    while byte & 0x80 != 0 {
+                        byte = read_u8(&mut *data)?;
+                        back = back
+                            .checked_add(1)
+                            .and_then(|n| n.checked_mul(128))
+                            .ok_or_else(|| anyhow!("Corrupt pack delta offset"))?
+                            | u64::from(byte & 0x7f);
+                    }
+                    // A base lies before its delta; anything else is corrupt
+                    // and could otherwise loop back onto this entry.
+                    let at = offset
+                        .checked_sub(back)
+                        .filter(|_| back > 0)
+                        .ok_or_else(|| anyhow!("Corrupt pack delta offset"))?;
+                    Some(Base::Offset(at))
+                }
+                7 => {
+                    let mut oid = [0u8; 20];
+                    data.read_exact(&mut oid)?;
+                    Some(Base::Id(oid))
+                }
+                _ => None,
+            };
+            let mut inflated =
+                Vec::with_capacity(usize::try_from(size).unwrap_or(0).min(MAX_PREALLOC));
+            ZlibDecoder::new(&mut *data)
+                .take(size)
+                .read_to_end(&mut inflated)
+                .context("Corrupt pack entry")?;
+            (ty, inflated, base)
+        };
+
+        match base {
+            None => {
+                let kind = Kind::from_pack(ty).ok_or_else(|| anyhow!("Bad pack type {ty}"))?;
+                Ok((kind, body))
+            }
+            Some(base) => {
+                let (kind, source) = match base {
+                    Base::Offset(at) => self.read_at(at, db, depth + 1)?,
+                    Base::Id(oid) => db.read_object(&oid, depth + 1)?,
+                };
+                Ok((kind, apply_delta(&source, &body)?))
+            }
+        }
+    }
+}
+
+/// Longest delta chain followed; git itself never writes more than 4095.
+/// Bounds the recursion for packs whose deltas form a cycle.
+const MAX_DELTA_DEPTH: usize = 4096;
+
+/// Most bytes reserved up front from a size read out of a pack, so that a
+/// corrupt size fails while reading instead of aborting the allocation.
+const MAX_PREALLOC: usize = 64 << 20;
+
+enum Base {
+    Offset(u64),
+    Id(Oid),
+}
+
+fn read_u8(r: &mut impl Read) -> Result<u8> {
+    let mut b = [0u8; 1];
+    r.read_exact(&mut b)?;
+    Ok(b[0])
+}
+
+fn be32(bytes: &[u8], at: usize) -> Result<u32> {
+    let word = bytes
+        .get(at..at + 4)
+        .ok_or_else(|| anyhow!("Truncated pack index"))?;
+    Ok(u32::from_be_bytes([word[0], word[1], word[2], word[3]]))
+}
+
+/// Applies a git delta to `source`.
+fn apply_delta(source: &[u8], delta: &[u8]) -> Result<Vec<u8>> {
+    let mut pos = 0;
+    let mut varint = || -> Result<usize> {
+        let mut value = 0usize;
+        let mut shift = 0;
+        loop {
+            if shift >= usize::BITS {
+                bail!("Corrupt delta size");
+            }
+            let byte = *delta.get(pos).ok_or_else(|| anyhow!("Truncated delta"))?;
+            pos += 1;
+            value |= usize::from(byte & 0x7f) << shift;
+            shift += 7;
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+        }
+    };
+    let source_len = varint()?;
+    let target_len = varint()?;
+    if source_len != source.len() {
+        bail!("Delta base size mismatch");
+    }
+
+    let mut out = Vec::with_capacity(target_len.min(MAX_PREALLOC));
+    while pos < delta.len() {
+        let op = delta[pos];
+        pos += 1;
+        if op & 0x80 != 0 {
+            let mut field = |bits: u8, bytes: u32| -> Result<usize> {
+                let mut value = 0usize;
+                for i in 0..bytes {
+                    if bits & (1 << i) != 0 {
+                        let byte = *delta.get(pos).ok_or_else(|| anyhow!("Truncated delta"))?;
+                        pos += 1;
+                        value |= usize::from(byte) << (8 * i);
+                    }
+                }
+                Ok(value)
+            };
+            let start = field(op, 4)?;
+            let len = match field(op >> 4, 3)? {
+                0 => 0x10000,
+                n => n,
+            };
+            let chunk = source
+                .get(start..start + len)
+                .ok_or_else(|| anyhow!("Delta copy out of range"))?;
+            out.extend_from_slice(chunk);
+        } else if op != 0 {
+            let len = usize::from(op);
+            let chunk = delta
+                .get(pos..pos + len)
+                .ok_or_else(|| anyhow!("Truncated delta"))?;
+            out.extend_from_slice(chunk);
+            pos += len;
+        } else {
+            bail!("Invalid delta opcode");
+        }
+    }
+    if out.len() != target_len {
+        bail!("Delta result size mismatch");
+    }
+    Ok(out)
+}
+
+/// Files of a tree by `/`-separated path, as `(mode, id)`.
+pub type TreeFiles = HashMap<String, (u32, Oid)>;
+
+/// Reads a tree and all subtrees into their non-tree entries.
+pub fn flatten_tree(db: &ObjectDb, tree: &Oid) -> Result<TreeFiles> {
+    let mut files = HashMap::new();
+    walk_tree(db, tree, "", &mut files)?;
+    Ok(files)
+}
+
+fn walk_tree(db: &ObjectDb, tree: &Oid, prefix: &str, out: &mut TreeFiles) -> Result<()> {
+    let (kind, data) = db.read(tree)?;
+    if kind != Kind::Tree {
+        bail!("{} is not a tree", to_hex(tree));
+    }
+    let mut rest = data.as_slice();
+    while !rest.is_empty() {
+        let nul = rest.iter().position(|&b| b == 0).context("Corrupt tree")?;
+        let space = rest[..nul]
+            .iter()
+            .position(|&b| b == b' ')
+            .context("Corrupt tree")?;
+        let mode = u32::from_str_radix(std::str::from_utf8(&rest[..space])?, 8)?;
+        let name = String::from_utf8_lossy(&rest[space + 1..nul]);
+        let mut oid = [0u8; 20];
+        oid.copy_from_slice(rest.get(nul + 1..nul + 21).context("Corrupt tree")?);
+        rest = &rest[nul + 21..];
+
+        let path = if prefix.is_empty() {
+            name.into_owned()
+        } else {
+            format!("{prefix}/{name}")
+        };
+        if mode == 0o40000 {
+            walk_tree(db, &oid, &path, out)?;
+        } else {
+            out.insert(path, (mode, oid));
+        }
+    }
+    Ok(())
+}
+
+/// Minimal SHA-1, used only to compute object ids.
+pub struct Sha1 {
+    state: [u32; 5],
+    block: [u8; 64],
+    filled: usize,
+    length: u64,
+}
+
+impl Default for Sha1 {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Sha1 {
+    #[must_use]
+    pub fn new() -> Self {
+        Self {
+            state: [
+                0x6745_2301,
+                0xEFCD_AB89,
+                0x98BA_DCFE,
+                0x1032_5476,
+                0xC3D2_E1F0,
+            ],
+            block: [0; 64],
+            filled: 0,
+            length: 0,
+        }
+    }
+
+    pub fn update(&mut self, mut data: &[u8]) {
+        self.length += data.len() as u64;
+        while !data.is_empty() {
+            let take = (64 - self.filled).min(data.len());
+            self.block[self.filled..self.filled + take].copy_from_slice(&data[..take]);
+            self.filled += take;
+            data = &data[take..];
+            if self.filled == 64 {
+                let block = self.block;
+                self.compress(&block);
+                self.filled = 0;
+            }
+        }
+    }
+
+    #[must_use]
+    pub fn finish(mut self) -> Oid {
+        let bits = self.length * 8;
+        self.update(&[0x80]);
+        while self.filled != 56 {
+            self.update(&[0]);
+        }
+        self.update(&bits.to_be_bytes());
+        let mut out = [0u8; 20];
+        for (chunk, word) in out.chunks_mut(4).zip(self.state) {
+            chunk.copy_from_slice(&word.to_be_bytes());
+        }
+        out
+    }
+
+    #[allow(clippy::many_single_char_names)]
+    fn compress(&mut self, block: &[u8; 64]) {
+        let mut w = [0u32; 80];
+        for (i, chunk) in block.chunks(4).enumerate() {
+            w[i] = u32::from_be_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]);
+        }
+        for i in 16..80 {
+            w[i] = (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]).rotate_left(1);
+        }
+        let [mut a, mut b, mut c, mut d, mut e] = self.state;
+        for (i, word) in w.iter().enumerate() {
+            let (f, k) = match i {
+                0..=19 => ((b & c) | (!b & d), 0x5A82_7999),
+                20..=39 => (b ^ c ^ d, 0x6ED9_EBA1),
+                40..=59 => ((b & c) | (b & d) | (c & d), 0x8F1B_BCDC),
+                _ => (b ^ c ^ d, 0xCA62_C1D6),
+            };
+            let t = a
+                .rotate_left(5)
+                .wrapping_add(f)
+                .wrapping_add(e)
+                .wrapping_add(k)
+                .wrapping_add(*word);
+            e = d;
+            d = c;
+            c = b.rotate_left(30);
+            b = a;
+            a = t;
+        }
+        for (s, v) in self.state.iter_mut().zip([a, b, c, d, e]) {
+            *s = s.wrapping_add(v);
+        }
+    }
+}
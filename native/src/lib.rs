@@ -0,0 +1,27 @@
+//! Isolation core of the `workspace_sandbox` launcher.
+//!
+//! Built both as the `workspace_launcher` binary (see `main.rs`) and as a
+//! C-ABI shared library (see [`ffi`]) that the Dart package can load to
+//! spawn sandboxed commands without an intermediate launcher process.
+
+#![warn(clippy::all, clippy::pedantic)]
+#![allow(clippy::missing_errors_doc, clippy::missing_panics_doc)]
+
+pub mod cache;
+pub mod cli;
+pub mod engine;
+#[cfg(unix)]
+pub mod ffi;
+pub mod git;
+#[cfg(target_os = "linux")]
+pub mod netns;
+pub mod normalize;
+pub mod priority;
+#[cfg(unix)]
+pub mod relay;
+#[cfg(target_os = "linux")]
+pub mod sample;
+pub mod strategies;
+pub mod supervise;
+#[cfg(target_os = "linux")]
+pub mod trace;
@@ -7,73 +7,99 @@
 #![warn(clippy::all, clippy::pedantic)]
 #![allow(clippy::missing_errors_doc, clippy::missing_panics_doc)]
 
-mod engine;
-mod strategies;
-
-use crate::engine::Engine;
-use crate::strategies::base::ExecutionContext;
 use clap::Parser;
+use std::path::Path;
 use std::process;
+use workspace_launcher::cli::Args;
+use workspace_launcher::engine::Engine;
+use workspace_launcher::git;
+#[cfg(target_os = "linux")]
+use workspace_launcher::netns;
+#[cfg(unix)]
+use workspace_launcher::relay;
+#[cfg(target_os = "linux")]
+use workspace_launcher::trace;
+
+fn main() {
+    let args = Args::parse();
 
-#[derive(Parser, Debug)]
-#[command(
-    name = "workspace_launcher",
-    version,
-    about = "Native isolation launcher for workspace_sandbox",
-    long_about = "Executes commands in isolated environments using platform-specific sandboxing"
-)]
-struct Args {
-    #[arg(long)]
-    id: String,
-
-    #[arg(long)]
-    workspace: String,
-
-    #[arg(long)]
-    sandbox: bool,
-
-    #[arg(long)]
-    no_net: bool,
-
-    #[arg(long)]
-    cwd: Option<String>,
-
-    #[arg(long, value_parser = parse_key_val)]
-    env: Vec<(String, String)>,
-
-    #[arg(last = true)]
-    command: Vec<String>,
-}
-
-fn parse_key_val(s: &str) -> Result<(String, String), String> {
-    let pos = s
-        .find('=')
-        .ok_or_else(|| format!("Invalid KEY=value format: no '=' found in `{s}`"))?;
-    Ok((s[..pos].to_string(), s[pos + 1..].to_string()))
-}
+    // Namespace holders unshare their user namespace, which the kernel only
+    // permits while the process is single-threaded, so this runs before any
+    // thread is started.
+    if args.netns_holder {
+        #[cfg(target_os = "linux")]
+        process::exit(netns::run_holder());
+        #[cfg(not(target_os = "linux"))]
+        {
+            eprintln!("[Launcher] ERROR: Network namespace pooling requires Linux");
+            process::exit(98);
+        }
+    }
 
-#[tokio::main]
-async fn main() {
-    let args = Args::parse();
+    if args.git_status {
+        let options = git::StatusOptions {
+            untracked: args.git_untracked.unwrap_or(git::Untracked::Normal),
+            untracked_cache: false,
+        };
+        let root = args.workspace.unwrap_or_default();
+        match git::status(Path::new(&root), options, &mut git::StatusCache::default()) {
+            Ok(status) => {
+                println!("{}", status.to_json());
+                process::exit(0);
+            }
+            Err(e) => {
+                if let Some(json) = git::unsupported_json(&e) {
+                    println!("{json}");
+                    process::exit(0);
+                }
+                eprintln!("[Launcher] ERROR: {e:#}");
+                process::exit(98);
+            }
+        }
+    }
 
     if args.command.is_empty() {
         eprintln!("[Launcher] ERROR: No command provided");
         process::exit(98);
     }
 
-    let ctx = ExecutionContext {
-        id: args.id,
-        root_path: args.workspace,
-        cmd: args.command[0].clone(),
-        args: args.command[1..].to_vec(),
-        env_vars: args.env.into_iter().collect(),
-        cwd: args.cwd,
-        allow_network: !args.no_net,
-    };
+    if !args.relay.is_empty() {
+        #[cfg(unix)]
+        match relay::run(&args.relay, &args.command) {
+            Ok(code) => process::exit(code),
+            Err(e) => {
+                eprintln!("[Launcher] FATAL ERROR: {e:#}");
+                process::exit(99);
+            }
+        }
+        #[cfg(not(unix))]
+        {
+            eprintln!("[Launcher] ERROR: Loopback relays require a unix platform");
+            process::exit(98);
+        }
+    }
+
+    if args.trace_exec {
+        #[cfg(target_os = "linux")]
+        {
+            let e = trace::exec(&args.command);
+            eprintln!("[Launcher] FATAL ERROR: {e:#}");
+            process::exit(99);
+        }
+        #[cfg(not(target_os = "linux"))]
+        {
+            eprintln!("[Launcher] ERROR: File-access tracing requires Linux");
+            process::exit(98);
+        }
+    }
+
+    let sandbox = args.sandbox;
+    let light = args.light;
+    let ctx = args.into_context();
 
-    let engine = Engine::new(args.sandbox);
+    let engine = Engine::new(sandbox, light);
 
-    match engine.run(ctx).await {
+    match engine.run(&ctx) {
         Ok(code) => process::exit(code),
         Err(e) => {
             eprintln!("[Launcher] FATAL ERROR: {e:#}");
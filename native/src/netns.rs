@@ -0,0 +1,168 @@
+//! Pre-created, loopback-only network namespaces for no-network execs.
+//!
+//! Creating and destroying a network namespace per command is one of the
+//! slowest parts of sandbox startup and serializes on a kernel lock under
+//! load. A *holder* process owns a user + network namespace pair with only
+//! `lo` up and stays alive until its stdin closes; sandboxed commands then
+//! join that namespace instead of unsharing a fresh one.
+//!
+//! Holder protocol (line based, driven by the Dart pool):
+//! - holder prints `ready` once the namespace is usable
+//! - `reset` on stdin re-asserts the loopback state and prints `ready`, or
+//!   prints `busy` if a process other than the holder is still inside (the
+//!   pool then retires the holder rather than hand out a namespace whose
+//!   listeners a previous command left behind)
+//! - EOF on stdin terminates the holder and releases the namespace
+
+use anyhow::{anyhow, Context, Result};
+use std::ffi::CString;
+use std::fs;
+use std::io::{self, BufRead, Write};
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd};
+use std::os::unix::fs::MetadataExt;
+
+/// Namespace file descriptors of a pooled holder, opened by the launcher
+/// before forking so the child can join them without allocating.
+pub struct PooledNetns {
+    user: OwnedFd,
+    net: OwnedFd,
+}
+
+impl PooledNetns {
+    /// Opens the user and network namespaces of the holder process `pid`.
+    pub fn open(pid: u32) -> Result<Self> {
+        Ok(PooledNetns {
+            user: open_ns(pid, "user")?,
+            net: open_ns(pid, "net")?,
+        })
+    }
+
+    /// Moves the calling process into the pooled namespaces.
+    ///
+    /// Must run in a single-threaded process (e.g. a `pre_exec` hook); the
+    /// user namespace is joined first so the caller gains the capabilities
+    /// needed to enter the network namespace it owns.
+    pub fn enter(&self) -> io::Result<()> {
+        unsafe {
+            if libc::setns(self.user.as_raw_fd(), libc::CLONE_NEWUSER) != 0
+                || libc::setns(self.net.as_raw_fd(), libc::CLONE_NEWNET) != 0
+            {
+                return Err(io::Error::last_os_error());
+            }
+        }
+        Ok(())
+    }
+}
+
+fn open_ns(pid: u32, kind: &str) -> Result<OwnedFd> {
+    let path = CString::new(format!("/proc/{pid}/ns/{kind}"))?;
+    let fd = unsafe { libc::open(path.as_ptr(), libc::O_RDONLY | libc::O_CLOEXEC) };
+    if fd < 0 {
+        return Err(anyhow!(
+            "Cannot open {kind} namespace of holder {pid}: {}",
+            io::Error::last_os_error()
+        ));
+    }
+    Ok(unsafe { OwnedFd::from_raw_fd(fd) })
+}
+
+/// Runs the holder loop. Must be called before any threads are started.
+#[must_use]
+pub fn run_holder() -> i32 {
+    match hold() {
+        Ok(()) => 0,
+        Err(e) => {
+            eprintln!("[Launcher] netns holder failed: {e:#}");
+            97
+        }
+    }
+}
+
+fn hold() -> Result<()> {
+    let uid = unsafe { libc::geteuid() };
+    let gid = unsafe { libc::getegid() };
+
+    if unsafe { libc::unshare(libc::CLONE_NEWUSER | libc::CLONE_NEWNET) } != 0 {
+        return Err(anyhow!("unshare failed: {}", io::Error::last_os_error()));
+    }
+
+    // Identity mapping keeps file ownership unchanged for processes that
+    // join the namespace; setgroups must be denied before writing gid_map.
+    fs::write("/proc/self/setgroups", "deny").context("setgroups")?;
+    fs::write("/proc/self/uid_map", format!("{uid} {uid} 1")).context("uid_map")?;
+    fs::write("/proc/self/gid_map", format!("{gid} {gid} 1")).context("gid_map")?;
+
+    loopback_up()?;
+
+    let stdin = io::stdin();
+    let mut stdout = io::stdout();
+    writeln!(stdout, "ready")?;
+    stdout.flush()?;
+
+    for line in stdin.lock().lines() {
+        if line?.trim() == "reset" {
+            let reply = if occupied()? {
+                "busy"
+            } else {
+                loopback_up()?;
+                "ready"
+            };
+            writeln!(stdout, "{reply}")?;
+            stdout.flush()?;
+        }
+    }
+    Ok(())
+}
+
+/// Whether any process besides the holder is in its network namespace.
+///
+/// Processes we may not inspect are skipped: joining the namespace needs
+/// capabilities in the holder's user namespace, which only our uid has.
+fn occupied() -> Result<bool> {
+    let own = fs::metadata("/proc/self/ns/net").context("own namespace")?;
+    let me = std::process::id();
+    for entry in fs::read_dir("/proc").context("/proc")? {
+        let Some(pid) = entry?
+            .file_name()
+            .to_str()
+            .and_then(|n| n.parse::<u32>().ok())
+        else {
+            continue;
+        };
+        if pid == me {
+            continue;
+        }
+        if let Ok(ns) = fs::metadata(format!("/proc/{pid}/ns/net")) {
+            if ns.dev() == own.dev() && ns.ino() == own.ino() {
+                return Ok(true);
+            }
+        }
+    }
+    Ok(false)
+}
+
+/// Brings `lo` up in the current network namespace.
+fn loopback_up() -> Result<()> {
+    let sock = unsafe { libc::socket(libc::AF_INET, libc::SOCK_DGRAM | libc::SOCK_CLOEXEC, 0) };
+    if sock < 0 {
+        return Err(anyhow!("socket failed: {}", io::Error::last_os_error()));
+    }
+    let sock = unsafe { OwnedFd::from_raw_fd(sock) };
+
+    let mut req: libc::ifreq = unsafe { std::mem::zeroed() };
+    for (dst, src) in req.ifr_name.iter_mut().zip(b"lo\0") {
+        *dst = libc::c_char::try_from(*src).unwrap_or(0);
+    }
+
+    unsafe {
+        if libc::ioctl(sock.as_raw_fd(), libc::SIOCGIFFLAGS, &mut req) != 0 {
+            return Err(anyhow!("SIOCGIFFLAGS: {}", io::Error::last_os_error()));
+        }
+        let up = libc::c_short::try_from(libc::IFF_UP).unwrap_or(1);
+        req.ifr_ifru.ifru_flags |= up;
+        if libc::ioctl(sock.as_raw_fd(), libc::SIOCSIFFLAGS, &req) != 0 {
+            return Err(anyhow!("SIOCSIFFLAGS: {}", io::Error::last_os_error()));
+        }
+    }
+    Ok(())
+}
@@ -0,0 +1,231 @@
+//! Output normalization applied before child output reaches the caller.
+//!
+//! Progress bars and colored output are mostly redraws: every `\r` frame
+//! and escape sequence would otherwise become its own chunk on the Dart
+//! side. [`Normalizer`] filters a stream incrementally, in this order:
+//! - ANSI escape sequences (CSI, OSC and two-byte escapes) are dropped
+//! - text overwritten by a carriage return is dropped, keeping only what
+//!   the terminal would finally show on that line (`\r\n` still ends a
+//!   line)
+//! - runs of identical lines are emitted once, followed by a
+//!   `[previous line repeated N more times]` marker
+//!
+//! The last two stages work on whole lines, so partial lines are held
+//! until their newline, the end of the stream, or [`MAX_LINE`] bytes.
+
+/// Lines longer than this are emitted in pieces rather than buffered.
+pub const MAX_LINE: usize = 64 * 1024;
+
+const ESC: u8 = 0x1b;
+const BEL: u8 = 0x07;
+
+/// Which normalization stages to apply.
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(clippy::struct_excessive_bools)]
+pub struct OutputFilter {
+    pub strip_ansi: bool,
+    pub collapse_cr: bool,
+    pub fold_repeats: bool,
+}
+
+impl OutputFilter {
+    /// Whether any stage is enabled.
+    #[must_use]
+    pub fn is_active(self) -> bool {
+        self.strip_ansi || self.collapse_cr || self.fold_repeats
+    }
+
+    fn by_line(self) -> bool {
+        self.collapse_cr || self.fold_repeats
+    }
+}
+
+/// Bytes a stream carried before and after normalization.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ByteCounts {
+    pub raw: u64,
+    pub normalized: u64,
+}
+
+impl ByteCounts {
+    fn to_json(self) -> String {
+        format!(r#"{{"raw":{},"normalized":{}}}"#, self.raw, self.normalized)
+    }
+}
+
+/// Writes the stdout and stderr counts to `path` as
+/// `{"stdout":{"raw":N,"normalized":M},"stderr":{...}}`.
+pub fn write_stats(path: &str, [stdout, stderr]: [ByteCounts; 2]) -> std::io::Result<()> {
+    std::fs::write(
+        path,
+        format!(
+            r#"{{"stdout":{},"stderr":{}}}"#,
+            stdout.to_json(),
+            stderr.to_json()
+        ),
+    )
+}
+
+/// Position inside an escape sequence.
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Escape {
+    None,
+    /// After `ESC`.
+    Start,
+    /// Inside `ESC [ ...`, up to a final byte in `@`..`~`.
+    Csi,
+    /// Inside `ESC ] ...`, up to `BEL` or `ESC \`.
+    Osc,
+    /// `ESC` seen inside an OSC string.
+    OscEsc,
+}
+
+/// Incremental filter for one output stream.
+pub struct Normalizer {
+    filter: OutputFilter,
+    escape: Escape,
+    /// The line being assembled (line-based stages only).
+    line: Vec<u8>,
+    /// A `\r` was the last byte; what follows decides between a line
+    /// ending and an overwrite.
+    pending_cr: bool,
+    /// Last complete line emitted, with its terminator.
+    previous: Vec<u8>,
+    repeats: u64,
+    counts: ByteCounts,
+}
+
+impl Normalizer {
+    #[must_use]
+    pub fn new(filter: OutputFilter) -> Self {
+        Normalizer {
+            filter,
+            escape: Escape::None,
+            line: Vec::new(),
+            pending_cr: false,
+            previous: Vec::new(),
+            repeats: 0,
+            counts: ByteCounts::default(),
+        }
+    }
+
+    /// Byte counts so far.
+    #[must_use]
+    pub fn counts(&self) -> ByteCounts {
+        self.counts
+    }
+
+    /// Filters `data`, appending what can be emitted now to `out`.
+    pub fn push(&mut self, data: &[u8], out: &mut Vec<u8>) {
+        self.counts.raw += data.len() as u64;
+        let start = out.len();
+        if self.filter.is_active() {
+            for &byte in data {
+                if self.filter.strip_ansi && self.in_escape(byte) {
+                    continue;
+                }
+                if self.filter.by_line() {
+                    self.line_byte(byte, out);
+                } else {
+                    out.push(byte);
+                }
+            }
+        } else {
+            out.extend_from_slice(data);
+        }
+        self.counts.normalized += (out.len() - start) as u64;
+    }
+
+    /// Emits whatever is held back at the end of the stream.
+    pub fn finish(&mut self, out: &mut Vec<u8>) {
+        let start = out.len();
+        if self.pending_cr {
+            // A trailing `\r` overwrites nothing.
+            self.pending_cr = false;
+            self.line.push(b'\r');
+        }
+        if !self.line.is_empty() {
+            let line = std::mem::take(&mut self.line);
+            self.emit_line(&line, out);
+        }
+        self.flush_repeats(out);
+        self.counts.normalized += (out.len() - start) as u64;
+    }
+
+    /// Advances the escape-sequence state; `true` if `byte` is part of a
+    /// sequence and must be dropped.
+    #[allow(clippy::match_same_arms)]
+    fn in_escape(&mut self, byte: u8) -> bool {
+        self.escape = match (self.escape, byte) {
+            (Escape::None, ESC) => Escape::Start,
+            (Escape::None, _) => return false,
+            (Escape::Start, b'[') => Escape::Csi,
+            (Escape::Start, b']') => Escape::Osc,
+            // Intermediate bytes, then one final byte.
+            (Escape::Start, 0x20..=0x2f) => Escape::Start,
+            (Escape::Start, _) => Escape::None,
+            // Parameter and intermediate bytes, then one final byte.
+            (Escape::Csi, 0x20..=0x3f) => Escape::Csi,
+            (Escape::Csi, _) => Escape::None,
+            (Escape::Osc | Escape::OscEsc, BEL) | (Escape::OscEsc, b'\\') => Escape::None,
+            (Escape::Osc | Escape::OscEsc, ESC) => Escape::OscEsc,
+            (Escape::OscEsc, _) => Escape::Osc,
+            (state, _) => state,
+        };
+        true
+    }
+
+    fn line_byte(&mut self, byte: u8, out: &mut Vec<u8>) {
+        if self.pending_cr {
+            self.pending_cr = false;
+            if byte == b'\n' {
+                self.line.extend_from_slice(b"\r\n");
+                let line = std::mem::take(&mut self.line);
+                self.emit_line(&line, out);
+                return;
+            }
+            self.line.clear();
+        }
+        match byte {
+            b'\r' if self.filter.collapse_cr => self.pending_cr = true,
+            b'\n' => {
+                self.line.push(b'\n');
+                let line = std::mem::take(&mut self.line);
+                self.emit_line(&line, out);
+            }
+            _ => {
+                self.line.push(byte);
+                if self.line.len() >= MAX_LINE {
+                    self.flush_repeats(out);
+                    out.append(&mut self.line);
+                    self.previous.clear();
+                }
+            }
+        }
+    }
+
+    /// Emits a complete line (with its terminator, if any), folding it into
+    /// the previous one when identical.
+    fn emit_line(&mut self, line: &[u8], out: &mut Vec<u8>) {
+        if self.filter.fold_repeats && !self.previous.is_empty() && self.previous == line {
+            self.repeats += 1;
+            return;
+        }
+        self.flush_repeats(out);
+        out.extend_from_slice(line);
+        if self.filter.fold_repeats {
+            self.previous.clear();
+            self.previous.extend_from_slice(line);
+        }
+    }
+
+    fn flush_repeats(&mut self, out: &mut Vec<u8>) {
+        if self.repeats > 0 {
+            let times = if self.repeats == 1 { "time" } else { "times" };
+            out.extend_from_slice(
+                format!("[previous line repeated {} more {times}]\n", self.repeats).as_bytes(),
+            );
+            self.repeats = 0;
+        }
+    }
+}
@@ -0,0 +1,170 @@
+//! Scheduling settings for `--cpus`, `--nice`, `--sched` and
+//! `--io-priority`.
+//!
+//! They are applied to the child in a `pre_exec` hook, right before exec,
+//! and inherited by everything it starts: Bubblewrap and the sandboxed
+//! tree included. The hook only makes syscalls on data prepared by
+//! [`Priority::attach`], so it is safe in the forked child.
+//!
+//! Raising the nice level, `SCHED_BATCH`, `SCHED_IDLE` and the idle and
+//! best-effort I/O classes need no privileges; a negative nice level does.
+
+#[cfg(unix)]
+use anyhow::{anyhow, Result};
+#[cfg(unix)]
+use std::io;
+#[cfg(unix)]
+use std::os::unix::process::CommandExt;
+#[cfg(unix)]
+use std::process::Command;
+
+/// CPU scheduling policy replacing `SCHED_OTHER`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SchedPolicy {
+    /// `SCHED_BATCH`: never preempts interactive tasks on wakeup.
+    Batch,
+    /// `SCHED_IDLE`: runs only when nothing else wants the CPU.
+    Idle,
+}
+
+/// I/O scheduling class, as set by `ionice`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IoPriority {
+    /// Best-effort with a level from 0 (highest) to 7.
+    BestEffort(u8),
+    /// Disk time only when no other process asks for it.
+    Idle,
+}
+
+/// Everything the child should be scheduled with; the default changes
+/// nothing.
+#[derive(Debug, Clone, Default)]
+pub struct Priority {
+    /// CPUs the child may run on; empty keeps the launcher's own set.
+    pub cpus: Vec<usize>,
+    pub nice: Option<i32>,
+    pub policy: Option<SchedPolicy>,
+    pub io: Option<IoPriority>,
+}
+
+impl Priority {
+    /// Whether any setting differs from the launcher's own.
+    #[must_use]
+    pub fn is_set(&self) -> bool {
+        !self.cpus.is_empty() || self.nice.is_some() || self.policy.is_some() || self.io.is_some()
+    }
+
+    /// Registers a `pre_exec` hook applying the settings to `command`.
+    ///
+    /// CPUs outside the launcher's own affinity mask (e.g. its cgroup's
+    /// cpuset) are rejected here rather than failing the exec.
+    #[cfg(target_os = "linux")]
+    pub fn attach(&self, command: &mut Command) -> Result<()> {
+        if !self.is_set() {
+            return Ok(());
+        }
+        let cpus = if self.cpus.is_empty() {
+            None
+        } else {
+            Some(cpu_set(&self.cpus)?)
+        };
+        let policy = self.policy.map(|policy| match policy {
+            SchedPolicy::Batch => libc::SCHED_BATCH,
+            SchedPolicy::Idle => libc::SCHED_IDLE,
+        });
+        let nice = self.nice;
+        let io = self.io.map(|io| match io {
+            IoPriority::BestEffort(level) => {
+                IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT | i32::from(level)
+            }
+            IoPriority::Idle => IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT,
+        });
+        unsafe {
+            command.pre_exec(move || {
+                if let Some(set) = &cpus {
+                    check(libc::sched_setaffinity(
+                        0,
+                        std::mem::size_of::<libc::cpu_set_t>(),
+                        set,
+                    ))?;
+                }
+                // Before the nice level: the policy change keeps it.
+                if let Some(policy) = policy {
+                    let param = libc::sched_param { sched_priority: 0 };
+                    check(libc::sched_setscheduler(
+                        0,
+                        policy,
+                        std::ptr::addr_of!(param),
+                    ))?;
+                }
+                if let Some(nice) = nice {
+                    check(libc::setpriority(libc::PRIO_PROCESS, 0, nice))?;
+                }
+                if let Some(io) = io {
+                    let ret = libc::syscall(libc::SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, io);
+                    check(i32::try_from(ret).unwrap_or(-1))?;
+                }
+                Ok(())
+            });
+        }
+        Ok(())
+    }
+
+    /// Registers a `pre_exec` hook applying the nice level; the other
+    /// settings are Linux-only.
+    #[cfg(all(unix, not(target_os = "linux")))]
+    pub fn attach(&self, command: &mut Command) -> Result<()> {
+        if !self.cpus.is_empty() || self.policy.is_some() || self.io.is_some() {
+            return Err(anyhow!(
+                "CPU affinity, scheduling policy and I/O priority require Linux"
+            ));
+        }
+        if let Some(nice) = self.nice {
+            unsafe {
+                command.pre_exec(move || check(libc::setpriority(libc::PRIO_PROCESS, 0, nice)));
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(target_os = "linux")]
+const IOPRIO_WHO_PROCESS: libc::c_int = 1;
+#[cfg(target_os = "linux")]
+const IOPRIO_CLASS_SHIFT: i32 = 13;
+#[cfg(target_os = "linux")]
+const IOPRIO_CLASS_BE: i32 = 2;
+#[cfg(target_os = "linux")]
+const IOPRIO_CLASS_IDLE: i32 = 3;
+
+#[cfg(unix)]
+fn check(ret: libc::c_int) -> io::Result<()> {
+    if ret < 0 {
+        Err(io::Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+/// Builds the affinity mask for `cpus`, each of which must be in the
+/// launcher's own mask.
+#[cfg(target_os = "linux")]
+fn cpu_set(cpus: &[usize]) -> Result<libc::cpu_set_t> {
+    unsafe {
+        let mut allowed: libc::cpu_set_t = std::mem::zeroed();
+        check(libc::sched_getaffinity(
+            0,
+            std::mem::size_of::<libc::cpu_set_t>(),
+            std::ptr::addr_of_mut!(allowed),
+        ))
+        .map_err(|e| anyhow!("sched_getaffinity: {e}"))?;
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        for &cpu in cpus {
+            if cpu >= libc::CPU_SETSIZE as usize || !libc::CPU_ISSET(cpu, &allowed) {
+                return Err(anyhow!("CPU {cpu} is not available to the launcher"));
+            }
+            libc::CPU_SET(cpu, &mut set);
+        }
+        Ok(set)
+    }
+}
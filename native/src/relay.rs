@@ -0,0 +1,69 @@
+//! Loopback-to-unix-socket relay for services hosted outside the sandbox.
+//!
+//! A sandbox without network access has a private loopback interface, so a
+//! host service (such as the package mirror) listening on `127.0.0.1` is
+//! unreachable. The host service also listens on a unix socket that is
+//! bind-mounted into the sandbox; this relay runs *inside* the sandbox,
+//! accepts TCP connections on the same loopback port and pipes them to the
+//! socket, then supervises the real command.
+
+use crate::strategies::base::LoopbackForward;
+use anyhow::{anyhow, Context, Result};
+use std::io;
+use std::net::{Shutdown, TcpListener, TcpStream};
+use std::os::unix::net::UnixStream;
+use std::os::unix::process::ExitStatusExt;
+use std::process::Command;
+use std::thread;
+
+/// Starts the forwards, runs `cmd` with inherited stdio and returns its exit
+/// code. Listener threads die with the process.
+pub fn run(forwards: &[LoopbackForward], cmd: &[String]) -> Result<i32> {
+    for forward in forwards {
+        let listener = TcpListener::bind(("127.0.0.1", forward.port))
+            .with_context(|| format!("Cannot listen on loopback port {}", forward.port))?;
+        let socket = forward.socket.clone();
+        thread::spawn(move || accept_loop(&listener, &socket));
+    }
+
+    let (program, args) = cmd
+        .split_first()
+        .ok_or_else(|| anyhow!("No command provided to relay"))?;
+    let status = Command::new(program)
+        .args(args)
+        .status()
+        .with_context(|| format!("Relay failed to spawn {program}"))?;
+
+    if let Some(sig) = status.signal() {
+        return Ok(128 + sig);
+    }
+    Ok(status.code().unwrap_or(-1))
+}
+
+fn accept_loop(listener: &TcpListener, socket: &str) {
+    for conn in listener.incoming().flatten() {
+        let socket = socket.to_string();
+        thread::spawn(move || {
+            if let Ok(upstream) = UnixStream::connect(&socket) {
+                let _ = pipe(conn, upstream);
+            }
+        });
+    }
+}
+
+fn pipe(client: TcpStream, upstream: UnixStream) -> io::Result<()> {
+    let mut client_read = client.try_clone()?;
+    let mut upstream_write = upstream.try_clone()?;
+    let forward = thread::spawn(move || {
+        let _ = io::copy(&mut client_read, &mut upstream_write);
+        let _ = upstream_write.shutdown(Shutdown::Write);
+    });
+
+    let mut upstream_read = upstream;
+    let mut client_write = client;
+    let _ = io::copy(&mut upstream_read, &mut client_write);
+    let _ = client_write.shutdown(Shutdown::Write);
+
+    let _ = forward.join();
+    Ok(())
+}
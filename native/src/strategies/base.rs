@@ -1,23 +1,106 @@
 //! Core traits and types for isolation strategies.
 
+use crate::normalize::OutputFilter;
+use crate::priority::Priority;
 use anyhow::Result;
 use std::collections::HashMap;
 use std::process::Command;
+use std::time::Duration;
+
+/// A shared host cache directory made writable inside the sandbox.
+#[derive(Debug, Clone)]
+pub struct CacheDir {
+    pub path: String,
+    /// Whether commands using this cache must hold an exclusive lock.
+    pub exclusive: bool,
+    /// The only entries of `path` the sandbox may write, as absolute
+    /// paths; directories end in `/`. Empty makes all of `path` writable,
+    /// otherwise the rest of it is read-only.
+    pub writable: Vec<String>,
+}
+
+impl CacheDir {
+    /// The host paths a sandbox gets write access to, without trailing
+    /// slashes.
+    #[must_use]
+    pub fn writable_paths(&self) -> Vec<&str> {
+        if self.writable.is_empty() {
+            vec![self.path.as_str()]
+        } else {
+            self.writable
+                .iter()
+                .map(|entry| entry.trim_end_matches('/'))
+                .collect()
+        }
+    }
+}
+
+/// A host unix socket exposed as a TCP port on the sandbox loopback.
+#[derive(Debug, Clone)]
+pub struct LoopbackForward {
+    pub port: u16,
+    pub socket: String,
+}
+
+/// A file receiving one of the child's output streams.
+#[derive(Debug, Clone)]
+pub struct OutputFile {
+    pub path: String,
+    /// Append instead of truncating.
+    pub append: bool,
+    /// Also forward the stream to the launcher's own output.
+    pub tee: bool,
+}
+
+/// Where and how often to record resource samples of the command tree.
+#[derive(Debug, Clone)]
+pub struct SampleFile {
+    pub path: String,
+    pub interval: Duration,
+}
 
 #[derive(Debug)]
 pub struct ExecutionContext {
     #[allow(dead_code)]
     pub id: String,
-    
+
     pub root_path: String,
     pub cmd: String,
     pub args: Vec<String>,
     pub env_vars: HashMap<String, String>,
     pub cwd: Option<String>,
     pub allow_network: bool,
+    /// Holder process whose pooled network namespace should be joined
+    /// instead of creating a fresh one (Linux, no-network execs only).
+    pub netns_pid: Option<u32>,
+    pub caches: Vec<CacheDir>,
+    /// Host services that must stay reachable on loopback even when
+    /// network access is disabled.
+    pub forwards: Vec<LoopbackForward>,
+    pub stdout_file: Option<OutputFile>,
+    pub stderr_file: Option<OutputFile>,
+    /// Where to write the paths the command read and wrote, if tracing.
+    pub trace_file: Option<String>,
+    pub sample_file: Option<SampleFile>,
+    /// Kill the command once it wrote nothing and used no CPU this long.
+    pub idle_timeout: Option<Duration>,
+    /// Where to record why the launcher ended the command itself.
+    pub termination_file: Option<String>,
+    /// CPU affinity and scheduling applied before exec.
+    pub priority: Priority,
+    /// Normalization applied to piped and tee'd output.
+    pub output_filter: OutputFilter,
+    /// Where to write the output byte counts, if requested.
+    pub output_stats: Option<String>,
 }
 
 pub trait IsolationStrategy: Send + Sync {
     fn build_command(&self, ctx: &ExecutionContext) -> Result<Command>;
     fn name(&self) -> &'static str;
+
+    /// Whether a traced command is started through `--trace-exec` inside
+    /// the sandbox, rather than traced from the command's own `pre_exec`.
+    fn traces_inside(&self) -> bool {
+        false
+    }
 }
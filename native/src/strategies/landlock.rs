@@ -0,0 +1,224 @@
+//! Lightweight Linux isolation using Landlock and seccomp.
+//!
+//! Unlike the Bubblewrap strategy, no namespaces are created: the launcher
+//! restricts the child in a `pre_exec` hook, so startup cost is close to a
+//! plain host exec. The trade-off is a weaker profile: the host filesystem
+//! stays visible (read-only), and there is no PID or IPC isolation.
+
+use super::base::{CacheDir, ExecutionContext, IsolationStrategy};
+use super::linux::SANDBOX_ENV_VARS;
+use super::seccomp::SeccompFilter;
+use anyhow::{anyhow, Result};
+use std::env;
+use std::ffi::CString;
+use std::io;
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd};
+use std::os::unix::ffi::OsStrExt;
+use std::os::unix::process::CommandExt;
+use std::path::Path;
+use std::process::{Command, Stdio};
+use which::which;
+
+const LANDLOCK_CREATE_RULESET_VERSION: u32 = 1 << 0;
+const LANDLOCK_RULE_PATH_BENEATH: libc::c_int = 1;
+
+const ACCESS_FS_EXECUTE: u64 = 1 << 0;
+const ACCESS_FS_WRITE_FILE: u64 = 1 << 1;
+const ACCESS_FS_READ_FILE: u64 = 1 << 2;
+const ACCESS_FS_READ_DIR: u64 = 1 << 3;
+const ACCESS_FS_TRUNCATE: u64 = 1 << 14;
+const ACCESS_FS_IOCTL_DEV: u64 = 1 << 15;
+
+const ACCESS_FS_READ: u64 = ACCESS_FS_EXECUTE | ACCESS_FS_READ_FILE | ACCESS_FS_READ_DIR;
+const ACCESS_FS_DEVICES: u64 =
+    ACCESS_FS_READ | ACCESS_FS_WRITE_FILE | ACCESS_FS_TRUNCATE | ACCESS_FS_IOCTL_DEV;
+
+/// Scratch locations that stay writable, mirroring the macOS Seatbelt profile.
+const WRITABLE_SCRATCH: [&str; 2] = ["/tmp", "/var/tmp"];
+
+#[repr(C)]
+struct RulesetAttr {
+    handled_access_fs: u64,
+}
+
+#[repr(C, packed)]
+struct PathBeneathAttr {
+    allowed_access: u64,
+    parent_fd: i32,
+}
+
+pub struct LinuxLandlockStrategy;
+
+impl LinuxLandlockStrategy {
+    /// Whether the running kernel exposes a usable Landlock ABI.
+    #[must_use]
+    pub fn is_supported() -> bool {
+        abi_version() >= 1
+    }
+}
+
+impl IsolationStrategy for LinuxLandlockStrategy {
+    fn name(&self) -> &'static str {
+        "Linux Landlock + seccomp (Lightweight)"
+    }
+
+    fn build_command(&self, ctx: &ExecutionContext) -> Result<Command> {
+        let resolved_program = which(&ctx.cmd).unwrap_or_else(|_| ctx.cmd.clone().into());
+        let mut command = Command::new(resolved_program);
+        command.args(&ctx.args);
+
+        command.env_clear();
+        for k in SANDBOX_ENV_VARS {
+            if let Ok(v) = env::var(k) {
+                command.env(k, v);
+            }
+        }
+        command.envs(&ctx.env_vars);
+
+        if let Some(cwd) = &ctx.cwd {
+            command.current_dir(cwd);
+        } else {
+            command.current_dir(&ctx.root_path);
+        }
+
+        let ruleset = build_ruleset(ctx)?;
+        let filter = if ctx.allow_network {
+            None
+        } else {
+            Some(SeccompFilter::deny_network())
+        };
+
+        unsafe {
+            command.pre_exec(move || {
+                if libc::prctl(libc::PR_SET_PDEATHSIG, libc::SIGKILL) != 0
+                    || libc::prctl(libc::PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0
+                {
+                    return Err(io::Error::last_os_error());
+                }
+                if libc::syscall(libc::SYS_landlock_restrict_self, ruleset.as_raw_fd(), 0) != 0 {
+                    return Err(io::Error::last_os_error());
+                }
+                if let Some(filter) = &filter {
+                    filter.install()?;
+                }
+                Ok(())
+            });
+        }
+
+        command
+            .stdin(Stdio::null())
+            .stdout(Stdio::piped())
+            .stderr(Stdio::piped());
+
+        Ok(command)
+    }
+}
+
+/// Returns the highest Landlock ABI supported by the kernel, or 0.
+fn abi_version() -> i64 {
+    let ret = unsafe {
+        libc::syscall(
+            libc::SYS_landlock_create_ruleset,
+            std::ptr::null::<RulesetAttr>(),
+            0usize,
+            LANDLOCK_CREATE_RULESET_VERSION,
+        )
+    };
+    ret.max(0)
+}
+
+/// Filesystem rights the kernel can enforce for the given ABI version.
+fn handled_access_for(abi: i64) -> u64 {
+    // ABI 1 covers EXECUTE..MAKE_SYM (bits 0-12); later ABIs add REFER,
+    // TRUNCATE and IOCTL_DEV.
+    let mut access = (1u64 << 13) - 1;
+    if abi >= 2 {
+        access |= 1 << 13;
+    }
+    if abi >= 3 {
+        access |= ACCESS_FS_TRUNCATE;
+    }
+    if abi >= 5 {
+        access |= ACCESS_FS_IOCTL_DEV;
+    }
+    access
+}
+
+/// Creates a ruleset granting read access everywhere and write access to the
+/// workspace, shared caches and scratch directories.
+fn build_ruleset(ctx: &ExecutionContext) -> Result<OwnedFd> {
+    let abi = abi_version();
+    if abi < 1 {
+        return Err(anyhow!("Landlock is not supported by this kernel"));
+    }
+    let handled = handled_access_for(abi);
+
+    let attr = RulesetAttr {
+        handled_access_fs: handled,
+    };
+    let fd = unsafe {
+        libc::syscall(
+            libc::SYS_landlock_create_ruleset,
+            std::ptr::addr_of!(attr),
+            std::mem::size_of::<RulesetAttr>(),
+            0u32,
+        )
+    };
+    if fd < 0 {
+        return Err(anyhow!(
+            "landlock_create_ruleset failed: {}",
+            io::Error::last_os_error()
+        ));
+    }
+    let ruleset = unsafe { OwnedFd::from_raw_fd(i32::try_from(fd)?) };
+
+    add_path_rule(&ruleset, Path::new("/"), ACCESS_FS_READ & handled)?;
+    add_path_rule(&ruleset, Path::new("/dev"), ACCESS_FS_DEVICES & handled)?;
+    add_path_rule(&ruleset, Path::new(&ctx.root_path), handled)?;
+    for entry in ctx.caches.iter().flat_map(CacheDir::writable_paths) {
+        add_path_rule(&ruleset, Path::new(entry), handled)?;
+    }
+    for scratch in WRITABLE_SCRATCH {
+        let path = Path::new(scratch);
+        if path.exists() {
+            add_path_rule(&ruleset, path, handled)?;
+        }
+    }
+
+    Ok(ruleset)
+}
+
+fn add_path_rule(ruleset: &OwnedFd, path: &Path, access: u64) -> Result<()> {
+    let c_path = CString::new(path.as_os_str().as_bytes())?;
+    let raw = unsafe { libc::open(c_path.as_ptr(), libc::O_PATH | libc::O_CLOEXEC) };
+    if raw < 0 {
+        return Err(anyhow!(
+            "Cannot open {} for Landlock rule: {}",
+            path.display(),
+            io::Error::last_os_error()
+        ));
+    }
+    let parent = unsafe { OwnedFd::from_raw_fd(raw) };
+
+    let attr = PathBeneathAttr {
+        allowed_access: access,
+        parent_fd: parent.as_raw_fd(),
+    };
+    let ret = unsafe {
+        libc::syscall(
+            libc::SYS_landlock_add_rule,
+            ruleset.as_raw_fd(),
+            LANDLOCK_RULE_PATH_BENEATH,
+            std::ptr::addr_of!(attr),
+            0u32,
+        )
+    };
+    if ret != 0 {
+        return Err(anyhow!(
+            "landlock_add_rule failed for {}: {}",
+            path.display(),
+            io::Error::last_os_error()
+        ));
+    }
+    Ok(())
+}
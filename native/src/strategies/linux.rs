@@ -1,13 +1,27 @@
 //! Linux isolation using Bubblewrap with root passthrough strategy.
 
 use super::base::{ExecutionContext, IsolationStrategy};
+use crate::netns::PooledNetns;
 use anyhow::{Context, Result};
 use std::env;
 use std::fs;
+use std::os::unix::process::CommandExt;
 use std::path::Path;
 use std::process::{Command, Stdio};
 use which::which;
 
+/// Host environment variables forwarded into Linux sandboxes.
+pub(super) const SANDBOX_ENV_VARS: [&str; 8] = [
+    "PATH",
+    "JAVA_HOME",
+    "FLUTTER_ROOT",
+    "GOPATH",
+    "TERM",
+    "LANG",
+    "HOME",
+    "SHELL",
+];
+
 pub struct LinuxBwrapStrategy;
 
 impl IsolationStrategy for LinuxBwrapStrategy {
@@ -15,6 +29,10 @@ impl IsolationStrategy for LinuxBwrapStrategy {
         "Linux Bubblewrap (Root Passthrough)"
     }
 
+    fn traces_inside(&self) -> bool {
+        true
+    }
+
     #[allow(clippy::too_many_lines)]
     fn build_command(&self, ctx: &ExecutionContext) -> Result<Command> {
         let bwrap_path = which("bwrap")
@@ -29,6 +47,14 @@ impl IsolationStrategy for LinuxBwrapStrategy {
 
         if ctx.allow_network {
             command.arg("--share-net");
+        } else if let Some(pid) = ctx.netns_pid {
+            // Join a pooled loopback-only namespace before bwrap starts, so
+            // it can share it instead of paying for a fresh one.
+            let pooled = PooledNetns::open(pid)?;
+            unsafe {
+                command.pre_exec(move || pooled.enter());
+            }
+            command.arg("--share-net");
         } else {
             command.arg("--unshare-net");
         }
@@ -103,6 +129,39 @@ impl IsolationStrategy for LinuxBwrapStrategy {
             }
         }
 
+        for cache in &ctx.caches {
+            if cache.writable.is_empty() {
+                command.arg("--bind").arg(&cache.path).arg(&cache.path);
+                continue;
+            }
+            command.arg("--ro-bind").arg(&cache.path).arg(&cache.path);
+            for entry in cache.writable_paths() {
+                command.arg("--bind").arg(entry).arg(entry);
+            }
+        }
+
+        // With a private network namespace, host services are only reachable
+        // through their unix sockets; a relay copy of the launcher re-exposes
+        // them on the sandbox loopback before running the command. Tracing
+        // runs another copy, which installs its filter inside the sandbox.
+        let relay = !ctx.allow_network && !ctx.forwards.is_empty();
+        let traced = ctx.trace_file.is_some();
+        let launcher_exe = if relay || traced {
+            let exe = env::current_exe().context("Cannot locate launcher binary")?;
+            command.arg("--ro-bind").arg(&exe).arg(&exe);
+            Some(exe)
+        } else {
+            None
+        };
+        if relay {
+            for forward in &ctx.forwards {
+                command
+                    .arg("--bind")
+                    .arg(&forward.socket)
+                    .arg(&forward.socket);
+            }
+        }
+
         command
             .arg("--bind")
             .arg(&ctx.root_path)
@@ -111,17 +170,7 @@ impl IsolationStrategy for LinuxBwrapStrategy {
             .arg(&ctx.root_path);
 
         command.env_clear();
-        let keep_vars = [
-            "PATH",
-            "JAVA_HOME",
-            "FLUTTER_ROOT",
-            "GOPATH",
-            "TERM",
-            "LANG",
-            "HOME",
-            "SHELL",
-        ];
-        for k in keep_vars {
+        for k in SANDBOX_ENV_VARS {
             if let Ok(v) = env::var(k) {
                 command.env(k, v);
             }
@@ -130,8 +179,24 @@ impl IsolationStrategy for LinuxBwrapStrategy {
             command.env(key, val);
         }
 
+        command.arg("--");
+        if let Some(exe) = &launcher_exe {
+            if relay {
+                command.arg(exe);
+                for forward in &ctx.forwards {
+                    command
+                        .arg("--relay")
+                        .arg(format!("{}={}", forward.port, forward.socket));
+                }
+                command.arg("--");
+            }
+            // Innermost, so the relay's own calls are not traced.
+            if traced {
+                command.arg(exe).arg("--trace-exec").arg("--");
+            }
+        }
+
         command
-            .arg("--")
             .arg(&ctx.cmd)
             .args(&ctx.args)
             .stdin(Stdio::null())
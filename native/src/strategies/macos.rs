@@ -23,11 +23,38 @@ impl IsolationStrategy for MacOsSandboxStrategy {
         let home = env::var("HOME").unwrap_or_else(|_| "/var/tmp".to_string());
 
         let network_policy = if ctx.allow_network {
-            "(allow network*)"
+            "(allow network*)".to_string()
         } else {
-            "(deny network*)"
+            // Forwarded host services stay reachable on their loopback ports.
+            let mut policy = "(deny network*)".to_string();
+            for forward in &ctx.forwards {
+                policy.push_str(&format!(
+                    "\n            (allow network-outbound (remote ip \"localhost:{}\"))",
+                    forward.port
+                ));
+            }
+            policy
         };
 
+        let cache_rules: String = ctx
+            .caches
+            .iter()
+            .flat_map(|cache| {
+                if cache.writable.is_empty() {
+                    vec![format!("\n                (subpath \"{}\")", cache.path)]
+                } else {
+                    cache
+                        .writable
+                        .iter()
+                        .map(|entry| match entry.strip_suffix('/') {
+                            Some(dir) => format!("\n                (subpath \"{dir}\")"),
+                            None => format!("\n                (literal \"{entry}\")"),
+                        })
+                        .collect()
+                }
+            })
+            .collect();
+
         let profile = format!(
             r#"
             (version 1)
@@ -43,7 +70,7 @@ impl IsolationStrategy for MacOsSandboxStrategy {
                 (subpath "/Users/Shared")
                 (subpath "{home}/.m2")
                 (subpath "{home}/.gradle")
-                (subpath "{home}/.dart_tool")
+                (subpath "{home}/.dart_tool"){cache_rules}
             )
 
             {network_policy}
@@ -54,6 +81,7 @@ impl IsolationStrategy for MacOsSandboxStrategy {
             "#,
             workspace = ctx.root_path,
             home = home,
+            cache_rules = cache_rules,
             network_policy = network_policy
         );
 
@@ -3,9 +3,15 @@
 pub mod base;
 pub mod host;
 
+#[cfg(target_os = "linux")]
+pub mod landlock;
+
 #[cfg(target_os = "linux")]
 pub mod linux;
 
+#[cfg(target_os = "linux")]
+pub mod seccomp;
+
 #[cfg(target_os = "macos")]
 pub mod macos;
 
@@ -0,0 +1,161 @@
+//! Minimal seccomp-bpf filter builder used by in-process Linux strategies
+//! and file-access tracing.
+
+use std::io;
+
+const BPF_LD_W_ABS: u16 = 0x20;
+const BPF_JEQ_K: u16 = 0x15;
+const BPF_JGE_K: u16 = 0x35;
+const BPF_RET_K: u16 = 0x06;
+
+const SECCOMP_RET_ALLOW: u32 = 0x7fff_0000;
+const SECCOMP_RET_ERRNO: u32 = 0x0005_0000;
+const SECCOMP_RET_USER_NOTIF: u32 = 0x7fc0_0000;
+
+const SECCOMP_SET_MODE_FILTER: libc::c_uint = 1;
+const SECCOMP_FILTER_FLAG_NEW_LISTENER: libc::c_uint = 1 << 3;
+
+const OFFSET_NR: u32 = 0;
+const OFFSET_ARCH: u32 = 4;
+const OFFSET_ARG0: u32 = 16;
+
+#[cfg(target_arch = "x86_64")]
+const AUDIT_ARCH_NATIVE: u32 = 0xC000_003E;
+#[cfg(target_arch = "aarch64")]
+const AUDIT_ARCH_NATIVE: u32 = 0xC000_00B7;
+
+/// Syscall numbers at or above this value belong to the x32 ABI on `x86_64`.
+const X32_SYSCALL_BIT: u32 = 0x4000_0000;
+
+/// A compiled BPF program ready to be installed with `PR_SET_SECCOMP`.
+pub struct SeccompFilter {
+    program: Vec<libc::sock_filter>,
+}
+
+impl SeccompFilter {
+    /// Builds a filter that rejects creation of any socket outside the
+    /// `AF_UNIX` and `AF_NETLINK` families with `EPERM`.
+    ///
+    /// `io_uring_setup` is rejected as well, since `IORING_OP_SOCKET` would
+    /// otherwise create sockets without going through `socket(2)`. Syscalls
+    /// from a foreign ABI (32-bit compat, x32) fail with `EPERM` because the
+    /// filter cannot reason about their numbering.
+    #[must_use]
+    pub fn deny_network() -> Self {
+        let deny = SECCOMP_RET_ERRNO | u32::try_from(libc::EPERM).unwrap_or(1);
+        let socket_nr = u32::try_from(libc::SYS_socket).unwrap_or(u32::MAX);
+        let uring_nr = u32::try_from(libc::SYS_io_uring_setup).unwrap_or(u32::MAX);
+        let af_unix = u32::try_from(libc::AF_UNIX).unwrap_or(0);
+        let af_netlink = u32::try_from(libc::AF_NETLINK).unwrap_or(0);
+
+        let program = vec![
+            stmt(BPF_LD_W_ABS, OFFSET_ARCH),
+            jump(BPF_JEQ_K, AUDIT_ARCH_NATIVE, 1, 0),
+            stmt(BPF_RET_K, deny),
+            stmt(BPF_LD_W_ABS, OFFSET_NR),
+            jump(BPF_JGE_K, X32_SYSCALL_BIT, 0, 1),
+            stmt(BPF_RET_K, deny),
+            jump(BPF_JEQ_K, uring_nr, 0, 1),
+            stmt(BPF_RET_K, deny),
+            jump(BPF_JEQ_K, socket_nr, 1, 0),
+            stmt(BPF_RET_K, SECCOMP_RET_ALLOW),
+            stmt(BPF_LD_W_ABS, OFFSET_ARG0),
+            jump(BPF_JEQ_K, af_unix, 2, 0),
+            jump(BPF_JEQ_K, af_netlink, 1, 0),
+            stmt(BPF_RET_K, deny),
+            stmt(BPF_RET_K, SECCOMP_RET_ALLOW),
+        ];
+
+        SeccompFilter { program }
+    }
+
+    /// Builds a filter that hands each of `syscalls` to a supervisor
+    /// through the listener returned by [`SeccompFilter::install_listener`]
+    /// and allows everything else.
+    ///
+    /// Syscalls from a foreign ABI are allowed without notification, since
+    /// their numbers would be misread.
+    #[must_use]
+    pub fn notify(syscalls: &[libc::c_long]) -> Self {
+        let numbers: Vec<u32> = syscalls
+            .iter()
+            .filter_map(|nr| u32::try_from(*nr).ok())
+            .collect();
+        let count = numbers.len();
+
+        let mut program = vec![
+            stmt(BPF_LD_W_ABS, OFFSET_ARCH),
+            jump(BPF_JEQ_K, AUDIT_ARCH_NATIVE, 1, 0),
+            stmt(BPF_RET_K, SECCOMP_RET_ALLOW),
+            stmt(BPF_LD_W_ABS, OFFSET_NR),
+        ];
+        for (i, nr) in numbers.into_iter().enumerate() {
+            // Jumps over the remaining comparisons and the allow below.
+            let skip = u8::try_from(count - i).unwrap_or(u8::MAX);
+            program.push(jump(BPF_JEQ_K, nr, skip, 0));
+        }
+        program.push(stmt(BPF_RET_K, SECCOMP_RET_ALLOW));
+        program.push(stmt(BPF_RET_K, SECCOMP_RET_USER_NOTIF));
+
+        SeccompFilter { program }
+    }
+
+    /// Installs the filter on the calling thread.
+    ///
+    /// Requires `PR_SET_NO_NEW_PRIVS` to already be set. Performs no heap
+    /// allocation, so it is safe to call from a `pre_exec` hook.
+    pub fn install(&self) -> io::Result<()> {
+        let prog = libc::sock_fprog {
+            len: u16::try_from(self.program.len()).unwrap_or(u16::MAX),
+            filter: self.program.as_ptr().cast_mut(),
+        };
+        let ret = unsafe {
+            libc::prctl(
+                libc::PR_SET_SECCOMP,
+                libc::SECCOMP_MODE_FILTER,
+                std::ptr::addr_of!(prog),
+            )
+        };
+        if ret != 0 {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(())
+    }
+
+    /// Installs a [`SeccompFilter::notify`] filter on the calling thread and
+    /// returns the notification listener (kernel 5.0+).
+    ///
+    /// Same requirements as [`SeccompFilter::install`]; the descriptor is
+    /// not close-on-exec.
+    pub fn install_listener(&self) -> io::Result<libc::c_int> {
+        let prog = libc::sock_fprog {
+            len: u16::try_from(self.program.len()).unwrap_or(u16::MAX),
+            filter: self.program.as_ptr().cast_mut(),
+        };
+        let fd = unsafe {
+            libc::syscall(
+                libc::SYS_seccomp,
+                SECCOMP_SET_MODE_FILTER,
+                SECCOMP_FILTER_FLAG_NEW_LISTENER,
+                std::ptr::addr_of!(prog),
+            )
+        };
+        libc::c_int::try_from(fd)
+            .ok()
+            .filter(|fd| *fd >= 0)
+            .ok_or_else(io::Error::last_os_error)
+    }
+}
+
+fn stmt(code: u16, k: u32) -> libc::sock_filter {
+    libc::sock_filter {
+        code,
+        jt: 0,
+        jf: 0,
+        k,
+    }
+}
+
+fn jump(code: u16, k: u32, jt: u8, jf: u8) -> libc::sock_filter {
+    libc::sock_filter { code, jt, jf, k }
+}
@@ -70,7 +70,13 @@ impl IsolationStrategy for WindowsJobStrategy {
             command.env("HTTP_PROXY", "http://0.0.0.0:0");
             command.env("HTTPS_PROXY", "http://0.0.0.0:0");
             command.env("ALL_PROXY", "socks5://0.0.0.0:0");
-            command.env("NO_PROXY", "");
+            // Forwarded host services listen on loopback, which must bypass
+            // the blackhole proxy.
+            if ctx.forwards.is_empty() {
+                command.env("NO_PROXY", "");
+            } else {
+                command.env("NO_PROXY", "127.0.0.1,localhost");
+            }
         }
 
         if let Some(cwd) = &ctx.cwd {
@@ -0,0 +1,694 @@
+//! Single-threaded supervision of one child process.
+//!
+//! The launcher only has to pump two pipes, notice the child's exit and
+//! react to termination requests, so instead of an async runtime it runs
+//! one readiness loop on the main thread:
+//! - Linux: `epoll` over the pipes, a `pidfd` for the child and a
+//!   `signalfd` for `SIGTERM`/`SIGINT`/`SIGCHLD` (the latter covers kernels
+//!   without `pidfd_open`)
+//! - other unix: `poll` over the pipes and a self-pipe fed by signal handlers
+//! - Windows: one copy thread per pipe while the main thread waits
+//!
+//! Signals are blocked (Linux) or handled (other unix) from [`Signals::new`]
+//! on, which must run before the child is spawned so that no termination
+//! request is lost; `std::process::Command` resets the mask in the child.
+
+use crate::normalize::{ByteCounts, Normalizer, OutputFilter};
+use std::fs::File;
+use std::io::{self, Write};
+use std::ops::{Deref, DerefMut};
+use std::process::{Child, ExitStatus};
+
+/// How supervision ended.
+pub enum Outcome {
+    /// The child exited and its output was fully forwarded. Carries the
+    /// stdout and stderr byte counts before and after normalization.
+    Exited(ExitStatus, [ByteCounts; 2]),
+    /// The launcher was asked to terminate; the child has been killed.
+    Terminated,
+    /// The child stopped producing output and using CPU time for the
+    /// [`IdleWatch`] limit and has been killed.
+    Idle,
+}
+
+/// Optional helpers the supervision loop drives alongside the pipes.
+#[derive(Default)]
+pub struct Monitors<'a> {
+    pub tracer: Option<&'a mut Tracer>,
+    pub sampler: Option<&'a mut Sampler>,
+    pub idle: Option<&'a mut IdleWatch>,
+}
+
+/// A child output stream and where it goes besides the launcher's own.
+struct Stream<R> {
+    src: R,
+    tee: Option<File>,
+    to_stderr: bool,
+    normalizer: Normalizer,
+    /// Normalized output waiting to be written, reused across chunks.
+    out: Vec<u8>,
+}
+
+impl<R> Stream<R> {
+    fn new(src: R, tee: Option<File>, to_stderr: bool, filter: OutputFilter) -> Self {
+        Stream {
+            src,
+            tee,
+            to_stderr,
+            normalizer: Normalizer::new(filter),
+            out: Vec::new(),
+        }
+    }
+
+    /// Normalizes and forwards a chunk read from the child.
+    fn emit(&mut self, data: &[u8]) -> io::Result<()> {
+        let mut out = std::mem::take(&mut self.out);
+        self.normalizer.push(data, &mut out);
+        let written = self.write(&out);
+        out.clear();
+        self.out = out;
+        written
+    }
+
+    /// Forwards output held back by the normalizer and returns the
+    /// stream's byte counts.
+    fn finish(&mut self) -> ByteCounts {
+        let mut out = Vec::new();
+        self.normalizer.finish(&mut out);
+        let _ = self.write(&out);
+        self.normalizer.counts()
+    }
+
+    fn write(&mut self, data: &[u8]) -> io::Result<()> {
+        if data.is_empty() {
+            return Ok(());
+        }
+        if let Some(file) = self.tee.as_mut() {
+            file.write_all(data)?;
+        }
+        if self.to_stderr {
+            let mut err = io::stderr().lock();
+            err.write_all(data)?;
+            err.flush()
+        } else {
+            let mut out = io::stdout().lock();
+            out.write_all(data)?;
+            out.flush()
+        }
+    }
+}
+
+#[cfg(target_os = "linux")]
+pub use crate::trace::Tracer;
+
+/// File-access tracing is Linux-only; elsewhere no tracer can exist.
+#[cfg(not(target_os = "linux"))]
+pub enum Tracer {}
+
+#[cfg(all(unix, not(target_os = "linux")))]
+impl Tracer {
+    fn fd(&self) -> std::os::fd::RawFd {
+        match *self {}
+    }
+
+    fn handle(&mut self) -> bool {
+        match *self {}
+    }
+}
+
+#[cfg(target_os = "linux")]
+pub use crate::sample::{IdleWatch, Sampler};
+
+/// Resource sampling is Linux-only; elsewhere no sampler can exist.
+#[cfg(not(target_os = "linux"))]
+pub enum Sampler {}
+
+/// Idle detection reads CPU time from `/proc`, so it is Linux-only too.
+#[cfg(not(target_os = "linux"))]
+pub enum IdleWatch {}
+
+#[cfg(all(unix, not(target_os = "linux")))]
+impl IdleWatch {
+    fn fd(&self) -> std::os::fd::RawFd {
+        match *self {}
+    }
+
+    fn output(&mut self) {
+        match *self {}
+    }
+
+    fn handle(&mut self, _root: u32) -> bool {
+        match *self {}
+    }
+}
+
+#[cfg(all(unix, not(target_os = "linux")))]
+impl Sampler {
+    fn fd(&self) -> std::os::fd::RawFd {
+        match *self {}
+    }
+
+    fn handle(&mut self, _root: u32) {
+        match *self {}
+    }
+
+    pub fn interval(&self) -> std::time::Duration {
+        match *self {}
+    }
+
+    pub fn record(&mut self, _root: u32) {
+        match *self {}
+    }
+}
+
+#[cfg(unix)]
+pub use self::unix::{supervise, Signals};
+#[cfg(windows)]
+pub use self::windows::{supervise, Signals};
+
+#[cfg(unix)]
+mod unix {
+    use super::{Monitors, Outcome, Stream};
+    use crate::normalize::{ByteCounts, OutputFilter};
+    use anyhow::{anyhow, Result};
+    use std::fs::File;
+    use std::io;
+    use std::os::fd::{AsRawFd, FromRawFd, OwnedFd, RawFd};
+    use std::process::Child;
+
+    const TOKEN_STDOUT: u64 = 0;
+    const TOKEN_STDERR: u64 = 1;
+    const TOKEN_CHILD: u64 = 2;
+    const TOKEN_SIGNAL: u64 = 3;
+    const TOKEN_TRACE: u64 = 4;
+    const TOKEN_SAMPLE: u64 = 5;
+    const TOKEN_IDLE: u64 = 6;
+
+    /// Supervises `child` until it exits (and both pipes reach EOF), a
+    /// termination signal arrives or it goes idle, passing output through
+    /// `filter` and driving `monitors` meanwhile.
+    pub fn supervise(
+        child: &mut Child,
+        signals: &Signals,
+        stdout_tee: Option<File>,
+        stderr_tee: Option<File>,
+        filter: OutputFilter,
+        monitors: Monitors,
+    ) -> Result<Outcome> {
+        let mut streams = [
+            child
+                .stdout
+                .take()
+                .map(|src| Stream::new(OwnedFd::from(src), stdout_tee, false, filter)),
+            child
+                .stderr
+                .take()
+                .map(|src| Stream::new(OwnedFd::from(src), stderr_tee, true, filter)),
+        ];
+        let mut counts = [ByteCounts::default(); 2];
+
+        let mut poller = Poller::new()?;
+        for (token, stream) in (0u64..).zip(streams.iter()) {
+            if let Some(stream) = stream {
+                set_nonblocking(stream.src.as_raw_fd())?;
+                poller.add(stream.src.as_raw_fd(), token)?;
+            }
+        }
+        let pidfd = pidfd_open(child.id());
+        if let Some(fd) = &pidfd {
+            poller.add(fd.as_raw_fd(), TOKEN_CHILD)?;
+        }
+        poller.add(signals.fd(), TOKEN_SIGNAL)?;
+        register(&mut poller, &monitors)?;
+        let Monitors {
+            mut tracer,
+            mut sampler,
+            mut idle,
+        } = monitors;
+
+        let mut status = child.try_wait()?;
+        let mut buf = vec![0u8; 64 * 1024];
+        let mut ready = Vec::with_capacity(7);
+
+        while status.is_none() || streams.iter().any(Option::is_some) {
+            poller.wait(&mut ready)?;
+            for &token in &ready {
+                match token {
+                    TOKEN_STDOUT | TOKEN_STDERR => {
+                        let index = usize::from(token == TOKEN_STDERR);
+                        if let Some(idle) = idle.as_deref_mut() {
+                            idle.output();
+                        }
+                        if let Some(stream) = streams[index].as_mut() {
+                            if !pump(stream, &mut buf) {
+                                poller.remove(stream.src.as_raw_fd());
+                                counts[index] = stream.finish();
+                                streams[index] = None;
+                            }
+                        }
+                    }
+                    TOKEN_CHILD => {
+                        status = child.try_wait()?;
+                        if let (Some(_), Some(fd)) = (status, &pidfd) {
+                            poller.remove(fd.as_raw_fd());
+                        }
+                    }
+                    TOKEN_TRACE => {
+                        // A traced call blocks its caller until answered, so
+                        // this is handled before the pipes drain.
+                        if let Some(active) = tracer.as_deref_mut() {
+                            if !active.handle() {
+                                poller.remove(active.fd());
+                                tracer = None;
+                            }
+                        }
+                    }
+                    TOKEN_SAMPLE => {
+                        if let Some(sampler) = sampler.as_deref_mut() {
+                            sampler.handle(child.id());
+                        }
+                    }
+                    TOKEN_IDLE => {
+                        if idle.as_deref_mut().is_some_and(|w| w.handle(child.id())) {
+                            if status.is_none() {
+                                let _ = child.kill();
+                                let _ = child.wait();
+                                return Ok(Outcome::Idle);
+                            }
+                            abandon(&mut streams, &mut counts);
+                        }
+                    }
+                    _ => {
+                        if signals.drain_termination() {
+                            let _ = child.kill();
+                            let _ = child.wait();
+                            return Ok(Outcome::Terminated);
+                        }
+                        // SIGCHLD, relevant when there is no pidfd.
+                        if status.is_none() {
+                            status = child.try_wait()?;
+                        }
+                    }
+                }
+            }
+        }
+
+        status
+            .map(|status| Outcome::Exited(status, counts))
+            .ok_or_else(|| anyhow!("Child exit status unavailable"))
+    }
+
+    fn register(poller: &mut Poller, monitors: &Monitors) -> io::Result<()> {
+        if let Some(tracer) = &monitors.tracer {
+            poller.add(tracer.fd(), TOKEN_TRACE)?;
+        }
+        if let Some(sampler) = &monitors.sampler {
+            poller.add(sampler.fd(), TOKEN_SAMPLE)?;
+        }
+        if let Some(idle) = &monitors.idle {
+            poller.add(idle.fd(), TOKEN_IDLE)?;
+        }
+        Ok(())
+    }
+
+    /// Stops waiting for pipes held open by descendants of an exited child
+    /// that stopped writing.
+    fn abandon(streams: &mut [Option<Stream<OwnedFd>>; 2], counts: &mut [ByteCounts; 2]) {
+        for (count, stream) in counts.iter_mut().zip(streams) {
+            if let Some(mut stream) = stream.take() {
+                *count = stream.finish();
+            }
+        }
+    }
+
+    /// Forwards whatever is readable. Returns `false` at EOF or on error.
+    fn pump(stream: &mut Stream<OwnedFd>, buf: &mut [u8]) -> bool {
+        loop {
+            let n =
+                unsafe { libc::read(stream.src.as_raw_fd(), buf.as_mut_ptr().cast(), buf.len()) };
+            if n > 0 {
+                let n = usize::try_from(n).unwrap_or(0);
+                if stream.emit(&buf[..n]).is_err() {
+                    return false;
+                }
+                continue;
+            }
+            if n == 0 {
+                return false;
+            }
+            return match io::Error::last_os_error().kind() {
+                io::ErrorKind::WouldBlock => true,
+                io::ErrorKind::Interrupted => continue,
+                _ => false,
+            };
+        }
+    }
+
+    fn set_nonblocking(fd: RawFd) -> io::Result<()> {
+        unsafe {
+            let flags = libc::fcntl(fd, libc::F_GETFL);
+            if flags < 0 || libc::fcntl(fd, libc::F_SETFL, flags | libc::O_NONBLOCK) < 0 {
+                return Err(io::Error::last_os_error());
+            }
+        }
+        Ok(())
+    }
+
+    #[cfg(target_os = "linux")]
+    fn pidfd_open(pid: u32) -> Option<OwnedFd> {
+        let fd = unsafe { libc::syscall(libc::SYS_pidfd_open, pid, 0) };
+        let fd = RawFd::try_from(fd).ok().filter(|fd| *fd >= 0)?;
+        Some(unsafe { OwnedFd::from_raw_fd(fd) })
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    fn pidfd_open(_pid: u32) -> Option<OwnedFd> {
+        None
+    }
+
+    /// Termination and child-exit signals as a pollable descriptor.
+    pub struct Signals {
+        fd: OwnedFd,
+        /// Write end of the self-pipe, kept alive for the handlers.
+        #[cfg(not(target_os = "linux"))]
+        _writer: OwnedFd,
+    }
+
+    #[cfg(target_os = "linux")]
+    impl Signals {
+        /// Blocks `SIGTERM`, `SIGINT` and `SIGCHLD` and routes them to a
+        /// `signalfd`.
+        pub fn new() -> Result<Self> {
+            unsafe {
+                let mut set: libc::sigset_t = std::mem::zeroed();
+                libc::sigemptyset(std::ptr::addr_of_mut!(set));
+                for sig in [libc::SIGTERM, libc::SIGINT, libc::SIGCHLD] {
+                    libc::sigaddset(std::ptr::addr_of_mut!(set), sig);
+                }
+                if libc::sigprocmask(
+                    libc::SIG_BLOCK,
+                    std::ptr::addr_of!(set),
+                    std::ptr::null_mut(),
+                ) != 0
+                {
+                    return Err(anyhow!("sigprocmask: {}", io::Error::last_os_error()));
+                }
+                let fd = libc::signalfd(
+                    -1,
+                    std::ptr::addr_of!(set),
+                    libc::SFD_NONBLOCK | libc::SFD_CLOEXEC,
+                );
+                if fd < 0 {
+                    return Err(anyhow!("signalfd: {}", io::Error::last_os_error()));
+                }
+                Ok(Signals {
+                    fd: OwnedFd::from_raw_fd(fd),
+                })
+            }
+        }
+
+        /// Consumes pending signals; `true` if one requested termination.
+        fn drain_termination(&self) -> bool {
+            let mut terminate = false;
+            let mut info: libc::signalfd_siginfo = unsafe { std::mem::zeroed() };
+            let size = std::mem::size_of::<libc::signalfd_siginfo>();
+            loop {
+                let n = unsafe {
+                    libc::read(
+                        self.fd.as_raw_fd(),
+                        std::ptr::addr_of_mut!(info).cast(),
+                        size,
+                    )
+                };
+                if usize::try_from(n).ok() != Some(size) {
+                    return terminate;
+                }
+                let signo = i32::try_from(info.ssi_signo).unwrap_or(0);
+                terminate |= signo == libc::SIGTERM || signo == libc::SIGINT;
+            }
+        }
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    static SELF_PIPE: std::sync::atomic::AtomicI32 = std::sync::atomic::AtomicI32::new(-1);
+
+    #[cfg(not(target_os = "linux"))]
+    extern "C" fn on_signal(signo: libc::c_int) {
+        let fd = SELF_PIPE.load(std::sync::atomic::Ordering::Relaxed);
+        let byte = u8::try_from(signo).unwrap_or(0);
+        unsafe {
+            libc::write(fd, std::ptr::addr_of!(byte).cast(), 1);
+        }
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    impl Signals {
+        /// Installs handlers for `SIGTERM`, `SIGINT` and `SIGCHLD` that
+        /// write the signal number to a non-blocking self-pipe.
+        pub fn new() -> Result<Self> {
+            let mut fds = [0; 2];
+            unsafe {
+                if libc::pipe(fds.as_mut_ptr()) != 0 {
+                    return Err(anyhow!("pipe: {}", io::Error::last_os_error()));
+                }
+                let (reader, writer) = (OwnedFd::from_raw_fd(fds[0]), OwnedFd::from_raw_fd(fds[1]));
+                for fd in fds {
+                    set_nonblocking(fd)?;
+                    libc::fcntl(fd, libc::F_SETFD, libc::FD_CLOEXEC);
+                }
+                SELF_PIPE.store(fds[1], std::sync::atomic::Ordering::Relaxed);
+                for sig in [libc::SIGTERM, libc::SIGINT, libc::SIGCHLD] {
+                    libc::signal(sig, on_signal as libc::sighandler_t);
+                }
+                Ok(Signals {
+                    fd: reader,
+                    _writer: writer,
+                })
+            }
+        }
+
+        /// Consumes pending signals; `true` if one requested termination.
+        fn drain_termination(&self) -> bool {
+            let mut terminate = false;
+            let mut byte = 0u8;
+            while unsafe { libc::read(self.fd.as_raw_fd(), std::ptr::addr_of_mut!(byte).cast(), 1) }
+                == 1
+            {
+                let signo = i32::from(byte);
+                terminate |= signo == libc::SIGTERM || signo == libc::SIGINT;
+            }
+            terminate
+        }
+    }
+
+    impl Signals {
+        fn fd(&self) -> RawFd {
+            self.fd.as_raw_fd()
+        }
+    }
+
+    /// Level-triggered readiness over a handful of descriptors.
+    #[cfg(target_os = "linux")]
+    struct Poller {
+        epoll: OwnedFd,
+    }
+
+    #[cfg(target_os = "linux")]
+    impl Poller {
+        fn new() -> io::Result<Self> {
+            let fd = unsafe { libc::epoll_create1(libc::EPOLL_CLOEXEC) };
+            if fd < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            Ok(Poller {
+                epoll: unsafe { OwnedFd::from_raw_fd(fd) },
+            })
+        }
+
+        fn add(&mut self, fd: RawFd, token: u64) -> io::Result<()> {
+            let mut event = libc::epoll_event {
+                events: u32::try_from(libc::EPOLLIN | libc::EPOLLHUP).unwrap_or(0),
+                u64: token,
+            };
+            if unsafe {
+                libc::epoll_ctl(
+                    self.epoll.as_raw_fd(),
+                    libc::EPOLL_CTL_ADD,
+                    fd,
+                    std::ptr::addr_of_mut!(event),
+                )
+            } != 0
+            {
+                return Err(io::Error::last_os_error());
+            }
+            Ok(())
+        }
+
+        fn remove(&mut self, fd: RawFd) {
+            unsafe {
+                libc::epoll_ctl(
+                    self.epoll.as_raw_fd(),
+                    libc::EPOLL_CTL_DEL,
+                    fd,
+                    std::ptr::null_mut(),
+                );
+            }
+        }
+
+        fn wait(&mut self, ready: &mut Vec<u64>) -> io::Result<()> {
+            let mut events = [libc::epoll_event { events: 0, u64: 0 }; 7];
+            ready.clear();
+            let n = unsafe { libc::epoll_wait(self.epoll.as_raw_fd(), events.as_mut_ptr(), 7, -1) };
+            if n < 0 {
+                let err = io::Error::last_os_error();
+                return if err.kind() == io::ErrorKind::Interrupted {
+                    Ok(())
+                } else {
+                    Err(err)
+                };
+            }
+            let n = usize::try_from(n).unwrap_or(0);
+            ready.extend(events[..n].iter().map(|e| e.u64));
+            Ok(())
+        }
+    }
+
+    /// Level-triggered readiness over a handful of descriptors.
+    #[cfg(not(target_os = "linux"))]
+    struct Poller {
+        fds: Vec<(libc::pollfd, u64)>,
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    impl Poller {
+        fn new() -> io::Result<Self> {
+            Ok(Poller { fds: Vec::new() })
+        }
+
+        #[allow(clippy::unnecessary_wraps)]
+        fn add(&mut self, fd: RawFd, token: u64) -> io::Result<()> {
+            self.fds.push((
+                libc::pollfd {
+                    fd,
+                    events: libc::POLLIN,
+                    revents: 0,
+                },
+                token,
+            ));
+            Ok(())
+        }
+
+        fn remove(&mut self, fd: RawFd) {
+            self.fds.retain(|(p, _)| p.fd != fd);
+        }
+
+        fn wait(&mut self, ready: &mut Vec<u64>) -> io::Result<()> {
+            let mut pollfds: Vec<libc::pollfd> = self.fds.iter().map(|(p, _)| *p).collect();
+            ready.clear();
+            let nfds = libc::nfds_t::try_from(pollfds.len()).unwrap_or(0);
+            if unsafe { libc::poll(pollfds.as_mut_ptr(), nfds, -1) } < 0 {
+                let err = io::Error::last_os_error();
+                return if err.kind() == io::ErrorKind::Interrupted {
+                    Ok(())
+                } else {
+                    Err(err)
+                };
+            }
+            for (p, (_, token)) in pollfds.iter().zip(&self.fds) {
+                if p.revents != 0 {
+                    ready.push(*token);
+                }
+            }
+            Ok(())
+        }
+    }
+}
+
+#[cfg(windows)]
+mod windows {
+    use super::{Monitors, Outcome, Stream};
+    use crate::normalize::{ByteCounts, OutputFilter};
+    use anyhow::Result;
+    use std::fs::File;
+    use std::io::Read;
+    use std::process::Child;
+    use std::thread;
+
+    /// Console control events terminate the launcher by default, and the
+    /// job object then kills the child, so nothing needs handling here.
+    pub struct Signals;
+
+    impl Signals {
+        #[allow(clippy::unnecessary_wraps)]
+        pub fn new() -> Result<Self> {
+            Ok(Signals)
+        }
+    }
+
+    /// Copies each pipe on its own thread while waiting for the child.
+    pub fn supervise(
+        child: &mut Child,
+        _signals: &Signals,
+        stdout_tee: Option<File>,
+        stderr_tee: Option<File>,
+        filter: OutputFilter,
+        _monitors: Monitors,
+    ) -> Result<Outcome> {
+        let copiers = [
+            child
+                .stdout
+                .take()
+                .map(|src| copy(Stream::new(src, stdout_tee, false, filter))),
+            child
+                .stderr
+                .take()
+                .map(|src| copy(Stream::new(src, stderr_tee, true, filter))),
+        ];
+        let status = child.wait()?;
+        let mut counts = [ByteCounts::default(); 2];
+        for (count, copier) in counts.iter_mut().zip(copiers) {
+            if let Some(copier) = copier {
+                *count = copier.join().unwrap_or_default();
+            }
+        }
+        Ok(Outcome::Exited(status, counts))
+    }
+
+    fn copy<R: Read + Send + 'static>(mut stream: Stream<R>) -> thread::JoinHandle<ByteCounts> {
+        thread::spawn(move || {
+            let mut buf = vec![0u8; 64 * 1024];
+            while let Ok(n) = stream.src.read(&mut buf) {
+                if n == 0 || stream.emit(&buf[..n]).is_err() {
+                    break;
+                }
+            }
+            stream.finish()
+        })
+    }
+}
+
+/// Kills the child if supervision is abandoned early (e.g. on error).
+pub struct KillOnDrop(pub Child);
+
+impl Deref for KillOnDrop {
+    type Target = Child;
+
+    fn deref(&self) -> &Child {
+        &self.0
+    }
+}
+
+impl DerefMut for KillOnDrop {
+    fn deref_mut(&mut self) -> &mut Child {
+        &mut self.0
+    }
+}
+
+impl Drop for KillOnDrop {
+    fn drop(&mut self) {
+        if matches!(self.0.try_wait(), Ok(None)) {
+            let _ = self.0.kill();
+            let _ = self.0.wait();
+        }
+    }
+}
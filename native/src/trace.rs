@@ -0,0 +1,557 @@
+//! File-access tracing for `--trace-file`.
+//!
+//! The child is started under a seccomp filter that turns every
+//! path-taking open, create, rename, unlink and truncate call into a user
+//! notification. The listener descriptor is passed back to the launcher over
+//! a socket pair, and the supervision loop reads each call's path from the
+//! caller's memory, records it and lets the call continue unchanged. The
+//! filter is inherited, so the whole process tree is covered.
+//!
+//! Under Bubblewrap the filter is not installed on `bwrap` itself, which
+//! may be setuid and whose mount setup is not the command's: a copy of the
+//! launcher runs first inside the sandbox (`--trace-exec`, see [`exec`]),
+//! installs the filter and hands the listener out over an inherited socket.
+//!
+//! The traced tree runs in its own process group, which is killed once
+//! supervision ends: a descendant left behind would otherwise keep the
+//! filter with nobody answering it. Descendants that start a new session
+//! (`setsid`) leave the group and are not killed; once the launcher exits
+//! their traced calls fail with `ENOSYS`.
+//!
+//! fanotify would avoid the round trip per call but needs `CAP_SYS_ADMIN`
+//! for mount-wide marks, which the launcher does not have; ptrace would
+//! stop the child on every syscall rather than only the traced ones.
+//!
+//! Limitations: the kernel opens the executable and its interpreter itself,
+//! so `execve` targets are not recorded; paths are recorded as the caller
+//! wrote them, normalised lexically but with symbolic links unresolved; and
+//! calls are recorded whether or not they succeed.
+
+use crate::strategies::seccomp::SeccompFilter;
+use anyhow::{anyhow, Result};
+use std::collections::BTreeSet;
+use std::env;
+use std::ffi::OsStr;
+use std::fs;
+use std::io;
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd, RawFd};
+use std::os::unix::ffi::OsStrExt;
+use std::os::unix::process::CommandExt;
+use std::path::{Component, Path, PathBuf};
+use std::process::Command;
+
+const SECCOMP_IOCTL_NOTIF_RECV: libc::c_ulong = 0xc050_2100;
+const SECCOMP_IOCTL_NOTIF_SEND: libc::c_ulong = 0xc018_2101;
+const SECCOMP_IOCTL_NOTIF_ID_VALID: libc::c_ulong = 0x4008_2102;
+const SECCOMP_USER_NOTIF_FLAG_CONTINUE: u32 = 1;
+
+/// Names the descriptor [`exec`] sends the listener over.
+pub const SOCKET_ENV: &str = "WORKSPACE_LAUNCHER_TRACE_FD";
+
+/// Paths under these prefixes are kernel interfaces, not inputs or outputs.
+const IGNORED_PREFIXES: [&str; 3] = ["/proc", "/dev", "/sys"];
+
+#[repr(C)]
+#[derive(Default)]
+struct SeccompData {
+    nr: i32,
+    arch: u32,
+    instruction_pointer: u64,
+    args: [u64; 6],
+}
+
+#[repr(C)]
+#[derive(Default)]
+struct Notif {
+    id: u64,
+    pid: u32,
+    flags: u32,
+    data: SeccompData,
+}
+
+#[repr(C)]
+struct NotifResp {
+    id: u64,
+    val: i64,
+    error: i32,
+    flags: u32,
+}
+
+/// The traced syscalls.
+fn syscalls() -> Vec<libc::c_long> {
+    let mut nrs = vec![
+        libc::SYS_openat,
+        libc::SYS_openat2,
+        libc::SYS_truncate,
+        libc::SYS_unlinkat,
+        libc::SYS_renameat2,
+        libc::SYS_mkdirat,
+    ];
+    #[cfg(target_arch = "x86_64")]
+    nrs.extend([
+        libc::SYS_open,
+        libc::SYS_creat,
+        libc::SYS_rename,
+        libc::SYS_renameat,
+        libc::SYS_unlink,
+        libc::SYS_rmdir,
+        libc::SYS_mkdir,
+    ]);
+    nrs
+}
+
+/// A path argument: the directory descriptor it is relative to (if any)
+/// and the address of the string.
+type PathArg = (Option<u64>, u64);
+
+/// How a call touches its paths.
+enum Access {
+    Read(PathArg),
+    Write(PathArg),
+    /// Renames write both the source and the destination.
+    Write2(PathArg, PathArg),
+    /// `openat2`: the flags sit in a `struct open_how` at the given address.
+    OpenHow(PathArg, u64),
+}
+
+fn classify(data: &SeccompData) -> Option<Access> {
+    let a = data.args;
+    let nr = libc::c_long::from(data.nr);
+    #[cfg(target_arch = "x86_64")]
+    match nr {
+        libc::SYS_open => return open((None, a[0]), a[1]),
+        libc::SYS_creat | libc::SYS_unlink | libc::SYS_rmdir | libc::SYS_mkdir => {
+            return Some(Access::Write((None, a[0])));
+        }
+        libc::SYS_rename => return Some(Access::Write2((None, a[0]), (None, a[1]))),
+        libc::SYS_renameat => {
+            return Some(Access::Write2((Some(a[0]), a[1]), (Some(a[2]), a[3])));
+        }
+        _ => {}
+    }
+    match nr {
+        libc::SYS_openat => open((Some(a[0]), a[1]), a[2]),
+        libc::SYS_openat2 => Some(Access::OpenHow((Some(a[0]), a[1]), a[2])),
+        libc::SYS_truncate => Some(Access::Write((None, a[0]))),
+        libc::SYS_unlinkat | libc::SYS_mkdirat => Some(Access::Write((Some(a[0]), a[1]))),
+        libc::SYS_renameat2 => Some(Access::Write2((Some(a[0]), a[1]), (Some(a[2]), a[3]))),
+        _ => None,
+    }
+}
+
+/// Classifies an open by its flags; `O_PATH` opens touch no content.
+fn open(at: PathArg, flags: u64) -> Option<Access> {
+    let flags = libc::c_int::try_from(flags & 0x7fff_ffff).unwrap_or(0);
+    if flags & libc::O_PATH != 0 {
+        None
+    } else if flags & libc::O_ACCMODE != libc::O_RDONLY
+        || flags & (libc::O_CREAT | libc::O_TRUNC) != 0
+    {
+        Some(Access::Write(at))
+    } else {
+        Some(Access::Read(at))
+    }
+}
+
+/// Arranges for `command` to be traced once spawned.
+///
+/// With `inside`, `command` runs [`exec`] before the traced command (as the
+/// Bubblewrap strategy arranges), so the socket is only handed down to it;
+/// otherwise the filter is installed right before `command` execs. Either
+/// way `command` starts a new process group.
+///
+/// Must be called after every other `pre_exec` hook is registered: once
+/// the filter is installed, a traced call made before `exec` would wait
+/// for a launcher that is still blocked in `spawn`.
+pub fn attach(command: &mut Command, inside: bool) -> Result<Pending> {
+    let mut fds = [0; 2];
+    if unsafe {
+        libc::socketpair(
+            libc::AF_UNIX,
+            libc::SOCK_STREAM | libc::SOCK_CLOEXEC,
+            0,
+            fds.as_mut_ptr(),
+        )
+    } != 0
+    {
+        return Err(anyhow!("socketpair: {}", io::Error::last_os_error()));
+    }
+    let (ours, theirs) = unsafe { (OwnedFd::from_raw_fd(fds[0]), OwnedFd::from_raw_fd(fds[1])) };
+    let socket = theirs.as_raw_fd();
+
+    if inside {
+        command.env(SOCKET_ENV, socket.to_string());
+        unsafe {
+            command.pre_exec(move || {
+                check(libc::setpgid(0, 0))?;
+                check(libc::fcntl(socket, libc::F_SETFD, 0))
+            });
+        }
+    } else {
+        let filter = SeccompFilter::notify(&syscalls());
+        unsafe {
+            command.pre_exec(move || {
+                check(libc::setpgid(0, 0))?;
+                check(libc::prctl(libc::PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0))?;
+                let listener = filter.install_listener()?;
+                let sent = send_fd(socket, listener);
+                libc::close(listener);
+                sent
+            });
+        }
+    }
+    Ok(Pending {
+        socket: ours,
+        theirs,
+    })
+}
+
+/// Runs inside the sandbox for `--trace-exec`: installs the filter, sends
+/// its listener over the socket named by [`SOCKET_ENV`] and execs `cmd`.
+/// Only returns on failure.
+pub fn exec(cmd: &[String]) -> anyhow::Error {
+    let Some(socket) = env::var(SOCKET_ENV)
+        .ok()
+        .and_then(|fd| fd.parse::<RawFd>().ok())
+    else {
+        return anyhow!("{SOCKET_ENV} is not set");
+    };
+    env::remove_var(SOCKET_ENV);
+    let Some((program, args)) = cmd.split_first() else {
+        return anyhow!("No command provided to trace");
+    };
+    // Built before the filter is installed: from then on every traced
+    // call waits for the launcher, which only polls once it has the
+    // listener.
+    let mut command = Command::new(program);
+    command.args(args);
+    let filter = SeccompFilter::notify(&syscalls());
+    let sent = unsafe {
+        check(libc::prctl(libc::PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)).and_then(|()| {
+            let listener = filter.install_listener()?;
+            let sent = send_fd(socket, listener);
+            libc::close(listener);
+            sent
+        })
+    };
+    unsafe {
+        libc::close(socket);
+    }
+    if let Err(e) = sent {
+        return anyhow!("Cannot install the tracing filter: {e}");
+    }
+    anyhow!("Cannot run {program}: {}", command.exec())
+}
+
+fn check(ret: libc::c_int) -> io::Result<()> {
+    if ret < 0 {
+        Err(io::Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+/// A tracer waiting for its child to be spawned.
+pub struct Pending {
+    socket: OwnedFd,
+    /// The child's end, closed once it is spawned so that a child exiting
+    /// without sending the listener ends the wait.
+    theirs: OwnedFd,
+}
+
+impl Pending {
+    /// Receives the listener from the spawned child `pid`.
+    pub fn connect(self, pid: u32) -> Result<Tracer> {
+        drop(self.theirs);
+        let group = libc::pid_t::try_from(pid)?;
+        let listener = recv_fd(self.socket.as_raw_fd()).map_err(|e| {
+            unsafe {
+                libc::killpg(group, libc::SIGKILL);
+            }
+            anyhow!("File-access tracing unavailable: {e}")
+        })?;
+        Ok(Tracer {
+            listener,
+            group,
+            reads: BTreeSet::new(),
+            writes: BTreeSet::new(),
+        })
+    }
+}
+
+/// Collects the paths read and written by a traced process tree.
+pub struct Tracer {
+    listener: OwnedFd,
+    /// The traced tree's process group.
+    group: libc::pid_t,
+    reads: BTreeSet<PathBuf>,
+    writes: BTreeSet<PathBuf>,
+}
+
+impl Tracer {
+    /// The descriptor to poll for pending notifications.
+    #[must_use]
+    pub fn fd(&self) -> RawFd {
+        self.listener.as_raw_fd()
+    }
+
+    /// Handles every pending notification. Returns `false` once no traced
+    /// process is left.
+    pub fn handle(&mut self) -> bool {
+        loop {
+            let mut pollfd = libc::pollfd {
+                fd: self.fd(),
+                events: libc::POLLIN,
+                revents: 0,
+            };
+            // The receive ioctl blocks, so only call it when a
+            // notification is known to be pending.
+            if unsafe { libc::poll(std::ptr::addr_of_mut!(pollfd), 1, 0) } <= 0 {
+                return true;
+            }
+            if pollfd.revents & libc::POLLIN == 0 {
+                return pollfd.revents & (libc::POLLHUP | libc::POLLERR) == 0;
+            }
+            let mut notif = Notif::default();
+            if unsafe {
+                libc::ioctl(
+                    self.fd(),
+                    SECCOMP_IOCTL_NOTIF_RECV,
+                    std::ptr::addr_of_mut!(notif),
+                )
+            } != 0
+            {
+                // The caller died before the notification was received.
+                continue;
+            }
+            self.record(&notif);
+            let mut resp = NotifResp {
+                id: notif.id,
+                val: 0,
+                error: 0,
+                flags: SECCOMP_USER_NOTIF_FLAG_CONTINUE,
+            };
+            unsafe {
+                libc::ioctl(
+                    self.fd(),
+                    SECCOMP_IOCTL_NOTIF_SEND,
+                    std::ptr::addr_of_mut!(resp),
+                );
+            }
+        }
+    }
+
+    fn record(&mut self, notif: &Notif) {
+        let Some(access) = classify(&notif.data) else {
+            return;
+        };
+        let pid = notif.pid;
+        let access = match access {
+            Access::OpenHow(arg, how) => {
+                let flags = read_memory(pid, how, 8).map_or(0, |bytes| {
+                    u64::from_ne_bytes(bytes.try_into().unwrap_or_default())
+                });
+                match open(arg, flags) {
+                    Some(access) => access,
+                    None => return,
+                }
+            }
+            access => access,
+        };
+        let path = |(dirfd, addr): PathArg| resolve(pid, dirfd, addr);
+        let (reads, writes) = match access {
+            Access::Read(arg) => (vec![path(arg)], vec![]),
+            Access::Write(arg) | Access::OpenHow(arg, _) => (vec![], vec![path(arg)]),
+            Access::Write2(from, to) => (vec![], vec![path(from), path(to)]),
+        };
+        // The pid may have been reused while its memory was being read.
+        let mut id = notif.id;
+        if unsafe {
+            libc::ioctl(
+                self.fd(),
+                SECCOMP_IOCTL_NOTIF_ID_VALID,
+                std::ptr::addr_of_mut!(id),
+            )
+        } != 0
+        {
+            return;
+        }
+        for path in writes.into_iter().flatten().filter(|p| !ignored(p)) {
+            self.writes.insert(path);
+        }
+        for path in reads.into_iter().flatten().filter(|p| !ignored(p)) {
+            // A file the command wrote first is an output, not an input.
+            if !self.writes.contains(&path) {
+                self.reads.insert(path);
+            }
+        }
+    }
+
+    /// Writes `{"reads":[...],"writes":[...]}`, each sorted, to `path`.
+    pub fn finish(self, path: &str) -> Result<()> {
+        let mut out = String::from("{\"reads\":");
+        json_paths(&mut out, &self.reads);
+        out.push_str(",\"writes\":");
+        json_paths(&mut out, &self.writes);
+        out.push('}');
+        fs::write(path, out).map_err(|e| anyhow!("Cannot write trace file {path}: {e}"))
+    }
+}
+
+impl Drop for Tracer {
+    /// Kills what is left of the traced tree before the listener closes.
+    fn drop(&mut self) {
+        unsafe {
+            libc::killpg(self.group, libc::SIGKILL);
+        }
+    }
+}
+
+fn json_paths(out: &mut String, paths: &BTreeSet<PathBuf>) {
+    out.push('[');
+    for (i, path) in paths.iter().enumerate() {
+        if i > 0 {
+            out.push(',');
+        }
+        crate::git::json_string(out, &path.to_string_lossy());
+    }
+    out.push(']');
+}
+
+fn ignored(path: &Path) -> bool {
+    IGNORED_PREFIXES
+        .iter()
+        .any(|prefix| path.starts_with(prefix))
+}
+
+/// Reads the path at `addr` in `pid` and makes it absolute against
+/// `dirfd` (or the working directory), normalising `.` and `..`.
+fn resolve(pid: u32, dirfd: Option<u64>, addr: u64) -> Option<PathBuf> {
+    let raw = read_c_string(pid, addr)?;
+    let path = Path::new(OsStr::from_bytes(&raw));
+    let joined = if path.is_absolute() {
+        path.to_path_buf()
+    } else {
+        let dirfd = dirfd.map_or(libc::AT_FDCWD, |fd| {
+            libc::c_int::try_from(fd & 0xffff_ffff).map_or(libc::AT_FDCWD, |fd| fd)
+        });
+        let base = if dirfd == libc::AT_FDCWD {
+            format!("/proc/{pid}/cwd")
+        } else {
+            format!("/proc/{pid}/fd/{dirfd}")
+        };
+        fs::read_link(base).ok()?.join(path)
+    };
+    let mut normal = PathBuf::new();
+    for component in joined.components() {
+        match component {
+            Component::ParentDir => {
+                normal.pop();
+            }
+            Component::CurDir => {}
+            other => normal.push(other),
+        }
+    }
+    Some(normal)
+}
+
+/// Reads a NUL-terminated string of at most `PATH_MAX` bytes, one page at a
+/// time so that a string ending just before an unmapped page is still read.
+fn read_c_string(pid: u32, addr: u64) -> Option<Vec<u8>> {
+    const PAGE: u64 = 4096;
+    let limit = usize::try_from(libc::PATH_MAX).unwrap_or(4096);
+    let mut out = Vec::new();
+    let mut at = addr;
+    while out.len() < limit {
+        let len = usize::try_from(PAGE - at % PAGE).unwrap_or(1);
+        let chunk = read_memory(pid, at, len)?;
+        if let Some(end) = chunk.iter().position(|&b| b == 0) {
+            out.extend_from_slice(&chunk[..end]);
+            return Some(out);
+        }
+        out.extend_from_slice(&chunk);
+        at += PAGE - at % PAGE;
+    }
+    None
+}
+
+fn read_memory(pid: u32, addr: u64, len: usize) -> Option<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    let local = libc::iovec {
+        iov_base: buf.as_mut_ptr().cast(),
+        iov_len: len,
+    };
+    let remote = libc::iovec {
+        iov_base: usize::try_from(addr).ok()? as *mut libc::c_void,
+        iov_len: len,
+    };
+    let pid = libc::pid_t::try_from(pid).ok()?;
+    let n = unsafe {
+        libc::process_vm_readv(
+            pid,
+            std::ptr::addr_of!(local),
+            1,
+            std::ptr::addr_of!(remote),
+            1,
+            0,
+        )
+    };
+    let n = usize::try_from(n).ok().filter(|n| *n > 0)?;
+    buf.truncate(n);
+    Some(buf)
+}
+
+/// Sends `fd` over `socket`. Performs no heap allocation, so it is safe to
+/// call from a `pre_exec` hook.
+fn send_fd(socket: RawFd, fd: RawFd) -> io::Result<()> {
+    let mut control = [0u64; 4];
+    let mut byte = 0u8;
+    let mut iov = libc::iovec {
+        iov_base: std::ptr::addr_of_mut!(byte).cast(),
+        iov_len: 1,
+    };
+    unsafe {
+        let mut msg: libc::msghdr = std::mem::zeroed();
+        msg.msg_iov = std::ptr::addr_of_mut!(iov);
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.as_mut_ptr().cast();
+        msg.msg_controllen = libc::CMSG_SPACE(4) as _;
+        let cmsg = libc::CMSG_FIRSTHDR(std::ptr::addr_of!(msg));
+        (*cmsg).cmsg_level = libc::SOL_SOCKET;
+        (*cmsg).cmsg_type = libc::SCM_RIGHTS;
+        (*cmsg).cmsg_len = libc::CMSG_LEN(4) as _;
+        std::ptr::write_unaligned(libc::CMSG_DATA(cmsg).cast::<RawFd>(), fd);
+        if libc::sendmsg(socket, std::ptr::addr_of!(msg), 0) < 0 {
+            return Err(io::Error::last_os_error());
+        }
+    }
+    Ok(())
+}
+
+fn recv_fd(socket: RawFd) -> io::Result<OwnedFd> {
+    let mut control = [0u64; 4];
+    let mut byte = 0u8;
+    let mut iov = libc::iovec {
+        iov_base: std::ptr::addr_of_mut!(byte).cast(),
+        iov_len: 1,
+    };
+    unsafe {
+        let mut msg: libc::msghdr = std::mem::zeroed();
+        msg.msg_iov = std::ptr::addr_of_mut!(iov);
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.as_mut_ptr().cast();
+        msg.msg_controllen = std::mem::size_of_val(&control) as _;
+        if libc::recvmsg(socket, std::ptr::addr_of_mut!(msg), libc::MSG_CMSG_CLOEXEC) <= 0 {
+            return Err(io::Error::last_os_error());
+        }
+        let cmsg = libc::CMSG_FIRSTHDR(std::ptr::addr_of!(msg));
+        if cmsg.is_null() || (*cmsg).cmsg_type != libc::SCM_RIGHTS {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidData,
+                "no descriptor received",
+            ));
+        }
+        let fd = std::ptr::read_unaligned(libc::CMSG_DATA(cmsg).cast::<RawFd>());
+        Ok(OwnedFd::from_raw_fd(fd))
+    }
+}
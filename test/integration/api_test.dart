@@ -1,3 +1,5 @@
+import 'dart:async';
+import 'dart:convert';
 import 'dart:io';
 import 'package:test/test.dart';
 import 'package:path/path.dart' as p;
@@ -50,5 +52,510 @@ void main() {
       expect(result.isCancelled, isTrue);
       expect(stopwatch.elapsed.inSeconds, lessThan(5));
     });
+
+    test('Should wait for output split across chunks', () async {
+      final cmd = Platform.isWindows
+          ? 'echo ready on 4000 & ping -n 5 127.0.0.1 >nul'
+          : "printf 'rea'; sleep 0.3; printf 'dy on 4000\\n'; sleep 5";
+      final process = await ws.execStream(cmd);
+
+      final match = await process.waitForOutput(RegExp(r'ready on (\d+)'),
+          timeout: const Duration(seconds: 5));
+      expect(match.group(1), equals('4000'));
+      process.kill();
+    });
+
+    test('Should decode JSON and NDJSON output as it streams', () async {
+      await ws.fs.writeFile('doc.json', '{"name": "pkg", "deps": [1, 2]}');
+      await ws.fs
+          .writeFile('events.ndjson', '{"n": 1}\n\n[2]\nnot json\n3\n');
+
+      final doc = await ws.execJson(['cat', 'doc.json']);
+      expect(doc.isSuccess, isTrue);
+      expect(doc.json, equals({'name': 'pkg', 'deps': [1, 2]}));
+      expect(doc.stdout, isEmpty);
+
+      await expectLater(ws.execJson(['cat', 'events.ndjson']),
+          throwsA(isA<FormatException>()));
+
+      final records = <Object?>[];
+      final errors = <Object>[];
+      await ws
+          .execNdjson('cat events.ndjson; echo broken >&2; exit 3')
+          .handleError(errors.add)
+          .forEach(records.add);
+      expect(
+          records,
+          equals([
+            {'n': 1},
+            [2],
+            3
+          ]));
+      expect(errors, hasLength(2));
+      expect(errors.first, isA<FormatException>());
+      expect(errors.last, isA<ProcessException>());
+      expect((errors.last as ProcessException).message, equals('broken'));
+    }, skip: Platform.isWindows ? 'uses cat' : null);
+
+    test('Should fail output waiters when the process exits', () async {
+      final process = await ws.execStream('echo done');
+      await expectLater(
+          process.waitForOutput(RegExp('never'),
+              timeout: const Duration(seconds: 5)),
+          throwsStateError);
+    });
+
+    test('Should run heavy fs helpers on a bounded isolate pool', () async {
+      final pool = IsolatePool(size: 2);
+      addTearDown(pool.close);
+      final fs = FileSystemService(ws.rootPath, pool: pool);
+      for (var i = 0; i < 50; i++) {
+        await fs.writeFile('src/file_$i.txt', 'line\nneedle $i\n');
+      }
+
+      var ticks = 0;
+      final ticker =
+          Timer.periodic(const Duration(milliseconds: 1), (_) => ticks++);
+      final results = await Future.wait([
+        fs.tree(),
+        fs.grep('needle'),
+        fs.find('file_4*.txt'),
+        fs.copy('src', 'copy').then((_) => ''),
+      ]);
+      ticker.cancel();
+
+      expect(pool.workerCount, lessThanOrEqualTo(2));
+      expect(results[0], contains('file_49.txt'));
+      expect((results[1] as String).split('\n'), hasLength(50));
+      expect(results[2], hasLength(11));
+      expect(await fs.exists('copy/file_0.txt'), isTrue);
+      expect(ticks, greaterThan(0));
+    });
+
+    test('Should diff files without spawning a process', () async {
+      await ws.fs.writeFile('old.txt', 'one\ntwo\nthree\n');
+      await ws.fs.writeFile('new.txt', 'one\n2\nthree\n');
+      await ws.fs.writeFile('same.txt', 'one\ntwo\nthree\n');
+
+      final diff = await ws.fs.diff('old.txt', 'new.txt');
+      expect(diff.unified, startsWith('--- old.txt\n+++ new.txt\n'));
+      expect(diff.unified, contains('-two\n+2\n'));
+      expect((await ws.fs.diff('old.txt', 'same.txt')).isIdentical, isTrue);
+
+      final big = [for (var i = 0; i < 50000; i++) 'row $i'].join('\n');
+      await ws.fs.writeFile('big_a.txt', big);
+      await ws.fs.writeFile('big_b.txt', big.replaceFirst('row 25000', 'x'));
+      final bigDiff = await ws.fs.diff('big_a.txt', 'big_b.txt');
+      expect(bigDiff.hunks.single.header, equals('@@ -24998,7 +24998,7 @@'));
+      await expectLater(ws.fs.diff('old.txt', 'missing.txt'),
+          throwsA(isA<FileSystemException>()));
+    });
+
+    test('Should apply edits across files atomically', () async {
+      await ws.fs.writeFile('lib/a.txt', 'fetchUser();\nfetchUser();\n');
+      await ws.fs.writeFile('lib/b.txt', 'one\ntwo\nthree\n');
+      await ws.fs.writeFile('lib/old.txt', 'legacy\n');
+      await ws.fs.writeFile('target.txt', 'one\n2\nthree\n');
+      final patch = (await ws.fs.diff('lib/b.txt', 'target.txt')).unified;
+
+      final changed = await ws.fs.applyEdits([
+        FileEdit.replace('lib/a.txt', 'fetchUser', 'loadUser', all: true),
+        FileEdit.patch(patch, path: 'lib/b.txt'),
+        FileEdit.write('lib/new.txt', 'fresh\n'),
+        FileEdit.delete('lib/old.txt'),
+      ]);
+      expect(changed, unorderedEquals(
+          ['lib/a.txt', 'lib/b.txt', 'lib/new.txt', 'lib/old.txt']));
+      expect(await ws.fs.readFile('lib/a.txt'),
+          equals('loadUser();\nloadUser();\n'));
+      expect(await ws.fs.readFile('lib/b.txt'), equals('one\n2\nthree\n'));
+      expect(await ws.fs.exists('lib/old.txt'), isFalse);
+
+      // One failing edit leaves every file untouched.
+      await expectLater(
+          ws.fs.applyEdits([
+            FileEdit.write('lib/a.txt', 'changed\n'),
+            FileEdit.patch(patch, path: 'lib/b.txt'),
+          ]),
+          throwsA(isA<EditException>()));
+      expect(await ws.fs.readFile('lib/a.txt'),
+          equals('loadUser();\nloadUser();\n'));
+      await expectLater(
+          ws.fs.applyEdits([FileEdit.replace('lib/a.txt', 'loadUser', 'x')]),
+          throwsA(isA<EditException>()));
+    });
+
+    test('Should keep file permissions when applying edits', () async {
+      await ws.fs.writeFile('run.sh', '#!/bin/sh\necho one\n');
+      await ws.exec('chmod 755 run.sh');
+      await ws.fs.applyEdits([FileEdit.replace('run.sh', 'one', 'two')]);
+
+      final result = await ws.exec('./run.sh');
+      expect(result.stdout.trim(), equals('two'));
+    }, skip: Platform.isWindows ? 'POSIX permissions' : null);
+
+    test('Should rerun watched commands on matching changes', () async {
+      await ws.fs.writeFile('data.txt', 'v1');
+      final results = StreamIterator(ws.watch('cat data.txt',
+          paths: ['*.txt'], debounce: const Duration(milliseconds: 100)));
+      addTearDown(results.cancel);
+
+      expect(await results.moveNext(), isTrue);
+      expect(results.current.stdout, equals('v1'));
+
+      await ws.fs.writeFile('ignored.log', 'x');
+      for (var i = 2; i <= 5; i++) {
+        await ws.fs.writeFile('data.txt', 'v$i');
+      }
+      expect(
+          await results.moveNext().timeout(const Duration(seconds: 5)), isTrue);
+      expect(results.current.stdout, equals('v5'));
+    });
+
+    test('Should skip ignored paths in tree, find and grep', () async {
+      await ws.fs.writeFile('.gitignore', 'build/\n*.log\n!keep.log\n');
+      await ws.fs.writeFile('.wsignore', 'fixtures/\n');
+      await ws.fs.writeFile('lib/main.dart', 'needle\n');
+      await ws.fs.writeFile('lib/.gitignore', '/gen.dart\n');
+      await ws.fs.writeFile('lib/gen.dart', 'needle\n');
+      await ws.fs.writeFile('lib/sub/gen.dart', 'needle\n');
+      await ws.fs.writeFile('build/out.dart', 'needle\n');
+      await ws.fs.writeFile('node_modules/pkg/index.dart', 'needle\n');
+      await ws.fs.writeFile('fixtures/big.dart', 'needle\n');
+      await ws.fs.writeFile('debug.log', 'needle\n');
+      await ws.fs.writeFile('keep.log', 'needle\n');
+
+      expect(
+          await ws.fs.find('*.dart'),
+          equals(
+              [p.join('lib', 'main.dart'), p.join('lib', 'sub', 'gen.dart')]));
+      expect(
+          (await ws.fs.grep('needle')).split('\n').map((l) => l.split(':')[0]),
+          equals([
+            'keep.log',
+            p.join('lib', 'main.dart'),
+            p.join('lib', 'sub', 'gen.dart'),
+          ]));
+      final tree = await ws.fs.tree();
+      expect(tree, isNot(contains('node_modules')));
+      expect(tree, isNot(contains('build')));
+      expect(tree, contains('main.dart'));
+
+      final all = await ws.fs.find('*.dart', includeIgnored: true);
+      expect(all, contains(p.join('node_modules', 'pkg', 'index.dart')));
+      expect(all, contains(p.join('build', 'out.dart')));
+    });
+
+    test('Should serve repeated reads from the content cache', () async {
+      final cache = ws.fs.enableCache(maxBytes: 1 << 20);
+      await ws.fs.writeFile('package.json', '{"v": 1}');
+
+      expect(await ws.fs.readFile('package.json'), equals('{"v": 1}'));
+      expect(await ws.fs.readFile('package.json'), equals('{"v": 1}'));
+      expect(await ws.fs.readBytes('package.json'),
+          equals(utf8.encode('{"v": 1}')));
+      // A late watcher event for the write may cost one more miss.
+      expect(cache.hits, greaterThanOrEqualTo(1));
+      expect(cache.hits + cache.misses, equals(3));
+
+      // Same size, written behind the service's back.
+      await ws.exec('printf \'{"v": 2}\' > package.json');
+      expect(await ws.fs.readFile('package.json'), equals('{"v": 2}'));
+
+      await ws.fs.writeFile('package.json', '{"v": 3}');
+      expect(await ws.fs.readFile('package.json'), equals('{"v": 3}'));
+
+      await ws.fs.delete('package.json');
+      await expectLater(ws.fs.readFile('package.json'),
+          throwsA(isA<FileSystemException>()));
+      expect(cache.length, equals(0));
+    }, skip: Platform.isWindows ? 'POSIX shell quoting' : null);
+
+    test('Should track disk usage and enforce the quota', () async {
+      final ws = Workspace.ephemeral(
+          options: const WorkspaceOptions(
+              diskQuota: DiskQuota(
+                  maxBytes: 64 * 1024,
+                  checkInterval: Duration(milliseconds: 100))));
+      addTearDown(ws.dispose);
+
+      await ws.fs.writeFile('a/one.txt', 'x' * 1000);
+      await ws.fs.writeBytes('a/b/two.bin', List.filled(2000, 0));
+      var usage = await ws.usage();
+      expect(usage.bytes, equals(3000));
+      expect(usage.files, equals(2));
+      expect(usage.directories, equals(2));
+
+      await ws.fs.delete('a/b');
+      usage = await ws.usage();
+      expect(usage.bytes, equals(1000));
+      expect(usage.inodes, equals(2));
+
+      await expectLater(ws.fs.writeFile('big.txt', 'x' * 70000),
+          throwsA(isA<QuotaExceededException>()));
+      expect(await ws.fs.exists('big.txt'), isFalse);
+
+      // Checked together, the writes still see each other's growth.
+      final writes = await Future.wait([
+        for (var i = 0; i < 4; i++)
+          ws.fs
+              .writeBytes('part$i.bin', List.filled(20000, 0))
+              .then((_) => true, onError: (Object _) => false),
+      ]);
+      expect(writes.where((ok) => ok), hasLength(3));
+      for (var i = 0; i < 4; i++) {
+        if (writes[i]) await ws.fs.delete('part$i.bin');
+      }
+
+      final result = await ws.exec(
+          'while true; do head -c 8192 /dev/zero >> fill.bin; sleep 0.05; done',
+          options: const WorkspaceOptions(timeout: Duration(seconds: 20)));
+      expect(result.isCancelled, isTrue);
+      expect(result.duration, lessThan(const Duration(seconds: 15)));
+      expect(await File(p.join(ws.rootPath, 'fill.bin')).length(),
+          lessThan(1024 * 1024));
+    }, skip: Platform.isWindows ? 'POSIX shell loop' : null);
+
+    test('Should trace the files a command reads and writes', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      await ws.fs.writeFile('src/in.txt', 'data\n');
+
+      final result = await ws.exec(
+          'cat src/in.txt > out.txt && mkdir -p gen && mv out.txt gen/ '
+          '&& cat gen/out.txt',
+          options: const WorkspaceOptions(traceFileAccess: true));
+      expect(result.isSuccess, isTrue, reason: result.stderr);
+      final access = result.fileAccess!.relativeTo(ws.rootPath);
+      expect(access.reads, equals(['src/in.txt']));
+      expect(access.writes, equals(['gen', 'gen/out.txt', 'out.txt']));
+
+      final untraced = await ws.exec('cat src/in.txt');
+      expect(untraced.fileAccess, isNull);
+    }, skip: Platform.isLinux ? null : 'tracing needs the Linux launcher');
+
+    test('Should trace only the command inside a sandbox', () async {
+      final ws = Workspace.ephemeral(
+          options: const WorkspaceOptions(sandbox: true));
+      addTearDown(ws.dispose);
+      await ws.fs.writeFile('in.txt', 'data\n');
+
+      final result = await ws.exec('cat in.txt > out.txt',
+          options: const WorkspaceOptions(
+              sandbox: true, traceFileAccess: true));
+      expect(result.isSuccess, isTrue, reason: result.stderr);
+      // Bubblewrap's own mount setup would show up as writes outside the
+      // workspace.
+      final access = result.fileAccess!;
+      expect(access.writes, equals([p.join(ws.rootPath, 'out.txt')]));
+      expect(access.reads, contains(p.join(ws.rootPath, 'in.txt')));
+    }, skip: Platform.isLinux ? null : 'tracing needs the Linux launcher');
+
+    test('Should kill processes a traced command leaves behind', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+
+      final result = await ws.exec(
+          'sleep 30 >/dev/null 2>&1 & echo \$! > bg.pid',
+          options: const WorkspaceOptions(traceFileAccess: true));
+      expect(result.isSuccess, isTrue, reason: result.stderr);
+      final pid = (await ws.fs.readFile('bg.pid')).trim();
+      await Future<void>.delayed(const Duration(milliseconds: 200));
+      final stat = File('/proc/$pid/stat');
+      final alive = await stat.exists() &&
+          (await stat.readAsString()).split(' ')[2] != 'Z';
+      expect(alive, isFalse);
+    }, skip: Platform.isLinux ? null : 'tracing needs the Linux launcher');
+
+    test('Should normalize output in the launcher', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      const script =
+          r"printf '10%%\r50%%\r100%%\n\033[31mred\033[0m\nx\nx\nx\n'";
+
+      final result = await ws.exec(script,
+          options: const WorkspaceOptions(outputFilter: OutputFilter()));
+      expect(result.stdout,
+          equals('100%\nred\nx\n[previous line repeated 2 more times]\n'));
+      final stats = result.outputStats!;
+      expect(stats.stdout.raw, equals(32));
+      expect(stats.stdout.normalized, equals(result.stdout.length));
+      expect(stats.stderr.raw, equals(0));
+
+      final colorOnly = await ws.exec(script,
+          options: const WorkspaceOptions(
+              outputFilter: OutputFilter(
+                  collapseCarriageReturns: false, foldRepeats: false)));
+      expect(colorOnly.stdout, equals('10%\r50%\r100%\nred\nx\nx\nx\n'));
+
+      final raw = await ws.exec(script);
+      expect(raw.stdout, contains('\x1b[31m'));
+      expect(raw.outputStats, isNull);
+    }, skip: Platform.isWindows ? 'POSIX shell quoting' : null);
+
+    test('Should sample resources of a running process', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      final events = <ProcessStatsEvent>[];
+      final sub = ws.onEvent
+          .where((e) => e is ProcessStatsEvent)
+          .listen((e) => events.add(e as ProcessStatsEvent));
+      addTearDown(sub.cancel);
+
+      final process = await ws.execStream(
+          'i=0; while [ \$i -lt 200000 ]; do i=\$((i+1)); done; sleep 0.3',
+          options: const WorkspaceOptions(
+              sampleInterval: Duration(milliseconds: 50)));
+      final samples = await process.stats.toList();
+      expect(await process.exitCode, equals(0));
+
+      expect(samples, isNotEmpty);
+      expect(samples.first.processes, greaterThanOrEqualTo(1));
+      expect(samples.first.rssBytes, greaterThan(0));
+      expect(samples.last.cpuTime, greaterThan(Duration.zero));
+      for (var i = 1; i < samples.length; i++) {
+        expect(samples[i].elapsed, greaterThan(samples[i - 1].elapsed));
+        expect(samples[i].cpuTime,
+            greaterThanOrEqualTo(samples[i - 1].cpuTime));
+      }
+      expect(samples.any((s) => s.cpuUsage > 0.2), isTrue);
+      await pumpEventQueue();
+      expect(events.map((e) => e.stats), equals(samples));
+      expect(events.every((e) => e.pid == process.pid), isTrue);
+
+      final unsampled = await ws.execStream('true');
+      expect(await unsampled.stats.isEmpty, isTrue);
+    }, skip: Platform.isLinux ? null : 'sampling needs the Linux launcher');
+
+    test('Should kill a command that stops making progress', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      const options = WorkspaceOptions(
+          idleTimeout: Duration(milliseconds: 300),
+          timeout: Duration(seconds: 20));
+
+      final watch = Stopwatch()..start();
+      final stuck = await ws.exec('echo waiting; sleep 30', options: options);
+      expect(stuck.terminationReason, equals(TerminationReason.idle));
+      expect(stuck.isCancelled, isTrue);
+      expect(stuck.stdout, contains('waiting'));
+      expect(watch.elapsed, lessThan(const Duration(seconds: 5)));
+
+      // Output keeps resetting the clock.
+      final chatty = await ws.exec(
+          'for i in 1 2 3 4 5 6; do echo \$i; sleep 0.1; done',
+          options: options);
+      expect(chatty.exitCode, equals(0));
+      expect(chatty.terminationReason, isNull);
+
+      final killed = await ws.execStream('sleep 30');
+      killed.kill();
+      await killed.exitCode;
+      expect(killed.terminationReason, equals(TerminationReason.killed));
+    }, skip: Platform.isLinux ? null : 'idle checks need the Linux launcher');
+
+    test('Should apply CPU affinity and scheduling priority', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      const probe = 'grep Cpus_allowed_list /proc/self/status; '
+          'cut -d" " -f19 /proc/self/stat; chrt -p \$\$; ionice -p \$\$';
+
+      final pinned = await ws.exec(probe,
+          options: const WorkspaceOptions(
+              priority: ProcessPriority(
+                  cpus: CpuSet([0]),
+                  nice: 7,
+                  scheduling: CpuScheduling.batch,
+                  io: IoPriority.idle())));
+      expect(pinned.exitCode, equals(0), reason: pinned.stderr);
+      expect(pinned.stdout, contains(RegExp(r'Cpus_allowed_list:\s+0\n')));
+      expect(pinned.stdout, contains(RegExp(r'^7$', multiLine: true)));
+      expect(pinned.stdout, contains('SCHED_BATCH'));
+      expect(pinned.stdout, contains('idle'));
+
+      // A spread pins the workspace to one of the groups it allows.
+      final spread = await ws.exec('grep Cpus_allowed_list /proc/self/status',
+          options: const WorkspaceOptions(
+              priority: ProcessPriority(cpus: CpuSet.spread(width: 1))));
+      expect(spread.stdout, matches(RegExp(r'Cpus_allowed_list:\s+\d+\n')));
+    }, skip: Platform.isLinux ? null : 'affinity needs the Linux launcher');
+
+    test('Should report git status without spawning git', () async {
+      final ws = Workspace.ephemeral();
+      addTearDown(ws.dispose);
+      Future<void> git(List<String> args) async {
+        final result = await Process.run('git', args,
+            workingDirectory: ws.rootPath);
+        expect(result.exitCode, equals(0), reason: '${result.stderr}');
+      }
+
+      await expectLater(ws.git.status(), throwsA(isA<GitException>()));
+      await git(['init', '-q', '-b', 'main']);
+      await ws.fs.writeFile('.gitignore', '*.log\n');
+      await ws.fs.writeFile('lib/a.txt', 'one\n');
+      await ws.fs.writeFile('lib/b.txt', 'two\n');
+      await git(['add', '-A']);
+      await git(
+          ['-c', 'user.name=t', '-c', 'user.email=t@t', 'commit', '-qm', 'x']);
+      expect((await ws.git.status()).isClean, isTrue);
+
+      await ws.fs.writeFile('lib/a.txt', 'changed\n');
+      await ws.fs.delete('lib/b.txt');
+      await ws.fs.writeFile('new/c.txt', 'new\n');
+      await ws.fs.writeFile('debug.log', 'ignored\n');
+      final status = await ws.git.status();
+      expect(status.branch, equals('main'));
+      expect(status.head, hasLength(40));
+      expect(status.entries.map((e) => e.toString()),
+          equals([' M lib/a.txt', ' D lib/b.txt', '?? new/']));
+
+      await git(['add', 'lib/a.txt']);
+      final staged = await ws.git.status(untracked: GitUntracked.no);
+      expect(staged.entries.single.toString(), equals('M  lib/a.txt'));
+      expect(await ws.git.changedFiles(),
+          equals(['lib/a.txt', 'lib/b.txt', 'new/c.txt']));
+
+      // A split index is left to git itself.
+      await git(['update-index', '--split-index']);
+      final split = await ws.git.status();
+      expect(split.branch, equals('main'));
+      expect(split.head, equals(status.head));
+      expect(split.entries.map((e) => e.toString()),
+          equals(['M  lib/a.txt', ' D lib/b.txt', '?? new/']));
+    });
+
+    test('Should run commands through remote launcher daemons', () async {
+      final first = await LauncherDaemon.bind(InternetAddress.loopbackIPv4, 0,
+          token: 'secret', capacity: 1);
+      final second = await LauncherDaemon.bind(
+          InternetAddress.loopbackIPv4, 0,
+          token: 'secret', capacity: 1);
+      addTearDown(first.close);
+      addTearDown(second.close);
+      await expectLater(
+          RemoteLauncher.connect([first.endpoint], token: 'wrong'),
+          throwsA(isA<SocketException>()));
+
+      final remote = await RemoteLauncher.connect(
+          [first.endpoint, second.endpoint],
+          token: 'secret');
+      addTearDown(remote.close);
+      final a = Workspace.ephemeral(backend: remote.backendFor);
+      final b = Workspace.ephemeral(backend: remote.backendFor);
+      addTearDown(a.dispose);
+      addTearDown(b.dispose);
+      expect(remote.daemons.map((d) => d.workspaces), equals([1, 1]));
+
+      final result = await a.exec('echo hello; echo oops >&2; exit 3');
+      expect(result.exitCode, equals(3));
+      expect(result.stdout.trim(), equals('hello'));
+      expect(result.stderr.trim(), equals('oops'));
+
+      final process = await b.execStream(['sh', '-c', 'echo up; sleep 30']);
+      await process.waitForOutput(RegExp('up'),
+          timeout: const Duration(seconds: 5));
+      process.kill();
+      expect(await process.exitCode, isNot(0));
+    });
   });
 }
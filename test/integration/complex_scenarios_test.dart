@@ -1,4 +1,5 @@
 import 'dart:io';
+import 'package:path/path.dart' as p;
 import 'package:test/test.dart';
 import 'package:workspace_sandbox/workspace_sandbox.dart';
 
@@ -46,5 +47,248 @@ void main() {
         expect(outputFileContent.trim(), equals('DATA'));
       }
     });
+
+    test('Shared cache is writable and visible across workspaces', () async {
+      final cacheRoot = Directory.systemTemp.createTempSync('ws_cache_');
+      final cache = CacheMount(p.join(cacheRoot.path, 'tool'),
+          env: {'TOOL_CACHE': p.join(cacheRoot.path, 'tool')});
+      final options = WorkspaceOptions(caches: [cache]);
+      final writer = Workspace.ephemeral(options: options);
+      final reader = Workspace.ephemeral(options: options);
+
+      try {
+        final cmd = Platform.isWindows
+            ? 'echo HIT> "%TOOL_CACHE%\\entry.txt"'
+            : 'echo HIT > "\$TOOL_CACHE/entry.txt"';
+        final write = await writer.exec(cmd);
+        expect(write.exitCode, 0);
+
+        final readCmd = Platform.isWindows
+            ? 'type "%TOOL_CACHE%\\entry.txt"'
+            : 'cat "\$TOOL_CACHE/entry.txt"';
+        final read = await reader.exec(readCmd);
+        expect(read.stdout.trim(), equals('HIT'));
+      } finally {
+        await writer.dispose();
+        await reader.dispose();
+        await cacheRoot.delete(recursive: true);
+      }
+    });
+
+    test('Shared cache keeps entries outside its writable list read-only',
+        () async {
+      final cacheRoot = Directory.systemTemp.createTempSync('ws_cache_');
+      final dir = p.join(cacheRoot.path, 'tool');
+      final cache = CacheMount(dir,
+          env: {'TOOL_HOME': dir}, writable: const ['registry/']);
+      final ws = Workspace.ephemeral(
+          options: WorkspaceOptions(sandbox: true, caches: [cache]));
+
+      try {
+        final fetch = await ws.exec('echo PKG > "\$TOOL_HOME/registry/pkg"');
+        expect(fetch.exitCode, 0, reason: fetch.stderr);
+        expect(File(p.join(dir, 'registry', 'pkg')).existsSync(), isTrue);
+
+        final plant = await ws.exec('echo EVIL > "\$TOOL_HOME/config.toml"');
+        expect(plant.exitCode, isNot(0));
+        expect(File(p.join(dir, 'config.toml')).existsSync(), isFalse);
+      } finally {
+        await ws.dispose();
+        await cacheRoot.delete(recursive: true);
+      }
+    }, testOn: 'linux || mac-os');
+
+    test('Output redirect writes to a workspace file', () async {
+      final res = await ws.exec('echo LOGLINE',
+          options: const WorkspaceOptions(
+              stdoutTo: OutputRedirect('logs/build.log')));
+      expect(res.exitCode, 0);
+      expect(res.stdout, isNot(contains('LOGLINE')));
+      expect(res.stdoutFile?.bytes, greaterThan(0));
+      expect(await ws.fs.readFile('logs/build.log'), contains('LOGLINE'));
+
+      final appended = await ws.exec('echo SECOND',
+          options: const WorkspaceOptions(
+              stdoutTo: OutputRedirect('logs/build.log',
+                  append: true, tee: true)));
+      expect(appended.stdout, contains('SECOND'));
+      final log = await ws.fs.readFile('logs/build.log');
+      expect(log, contains('LOGLINE'));
+      expect(log, contains('SECOND'));
+    });
+
+    test('Output redirect rejects paths outside the workspace', () async {
+      expect(
+          () => ws.exec('echo x',
+              options:
+                  const WorkspaceOptions(stdoutTo: OutputRedirect('../x.log'))),
+          throwsA(isA<SecurityException>()));
+    });
+
+    test('Output redirect does not follow symlinks', () async {
+      final outside = Directory.systemTemp.createTempSync('ws_outside_');
+      final target = File(p.join(outside.path, 'target.log'))
+        ..writeAsStringSync('ORIGINAL');
+      try {
+        Link(p.join(ws.rootPath, 'out.log')).createSync(target.path);
+        Link(p.join(ws.rootPath, 'logs')).createSync(outside.path);
+
+        for (final path in ['out.log', 'logs/target.log', 'logs/new.log']) {
+          await expectLater(
+              () => ws.exec('echo PWNED',
+                  options: WorkspaceOptions(stdoutTo: OutputRedirect(path))),
+              throwsA(isA<SecurityException>()),
+              reason: path);
+        }
+        expect(target.readAsStringSync(), equals('ORIGINAL'));
+        expect(File(p.join(outside.path, 'new.log')).existsSync(), isFalse);
+      } finally {
+        await outside.delete(recursive: true);
+      }
+    }, testOn: '!windows');
+
+    test('In-process launcher runs commands without the binary', () async {
+      final launcher = await InProcessLauncher.enable();
+      if (launcher == null) {
+        markTestSkipped('launcher shared library not available');
+        return;
+      }
+      try {
+        final res = await ws.exec('echo INPROC; exit 3');
+        expect(res.stdout.trim(), equals('INPROC'));
+        expect(res.exitCode, 3);
+      } finally {
+        InProcessLauncher.disable();
+      }
+    }, testOn: '!windows');
+
+    test('In-process exit codes survive traced execs alongside', () async {
+      final launcher = await InProcessLauncher.enable();
+      if (launcher == null) {
+        markTestSkipped('launcher shared library not available');
+        return;
+      }
+      try {
+        // The traced exec needs the binary; started through `dart:io`, its
+        // exit handling would reap the in-process commands.
+        final results = await Future.wait([
+          ws.exec('sleep 0.3; exit 4',
+              options: const WorkspaceOptions(traceFileAccess: true)),
+          for (var i = 0; i < 8; i++) ws.exec('sleep 0.1; exit $i'),
+        ]);
+        expect(results.first.exitCode, 4, reason: results.first.stderr);
+        expect(results.first.fileAccess, isNotNull);
+        for (var i = 0; i < 8; i++) {
+          expect(results[i + 1].exitCode, i);
+        }
+      } finally {
+        InProcessLauncher.disable();
+      }
+    }, testOn: 'linux');
+
+    test('In-process kill stops background children too', () async {
+      final launcher = await InProcessLauncher.enable();
+      if (launcher == null) {
+        markTestSkipped('launcher shared library not available');
+        return;
+      }
+      try {
+        final process = await ws.execStream(
+            r'sleep 30 >/dev/null 2>&1 & echo "bg $!"; wait');
+        final match = await process.waitForOutput(RegExp(r'bg (\d+)'),
+            timeout: const Duration(seconds: 5));
+        final background = Directory('/proc/${match.group(1)}');
+        expect(background.existsSync(), isTrue);
+
+        process.kill();
+        await process.exitCode;
+        final deadline = DateTime.now().add(const Duration(seconds: 5));
+        while (_isRunning(background) && DateTime.now().isBefore(deadline)) {
+          await Future<void>.delayed(const Duration(milliseconds: 50));
+        }
+        expect(_isRunning(background), isFalse);
+      } finally {
+        InProcessLauncher.disable();
+      }
+    }, testOn: 'linux');
+
+    test('Offline package mirror is injected into workspaces', () async {
+      final cacheRoot = Directory.systemTemp.createTempSync('ws_mirror_');
+      final mirror =
+          await PackageMirror.start(cacheDir: cacheRoot.path, offline: true);
+      final mirrored = Workspace.ephemeral(
+          options: WorkspaceOptions(packageMirror: mirror));
+
+      try {
+        final client = HttpClient();
+        final request =
+            await client.getUrl(Uri.parse('${mirror.baseUrl}/npm/left-pad'));
+        final response = await request.close();
+        await response.drain<void>();
+        client.close();
+        expect(response.statusCode, HttpStatus.notFound);
+
+        final cmd = Platform.isWindows
+            ? 'echo %npm_config_registry%'
+            : 'echo "\$npm_config_registry"';
+        final res = await mirrored.exec(cmd);
+        expect(res.stdout.trim(), equals('${mirror.baseUrl}/npm/'));
+      } finally {
+        await mirrored.dispose();
+        await mirror.close();
+        await cacheRoot.delete(recursive: true);
+      }
+    });
+
+    test('No-network sandbox reaches the mirror through the relay', () async {
+      if (Process.runSync('which', ['curl']).exitCode != 0) {
+        markTestSkipped('curl is not installed');
+        return;
+      }
+      final cacheRoot = Directory.systemTemp.createTempSync('ws_mirror_');
+      final entry = Directory(p.join(cacheRoot.path, 'npm', 'left-pad'))
+        ..createSync(recursive: true);
+      File(p.join(entry.path, '#body'))
+          .writeAsStringSync('{"name":"left-pad"}');
+      File(p.join(entry.path, '#meta')).writeAsStringSync(
+          '{"contentType":"application/json",'
+          '"fetchedAt":"${DateTime.now().toIso8601String()}"}');
+      final mirror =
+          await PackageMirror.start(cacheDir: cacheRoot.path, offline: true);
+      final sandboxed = Workspace.ephemeral(
+          options: WorkspaceOptions(
+              sandbox: true, allowNetwork: false, packageMirror: mirror));
+
+      try {
+        final fetch = await sandboxed
+            .exec('curl -sf "\${npm_config_registry}left-pad"');
+        expect(fetch.exitCode, 0, reason: fetch.stderr);
+        expect(fetch.stdout, contains('"name":"left-pad"'));
+
+        final config = await sandboxed.exec('cat "\$CARGO_HOME/config.toml"');
+        expect(config.stdout, contains('workspace-mirror'));
+
+        final tamper = await sandboxed
+            .exec('echo "[source.evil]" >> "\$CARGO_HOME/config.toml"');
+        expect(tamper.exitCode, isNot(0));
+        expect(
+            File(p.join(cacheRoot.path, 'cargo-home', 'config.toml'))
+                .readAsStringSync(),
+            isNot(contains('evil')));
+      } finally {
+        await sandboxed.dispose();
+        await mirror.close();
+        await cacheRoot.delete(recursive: true);
+      }
+    }, testOn: 'linux');
   });
 }
+
+/// Whether the process at [dir] (under `/proc`) exists and is not a zombie.
+bool _isRunning(Directory dir) {
+  try {
+    return File('${dir.path}/stat').readAsStringSync().split(' ')[2] != 'Z';
+  } on FileSystemException {
+    return false;
+  }
+}
@@ -28,4 +28,90 @@ void main() {
     final results = await Future.wait(futures);
     expect(results.every((r) => r), isTrue);
   }, timeout: Timeout(Duration(seconds: 30)));
+
+  test('Concurrency: workspaces sharded across isolates', () async {
+    final manager = await WorkspaceManager.start(isolates: 2);
+    addTearDown(manager.close);
+
+    final workspaces =
+        await Future.wait(List.generate(6, (_) => manager.ephemeral()));
+    expect(manager.workspaceCount, 6);
+
+    final events = <WorkspaceEvent>[];
+    workspaces.first.onEvent.listen(events.add);
+
+    final results = await Future.wait([
+      for (var i = 0; i < workspaces.length; i++)
+        workspaces[i].exec('echo $i'),
+    ]);
+    for (var i = 0; i < results.length; i++) {
+      expect(results[i].stdout.trim(), equals('$i'));
+    }
+
+    final cmd = Platform.isWindows
+        ? 'for /L %i in (1,1,200) do @echo line %i'
+        : 'for i in \$(seq 1 200); do echo line \$i; done';
+    final process = await workspaces.last.execStream(cmd);
+    final lines = await process.stdout.join();
+    expect(await process.exitCode, 0);
+    expect(lines.trim().split('\n').last.trim(), equals('line 200'));
+
+    await workspaces.first.fs.writeFile('shared.txt', 'from caller');
+    final cat = await workspaces.first
+        .exec(Platform.isWindows ? 'type shared.txt' : 'cat shared.txt');
+    expect(cat.stdout.trim(), equals('from caller'));
+    expect(events.whereType<ProcessLifecycleEvent>(), isNotEmpty);
+
+    await workspaces.first.dispose();
+    expect(manager.workspaceCount, 5);
+  }, timeout: Timeout(Duration(seconds: 60)));
+
+  test('Concurrency: CPU spreads balance across manager isolates', () async {
+    final manager = await WorkspaceManager.start(isolates: 2);
+    addTearDown(manager.close);
+    const options = WorkspaceOptions(
+        priority: ProcessPriority(cpus: CpuSet.spread(width: 1)));
+
+    final workspaces = await Future.wait(
+        List.generate(2, (_) => manager.ephemeral(options: options)));
+    final results = await Future.wait([
+      for (final ws in workspaces)
+        ws.exec('grep Cpus_allowed_list /proc/self/status'),
+    ]);
+    final cpus = {for (final r in results) r.stdout.split(':').last.trim()};
+    expect(cpus, hasLength(2));
+  },
+      skip: !Platform.isLinux
+          ? 'affinity needs the Linux launcher'
+          : Platform.numberOfProcessors < 2
+              ? 'needs two CPUs'
+              : null);
+
+  test('Concurrency: fan-out across a workspace group', () async {
+    final group = await WorkspaceGroup.ephemeral(6, concurrency: 2);
+    addTearDown(group.dispose);
+    for (var i = 0; i < group.length; i += 2) {
+      await group.members[i].fs.writeFile('ok', '$i');
+    }
+
+    final streamed = <int>[];
+    await for (final member in group.execEach('sleep 0.2; cat ok')) {
+      streamed.add(member.index);
+      expect(member.workspace, same(group.members[member.index]));
+    }
+    expect(streamed..sort(), equals([0, 1, 2, 3, 4, 5]));
+
+    final summary = await group.exec('sleep 0.2; cat ok');
+    expect(summary.length, 6);
+    expect(summary.successCount, 3);
+    expect(summary.failures.map((r) => r.index), equals([1, 3, 5]));
+    expect(summary.results[2].result!.stdout, equals('2'));
+    // Three waves of two 200 ms commands.
+    expect(summary.elapsed, greaterThanOrEqualTo(Duration(milliseconds: 600)));
+    expect(summary.p50, greaterThanOrEqualTo(Duration(milliseconds: 200)));
+    expect(summary.p50, lessThanOrEqualTo(summary.p90));
+    expect(summary.percentile(100), equals(summary.maxLatency));
+  },
+      timeout: Timeout(Duration(seconds: 60)),
+      skip: Platform.isWindows ? 'uses sh commands' : null);
 }
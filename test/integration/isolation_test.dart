@@ -21,6 +21,126 @@ void main() {
       }
     });
 
+    test('Network: Should BLOCK with pooled namespaces', () async {
+      await NetworkNamespacePool.warmUp(size: 2);
+      final ws = Workspace.ephemeral(
+        options: const WorkspaceOptions(allowNetwork: false),
+      );
+
+      try {
+        final results = await Future.wait(List.generate(
+            4, (_) => ws.exec('curl --connect-timeout 2 https://google.com')));
+        for (final result in results) {
+          expect(result.exitCode, isNot(0));
+        }
+      } finally {
+        await ws.dispose();
+        await NetworkNamespacePool.shutdown();
+      }
+    }, testOn: 'linux');
+
+    test('Network: Should reuse the pooled namespace', () async {
+      final pool = await NetworkNamespacePool.warmUp(size: 1);
+      addTearDown(NetworkNamespacePool.shutdown);
+      if (pool == null || pool.idleCount == 0) {
+        markTestSkipped('user namespaces are unavailable');
+        return;
+      }
+      final ws = Workspace.ephemeral(
+        options: const WorkspaceOptions(allowNetwork: false),
+      );
+      addTearDown(ws.dispose);
+
+      Future<String> namespace() async {
+        // The lease is returned once the namespace has been reset.
+        while (pool.idleCount == 0) {
+          await Future<void>.delayed(const Duration(milliseconds: 10));
+        }
+        final result = await ws.exec('readlink /proc/self/ns/net');
+        expect(result.exitCode, 0, reason: result.stderr);
+        return result.stdout.trim();
+      }
+
+      final first = await namespace();
+      final second = await namespace();
+      expect(pool.leaseCount, 2);
+      // A fresh --unshare-net namespace would get a new inode every time.
+      expect(second, equals(first));
+      expect(first, startsWith('net:['));
+    }, testOn: 'linux');
+
+    test('Network: Lightweight profile should not lease pooled namespaces',
+        () async {
+      final pool = await NetworkNamespacePool.warmUp(size: 1);
+      addTearDown(NetworkNamespacePool.shutdown);
+      if (pool == null || pool.idleCount == 0) {
+        markTestSkipped('user namespaces are unavailable');
+        return;
+      }
+      final ws = Workspace.ephemeral(
+        options: const WorkspaceOptions(
+          allowNetwork: false,
+          sandboxProfile: SandboxProfile.lightweight,
+        ),
+      );
+      addTearDown(ws.dispose);
+
+      final result = await ws.exec('true');
+      expect(result.exitCode, 0, reason: result.stderr);
+      expect(pool.leaseCount, 0);
+      expect(pool.idleCount, 1);
+    }, testOn: 'linux');
+
+    test('Network: Should not leak leftover listeners between leases',
+        () async {
+      final pool = await NetworkNamespacePool.warmUp(size: 1);
+      addTearDown(NetworkNamespacePool.shutdown);
+      if (pool == null || pool.idleCount == 0) {
+        markTestSkipped('user namespaces are unavailable');
+        return;
+      }
+      final ws = Workspace.ephemeral(
+        options: const WorkspaceOptions(allowNetwork: false),
+      );
+      addTearDown(ws.dispose);
+
+      Future<void> leased() async {
+        while (pool.idleCount == 0) {
+          await Future<void>.delayed(const Duration(milliseconds: 10));
+        }
+      }
+
+      const probe = '''python3 -c "
+import socket
+try:
+    socket.create_connection(('127.0.0.1', 47123), timeout=1)
+    print('reachable')
+except OSError:
+    print('unreachable')
+"''';
+
+      // Leave a daemon listening on loopback behind in the first lease.
+      await leased();
+      final daemon = await ws.exec('''
+nohup python3 -c "
+import socket, time
+s = socket.socket()
+s.bind(('127.0.0.1', 47123))
+s.listen()
+time.sleep(30)
+" >/dev/null 2>&1 &
+sleep 0.5
+$probe''');
+      expect(daemon.exitCode, 0, reason: daemon.stderr);
+      expect(daemon.stdout.trim(), 'reachable');
+
+      await leased();
+      final result = await ws.exec(probe);
+      expect(result.exitCode, 0, reason: result.stderr);
+      expect(result.stdout.trim(), 'unreachable');
+      expect(pool.leaseCount, 2);
+    }, testOn: 'linux');
+
     test('Network: Should ALLOW when enabled', () async {
       final ws = Workspace.ephemeral(
         options: const WorkspaceOptions(allowNetwork: true),
@@ -95,4 +95,55 @@ except PermissionError:
       expect(stopwatch.elapsed.inSeconds, lessThan(6));
     });
   });
+
+  group('Linux Lightweight Profile Pentest', () {
+    late Workspace ws;
+
+    setUp(() {
+      ws = Workspace.ephemeral(
+        options: const WorkspaceOptions(
+          allowNetwork: false,
+          sandboxProfile: SandboxProfile.lightweight,
+        ),
+      );
+    });
+
+    tearDown(() async {
+      await ws.dispose();
+    });
+
+    test('Workspace stays writable', () async {
+      final result = await ws.exec('echo OK > probe.txt && cat probe.txt');
+      expect(result.stdout.trim(), equals('OK'));
+    });
+
+    test('Host filesystem is read-only', () async {
+      final home = Platform.environment['HOME'] ?? '/root';
+      final target = '$home/.ws_lightweight_probe';
+      await ws.exec('echo HACKED > $target');
+
+      final file = File(target);
+      if (await file.exists()) {
+        await file.delete();
+        fail('CRITICAL: Lightweight sandbox allowed a write outside the '
+            'workspace!');
+      }
+    });
+
+    test('Internet sockets are blocked', () async {
+      final cmd = '''python3 -c "
+import socket
+try:
+    socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    print('SOCKET_CREATED')
+except PermissionError:
+    print('BLOCKED')
+"''';
+
+      final result = await ws.exec(cmd);
+      if (result.stdout.contains('SOCKET_CREATED')) {
+        fail('CRITICAL: Socket creation allowed with network disabled!');
+      }
+    });
+  });
 }
@@ -0,0 +1,48 @@
+import 'package:test/test.dart';
+import 'package:workspace_sandbox/workspace_sandbox.dart';
+
+void main() {
+  group('diffText', () {
+    test('Should return no hunks for equal texts', () {
+      final diff = diffText('a\nb\n', 'a\nb\n');
+      expect(diff.isIdentical, isTrue);
+      expect(diff.unified, isEmpty);
+    });
+
+    test('Should produce unified output', () {
+      final diff = diffText('a\nb\nc\n', 'a\nx\nc\ny\n', context: 1);
+      expect(
+          diff.unified,
+          equals('--- a\n+++ b\n'
+              '@@ -1,3 +1,4 @@\n a\n-b\n+x\n c\n+y\n'));
+      expect(diff.additions, equals(2));
+      expect(diff.deletions, equals(1));
+    });
+
+    test('Should split distant changes into hunks', () {
+      final old = [for (var i = 0; i < 20; i++) 'line $i\n'];
+      final changed = List.of(old)
+        ..[2] = 'two\n'
+        ..[17] = 'seventeen\n';
+      final diff = diffText(old.join(), changed.join());
+
+      expect(diff.hunks, hasLength(2));
+      expect(diff.hunks[0].header, equals('@@ -1,6 +1,6 @@'));
+      expect(diff.hunks[1].header, equals('@@ -15,6 +15,6 @@'));
+      expect(diff.hunks[1].lines.map((l) => l.kind),
+          contains(DiffLineKind.added));
+    });
+
+    test('Should mark a missing trailing newline', () {
+      final diff = diffText('a\nb', 'a\nb\n');
+      expect(diff.hunks.single.lines.last.missingNewline, isFalse);
+      expect(diff.unified,
+          contains('-b\n\\ No newline at end of file\n+b\n'));
+    });
+
+    test('Should find a minimal diff', () {
+      final diff = diffText('a\nb\nc\na\nb\nb\na\n', 'c\nb\na\nb\na\nc\n');
+      expect(diff.additions + diff.deletions, equals(5));
+    });
+  });
+}